@@ -0,0 +1,876 @@
+/******************************************************************
+ *
+ *
+ * FILE        : analysis.c
+ * PROJECT     : chip8
+ * AUTHOR      : danpham
+ * DESCRIPTION : Static rom analysis.
+ *
+ *               The rom is walked from CPU_START_ADDRESS following
+ *               jumps, calls and both sides of skips, which marks
+ *               every reachable instruction; the walks are then cut
+ *               in basic blocks at every target. I is tracked along
+ *               a walk from Annn so sprite reads and Fx33/Fx55
+ *               writes can be placed; code that may be written is
+ *               self-modifying. Bnnn targets depend on V0 and are
+ *               only marked, not followed.
+ *
+ *               Results are kept in a process wide cache keyed by
+ *               rom content and profile, like the rom images.
+ *
+ ******************************************************************/
+
+/******************************************************************
+ * 1. Included files (microcontroller ones then user defined ones)
+ ******************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <SDL2/SDL.h>
+#include "analysis.h"
+#include "../import/import.h"
+
+/******************************************************************
+ * 2. Define declarations (macros then function macros)
+ ******************************************************************/
+#define ANALYSIS_LONG_I_OPCODE                                0xF000U
+
+/* Bnnn adds a register value to its base */
+#define ANALYSIS_INDIRECT_RANGE                                 256U
+
+/* Decoded flow of one instruction, ANALYSIS_END_* otherwise */
+#define ANALYSIS_FLOW_NEXT                                     0xFFU
+
+/******************************************************************
+ * 3. Typedef definitions (simple typedef, then enum and structs)
+ ******************************************************************/
+typedef struct
+{
+    U16 opCode;
+    U8 length;
+    U8 flow;                        /* ANALYSIS_FLOW_NEXT or ANALYSIS_END_* */
+    U16 target;                     /* Jump or call target */
+    BOOL valid;
+} analysisInstructionType;
+
+typedef struct
+{
+    SDL_SpinLock lock;
+    analysisType **entries;
+    U32 count;
+    U32 capacity;
+} analysisCacheType;
+
+/******************************************************************
+ * 4. Variable definitions (static then global)
+ ******************************************************************/
+static analysisCacheType s_analysisCache;
+
+/******************************************************************
+ * 5. Functions prototypes (static only)
+ ******************************************************************/
+static analysisType * analysisBuild(const U8 *rom, U32 size, cpuProfileType profile, U64 hash);
+static void analysisWalk(analysisType *analysis, U16 *pending, U32 *pendingCount);
+static void analysisTrackI(analysisType *analysis, U16 address, const analysisInstructionType *instruction,
+                           BOOL *iKnown, U16 *i);
+static void analysisMark(analysisType *analysis, U32 address, U32 count, U8 flag);
+static void analysisLeader(analysisType *analysis, U32 address, U8 flag, U16 *pending, U32 *pendingCount);
+static Std_ReturnType analysisBlocks(analysisType *analysis);
+static void analysisDecode(const U8 *memory, U32 memorySize, U32 address, cpuProfileType profile,
+                           analysisInstructionType *instruction);
+static void analysisFree(analysisType *analysis);
+
+/******************************************************************
+ * FUNCTION : AnalysisGet()
+ *    Description: Analysis of a rom, computed on the first call for
+ *                 a content and profile
+ *    Parameters:  rom, size: rom bytes
+ *                 profile: instruction set
+ *    Return:      Analysis, valid until AnalysisExit(), NULL on
+ *                 error
+ ******************************************************************/
+const analysisType * AnalysisGet(const U8 *rom, U32 size, cpuProfileType profile)
+{
+    U64 hash = ImportHash(IMPORT_HASH_OFFSET, rom, size);
+    analysisType *analysis = NULL;
+    analysisType *built;
+    analysisType **entries;
+    U32 capacity;
+    U32 i;
+
+    SDL_AtomicLock(&s_analysisCache.lock);
+    for (i = 0U; i < s_analysisCache.count; i++)
+    {
+        analysis = s_analysisCache.entries[i];
+        if ((analysis->hash == hash) && (analysis->romSize == size) && (analysis->profile == profile)
+            && (0 == memcmp(&analysis->memory[CPU_START_ADDRESS], rom, size)))
+        {
+            break;
+        }
+        analysis = NULL;
+    }
+    SDL_AtomicUnlock(&s_analysisCache.lock);
+
+    if (NULL != analysis)
+    {
+        return analysis;
+    }
+
+    /* Built outside the lock, a concurrent build of the same rom is
+     * dropped below */
+    built = analysisBuild(rom, size, profile, hash);
+    if (NULL == built)
+    {
+        return NULL;
+    }
+
+    SDL_AtomicLock(&s_analysisCache.lock);
+    for (i = 0U; i < s_analysisCache.count; i++)
+    {
+        analysis = s_analysisCache.entries[i];
+        if ((analysis->hash == hash) && (analysis->romSize == size) && (analysis->profile == profile)
+            && (0 == memcmp(&analysis->memory[CPU_START_ADDRESS], rom, size)))
+        {
+            break;
+        }
+        analysis = NULL;
+    }
+
+    if (NULL == analysis)
+    {
+        if (s_analysisCache.count == s_analysisCache.capacity)
+        {
+            capacity = (0U == s_analysisCache.capacity) ? 8U : (2U * s_analysisCache.capacity);
+            entries = (analysisType **)realloc(s_analysisCache.entries, capacity * sizeof(analysisType *));
+            if (NULL != entries)
+            {
+                s_analysisCache.entries = entries;
+                s_analysisCache.capacity = capacity;
+            }
+        }
+
+        if (s_analysisCache.count < s_analysisCache.capacity)
+        {
+            s_analysisCache.entries[s_analysisCache.count] = built;
+            s_analysisCache.count++;
+            analysis = built;
+            built = NULL;
+        }
+    }
+    SDL_AtomicUnlock(&s_analysisCache.lock);
+
+    analysisFree(built);
+
+    return analysis;
+}
+
+/******************************************************************
+ * FUNCTION : AnalysisDisassemble()
+ *    Description: Disassemble one instruction
+ *    Parameters:  memory, memorySize: memory holding the rom
+ *                 address: instruction address
+ *                 profile: instruction set
+ *                 text: output, ANALYSIS_TEXT_SIZE bytes are enough
+ *                 textSize: bytes of text
+ *    Return:      Instruction length in bytes
+ ******************************************************************/
+U16 AnalysisDisassemble(const U8 *memory, U32 memorySize, U16 address, cpuProfileType profile,
+                        char *text, U32 textSize)
+{
+    static const char *s_alu[16] = {
+        "LD", "OR", "AND", "XOR", "ADD", "SUB", "SHR", "SUBN", NULL, NULL, NULL, NULL, NULL, NULL, "SHL", NULL
+    };
+    analysisInstructionType instruction;
+    U16 op;
+    U8 x;
+    U8 y;
+    U8 kk;
+    U16 nnn;
+
+    analysisDecode(memory, memorySize, address, profile, &instruction);
+    op = instruction.opCode;
+    x = (U8)((op >> 8U) & 0x0FU);
+    y = (U8)((op >> 4U) & 0x0FU);
+    kk = (U8)(op & 0xFFU);
+    nnn = (U16)(op & 0x0FFFU);
+
+    if (FALSE == instruction.valid)
+    {
+        (void)snprintf(text, textSize, "DW   0x%04X", op);
+        return instruction.length;
+    }
+
+    switch (op >> 12U)
+    {
+    case 0x0:
+        if (0x00E0U == op)
+        {
+            (void)snprintf(text, textSize, "CLS");
+        }
+        else if (0x00EEU == op)
+        {
+            (void)snprintf(text, textSize, "RET");
+        }
+        else if (0x00C0U == (op & 0xFFF0U))
+        {
+            (void)snprintf(text, textSize, "SCD  %u", op & 0x0FU);
+        }
+        else if (0x00D0U == (op & 0xFFF0U))
+        {
+            (void)snprintf(text, textSize, "SCU  %u", op & 0x0FU);
+        }
+        else
+        {
+            (void)snprintf(text, textSize, "%s", (0x00FBU == op) ? "SCR" : ((0x00FCU == op) ? "SCL"
+                                                 : ((0x00FDU == op) ? "EXIT" : ((0x00FEU == op) ? "LOW" : "HIGH"))));
+        }
+        break;
+    case 0x1:
+        (void)snprintf(text, textSize, "JP   0x%03X", nnn);
+        break;
+    case 0x2:
+        (void)snprintf(text, textSize, "CALL 0x%03X", nnn);
+        break;
+    case 0x3:
+        (void)snprintf(text, textSize, "SE   V%X, 0x%02X", x, kk);
+        break;
+    case 0x4:
+        (void)snprintf(text, textSize, "SNE  V%X, 0x%02X", x, kk);
+        break;
+    case 0x5:
+        (void)snprintf(text, textSize, (0U == (op & 0x0FU)) ? "SE   V%X, V%X"
+                                       : ((2U == (op & 0x0FU)) ? "SAVE V%X-V%X" : "LOAD V%X-V%X"), x, y);
+        break;
+    case 0x6:
+        (void)snprintf(text, textSize, "LD   V%X, 0x%02X", x, kk);
+        break;
+    case 0x7:
+        (void)snprintf(text, textSize, "ADD  V%X, 0x%02X", x, kk);
+        break;
+    case 0x8:
+        if (NULL != s_alu[op & 0x0FU])
+        {
+            (void)snprintf(text, textSize, "%-4s V%X, V%X", s_alu[op & 0x0FU], x, y);
+        }
+        else
+        {
+            (void)snprintf(text, textSize, "DW   0x%04X", op);
+        }
+        break;
+    case 0x9:
+        (void)snprintf(text, textSize, "SNE  V%X, V%X", x, y);
+        break;
+    case 0xA:
+        (void)snprintf(text, textSize, "LD   I, 0x%03X", nnn);
+        break;
+    case 0xB:
+        if (E_CPU_PROFILE_VIP == profile)
+        {
+            (void)snprintf(text, textSize, "JP   V0, 0x%03X", nnn);
+        }
+        else
+        {
+            (void)snprintf(text, textSize, "JP   V%X, 0x%03X", x, nnn);
+        }
+        break;
+    case 0xC:
+        (void)snprintf(text, textSize, "RND  V%X, 0x%02X", x, kk);
+        break;
+    case 0xD:
+        (void)snprintf(text, textSize, "DRW  V%X, V%X, %u", x, y, op & 0x0FU);
+        break;
+    case 0xE:
+        (void)snprintf(text, textSize, "%s V%X", (0x9EU == kk) ? "SKP " : "SKNP", x);
+        break;
+    case 0xF:
+    default:
+        switch (kk)
+        {
+        case 0x00:
+            (void)snprintf(text, textSize, "LD   I, 0x%04X",
+                           (U16)((memory[(address + 2U) % memorySize] << 8U) + memory[(address + 3U) % memorySize]));
+            break;
+        case 0x01:
+            (void)snprintf(text, textSize, "PLN  %u", x);
+            break;
+        case 0x07:
+            (void)snprintf(text, textSize, "LD   V%X, DT", x);
+            break;
+        case 0x0A:
+            (void)snprintf(text, textSize, "LD   V%X, K", x);
+            break;
+        case 0x15:
+            (void)snprintf(text, textSize, "LD   DT, V%X", x);
+            break;
+        case 0x18:
+            (void)snprintf(text, textSize, "LD   ST, V%X", x);
+            break;
+        case 0x1E:
+            (void)snprintf(text, textSize, "ADD  I, V%X", x);
+            break;
+        case 0x29:
+            (void)snprintf(text, textSize, "LD   F, V%X", x);
+            break;
+        case 0x30:
+            (void)snprintf(text, textSize, "LD   HF, V%X", x);
+            break;
+        case 0x33:
+            (void)snprintf(text, textSize, "LD   B, V%X", x);
+            break;
+        case 0x55:
+            (void)snprintf(text, textSize, "LD   [I], V%X", x);
+            break;
+        case 0x65:
+            (void)snprintf(text, textSize, "LD   V%X, [I]", x);
+            break;
+        case 0x75:
+            (void)snprintf(text, textSize, "LD   R, V%X", x);
+            break;
+        case 0x85:
+            (void)snprintf(text, textSize, "LD   V%X, R", x);
+            break;
+        default:
+            (void)snprintf(text, textSize, "DW   0x%04X", op);
+            break;
+        }
+        break;
+    }
+
+    return instruction.length;
+}
+
+/******************************************************************
+ * FUNCTION : AnalysisFindBlock()
+ *    Description: Block holding an address
+ *    Parameters:  analysis: analysis
+ *                 address: address
+ *    Return:      Block, NULL if the address is not reachable code
+ ******************************************************************/
+const analysisBlockType * AnalysisFindBlock(const analysisType *analysis, U16 address)
+{
+    U32 low = 0U;
+    U32 high = analysis->blockCount;
+    U32 middle;
+
+    /* Blocks are sorted and do not overlap */
+    while (low < high)
+    {
+        middle = (low + high) / 2U;
+        if (address < analysis->blocks[middle].start)
+        {
+            high = middle;
+        }
+        else if (address >= analysis->blocks[middle].end)
+        {
+            low = middle + 1U;
+        }
+        else
+        {
+            return &analysis->blocks[middle];
+        }
+    }
+
+    return NULL;
+}
+
+/******************************************************************
+ * FUNCTION : AnalysisExit()
+ *    Description: Release every cached analysis
+ *    Parameters:  None
+ *    Return:      None
+ ******************************************************************/
+void AnalysisExit(void)
+{
+    U32 i;
+
+    SDL_AtomicLock(&s_analysisCache.lock);
+    for (i = 0U; i < s_analysisCache.count; i++)
+    {
+        analysisFree(s_analysisCache.entries[i]);
+    }
+    free(s_analysisCache.entries);
+    s_analysisCache.entries = NULL;
+    s_analysisCache.count = 0U;
+    s_analysisCache.capacity = 0U;
+    SDL_AtomicUnlock(&s_analysisCache.lock);
+}
+
+/******************************************************************
+ * FUNCTION : analysisBuild()
+ *    Description: Analyse a rom
+ *    Parameters:  rom, size: rom bytes
+ *                 profile: instruction set
+ *                 hash: content hash
+ *    Return:      Analysis, NULL on error
+ ******************************************************************/
+static analysisType * analysisBuild(const U8 *rom, U32 size, cpuProfileType profile, U64 hash)
+{
+    analysisType *analysis;
+    U16 *pending;
+    U32 pendingCount = 0U;
+    U32 address;
+
+    analysis = (analysisType *)calloc(1U, sizeof(analysisType));
+    if (NULL == analysis)
+    {
+        return NULL;
+    }
+
+    analysis->hash = hash;
+    analysis->romSize = size;
+    analysis->profile = profile;
+    analysis->memorySize = (E_CPU_PROFILE_XOCHIP == profile) ? CPU_XO_MEMORY_SIZE : CPU_MEMORY_SIZE;
+    analysis->memory = (U8 *)calloc(analysis->memorySize, 1U);
+    analysis->flags = (U8 *)calloc(analysis->memorySize, 1U);
+
+    /* Every instruction pushes at most two targets */
+    pending = (U16 *)malloc((analysis->memorySize + 2U) * sizeof(U16));
+
+    if ((NULL == analysis->memory) || (NULL == analysis->flags) || (NULL == pending) || (0U == size)
+        || (size > (analysis->memorySize - CPU_START_ADDRESS)))
+    {
+        free(pending);
+        analysisFree(analysis);
+        return NULL;
+    }
+
+    (void)memcpy(&analysis->memory[CPU_START_ADDRESS], rom, size);
+
+    analysisLeader(analysis, CPU_START_ADDRESS, ANALYSIS_BLOCK, pending, &pendingCount);
+    analysisWalk(analysis, pending, &pendingCount);
+    free(pending);
+
+    for (address = 0U; address < analysis->memorySize; address++)
+    {
+        if ((0U != (analysis->flags[address] & ANALYSIS_WRITTEN))
+            && (0U != (analysis->flags[address] & (ANALYSIS_CODE | ANALYSIS_OPERAND))))
+        {
+            analysis->selfModifying = TRUE;
+        }
+    }
+
+    if (E_OK != analysisBlocks(analysis))
+    {
+        analysisFree(analysis);
+        return NULL;
+    }
+
+    return analysis;
+}
+
+/******************************************************************
+ * FUNCTION : analysisWalk()
+ *    Description: Follow every pending target until the code
+ *                 reached is already known
+ *    Parameters:  analysis: analysis
+ *                 pending, pendingCount: targets to walk
+ *    Return:      None
+ ******************************************************************/
+static void analysisWalk(analysisType *analysis, U16 *pending, U32 *pendingCount)
+{
+    analysisInstructionType instruction;
+    analysisInstructionType next;
+    U32 address;
+    BOOL iKnown;
+    U16 i;
+
+    while (*pendingCount > 0U)
+    {
+        (*pendingCount)--;
+        address = pending[*pendingCount];
+        iKnown = FALSE;
+        i = 0U;
+
+        for (;;)
+        {
+            if ((address + 1U) >= analysis->memorySize)
+            {
+                break;
+            }
+
+            /* Joined a walk done before, which is cut here */
+            if (0U != (analysis->flags[address] & ANALYSIS_CODE))
+            {
+                analysis->flags[address] |= ANALYSIS_BLOCK;
+                break;
+            }
+
+            analysisDecode(analysis->memory, analysis->memorySize, address, analysis->profile, &instruction);
+            analysis->flags[address] |= ANALYSIS_CODE;
+            analysisMark(analysis, address + 1U, instruction.length - 1U, ANALYSIS_OPERAND);
+            analysis->instructionCount++;
+
+            if (FALSE == instruction.valid)
+            {
+                analysis->flags[address] |= ANALYSIS_INVALID;
+                break;
+            }
+
+            analysisTrackI(analysis, (U16)address, &instruction, &iKnown, &i);
+
+            if (ANALYSIS_FLOW_NEXT == instruction.flow)
+            {
+                address += instruction.length;
+                continue;
+            }
+
+            switch (instruction.flow)
+            {
+            case ANALYSIS_END_JUMP:
+                analysisLeader(analysis, instruction.target, ANALYSIS_BLOCK, pending, pendingCount);
+                break;
+            case ANALYSIS_END_CALL:
+                analysisLeader(analysis, instruction.target, ANALYSIS_BLOCK | ANALYSIS_CALL, pending, pendingCount);
+                analysisLeader(analysis, address + instruction.length, ANALYSIS_BLOCK, pending, pendingCount);
+                break;
+            case ANALYSIS_END_BRANCH:
+                /* A skip jumps over a whole F000 nnnn */
+                analysisDecode(analysis->memory, analysis->memorySize, address + instruction.length, analysis->profile,
+                               &next);
+                analysisLeader(analysis, address + instruction.length, ANALYSIS_BLOCK, pending, pendingCount);
+                analysisLeader(analysis, address + instruction.length + next.length, ANALYSIS_BLOCK, pending,
+                               pendingCount);
+                break;
+            case ANALYSIS_END_INDIRECT:
+                analysisMark(analysis, instruction.target, ANALYSIS_INDIRECT_RANGE, ANALYSIS_INDIRECT);
+                analysis->indirect = TRUE;
+                break;
+            case ANALYSIS_END_RETURN:
+            case ANALYSIS_END_STOP:
+            default:
+                break;
+            }
+            break;
+        }
+    }
+}
+
+/******************************************************************
+ * FUNCTION : analysisTrackI()
+ *    Description: Follow I along a walk and mark what it reads and
+ *                 writes while known
+ *    Parameters:  analysis: analysis
+ *                 address: instruction address
+ *                 instruction: decoded instruction
+ *                 iKnown, i: I state, updated
+ *    Return:      None
+ ******************************************************************/
+static void analysisTrackI(analysisType *analysis, U16 address, const analysisInstructionType *instruction,
+                           BOOL *iKnown, U16 *i)
+{
+    U16 op = instruction->opCode;
+    U8 x = (U8)((op >> 8U) & 0x0FU);
+    U8 y = (U8)((op >> 4U) & 0x0FU);
+    U32 rows;
+
+    switch (op >> 12U)
+    {
+    case 0xA:
+        *iKnown = TRUE;
+        *i = (U16)(op & 0x0FFFU);
+        break;
+    case 0x5:
+        /* 5xy2 saves, 5xy3 loads a register range */
+        if (FALSE == *iKnown)
+        {
+            analysis->unknownWrites = (analysis->unknownWrites || (2U == (op & 0x0FU))) ? TRUE : FALSE;
+        }
+        else if ((2U == (op & 0x0FU)) || (3U == (op & 0x0FU)))
+        {
+            analysisMark(analysis, *i, (U32)((x > y) ? (x - y) : (y - x)) + 1U,
+                         (2U == (op & 0x0FU)) ? ANALYSIS_WRITTEN : ANALYSIS_READ);
+        }
+        break;
+    case 0xD:
+        if (FALSE != *iKnown)
+        {
+            /* Dxy0 is a 16x16 sprite past VIP, every plane reads its own sprite */
+            rows = ((0U == (op & 0x0FU)) && (E_CPU_PROFILE_VIP != analysis->profile)) ? 32U : (U32)(op & 0x0FU);
+            analysisMark(analysis, *i, (E_CPU_PROFILE_XOCHIP == analysis->profile) ? (2U * rows) : rows,
+                         ANALYSIS_READ);
+        }
+        break;
+    case 0xF:
+        if (ANALYSIS_LONG_I_OPCODE == op)
+        {
+            *iKnown = TRUE;
+            *i = (U16)((analysis->memory[address + 2U] << 8U) + analysis->memory[address + 3U]);
+        }
+        else if ((0x33U == (op & 0xFFU)) || (0x55U == (op & 0xFFU)) || (0x65U == (op & 0xFFU)))
+        {
+            if (FALSE == *iKnown)
+            {
+                analysis->unknownWrites = (analysis->unknownWrites || (0x65U != (op & 0xFFU))) ? TRUE : FALSE;
+            }
+            else
+            {
+                analysisMark(analysis, *i, (0x33U == (op & 0xFFU)) ? 3U : ((U32)x + 1U),
+                             (0x65U == (op & 0xFFU)) ? ANALYSIS_READ : ANALYSIS_WRITTEN);
+            }
+
+            /* The increment depends on the quirks, stop tracking */
+            if (0x33U != (op & 0xFFU))
+            {
+                *iKnown = FALSE;
+            }
+        }
+        else if ((0x1EU == (op & 0xFFU)) || (0x29U == (op & 0xFFU)) || (0x30U == (op & 0xFFU)))
+        {
+            *iKnown = FALSE;
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+/******************************************************************
+ * FUNCTION : analysisMark()
+ *    Description: Flag a range of memory, clipped to the memory
+ *    Parameters:  analysis: analysis
+ *                 address, count: range
+ *                 flag: ANALYSIS_* to set
+ *    Return:      None
+ ******************************************************************/
+static void analysisMark(analysisType *analysis, U32 address, U32 count, U8 flag)
+{
+    U32 k;
+
+    for (k = 0U; (k < count) && ((address + k) < analysis->memorySize); k++)
+    {
+        analysis->flags[address + k] |= flag;
+    }
+}
+
+/******************************************************************
+ * FUNCTION : analysisLeader()
+ *    Description: Flag a target and queue it unless already walked
+ *    Parameters:  analysis: analysis
+ *                 address: target
+ *                 flag: ANALYSIS_BLOCK, with ANALYSIS_CALL for calls
+ *                 pending, pendingCount: targets to walk
+ *    Return:      None
+ ******************************************************************/
+static void analysisLeader(analysisType *analysis, U32 address, U8 flag, U16 *pending, U32 *pendingCount)
+{
+    if (address >= analysis->memorySize)
+    {
+        return;
+    }
+
+    analysis->flags[address] |= flag;
+    if ((0U == (analysis->flags[address] & ANALYSIS_CODE)) && (*pendingCount <= analysis->memorySize))
+    {
+        pending[*pendingCount] = (U16)address;
+        (*pendingCount)++;
+    }
+}
+
+/******************************************************************
+ * FUNCTION : analysisBlocks()
+ *    Description: Cut the reachable code in basic blocks
+ *    Parameters:  analysis: analysis
+ *    Return:      E_OK, E_NOT_OK if out of memory
+ ******************************************************************/
+static Std_ReturnType analysisBlocks(analysisType *analysis)
+{
+    analysisInstructionType instruction;
+    analysisInstructionType next;
+    analysisBlockType *block;
+    U32 address;
+    U32 end;
+    U32 count = 0U;
+
+    for (address = 0U; address < analysis->memorySize; address++)
+    {
+        if ((ANALYSIS_CODE | ANALYSIS_BLOCK) == (analysis->flags[address] & (ANALYSIS_CODE | ANALYSIS_BLOCK)))
+        {
+            count++;
+        }
+    }
+
+    analysis->blocks = (analysisBlockType *)calloc((0U == count) ? 1U : count, sizeof(analysisBlockType));
+    if (NULL == analysis->blocks)
+    {
+        return E_NOT_OK;
+    }
+
+    for (address = 0U; address < analysis->memorySize; address++)
+    {
+        if ((ANALYSIS_CODE | ANALYSIS_BLOCK) != (analysis->flags[address] & (ANALYSIS_CODE | ANALYSIS_BLOCK)))
+        {
+            continue;
+        }
+
+        block = &analysis->blocks[analysis->blockCount];
+        analysis->blockCount++;
+        block->start = (U16)address;
+        block->last = (U16)address;
+
+        for (;;)
+        {
+            analysisDecode(analysis->memory, analysis->memorySize, block->last, analysis->profile, &instruction);
+            end = (U32)block->last + instruction.length;
+            block->end = (U16)end;
+
+            if (FALSE == instruction.valid)
+            {
+                block->kind = ANALYSIS_END_STOP;
+                break;
+            }
+            if (ANALYSIS_FLOW_NEXT != instruction.flow)
+            {
+                block->kind = instruction.flow;
+                break;
+            }
+
+            /* Falls into the next block, or runs off the code */
+            if ((end >= analysis->memorySize) || (0U == (analysis->flags[end] & ANALYSIS_CODE)))
+            {
+                block->kind = ANALYSIS_END_STOP;
+                break;
+            }
+            if (0U != (analysis->flags[block->end] & ANALYSIS_BLOCK))
+            {
+                block->kind = ANALYSIS_END_FALLTHROUGH;
+                break;
+            }
+            block->last = block->end;
+        }
+
+        switch (block->kind)
+        {
+        case ANALYSIS_END_JUMP:
+            block->successors[0U] = instruction.target;
+            block->successorCount = 1U;
+            break;
+        case ANALYSIS_END_CALL:
+            block->successors[0U] = instruction.target;
+            block->successors[1U] = block->end;
+            block->successorCount = 2U;
+            break;
+        case ANALYSIS_END_BRANCH:
+            analysisDecode(analysis->memory, analysis->memorySize, block->end, analysis->profile, &next);
+            block->successors[0U] = block->end;
+            block->successors[1U] = (U16)(block->end + next.length);
+            block->successorCount = 2U;
+            break;
+        case ANALYSIS_END_FALLTHROUGH:
+            block->successors[0U] = block->end;
+            block->successorCount = 1U;
+            break;
+        default:
+            break;
+        }
+    }
+
+    return E_OK;
+}
+
+/******************************************************************
+ * FUNCTION : analysisDecode()
+ *    Description: Decode the length, validity and flow of one
+ *                 instruction, with the opcode table of cpu.c
+ *    Parameters:  memory, memorySize: memory
+ *                 address: instruction address
+ *                 profile: instruction set
+ *                 instruction: output
+ *    Return:      None
+ ******************************************************************/
+static void analysisDecode(const U8 *memory, U32 memorySize, U32 address, cpuProfileType profile,
+                           analysisInstructionType *instruction)
+{
+    U16 op = (U16)((memory[address % memorySize] << 8U) + memory[(address + 1U) % memorySize]);
+    BOOL schip = (E_CPU_PROFILE_VIP != profile) ? TRUE : FALSE;
+    BOOL xochip = (E_CPU_PROFILE_XOCHIP == profile) ? TRUE : FALSE;
+
+    instruction->opCode = op;
+    instruction->length = ((FALSE != xochip) && (ANALYSIS_LONG_I_OPCODE == op)) ? 4U : 2U;
+    instruction->flow = ANALYSIS_FLOW_NEXT;
+    instruction->target = (U16)(op & 0x0FFFU);
+    instruction->valid = TRUE;
+
+    switch (op >> 12U)
+    {
+    case 0x0:
+        if (0x00EEU == op)
+        {
+            instruction->flow = ANALYSIS_END_RETURN;
+        }
+        else if ((FALSE != schip) && (0x00FDU == op))
+        {
+            instruction->flow = ANALYSIS_END_STOP;
+        }
+        else if (0x00E0U != op)
+        {
+            /* Scrolls and resolution past VIP, scroll up on XO-CHIP */
+            instruction->valid = (((FALSE != schip)
+                                   && ((0x00C0U == (op & 0xFFF0U)) || ((op >= 0x00FBU) && (op <= 0x00FFU))))
+                                  || ((FALSE != xochip) && (0x00D0U == (op & 0xFFF0U)))) ? TRUE : FALSE;
+        }
+        break;
+    case 0x1:
+        instruction->flow = ANALYSIS_END_JUMP;
+        break;
+    case 0x2:
+        instruction->flow = ANALYSIS_END_CALL;
+        break;
+    case 0x3:
+    case 0x4:
+        instruction->flow = ANALYSIS_END_BRANCH;
+        break;
+    case 0x5:
+        if (0U == (op & 0x0FU))
+        {
+            instruction->flow = ANALYSIS_END_BRANCH;
+        }
+        else if ((FALSE == xochip) || ((2U != (op & 0x0FU)) && (3U != (op & 0x0FU))))
+        {
+            instruction->valid = FALSE;
+        }
+        break;
+    case 0x9:
+        if (0U == (op & 0x0FU))
+        {
+            instruction->flow = ANALYSIS_END_BRANCH;
+        }
+        else
+        {
+            instruction->valid = FALSE;
+        }
+        break;
+    case 0xB:
+        instruction->flow = ANALYSIS_END_INDIRECT;
+        break;
+    case 0xE:
+        if ((0x9EU == (op & 0xFFU)) || (0xA1U == (op & 0xFFU)))
+        {
+            instruction->flow = ANALYSIS_END_BRANCH;
+        }
+        else
+        {
+            instruction->valid = FALSE;
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+/******************************************************************
+ * FUNCTION : analysisFree()
+ *    Description: Release an analysis
+ *    Parameters:  analysis: analysis, may be NULL
+ *    Return:      None
+ ******************************************************************/
+static void analysisFree(analysisType *analysis)
+{
+    if (NULL != analysis)
+    {
+        free(analysis->memory);
+        free(analysis->flags);
+        free(analysis->blocks);
+        free(analysis);
+    }
+}
+
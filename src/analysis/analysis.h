@@ -0,0 +1,96 @@
+/******************************************************************
+ *
+ *
+ * FILE        : analysis.h
+ * PROJECT     : chip8
+ * AUTHOR      : danpham
+ * DESCRIPTION : Static rom analysis: control flow graph, code and
+ *               data map, disassembly
+ *
+ ******************************************************************/
+#ifndef ANALYSIS_H_
+#define ANALYSIS_H_
+
+/******************************************************************
+ * 1. Included files (microcontroller ones then user defined ones)
+ ******************************************************************/
+#include "../headers/typedef.h"
+#include "../cpu/cpu.h"
+
+/******************************************************************
+ * 2. Define declarations (macros then function macros)
+ ******************************************************************/
+/* Flags of a memory byte:
+ * CODE      first byte of a reachable instruction
+ * OPERAND   other byte of a reachable instruction
+ * BLOCK     first instruction of a block
+ * CALL      subroutine entry
+ * INDIRECT  may be reached by Bnnn
+ * READ      read through I by a sprite or Fx65
+ * WRITTEN   written through I by Fx33 or Fx55
+ * INVALID   invalid opcode on a reachable path */
+#define ANALYSIS_CODE                                          0x01U
+#define ANALYSIS_OPERAND                                       0x02U
+#define ANALYSIS_BLOCK                                         0x04U
+#define ANALYSIS_CALL                                          0x08U
+#define ANALYSIS_INDIRECT                                      0x10U
+#define ANALYSIS_READ                                          0x20U
+#define ANALYSIS_WRITTEN                                       0x40U
+#define ANALYSIS_INVALID                                       0x80U
+
+/* How a block ends: jump, skip (next or one after), call, return,
+ * Bnnn, stop (00FD, invalid opcode, end of memory) or fall through
+ * the next block */
+#define ANALYSIS_END_JUMP                                         0U
+#define ANALYSIS_END_BRANCH                                       1U
+#define ANALYSIS_END_CALL                                         2U
+#define ANALYSIS_END_RETURN                                       3U
+#define ANALYSIS_END_INDIRECT                                     4U
+#define ANALYSIS_END_STOP                                         5U
+#define ANALYSIS_END_FALLTHROUGH                                  6U
+
+#define ANALYSIS_TEXT_SIZE                                       32U
+
+/******************************************************************
+ * 3. Typedef definitions (simple typedef, then enum and structs)
+ ******************************************************************/
+typedef struct
+{
+    U16 start;
+    U16 end;                        /* Address after the last instruction */
+    U16 last;                       /* Address of the last instruction */
+    U8 kind;                        /* ANALYSIS_END_* */
+    U8 successorCount;
+    U16 successors[2];
+} analysisBlockType;
+
+typedef struct
+{
+    U64 hash;
+    U32 romSize;
+    cpuProfileType profile;
+    U32 memorySize;
+    U8 *memory;                     /* Rom at CPU_START_ADDRESS, zeros elsewhere */
+    U8 *flags;                      /* memorySize entries of ANALYSIS_* */
+    analysisBlockType *blocks;      /* By address */
+    U32 blockCount;
+    U32 instructionCount;
+    BOOL indirect;                  /* Bnnn reached, its targets are not followed */
+    BOOL unknownWrites;             /* Fx33 or Fx55 with I unknown */
+    BOOL selfModifying;             /* Code bytes may be written */
+} analysisType;
+
+/******************************************************************
+ * 4. Variable definitions (static then global)
+ ******************************************************************/
+
+/******************************************************************
+ * 5. Functions prototypes (static only)
+ ******************************************************************/
+extern const analysisType * AnalysisGet(const U8 *rom, U32 size, cpuProfileType profile);
+extern U16 AnalysisDisassemble(const U8 *memory, U32 memorySize, U16 address, cpuProfileType profile,
+                               char *text, U32 textSize);
+extern const analysisBlockType * AnalysisFindBlock(const analysisType *analysis, U16 address);
+extern void AnalysisExit(void);
+
+#endif /* ANALYSIS_H_ */
@@ -0,0 +1,631 @@
+/******************************************************************
+ *
+ *
+ * FILE        : bench.c
+ * PROJECT     : chip8
+ * AUTHOR      : danpham
+ * DESCRIPTION : Micro-benchmarks of the cpu core, the draw path
+ *               and the headless frame loop
+ *
+ ******************************************************************/
+
+/******************************************************************
+ * 1. Included files (microcontroller ones then user defined ones)
+ ******************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <SDL2/SDL.h>
+#include "../cpu/cpu.h"
+#include "../display/display.h"
+#include "../import/import.h"
+#include "../input/input.h"
+
+/******************************************************************
+ * 2. Define declarations (macros then function macros)
+ ******************************************************************/
+#define BENCH_MAX_RUNS                                           64U
+#define BENCH_MAX_WARMUP                                         64U
+#define BENCH_MAX_CASES                                          32U
+#define BENCH_DEFAULT_RUNS                                       10U
+#define BENCH_DEFAULT_WARMUP                                      3U
+#define BENCH_NAME_SIZE                                          96U
+
+#define BENCH_CPU_INSTRUCTIONS                              4000000UL
+#define BENCH_DRAW_CALLS                                    1000000UL
+#define BENCH_FRAMES                                         200000UL
+#define BENCH_RUN_FRAMES                                     400000UL
+
+/* Instructions executed per emulated frame in the headless loop */
+#define BENCH_FRAME_INSTRUCTIONS                CPU_INSTRUCTIONS_PER_FRAME
+
+#define BENCH_PIXEL_ALPHA                                0xFF000000UL
+
+/******************************************************************
+ * 3. Typedef definitions (simple typedef, then enum and structs)
+ ******************************************************************/
+typedef enum
+{
+    E_BENCH_CPU,
+    E_BENCH_STEP,
+    E_BENCH_RUN,
+    E_BENCH_DRAW,
+    E_BENCH_FRAME
+} benchKindType;
+
+typedef struct
+{
+    const char *name;
+    const U8 *program;
+    U16 size;
+} benchProgramType;
+
+typedef struct
+{
+    U8 x;
+    U8 y;
+    U8 n;
+} benchDrawType;
+
+typedef struct
+{
+    char name[BENCH_NAME_SIZE];
+    const char *unit;
+    U8 runs;
+    double samples[BENCH_MAX_RUNS];
+    double median;
+    double mean;
+    double min;
+    double max;
+    double stddev;
+} benchResultType;
+
+typedef struct
+{
+    U8 runs;
+    U8 warmup;
+    const char *jsonPath;
+    U8 resultCount;
+    benchResultType results[BENCH_MAX_CASES];
+} benchType;
+
+/******************************************************************
+ * 4. Variable definitions (static then global)
+ ******************************************************************/
+static benchType s_bench;
+
+/* Machine of the cases, apart from the window cpu so no input, sound
+ * or fault dialog is timed */
+static cpuType s_cpu;
+static U8 s_memory[CPU_MEMORY_BYTES(E_CPU_PROFILE_VIP)];
+static displayScreenType s_screen;
+static BOOL s_keys[INPUT_NUMBER_OF_KEYBOARD_KEYS];
+
+/* Register arithmetic and logic: 6xkk, 7xkk, 8xyN */
+static const U8 s_programAlu[] = {
+    0x60, 0x05, 0x61, 0x03, 0x70, 0x01, 0x80, 0x14,
+    0x80, 0x15, 0x80, 0x12, 0x80, 0x13, 0x80, 0x11,
+    0x81, 0x06, 0x81, 0x0E, 0x80, 0x17, 0x80, 0x10,
+    0x12, 0x00
+};
+
+/* Conditional skips: 3xkk, 4xkk, 5xy0, 9xy0 */
+static const U8 s_programBranch[] = {
+    0x60, 0x01, 0x61, 0x02, 0x30, 0x01, 0x60, 0x00,
+    0x40, 0x02, 0x60, 0x00, 0x50, 0x10, 0x90, 0x10,
+    0x60, 0x00, 0x12, 0x00
+};
+
+/* Index register and memory: Annn, Fx33, Fx55, Fx65, Fx1E, Fx29 */
+static const U8 s_programMemory[] = {
+    0xA3, 0x00, 0x60, 0xFF, 0xF0, 0x33, 0xF2, 0x55,
+    0xF2, 0x65, 0xF0, 0x1E, 0xF0, 0x29, 0x12, 0x00
+};
+
+/* Subroutines: 2nnn, 00EE */
+static const U8 s_programCall[] = {
+    0x22, 0x06, 0x22, 0x06, 0x12, 0x00, 0x70, 0x01,
+    0x00, 0xEE
+};
+
+/* Sprite drawing at moving, misaligned positions: Annn, Dxyn */
+static const U8 s_programDraw[] = {
+    0x60, 0x00, 0x61, 0x00, 0x62, 0x3F, 0x63, 0x1F,
+    0xA0, 0x0A, 0xD0, 0x15, 0x70, 0x03, 0x80, 0x22,
+    0x71, 0x02, 0x81, 0x32, 0x12, 0x08
+};
+
+/* Register loads, sprite draws, table lookup, then a delay spin: the
+ * idioms fused by CpuRun() */
+static const U8 s_programIdiom[] = {
+    0x60, 0x05, 0x61, 0x03, 0x62, 0x00, 0xA2, 0x40,
+    0xD0, 0x15, 0xA2, 0x40, 0xD1, 0x15, 0xF2, 0x1E,
+    0xF1, 0x65, 0x63, 0x04, 0xF3, 0x15, 0xF4, 0x07,
+    0x34, 0x00, 0x12, 0x16, 0x12, 0x00
+};
+
+static const benchProgramType s_programs[] = {
+    {"alu", s_programAlu, sizeof(s_programAlu)},
+    {"branch", s_programBranch, sizeof(s_programBranch)},
+    {"memory", s_programMemory, sizeof(s_programMemory)},
+    {"call", s_programCall, sizeof(s_programCall)},
+    {"draw", s_programDraw, sizeof(s_programDraw)}
+};
+
+/* Byte aligned, misaligned, clipped on the right and wrapped on the bottom */
+static const benchDrawType s_draws[] = {
+    {0U, 0U, 5U},
+    {8U, 8U, 5U},
+    {13U, 3U, 5U},
+    {61U, 10U, 5U},
+    {30U, 29U, 15U}
+};
+
+static U32 s_frameBuffer[DISPLAY_HIRES_WIDTH * DISPLAY_HIRES_HEIGHT];
+static const U32 s_palette[DISPLAY_COLORS] = DISPLAY_PALETTE;
+
+/******************************************************************
+ * 5. Functions prototypes (static only)
+ ******************************************************************/
+static double benchNow(void);
+static U32 benchRunCpu(void);
+static U32 benchRunInstructions(BOOL fused);
+static U32 benchRunDraw(void);
+static U32 benchRunFrames(void);
+static void benchCase(const char *name, benchKindType kind, const U8 *program, U16 size);
+static void benchStatistics(benchResultType *result);
+static int benchCompare(const void *a, const void *b);
+static void benchPrint(const benchResultType *result);
+static Std_ReturnType benchWriteJson(const char *path);
+static const char * benchBaseName(const char *path);
+
+/******************************************************************
+ * FUNCTION : main(int argc, char** argv)
+ *    Description: Benchmark entry point.
+ *                 Usage: bench [--runs N] [--warmup N]
+ *                              [--json FILE] [ROM...]
+ *    Parameters:  None
+ *    Return:      0 on success, 1 otherwise
+ ******************************************************************/
+int main(int argc, char **argv)
+{
+    U8 i;
+    int arg;
+    U32 size;
+    const U8 *rom;
+    char name[BENCH_NAME_SIZE];
+    int returnValue = 0;
+
+    s_bench.runs = BENCH_DEFAULT_RUNS;
+    s_bench.warmup = BENCH_DEFAULT_WARMUP;
+    s_bench.jsonPath = NULL;
+    s_bench.resultCount = 0U;
+
+    for (arg = 1; arg < argc; arg++)
+    {
+        if ((0 == strcmp(argv[arg], "--runs")) && ((arg + 1) < argc))
+        {
+            s_bench.runs = (U8)atoi(argv[++arg]);
+        }
+        else if ((0 == strcmp(argv[arg], "--warmup")) && ((arg + 1) < argc))
+        {
+            s_bench.warmup = (U8)atoi(argv[++arg]);
+        }
+        else if ((0 == strcmp(argv[arg], "--json")) && ((arg + 1) < argc))
+        {
+            s_bench.jsonPath = argv[++arg];
+        }
+    }
+
+    if ((0U == s_bench.runs) || (s_bench.runs > BENCH_MAX_RUNS))
+    {
+        s_bench.runs = BENCH_DEFAULT_RUNS;
+    }
+
+    if (s_bench.warmup > BENCH_MAX_WARMUP)
+    {
+        s_bench.warmup = BENCH_DEFAULT_WARMUP;
+    }
+
+    printf("%-32s %16s %16s %16s %8s\n", "benchmark", "median", "min", "max", "stddev");
+
+    /* Decode and dispatch on synthetic opcode mixes */
+    for (i = 0U; i < (sizeof(s_programs) / sizeof(s_programs[0])); i++)
+    {
+        (void)snprintf(name, sizeof(name), "cpu/%s", s_programs[i].name);
+        benchCase(name, E_BENCH_CPU, s_programs[i].program, s_programs[i].size);
+    }
+
+    /* Frame loop instructions, one by one then fused */
+    benchCase("step/idiom", E_BENCH_STEP, s_programIdiom, sizeof(s_programIdiom));
+    benchCase("run/idiom", E_BENCH_RUN, s_programIdiom, sizeof(s_programIdiom));
+
+    /* Dxyn throughput without the decode layer */
+    benchCase("draw/dxyn", E_BENCH_DRAW, NULL, 0U);
+
+    /* Headless frame loop */
+    benchCase("frame/draw", E_BENCH_FRAME, s_programDraw, sizeof(s_programDraw));
+
+    /* Real roms given on the command line */
+    for (arg = 1; arg < argc; arg++)
+    {
+        if ((0 == strcmp(argv[arg], "--runs")) || (0 == strcmp(argv[arg], "--warmup")) || (0 == strcmp(argv[arg], "--json")))
+        {
+            arg++;
+        }
+        else
+        {
+            rom = ImportRomCached(argv[arg], &size);
+
+            if (NULL == rom)
+            {
+                printf("Unable to load rom %s\n", argv[arg]);
+                returnValue = 1;
+            }
+            else
+            {
+                (void)snprintf(name, sizeof(name), "cpu/rom:%s", benchBaseName(argv[arg]));
+                benchCase(name, E_BENCH_CPU, rom, (U16)size);
+                (void)snprintf(name, sizeof(name), "step/rom:%s", benchBaseName(argv[arg]));
+                benchCase(name, E_BENCH_STEP, rom, (U16)size);
+                (void)snprintf(name, sizeof(name), "run/rom:%s", benchBaseName(argv[arg]));
+                benchCase(name, E_BENCH_RUN, rom, (U16)size);
+                (void)snprintf(name, sizeof(name), "frame/rom:%s", benchBaseName(argv[arg]));
+                benchCase(name, E_BENCH_FRAME, rom, (U16)size);
+            }
+        }
+    }
+
+    if ((NULL != s_bench.jsonPath) && (E_OK != benchWriteJson(s_bench.jsonPath)))
+    {
+        printf("Unable to write %s\n", s_bench.jsonPath);
+        returnValue = 1;
+    }
+
+    ImportExit();
+
+    return returnValue;
+}
+
+/******************************************************************
+ * FUNCTION : benchNow()
+ *    Description: Monotonic time
+ *    Parameters:  None
+ *    Return:      Time in seconds
+ ******************************************************************/
+static double benchNow(void)
+{
+    return (double)SDL_GetPerformanceCounter() / (double)SDL_GetPerformanceFrequency();
+}
+
+/******************************************************************
+ * FUNCTION : benchRunCpu()
+ *    Description: Execute instructions on the loaded program one
+ *                 CpuStep() at a time
+ *    Parameters:  None
+ *    Return:      Number of instructions executed, fewer than
+ *                 BENCH_CPU_INSTRUCTIONS if the program stopped
+ ******************************************************************/
+static U32 benchRunCpu(void)
+{
+    U32 count = 0U;
+
+    while ((count < BENCH_CPU_INSTRUCTIONS) && (E_OK == CpuStep(&s_cpu)))
+    {
+        count++;
+    }
+
+    return count;
+}
+
+/******************************************************************
+ * FUNCTION : benchRunInstructions()
+ *    Description: Run frames of the timers then
+ *                 BENCH_FRAME_INSTRUCTIONS instructions, one
+ *                 CpuStep() at a time or fused by CpuRun()
+ *    Parameters:  fused: run the frames with CpuRun()
+ *    Return:      Number of instructions executed
+ ******************************************************************/
+static U32 benchRunInstructions(BOOL fused)
+{
+    U32 count = 0U;
+    U32 frame;
+    U32 executed;
+
+    for (frame = 0U; frame < BENCH_RUN_FRAMES; frame++)
+    {
+        CpuTimers(&s_cpu);
+
+        if (FALSE != fused)
+        {
+            executed = CpuRun(&s_cpu, BENCH_FRAME_INSTRUCTIONS);
+        }
+        else
+        {
+            executed = 0U;
+            while ((executed < BENCH_FRAME_INSTRUCTIONS) && (E_OK == CpuStep(&s_cpu)))
+            {
+                executed++;
+            }
+        }
+
+        count += executed;
+    }
+
+    return count;
+}
+
+/******************************************************************
+ * FUNCTION : benchRunDraw()
+ *    Description: Draw font sprites at various positions
+ *    Parameters:  None
+ *    Return:      Number of draws executed
+ ******************************************************************/
+static U32 benchRunDraw(void)
+{
+    /* Digit sprites followed by spare bytes for the 15 rows case */
+    static U8 s_sprite[16U] = {0xF0, 0x90, 0x90, 0x90, 0xF0, 0x20, 0x60, 0x20, 0x20, 0x70, 0xF0, 0x10, 0xF0, 0x80, 0xF0, 0x00};
+    U32 i;
+    U8 vf = 0U;
+    U8 count = sizeof(s_draws) / sizeof(s_draws[0]);
+    U8 index = 0U;
+
+    for (i = 0U; i < BENCH_DRAW_CALLS; i++)
+    {
+        DisplayDraw(&s_screen, s_sprite, &vf, s_draws[index].x, s_draws[index].y, s_draws[index].n, FALSE);
+
+        index++;
+        if (index == count)
+        {
+            index = 0U;
+        }
+    }
+
+    return BENCH_DRAW_CALLS;
+}
+
+/******************************************************************
+ * FUNCTION : benchRunFrames()
+ *    Description: Run the headless frame loop: the timers, one
+ *                 frame of instructions, then the screen conversion
+ *                 a presenter would do
+ *    Parameters:  None
+ *    Return:      Number of frames executed
+ ******************************************************************/
+static U32 benchRunFrames(void)
+{
+    U32 frame;
+    U8 x;
+    U8 y;
+    U32 *pixel;
+    const displayScreenType *screen = &s_screen;
+
+    for (frame = 0U; frame < BENCH_FRAMES; frame++)
+    {
+        CpuTimers(&s_cpu);
+        (void)CpuRun(&s_cpu, BENCH_FRAME_INSTRUCTIONS);
+
+        pixel = s_frameBuffer;
+
+        for (y = 0U; y < screen->height; y++)
+        {
+            for (x = 0U; x < screen->width; x++)
+            {
+                *pixel++ = BENCH_PIXEL_ALPHA | s_palette[DISPLAY_PIXEL(screen, x, y)];
+            }
+        }
+    }
+
+    return BENCH_FRAMES;
+}
+
+/******************************************************************
+ * FUNCTION : benchCase()
+ *    Description: Warm up then time repeated runs of one case
+ *    Parameters:  name: case name
+ *                 kind: what to measure
+ *                 program, size: program to load, if any
+ *    Return:      None
+ ******************************************************************/
+static void benchCase(const char *name, benchKindType kind, const U8 *program, U16 size)
+{
+    benchResultType *result;
+    U32 run;
+    U32 operations = 0U;
+    double start;
+    double elapsed;
+
+    if (s_bench.resultCount >= BENCH_MAX_CASES)
+    {
+        return;
+    }
+
+    result = &s_bench.results[s_bench.resultCount];
+    s_bench.resultCount++;
+
+    (void)snprintf(result->name, sizeof(result->name), "%s", name);
+    result->unit = ((kind == E_BENCH_CPU) || (kind == E_BENCH_STEP) || (kind == E_BENCH_RUN))
+                       ? "instructions/s" : ((kind == E_BENCH_DRAW) ? "draws/s" : "frames/s");
+    result->runs = s_bench.runs;
+
+    for (run = 0U; run < (s_bench.warmup + s_bench.runs); run++)
+    {
+        /* Every run starts from the same machine state, random
+         * generator included */
+        if (NULL != program)
+        {
+            CpuAttach(&s_cpu, s_memory, &s_screen, s_keys);
+            CpuReset(&s_cpu, E_CPU_PROFILE_VIP, 0U);
+            (void)CpuLoad(&s_cpu, program, size);
+        }
+        else
+        {
+            DisplayReset(&s_screen);
+        }
+
+        start = benchNow();
+
+        switch (kind)
+        {
+        case E_BENCH_CPU:
+            operations = benchRunCpu();
+            break;
+        case E_BENCH_STEP:
+            operations = benchRunInstructions(FALSE);
+            break;
+        case E_BENCH_RUN:
+            operations = benchRunInstructions(TRUE);
+            break;
+        case E_BENCH_DRAW:
+            operations = benchRunDraw();
+            break;
+        case E_BENCH_FRAME:
+        default:
+            operations = benchRunFrames();
+            break;
+        }
+
+        elapsed = benchNow() - start;
+
+        if (run >= s_bench.warmup)
+        {
+            result->samples[run - s_bench.warmup] = (double)operations / elapsed;
+        }
+    }
+
+    benchStatistics(result);
+    benchPrint(result);
+}
+
+/******************************************************************
+ * FUNCTION : benchCompare()
+ *    Description: qsort comparator on doubles
+ *    Parameters:  a, b: samples
+ *    Return:      Ordering of a and b
+ ******************************************************************/
+static int benchCompare(const void *a, const void *b)
+{
+    double left = *(const double *)a;
+    double right = *(const double *)b;
+
+    return (left > right) - (left < right);
+}
+
+/******************************************************************
+ * FUNCTION : benchStatistics()
+ *    Description: Compute median, mean, extrema and relative
+ *                 standard deviation of the samples
+ *    Parameters:  result: case to update
+ *    Return:      None
+ ******************************************************************/
+static void benchStatistics(benchResultType *result)
+{
+    double sorted[BENCH_MAX_RUNS];
+    double sum = 0.0;
+    double variance = 0.0;
+    U8 i;
+
+    (void)memcpy(sorted, result->samples, result->runs * sizeof(double));
+    qsort(sorted, result->runs, sizeof(double), benchCompare);
+
+    for (i = 0U; i < result->runs; i++)
+    {
+        sum += sorted[i];
+    }
+    result->mean = sum / result->runs;
+
+    for (i = 0U; i < result->runs; i++)
+    {
+        variance += (sorted[i] - result->mean) * (sorted[i] - result->mean);
+    }
+
+    result->stddev = sqrt(variance / result->runs) / result->mean;
+    result->min = sorted[0U];
+    result->max = sorted[result->runs - 1U];
+
+    if ((result->runs % 2U) == 0U)
+    {
+        result->median = (sorted[(result->runs / 2U) - 1U] + sorted[result->runs / 2U]) / 2.0;
+    }
+    else
+    {
+        result->median = sorted[result->runs / 2U];
+    }
+}
+
+/******************************************************************
+ * FUNCTION : benchPrint()
+ *    Description: Print one result line
+ *    Parameters:  result: case to print
+ *    Return:      None
+ ******************************************************************/
+static void benchPrint(const benchResultType *result)
+{
+    printf("%-32s %16.0f %16.0f %16.0f %7.2f%% %s\n",
+           result->name, result->median, result->min, result->max, result->stddev * 100.0, result->unit);
+}
+
+/******************************************************************
+ * FUNCTION : benchWriteJson()
+ *    Description: Write all results in a json file
+ *    Parameters:  path: output file
+ *    Return:      E_OK if file is written, E_NOT_OK otherwise
+ ******************************************************************/
+static Std_ReturnType benchWriteJson(const char *path)
+{
+    FILE *filePtr;
+    U8 i;
+    U8 j;
+    const benchResultType *result;
+
+    if (NULL == (filePtr = fopen(path, "w")))
+    {
+        return E_NOT_OK;
+    }
+
+    fprintf(filePtr, "{\n  \"runs\": %u,\n  \"warmup\": %u,\n  \"results\": [\n", s_bench.runs, s_bench.warmup);
+
+    for (i = 0U; i < s_bench.resultCount; i++)
+    {
+        result = &s_bench.results[i];
+
+        fprintf(filePtr, "    {\"name\": \"%s\", \"unit\": \"%s\", \"median\": %.1f, \"mean\": %.1f, "
+                         "\"min\": %.1f, \"max\": %.1f, \"stddev\": %.5f, \"samples\": [",
+                result->name, result->unit, result->median, result->mean, result->min, result->max, result->stddev);
+
+        for (j = 0U; j < result->runs; j++)
+        {
+            fprintf(filePtr, "%s%.1f", (j == 0U) ? "" : ", ", result->samples[j]);
+        }
+
+        fprintf(filePtr, "]}%s\n", ((i + 1U) == s_bench.resultCount) ? "" : ",");
+    }
+
+    fprintf(filePtr, "  ]\n}\n");
+    fclose(filePtr);
+
+    return E_OK;
+}
+
+/******************************************************************
+ * FUNCTION : benchBaseName()
+ *    Description: File name part of a path, used in case names
+ *    Parameters:  path: rom file
+ *    Return:      Pointer inside path
+ ******************************************************************/
+static const char * benchBaseName(const char *path)
+{
+    const char *name = path;
+    const char *current;
+
+    for (current = path; *current != '\0'; current++)
+    {
+        if ((*current == '/') || (*current == '\\'))
+        {
+            name = current + 1;
+        }
+    }
+
+    return name;
+}
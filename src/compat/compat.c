@@ -0,0 +1,678 @@
+/******************************************************************
+ *
+ *
+ * FILE        : compat.c
+ * PROJECT     : chip8
+ * AUTHOR      : danpham
+ * DESCRIPTION : Rom compatibility runner. Runs every rom of a
+ *               manifest headless, on all cores, and compares
+ *               screen hashes at checkpoints with golden values.
+ *
+ *               Manifest, one rom per line, '#' starts a comment:
+ *                 ROM PROFILE FRAMES INPUTS CHECKPOINT...
+ *               - ROM: path, relative to the manifest
+ *               - PROFILE: vip, schip or xochip
+ *               - FRAMES: frames to run, each runs --ipf
+ *                 instructions then the timers
+ *               - INPUTS: '-' or comma separated FRAME:KEY+ (press)
+ *                 and FRAME:KEY- (release), KEY in hexadecimal,
+ *                 applied before running FRAME
+ *               - CHECKPOINT: FRAME:HASH, the screen hash once
+ *                 FRAME frames ran; FRAME alone has no golden
+ *                 value yet, see --record
+ *
+ ******************************************************************/
+
+/******************************************************************
+ * 1. Included files (microcontroller ones then user defined ones)
+ ******************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <SDL2/SDL.h>
+#include "../cpu/cpu.h"
+#include "../display/display.h"
+#include "../import/import.h"
+#include "../input/input.h"
+#include "../metrics/metrics.h"
+
+/******************************************************************
+ * 2. Define declarations (macros then function macros)
+ ******************************************************************/
+#define COMPAT_LINE_SIZE                                       1024U
+#define COMPAT_PATH_SIZE                                        512U
+#define COMPAT_MAX_INPUTS                                        64U
+#define COMPAT_MAX_CHECKPOINTS                                   16U
+#define COMPAT_MAX_THREADS                                       64U
+
+#define COMPAT_DEFAULT_INSTRUCTIONS_PER_FRAME                    10U
+#define COMPAT_SEPARATORS                                   " \t\r\n"
+
+/******************************************************************
+ * 3. Typedef definitions (simple typedef, then enum and structs)
+ ******************************************************************/
+typedef struct
+{
+    U32 frame;
+    U8 key;
+    BOOL down;
+} compatInputType;
+
+typedef struct
+{
+    U32 frame;
+    BOOL hasGolden;
+    U64 golden;
+    U64 hash;
+} compatCheckpointType;
+
+typedef struct
+{
+    char rom[COMPAT_PATH_SIZE];             /* As written in the manifest */
+    char path[COMPAT_PATH_SIZE];            /* Resolved */
+    char inputText[COMPAT_LINE_SIZE];
+    cpuProfileType profile;
+    U32 frames;
+    U32 inputCount;
+    compatInputType inputs[COMPAT_MAX_INPUTS];
+    U32 checkpointCount;
+    compatCheckpointType checkpoints[COMPAT_MAX_CHECKPOINTS];
+    BOOL loaded;
+    cpuStatusType status;
+} compatJobType;
+
+typedef struct
+{
+    compatJobType *jobs;
+    U32 jobCount;
+    U32 jobCapacity;
+    SDL_atomic_t nextJob;
+    U32 instructionsPerFrame;
+} compatType;
+
+/******************************************************************
+ * 4. Variable definitions (static then global)
+ ******************************************************************/
+static compatType s_compat;
+
+static const char * const s_profileNames[E_CPU_PROFILE_NUMBER] = { "vip", "schip", "xochip" };
+
+static const char * const s_statusNames[] = {
+    "", " (exited)", " (invalid opcode)", " (stack overflow)", " (stack underflow)"
+};
+
+/******************************************************************
+ * 5. Functions prototypes (static only)
+ ******************************************************************/
+static Std_ReturnType compatParse(const char *manifest);
+static Std_ReturnType compatParseLine(compatJobType *job, char *line, const char *directory);
+static Std_ReturnType compatParseInputs(compatJobType *job, const char *text);
+static Std_ReturnType compatWrite(const char *manifest);
+static int compatWorker(void *data);
+static void compatRun(compatJobType *job);
+static U64 compatHash(const displayScreenType *screen);
+
+/******************************************************************
+ * FUNCTION : main(int argc, char** argv)
+ *    Description: Usage: compat MANIFEST [--threads N] [--ipf N]
+ *                                [--record FILE] [--verbose]
+ *                 --record writes the manifest back with the
+ *                 hashes found, to accept new golden values.
+ *    Parameters:  None
+ *    Return:      0 if every checkpoint matches, 1 otherwise
+ ******************************************************************/
+int main(int argc, char **argv)
+{
+    SDL_Thread *threads[COMPAT_MAX_THREADS];
+    const char *manifest = NULL;
+    const char *recordPath = NULL;
+    BOOL verbose = FALSE;
+    U32 threadCount = 0U;
+    U32 started = 0U;
+    U32 checkpoints = 0U;
+    U32 failures = 0U;
+    U32 i;
+    U32 j;
+    U64 start;
+    double elapsed;
+    compatJobType *job;
+    int arg;
+
+    s_compat.instructionsPerFrame = COMPAT_DEFAULT_INSTRUCTIONS_PER_FRAME;
+
+    for (arg = 1; arg < argc; arg++)
+    {
+        if ((0 == strcmp(argv[arg], "--threads")) && ((arg + 1) < argc))
+        {
+            threadCount = (U32)strtoul(argv[++arg], NULL, 0);
+        }
+        else if ((0 == strcmp(argv[arg], "--ipf")) && ((arg + 1) < argc))
+        {
+            s_compat.instructionsPerFrame = (U32)strtoul(argv[++arg], NULL, 0);
+        }
+        else if ((0 == strcmp(argv[arg], "--record")) && ((arg + 1) < argc))
+        {
+            recordPath = argv[++arg];
+        }
+        else if (0 == strcmp(argv[arg], "--verbose"))
+        {
+            verbose = TRUE;
+        }
+        else
+        {
+            manifest = argv[arg];
+        }
+    }
+
+    if ((NULL == manifest) || (E_OK != compatParse(manifest)))
+    {
+        printf("Usage: compat MANIFEST [--threads N] [--ipf N] [--record FILE] [--verbose]\n");
+        return 1;
+    }
+
+    if (0U == threadCount)
+    {
+        threadCount = (U32)SDL_GetCPUCount();
+    }
+    if (threadCount > s_compat.jobCount)
+    {
+        threadCount = s_compat.jobCount;
+    }
+    if (threadCount > COMPAT_MAX_THREADS)
+    {
+        threadCount = COMPAT_MAX_THREADS;
+    }
+
+    METRICS_START();
+
+    start = SDL_GetPerformanceCounter();
+
+    /* The main thread works too */
+    for (i = 1U; i < threadCount; i++)
+    {
+        threads[started] = SDL_CreateThread(compatWorker, "chip8 compat", NULL);
+        if (NULL != threads[started])
+        {
+            started++;
+        }
+    }
+    (void)compatWorker(NULL);
+    for (i = 0U; i < started; i++)
+    {
+        SDL_WaitThread(threads[i], NULL);
+    }
+
+    METRICS_STOP();
+
+    elapsed = (double)(SDL_GetPerformanceCounter() - start) / (double)SDL_GetPerformanceFrequency();
+
+    for (i = 0U; i < s_compat.jobCount; i++)
+    {
+        job = &s_compat.jobs[i];
+        checkpoints += job->checkpointCount;
+
+        if (FALSE == job->loaded)
+        {
+            printf("FAIL %s: unable to load\n", job->rom);
+            failures++;
+            continue;
+        }
+
+        for (j = 0U; j < job->checkpointCount; j++)
+        {
+            if (FALSE == job->checkpoints[j].hasGolden)
+            {
+                printf("NEW  %s frame %lu: %016llX\n", job->rom, (unsigned long)job->checkpoints[j].frame,
+                       (unsigned long long)job->checkpoints[j].hash);
+                if (NULL == recordPath)
+                {
+                    failures++;
+                }
+            }
+            else if (job->checkpoints[j].hash != job->checkpoints[j].golden)
+            {
+                printf("FAIL %s frame %lu: %016llX, expected %016llX%s\n", job->rom,
+                       (unsigned long)job->checkpoints[j].frame, (unsigned long long)job->checkpoints[j].hash,
+                       (unsigned long long)job->checkpoints[j].golden,
+                       s_statusNames[job->status]);
+                failures++;
+            }
+            else if (FALSE != verbose)
+            {
+                printf("PASS %s frame %lu\n", job->rom, (unsigned long)job->checkpoints[j].frame);
+            }
+        }
+    }
+
+    printf("%lu roms, %lu checkpoints, %lu failures, %lu threads, %.3f s\n", (unsigned long)s_compat.jobCount,
+           (unsigned long)checkpoints, (unsigned long)failures, (unsigned long)threadCount, elapsed);
+
+    if ((NULL != recordPath) && (E_OK != compatWrite(recordPath)))
+    {
+        printf("Unable to write %s\n", recordPath);
+        failures++;
+    }
+
+    free(s_compat.jobs);
+    ImportExit();
+
+    return (0U == failures) ? 0 : 1;
+}
+
+/******************************************************************
+ * FUNCTION : compatParse()
+ *    Description: Read all jobs of a manifest
+ *    Parameters:  manifest: manifest file
+ *    Return:      E_OK if every line is valid, E_NOT_OK otherwise
+ ******************************************************************/
+static Std_ReturnType compatParse(const char *manifest)
+{
+    char line[COMPAT_LINE_SIZE];
+    char directory[COMPAT_PATH_SIZE];
+    const char *current;
+    char *comment;
+    size_t length = 0U;
+    compatJobType *jobs;
+    FILE *filePtr;
+    U32 lineNumber = 0U;
+    Std_ReturnType returnValue = E_OK;
+
+    if (NULL == (filePtr = fopen(manifest, "r")))
+    {
+        printf("Unable to open %s\n", manifest);
+        return E_NOT_OK;
+    }
+
+    /* Directory of the manifest, with its separator */
+    for (current = manifest; *current != '\0'; current++)
+    {
+        if ((*current == '/') || (*current == '\\'))
+        {
+            length = (size_t)(current - manifest) + 1U;
+        }
+    }
+    if (length >= sizeof(directory))
+    {
+        length = 0U;
+    }
+    (void)memcpy(directory, manifest, length);
+    directory[length] = '\0';
+
+    while ((E_OK == returnValue) && (NULL != fgets(line, sizeof(line), filePtr)))
+    {
+        lineNumber++;
+
+        if (s_compat.jobCount == s_compat.jobCapacity)
+        {
+            s_compat.jobCapacity = (0U == s_compat.jobCapacity) ? 64U : (s_compat.jobCapacity * 2U);
+            jobs = (compatJobType *)realloc(s_compat.jobs, s_compat.jobCapacity * sizeof(compatJobType));
+            if (NULL == jobs)
+            {
+                returnValue = E_NOT_OK;
+                break;
+            }
+            s_compat.jobs = jobs;
+        }
+
+        /* Skip comments and blank lines */
+        comment = strchr(line, '#');
+        if (NULL != comment)
+        {
+            *comment = '\0';
+        }
+        if (line[strspn(line, COMPAT_SEPARATORS)] == '\0')
+        {
+            continue;
+        }
+
+        (void)memset((void *)&s_compat.jobs[s_compat.jobCount], 0, sizeof(compatJobType));
+        if (E_OK == compatParseLine(&s_compat.jobs[s_compat.jobCount], line, directory))
+        {
+            s_compat.jobCount++;
+        }
+        else
+        {
+            printf("%s:%lu: invalid line\n", manifest, (unsigned long)lineNumber);
+            returnValue = E_NOT_OK;
+        }
+    }
+
+    fclose(filePtr);
+
+    if ((E_OK == returnValue) && (0U == s_compat.jobCount))
+    {
+        printf("%s: no rom\n", manifest);
+        returnValue = E_NOT_OK;
+    }
+
+    return returnValue;
+}
+
+/******************************************************************
+ * FUNCTION : compatParseLine()
+ *    Description: Parse one manifest line
+ *    Parameters:  job: output
+ *                 line: line without comment, modified
+ *                 directory: prefix of relative rom paths
+ *    Return:      E_OK if valid, E_NOT_OK otherwise
+ ******************************************************************/
+static Std_ReturnType compatParseLine(compatJobType *job, char *line, const char *directory)
+{
+    char *token;
+    char *end;
+    U32 profile;
+
+    token = strtok(line, COMPAT_SEPARATORS);
+
+    (void)snprintf(job->rom, sizeof(job->rom), "%s", token);
+    if ((token[0] == '/') || (token[0] == '\\') || ((token[0] != '\0') && (token[1] == ':')))
+    {
+        (void)snprintf(job->path, sizeof(job->path), "%s", token);
+    }
+    else
+    {
+        (void)snprintf(job->path, sizeof(job->path), "%s%s", directory, token);
+    }
+
+    token = strtok(NULL, COMPAT_SEPARATORS);
+    if (NULL == token)
+    {
+        return E_NOT_OK;
+    }
+    for (profile = 0U; profile < (U32)E_CPU_PROFILE_NUMBER; profile++)
+    {
+        if (0 == strcmp(token, s_profileNames[profile]))
+        {
+            break;
+        }
+    }
+    if (profile == (U32)E_CPU_PROFILE_NUMBER)
+    {
+        return E_NOT_OK;
+    }
+    job->profile = (cpuProfileType)profile;
+
+    token = strtok(NULL, COMPAT_SEPARATORS);
+    if (NULL == token)
+    {
+        return E_NOT_OK;
+    }
+    job->frames = (U32)strtoul(token, &end, 10);
+    if ((0U == job->frames) || (*end != '\0'))
+    {
+        return E_NOT_OK;
+    }
+
+    token = strtok(NULL, COMPAT_SEPARATORS);
+    if ((NULL == token) || (E_OK != compatParseInputs(job, token)))
+    {
+        return E_NOT_OK;
+    }
+    (void)snprintf(job->inputText, sizeof(job->inputText), "%s", token);
+
+    while (NULL != (token = strtok(NULL, COMPAT_SEPARATORS)))
+    {
+        if (job->checkpointCount == COMPAT_MAX_CHECKPOINTS)
+        {
+            return E_NOT_OK;
+        }
+
+        job->checkpoints[job->checkpointCount].frame = (U32)strtoul(token, &end, 10);
+        if (*end == ':')
+        {
+            job->checkpoints[job->checkpointCount].golden = (U64)strtoull(end + 1, &end, 16);
+            job->checkpoints[job->checkpointCount].hasGolden = TRUE;
+        }
+        if ((*end != '\0') || (job->checkpoints[job->checkpointCount].frame > job->frames))
+        {
+            return E_NOT_OK;
+        }
+        job->checkpointCount++;
+    }
+
+    return E_OK;
+}
+
+/******************************************************************
+ * FUNCTION : compatParseInputs()
+ *    Description: Parse the input script of a job
+ *    Parameters:  job: output
+ *                 text: '-' or FRAME:KEY+ and FRAME:KEY- events
+ *    Return:      E_OK if valid, E_NOT_OK otherwise
+ ******************************************************************/
+static Std_ReturnType compatParseInputs(compatJobType *job, const char *text)
+{
+    const char *current = text;
+    char *end;
+    compatInputType *input;
+
+    if (0 == strcmp(text, "-"))
+    {
+        return E_OK;
+    }
+
+    for (;;)
+    {
+        if (job->inputCount == COMPAT_MAX_INPUTS)
+        {
+            return E_NOT_OK;
+        }
+        input = &job->inputs[job->inputCount];
+
+        input->frame = (U32)strtoul(current, &end, 10);
+        if ((end == current) || (*end != ':'))
+        {
+            return E_NOT_OK;
+        }
+        current = end + 1;
+
+        input->key = (U8)strtoul(current, &end, 16);
+        if ((end == current) || (input->key >= INPUT_NUMBER_OF_KEYBOARD_KEYS) || ((*end != '+') && (*end != '-')))
+        {
+            return E_NOT_OK;
+        }
+        input->down = (*end == '+') ? TRUE : FALSE;
+        job->inputCount++;
+        current = end + 1;
+
+        if (*current == '\0')
+        {
+            break;
+        }
+        if (*current != ',')
+        {
+            return E_NOT_OK;
+        }
+        current++;
+    }
+
+    return E_OK;
+}
+
+/******************************************************************
+ * FUNCTION : compatWrite()
+ *    Description: Write the manifest with the hashes found as
+ *                 golden values
+ *    Parameters:  manifest: output file
+ *    Return:      E_OK if written, E_NOT_OK otherwise
+ ******************************************************************/
+static Std_ReturnType compatWrite(const char *manifest)
+{
+    const compatJobType *job;
+    FILE *filePtr;
+    U32 i;
+    U32 j;
+
+    if (NULL == (filePtr = fopen(manifest, "w")))
+    {
+        return E_NOT_OK;
+    }
+
+    fprintf(filePtr, "# ROM PROFILE FRAMES INPUTS CHECKPOINT...\n");
+    for (i = 0U; i < s_compat.jobCount; i++)
+    {
+        job = &s_compat.jobs[i];
+
+        fprintf(filePtr, "%s %s %lu %s", job->rom, s_profileNames[job->profile], (unsigned long)job->frames,
+                job->inputText);
+        for (j = 0U; j < job->checkpointCount; j++)
+        {
+            if (FALSE != job->loaded)
+            {
+                fprintf(filePtr, " %lu:%016llX", (unsigned long)job->checkpoints[j].frame,
+                        (unsigned long long)job->checkpoints[j].hash);
+            }
+            else
+            {
+                fprintf(filePtr, " %lu", (unsigned long)job->checkpoints[j].frame);
+            }
+        }
+        fprintf(filePtr, "\n");
+    }
+
+    fclose(filePtr);
+
+    return E_OK;
+}
+
+/******************************************************************
+ * FUNCTION : compatWorker()
+ *    Description: Run jobs until none is left
+ *    Parameters:  data: unused
+ *    Return:      0
+ ******************************************************************/
+static int compatWorker(void *data)
+{
+    U32 index;
+
+    (void)data;
+
+    METRICS_THREAD("compat worker");
+
+    for (;;)
+    {
+        index = (U32)SDL_AtomicAdd(&s_compat.nextJob, 1);
+        if (index >= s_compat.jobCount)
+        {
+            break;
+        }
+
+        compatRun(&s_compat.jobs[index]);
+    }
+
+    return 0;
+}
+
+/******************************************************************
+ * FUNCTION : compatRun()
+ *    Description: Run one rom on its own machine and hash the
+ *                 screen at every checkpoint
+ *    Parameters:  job: job to run
+ *    Return:      None
+ ******************************************************************/
+static void compatRun(compatJobType *job)
+{
+    cpuType cpu;
+    U8 *memory;
+    displayScreenType screen;
+    BOOL keys[INPUT_NUMBER_OF_KEYBOARD_KEYS];
+    const U8 *rom;
+    U32 size = 0U;
+    U32 frame;
+    U32 input;
+    U32 instruction;
+    U32 i;
+
+    rom = ImportRomCached(job->path, &size);
+    memory = (U8 *)malloc(CPU_MEMORY_BYTES(job->profile));
+    if ((NULL == rom) || (NULL == memory))
+    {
+        free(memory);
+        return;
+    }
+
+    (void)memset((void *)keys, 0, sizeof(keys));
+    CpuAttach(&cpu, memory, &screen, keys);
+    CpuReset(&cpu, job->profile, 0U);
+    if (E_OK != CpuLoad(&cpu, rom, size))
+    {
+        free(memory);
+        return;
+    }
+    job->loaded = TRUE;
+
+    for (frame = 0U; frame <= job->frames; frame++)
+    {
+        for (i = 0U; i < job->checkpointCount; i++)
+        {
+            if (job->checkpoints[i].frame == frame)
+            {
+                job->checkpoints[i].hash = compatHash(&screen);
+            }
+        }
+
+        if (frame == job->frames)
+        {
+            break;
+        }
+
+        /* Events are in manifest order, all of this frame apply */
+        for (input = 0U; input < job->inputCount; input++)
+        {
+            if (job->inputs[input].frame == frame)
+            {
+                keys[job->inputs[input].key] = job->inputs[input].down;
+            }
+        }
+
+        instruction = CpuRun(&cpu, s_compat.instructionsPerFrame);
+        CpuTimers(&cpu);
+
+        METRICS_INSTRUCTIONS(instruction);
+        METRICS_MACHINES((E_CPU_RUNNING == cpu.status) ? 1U : 0U, (FALSE != CpuWaitingKey(&cpu)) ? 1U : 0U);
+    }
+
+    METRICS_MACHINES(0U, 0U);
+    job->status = (cpuStatusType)cpu.status;
+    free(memory);
+}
+
+/******************************************************************
+ * FUNCTION : compatHash()
+ *    Description: FNV-1a hash of the visible screen, independent of
+ *                 the host byte order
+ *    Parameters:  screen: screen
+ *    Return:      Hash
+ ******************************************************************/
+static U64 compatHash(const displayScreenType *screen)
+{
+    U8 bytes[8];
+    U64 hash;
+    U64 word;
+    U32 plane;
+    U32 y;
+    U32 half;
+    U32 byte;
+
+    bytes[0U] = screen->width;
+    bytes[1U] = screen->height;
+    hash = ImportHash(IMPORT_HASH_OFFSET, bytes, 2U);
+
+    for (plane = 0U; plane < DISPLAY_PLANES; plane++)
+    {
+        for (y = 0U; y < screen->height; y++)
+        {
+            for (half = 0U; half < 2U; half++)
+            {
+                word = screen->rows[plane][y][half];
+                for (byte = 0U; byte < 8U; byte++)
+                {
+                    bytes[byte] = (U8)(word >> (56U - (8U * byte)));
+                }
+                hash = ImportHash(hash, bytes, 8U);
+            }
+        }
+    }
+
+    return hash;
+}
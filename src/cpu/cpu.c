@@ -11,6 +11,7 @@
 /******************************************************************
  * 1. Included files (microcontroller ones then user defined ones)
  ******************************************************************/
+#include <stddef.h>
 #include <string.h>
 #include <time.h>
 #include <stdio.h>
@@ -19,21 +20,40 @@
 #include "../display/display.h"
 #include "../input/input.h"
 #include "../sound/sound.h"
+#include "../profiler/profiler.h"
+#include "../trace/trace.h"
+#include "../netplay/netplay.h"
+#include "../debugger/debugger.h"
+#include "../metrics/metrics.h"
+#include "../latency/latency.h"
 
 /******************************************************************
  * 2. Define declarations (macros then function macros)
  ******************************************************************/
 #define CPU_SYSTEM_CHARACTER_FONT_SIZE                            5U
 #define CPU_SYSTEM_FONT_SIZE                                        CPU_SYSTEM_CHARACTER_FONT_SIZE * 16U
-#define CPU_OPCODES_NUMBER                                       18U
+#define CPU_SYSTEM_BIG_CHARACTER_FONT_SIZE                       10U
+#define CPU_SYSTEM_BIG_FONT_SIZE                                    CPU_SYSTEM_BIG_CHARACTER_FONT_SIZE * 16U
+#define CPU_SYSTEM_BIG_FONT_ADDRESS                           0x050U
+#define CPU_OPCODES_NUMBER                                       27U
+
 #define CPU_IDENTIFIER_INVALID                                0xFFFF
 #define CPU_IDENTIFIER_CLEAR_SCREEN                           0x00E0
 #define CPU_IDENTIFIER_RETURN                                 0x00EE
+#define CPU_IDENTIFIER_SCROLL_DOWN                            0x00C0
+#define CPU_IDENTIFIER_SCROLL_UP                              0x00D0
+#define CPU_IDENTIFIER_SCROLL_RIGHT                           0x00FB
+#define CPU_IDENTIFIER_SCROLL_LEFT                            0x00FC
+#define CPU_IDENTIFIER_EXIT                                   0x00FD
+#define CPU_IDENTIFIER_LORES                                  0x00FE
+#define CPU_IDENTIFIER_HIRES                                  0x00FF
 #define CPU_IDENTIFIER_JUMP                                   0x1000
 #define CPU_IDENTIFIER_CALL                                   0x2000
 #define CPU_IDENTIFIER_SE                                     0x3000
 #define CPU_IDENTIFIER_SNE                                    0x4000
 #define CPU_IDENTIFIER_SE_VXVY                                0x5000
+#define CPU_IDENTIFIER_SAVE_VXVY                              0x5002
+#define CPU_IDENTIFIER_LOAD_VXVY                              0x5003
 #define CPU_IDENTIFIER_SET_VX                                 0x6000
 #define CPU_IDENTIFIER_ADD_TO_VX                              0x7000
 #define CPU_IDENTIFIER_8XXX                                   0x8000
@@ -45,6 +65,7 @@
 #define CPU_IDENTIFIER_SKIP_VX                                0xE09E
 #define CPU_IDENTIFIER_SKIPN_VX                               0xE0A1
 #define CPU_IDENTIFIER_FXXX                                   0xF000
+#define CPU_IDENTIFIER_WAIT_KEY                               0xF00A
 
 #define CPU_JUMP_MASK                                         0x0FFF
 #define CPU_CALL_MASK                                         0x0FFF
@@ -69,54 +90,87 @@
 #define CPU_SKIP_VX_MASK                                      0x0F00
 #define CPU_FXXX_VX_MASK                                      0x0F00
 #define CPU_FXXX_IDENTIFIER_MASK                              0x00FF
+#define CPU_WAIT_KEY_MASK                                     0xF0FF
+#define CPU_SCROLL_N_MASK                                     0x000F
+#define CPU_RANGE_VX_MASK                                     0x0F00
+#define CPU_RANGE_VY_MASK                                     0x00F0
+#define CPU_RANGE_IDENTIFIER_MASK                             0xF00F
+#define CPU_LONG_I_OPCODE                                     0xF000
+#define CPU_KEY_MASK                                          0x000F
+#define CPU_DEFAULT_SEED                                  0x2545F491UL
+
+/* Superinstructions, see cpuFuse<Profile>(). The per instruction
+ * hooks would miss the fused instructions, they turn fusion off. */
+#if defined(DEBUGGER_ENABLED) || defined(PROFILER_ENABLED) || defined(TRACE_ENABLED) || defined(LATENCY_ENABLED)
+#define CPU_FUSION                                             FALSE
+#else
+#define CPU_FUSION                                              TRUE
+#endif
+#define CPU_FUSE_OPCODE_MASK                                  0xF000
+#define CPU_FUSE_FXXX_MASK                                    0xF0FF
+#define CPU_FUSE_GET_DELAY                                    0xF007
+#define CPU_FUSE_ADD_I                                        0xF01E
+#define CPU_FUSE_LOAD_VX                                      0xF065
+#define CPU_FUSE_SPIN_LENGTH                                      3U
+
+#define CPU_FUSE_OPCODE(cpu, offset)  ((U16)(((cpu)->memory[(cpu)->pc + (offset)] << 8U) \
+                                             + (cpu)->memory[(cpu)->pc + (offset) + 1U]))
 
 /******************************************************************
  * 3. Typedef definitions (simple typedef, then enum and structs)
  ******************************************************************/
-typedef struct
-{
-    U8 memory[CPU_MEMORY_SIZE];
-    U16 i;
-    U8 vx[CPU_NUMBER_OF_VX_REGISTER];
-    U16 pc;
-    U16 stack[CPU_STACK_DEPTH_LEVEL];
-    S8 stackLevel;
-    U8 sysCounter;
-    U8 soundCounter;
-} cpuType;
-
 typedef struct
 {
     U16 mask;
     U16 identifier;
+    cpuProfileType profile;     /* First profile decoding the opcode */
 } opCodeType;
 
+/* Fails to compile when the hot registers spill out of the first
+ * cache line of cpuType */
+typedef char cpuHotLineCheckType[((offsetof(cpuType, stack) + sizeof(((cpuType *)0)->stack)) <= CPU_CACHE_LINE)
+                                  ? 1 : -1];
+
 opCodeType opCodeReference[CPU_OPCODES_NUMBER] =
 {
-    {0xFFFF, CPU_IDENTIFIER_CLEAR_SCREEN},
-    {0xFFFF, CPU_IDENTIFIER_RETURN},
-    {0xF000, CPU_IDENTIFIER_JUMP},
-    {0xF000, CPU_IDENTIFIER_CALL},
-    {0xF000, CPU_IDENTIFIER_SE},
-    {0xF000, CPU_IDENTIFIER_SNE},
-    {0xF00F, CPU_IDENTIFIER_SE_VXVY},
-    {0xF000, CPU_IDENTIFIER_SET_VX},
-    {0xF000, CPU_IDENTIFIER_ADD_TO_VX},
-    {0xF000, CPU_IDENTIFIER_8XXX},
-    {0xF00F, CPU_IDENTIFIER_SNE_VXVY},
-    {0xF000, CPU_IDENTIFIER_SET_I},
-    {0xF000, CPU_IDENTIFIER_JUMP_V0},
-    {0xF000, CPU_IDENTIFIER_RAND_VX},
-    {0xF000, CPU_IDENTIFIER_DRAW},
-    {0xF0FF, CPU_IDENTIFIER_SKIP_VX},
-    {0xF0FF, CPU_IDENTIFIER_SKIPN_VX},
-    {0xF000, CPU_IDENTIFIER_FXXX},
+    {0xFFFF, CPU_IDENTIFIER_CLEAR_SCREEN, E_CPU_PROFILE_VIP},
+    {0xFFFF, CPU_IDENTIFIER_RETURN, E_CPU_PROFILE_VIP},
+    {0xF000, CPU_IDENTIFIER_JUMP, E_CPU_PROFILE_VIP},
+    {0xF000, CPU_IDENTIFIER_CALL, E_CPU_PROFILE_VIP},
+    {0xF000, CPU_IDENTIFIER_SE, E_CPU_PROFILE_VIP},
+    {0xF000, CPU_IDENTIFIER_SNE, E_CPU_PROFILE_VIP},
+    {0xF00F, CPU_IDENTIFIER_SE_VXVY, E_CPU_PROFILE_VIP},
+    {0xF000, CPU_IDENTIFIER_SET_VX, E_CPU_PROFILE_VIP},
+    {0xF000, CPU_IDENTIFIER_ADD_TO_VX, E_CPU_PROFILE_VIP},
+    {0xF000, CPU_IDENTIFIER_8XXX, E_CPU_PROFILE_VIP},
+    {0xF00F, CPU_IDENTIFIER_SNE_VXVY, E_CPU_PROFILE_VIP},
+    {0xF000, CPU_IDENTIFIER_SET_I, E_CPU_PROFILE_VIP},
+    {0xF000, CPU_IDENTIFIER_JUMP_V0, E_CPU_PROFILE_VIP},
+    {0xF000, CPU_IDENTIFIER_RAND_VX, E_CPU_PROFILE_VIP},
+    {0xF000, CPU_IDENTIFIER_DRAW, E_CPU_PROFILE_VIP},
+    {0xF0FF, CPU_IDENTIFIER_SKIP_VX, E_CPU_PROFILE_VIP},
+    {0xF0FF, CPU_IDENTIFIER_SKIPN_VX, E_CPU_PROFILE_VIP},
+    {0xF000, CPU_IDENTIFIER_FXXX, E_CPU_PROFILE_VIP},
+    {0xFFF0, CPU_IDENTIFIER_SCROLL_DOWN, E_CPU_PROFILE_SCHIP},
+    {0xFFFF, CPU_IDENTIFIER_SCROLL_RIGHT, E_CPU_PROFILE_SCHIP},
+    {0xFFFF, CPU_IDENTIFIER_SCROLL_LEFT, E_CPU_PROFILE_SCHIP},
+    {0xFFFF, CPU_IDENTIFIER_EXIT, E_CPU_PROFILE_SCHIP},
+    {0xFFFF, CPU_IDENTIFIER_LORES, E_CPU_PROFILE_SCHIP},
+    {0xFFFF, CPU_IDENTIFIER_HIRES, E_CPU_PROFILE_SCHIP},
+    {0xFFF0, CPU_IDENTIFIER_SCROLL_UP, E_CPU_PROFILE_XOCHIP},
+    {0xF00F, CPU_IDENTIFIER_SAVE_VXVY, E_CPU_PROFILE_XOCHIP},
+    {0xF00F, CPU_IDENTIFIER_LOAD_VXVY, E_CPU_PROFILE_XOCHIP},
 };
 
 /******************************************************************
  * 4. Variable definitions (static then global)
  ******************************************************************/
 static cpuType s_cpu;
+static U8 s_cpuMemory[CPU_MAX_MEMORY_BYTES];
+static cpuProfileType s_cpuProfile = E_CPU_PROFILE_VIP;
+static netplayType *s_cpuNetplay = NULL;
+static U32 s_cpuKeyTicks = 0U;              /* Key events applied up to this time */
+static BOOL s_cpuPaused = FALSE;
 static U8 s_systemFont[CPU_SYSTEM_FONT_SIZE] = {
     0xF0, 0x90, 0x90, 0x90, 0xF0,    /* 0 */
     0x20, 0x60, 0x20, 0x20, 0x70,    /* 1 */
@@ -135,597 +189,552 @@ static U8 s_systemFont[CPU_SYSTEM_FONT_SIZE] = {
     0xF0, 0x80, 0xF0, 0x80, 0xF0,    /* E */
     0xF0, 0x80, 0xF0, 0x80, 0x80     /* F */
 };
+static U8 s_systemBigFont[CPU_SYSTEM_BIG_FONT_SIZE] = {
+    0x3C, 0x7E, 0xE7, 0xC3, 0xC3, 0xC3, 0xC3, 0xE7, 0x7E, 0x3C,    /* 0 */
+    0x18, 0x38, 0x58, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x3C,    /* 1 */
+    0x3E, 0x7F, 0xC3, 0x06, 0x0C, 0x18, 0x30, 0x60, 0xFF, 0xFF,    /* 2 */
+    0x3C, 0x7E, 0xC3, 0x03, 0x0E, 0x0E, 0x03, 0xC3, 0x7E, 0x3C,    /* 3 */
+    0x06, 0x0E, 0x1E, 0x36, 0x66, 0xC6, 0xFF, 0xFF, 0x06, 0x06,    /* 4 */
+    0xFF, 0xFF, 0xC0, 0xC0, 0xFC, 0xFE, 0x03, 0xC3, 0x7E, 0x3C,    /* 5 */
+    0x3E, 0x7C, 0xE0, 0xC0, 0xFC, 0xFE, 0xC3, 0xC3, 0x7E, 0x3C,    /* 6 */
+    0xFF, 0xFF, 0x03, 0x06, 0x0C, 0x18, 0x30, 0x60, 0x60, 0x60,    /* 7 */
+    0x3C, 0x7E, 0xC3, 0xC3, 0x7E, 0x7E, 0xC3, 0xC3, 0x7E, 0x3C,    /* 8 */
+    0x3C, 0x7E, 0xC3, 0xC3, 0x7F, 0x3F, 0x03, 0x03, 0x3E, 0x7C,    /* 9 */
+    0x18, 0x3C, 0x66, 0xC3, 0xC3, 0xFF, 0xFF, 0xC3, 0xC3, 0xC3,    /* A */
+    0xFC, 0xFE, 0xC3, 0xC3, 0xFE, 0xFE, 0xC3, 0xC3, 0xFE, 0xFC,    /* B */
+    0x3C, 0x7E, 0xC3, 0xC0, 0xC0, 0xC0, 0xC0, 0xC3, 0x7E, 0x3C,    /* C */
+    0xFC, 0xFE, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xFE, 0xFC,    /* D */
+    0xFF, 0xFF, 0xC0, 0xC0, 0xFC, 0xFC, 0xC0, 0xC0, 0xFF, 0xFF,    /* E */
+    0xFF, 0xFF, 0xC0, 0xC0, 0xFC, 0xFC, 0xC0, 0xC0, 0xC0, 0xC0     /* F */
+};
 
 /******************************************************************
  * 5. Functions prototypes (static only)
  ******************************************************************/
-static void cpuCounters(void);
-static void cpuExecute(U16 identifier);
-static U16 cpuParseOpcode(void);
-static void cpuIdentifierClearScreen();
-static void cpuIdentifierReturn();
-static void cpuIdentifierCall(U16 opCode);
-static void cpuIdentifierSE(U16 opCode);
-static void cpuIdentifierSNE(U16 opCode);
-static void cpuIdentifierSEVxVy(U16 opCode);
-static void cpuIdentifierJump(U16 opCode);
-static void cpuIdentifierSetVx(U16 opCode);
-static void cpuIdentifierAddToVx(U16 opCode);
-static void cpuIdentifier8xxx(U16 opCode);
-static void cpuIdentifierSNEVxVy(U16 opCode);
-static void cpuIdentifierSetI(U16 opCode);
-static void cpuIdentifierJumpV0(U16 opCode);
-static void cpuIdentifierRandVx(U16 opCode);
-static void cpuIdentifierDraw(U16 opCode);
-static void cpuIdentifierSkipVx(U16 opCode);
-static void cpuIdentifierSkipNVx(U16 opCode);
-static void cpuIdentifierFxxx(U16 opCode);
+static void cpuIdentifierClearScreen(cpuType *cpu);
+static void cpuIdentifierReturn(cpuType *cpu);
+static void cpuIdentifierCall(cpuType *cpu, U16 opCode);
+static void cpuIdentifierSE(cpuType *cpu, U16 opCode);
+static void cpuIdentifierSNE(cpuType *cpu, U16 opCode);
+static void cpuIdentifierSEVxVy(cpuType *cpu, U16 opCode);
+static void cpuIdentifierJump(cpuType *cpu, U16 opCode);
+static void cpuIdentifierSetVx(cpuType *cpu, U16 opCode);
+static void cpuIdentifierAddToVx(cpuType *cpu, U16 opCode);
+static void cpuIdentifierSNEVxVy(cpuType *cpu, U16 opCode);
+static void cpuIdentifierSetI(cpuType *cpu, U16 opCode);
+static void cpuIdentifierRandVx(cpuType *cpu, U16 opCode);
+static void cpuIdentifierSkipVx(cpuType *cpu, U16 opCode);
+static void cpuIdentifierSkipNVx(cpuType *cpu, U16 opCode);
+static void cpuIdentifierScroll(cpuType *cpu, U16 opCode);
+static void cpuIdentifierResolution(cpuType *cpu, U16 opCode);
+static void cpuIdentifierExit(cpuType *cpu);
+static void cpuIdentifierVxVyRange(cpuType *cpu, U16 opCode);
+static void cpuSkipNextInstruction(cpuType *cpu);
+static void cpuStepVip(cpuType *cpu);
+static void cpuStepSchip(cpuType *cpu);
+static void cpuStepXochip(cpuType *cpu);
+#if CPU_FUSION
+static U32 cpuRunVip(cpuType *cpu, U32 instructions);
+static U32 cpuRunSchip(cpuType *cpu, U32 instructions);
+static U32 cpuRunXochip(cpuType *cpu, U32 instructions);
+#endif
 
 /******************************************************************
- * FUNCTION : CpuInit()
- *    Description: Initialize cpu
+ * FUNCTION : CpuSetProfile()
+ *    Description: Select the instruction set and quirks of the
+ *                 emulator cpu, kept across resets. Call before
+ *                 loading the program.
+ *    Parameters:  profile: platform to emulate
+ *    Return:      None
+ ******************************************************************/
+void CpuSetProfile(cpuProfileType profile)
+{
+    if (profile < E_CPU_PROFILE_NUMBER)
+    {
+        s_cpuProfile = profile;
+    }
+}
+
+/******************************************************************
+ * FUNCTION : CpuSetNetplay()
+ *    Description: Let a netplay session run the emulator cpu
+ *                 instead of CpuMain()
+ *    Parameters:  netplay: session, NULL to run locally
+ *    Return:      None
+ ******************************************************************/
+void CpuSetNetplay(struct netplayType *netplay)
+{
+    s_cpuNetplay = netplay;
+}
+
+/******************************************************************
+ * FUNCTION : CpuGetDefault()
+ *    Description: Emulator cpu driven by CpuMain()
  *    Parameters:  None
+ *    Return:      Emulator cpu
+ ******************************************************************/
+cpuType * CpuGetDefault(void)
+{
+    return &s_cpu;
+}
+
+/******************************************************************
+ * FUNCTION : CpuInit()
+ *    Description: Initialize the emulator cpu, drawing on the
+ *                 window screen and reading the keyboard
+ *    Parameters:  romPath: rom file to load
  *    Return:      E_OK if initialization succeed, E_NOT_OK
  *                 otherwise.
  ******************************************************************/
-Std_ReturnType CpuInit(void)
+Std_ReturnType CpuInit(const char *romPath)
 {
-    cpuType *returnPtr = NULL;
     Std_ReturnType returnValue = E_NOT_OK;
-    U8 i;
 
-    returnPtr = (cpuType *)memset((void *)&s_cpu, 0U, sizeof(cpuType));
+    CpuAttach(&s_cpu, s_cpuMemory, DisplayGetScreen(), InputKeyboardStatus());
 
-    if (&s_cpu == returnPtr)
-    {
-        /* Set PC to start address */
-        s_cpu.pc = CPU_START_ADDRESS;
+    /* Random seed initialization */
+    CpuReset(&s_cpu, s_cpuProfile, (U32)time(NULL));
 
-        /* Set stack level to -1 */
-        s_cpu.stackLevel = -1;
+    /* Load ROM */
+    returnValue = ImportRom(romPath, s_cpu.memory, CPU_ADDRESS_SPACE(s_cpu.profile));
 
-        /* Load ROM */
-        returnValue = ImportRom(s_cpu.memory);
+    return returnValue;
+}
 
-        /* Random seed initialization */
-        srand(time(NULL));
+/******************************************************************
+ * FUNCTION : CpuLoadProgram()
+ *    Description: Reset the emulator cpu and load a program from
+ *                 a memory buffer instead of the rom file. The
+ *                 random generator always starts from the same
+ *                 seed.
+ *    Parameters:  program: program bytes
+ *                 size: number of bytes in program
+ *    Return:      E_OK if program fits in memory, E_NOT_OK
+ *                 otherwise.
+ ******************************************************************/
+Std_ReturnType CpuLoadProgram(const U8 *program, U16 size)
+{
+    CpuAttach(&s_cpu, s_cpuMemory, DisplayGetScreen(), InputKeyboardStatus());
+    CpuReset(&s_cpu, s_cpuProfile, CPU_DEFAULT_SEED);
 
-        /* Load system font */
-        for (i = 0U; i < CPU_SYSTEM_FONT_SIZE; i++)
-        {
-            s_cpu.memory[i] = s_systemFont[i];
-        }
-    }
+    return CpuLoad(&s_cpu, program, size);
+}
 
-    return returnValue;
+/******************************************************************
+ * FUNCTION : CpuAttach()
+ *    Description: Give a cpu its memory, the screen it draws on and
+ *                 the keypad it reads, all kept across resets
+ *    Parameters:  cpu: cpu to attach
+ *                 memory: CPU_MEMORY_BYTES() of the profile given
+ *                 to CpuReset()
+ *                 screen: screen planes
+ *                 keys: INPUT_NUMBER_OF_KEYBOARD_KEYS key states
+ *    Return:      None
+ ******************************************************************/
+void CpuAttach(cpuType *cpu, U8 *memory, displayScreenType *screen, const BOOL *keys)
+{
+    cpu->memory = memory;
+    cpu->screen = screen;
+    cpu->keys = keys;
 }
 
 /******************************************************************
- * FUNCTION : cpuCounters()
- *    Description: Handle time counters
- *    Parameters:  None
+ * FUNCTION : CpuCopy()
+ *    Description: Copy the registers and memory of a cpu, for save
+ *                 states and rollback. The memory, screen and keypad
+ *                 of the destination stay attached, the screen is
+ *                 not copied.
+ *    Parameters:  to: cpu attached to CPU_MEMORY_BYTES() of the
+ *                 profile of from
+ *                 from: cpu to copy
  *    Return:      None
  ******************************************************************/
-static void cpuCounters(void)
+void CpuCopy(cpuType *to, const cpuType *from)
 {
-    if (s_cpu.sysCounter > 0)
-    {
-        s_cpu.sysCounter--;
-    }
+    U8 *memory = to->memory;
+    displayScreenType *screen = to->screen;
+    const BOOL *keys = to->keys;
 
-    if (s_cpu.soundCounter > 0)
-    {
-        s_cpu.soundCounter--;
-    }
+    (void)memcpy((void *)to, (const void *)from, sizeof(cpuType));
+    (void)memcpy((void *)memory, (const void *)from->memory, CPU_MEMORY_BYTES(from->profile));
+
+    to->memory = memory;
+    to->screen = screen;
+    to->keys = keys;
 }
 
 /******************************************************************
- * FUNCTION : cpuParseOpcode()
- *    Description: 
- *    Parameters:  None
- *    Return:      Found identifier
+ * FUNCTION : CpuReset()
+ *    Description: Clear registers, memory and screen, then load
+ *                 system fonts
+ *    Parameters:  cpu: cpu to reset, see CpuAttach()
+ *                 profile: platform to emulate
+ *                 seed: random generator seed
+ *    Return:      None
  ******************************************************************/
-static U16 cpuParseOpcode(void)
+void CpuReset(cpuType *cpu, cpuProfileType profile, U32 seed)
 {
-    U16 currentOpCode = (s_cpu.memory[s_cpu.pc] << 8U) + s_cpu.memory[s_cpu.pc + 1U];
+    U8 *memory = cpu->memory;
+    displayScreenType *screen = cpu->screen;
+    const BOOL *keys = cpu->keys;
     U8 i;
-    U16 identifier = currentOpCode;
 
-    for (i = 0U; i < CPU_OPCODES_NUMBER; i++)
+    (void)memset((void *)cpu, 0U, sizeof(cpuType));
+
+    cpu->memory = memory;
+    cpu->screen = screen;
+    cpu->keys = keys;
+    cpu->profile = (profile < E_CPU_PROFILE_NUMBER) ? profile : E_CPU_PROFILE_VIP;
+    (void)memset((void *)cpu->memory, 0U, CPU_MEMORY_BYTES(cpu->profile));
+
+    /* Xorshift state must not be zero */
+    cpu->random = (0U != seed) ? seed : CPU_DEFAULT_SEED;
+
+    /* Set PC to start address */
+    cpu->pc = CPU_START_ADDRESS;
+
+    /* Set stack level to -1 */
+    cpu->stackLevel = -1;
+
+    /* Load system font */
+    for (i = 0U; i < CPU_SYSTEM_FONT_SIZE; i++)
     {
-        if ((currentOpCode & opCodeReference[i].mask) == opCodeReference[i].identifier)
-        {
-            identifier = opCodeReference[i].identifier;
-            break;
-        }
+        cpu->memory[i] = s_systemFont[i];
+    }
+
+    /* Load SUPER-CHIP big font */
+    for (i = 0U; i < CPU_SYSTEM_BIG_FONT_SIZE; i++)
+    {
+        cpu->memory[CPU_SYSTEM_BIG_FONT_ADDRESS + i] = s_systemBigFont[i];
     }
 
-    return identifier;
+    /* Programs start in low resolution */
+    DisplayReset(cpu->screen);
+}
+
+/******************************************************************
+ * FUNCTION : CpuLoad()
+ *    Description: Copy a program at CPU_START_ADDRESS
+ *    Parameters:  cpu: cpu reset with CpuReset()
+ *                 program: program bytes
+ *                 size: number of bytes in program
+ *    Return:      E_OK if program fits in the memory of the
+ *                 profile, E_NOT_OK otherwise.
+ ******************************************************************/
+Std_ReturnType CpuLoad(cpuType *cpu, const U8 *program, U32 size)
+{
+    return ImportRomBuffer(program, size, cpu->memory, CPU_ADDRESS_SPACE(cpu->profile));
 }
 
 /******************************************************************
- * FUNCTION : cpuExecute()
- *    Description: Route on the correct identifier to execute
- *    Parameters:  identifier
+ * FUNCTION : CpuTimers()
+ *    Description: Count the delay and sound timers down by one
+ *    Parameters:  cpu: emulated cpu
  *    Return:      None
  ******************************************************************/
-static void cpuExecute(U16 identifier)
+void CpuTimers(cpuType *cpu)
 {
-    U16 currentOpCode = (s_cpu.memory[s_cpu.pc] << 8U) + s_cpu.memory[s_cpu.pc + 1U];
+    if (cpu->sysCounter > 0)
+    {
+        cpu->sysCounter--;
+    }
 
-    switch (identifier)
+    if (cpu->soundCounter > 0)
     {
-    case CPU_IDENTIFIER_CLEAR_SCREEN:
-        cpuIdentifierClearScreen();
-        break;
-    case CPU_IDENTIFIER_RETURN:
-        cpuIdentifierReturn();
-        break;
-    case CPU_IDENTIFIER_CALL:
-        cpuIdentifierCall(currentOpCode);
-        break;
-    case CPU_IDENTIFIER_SE:
-        cpuIdentifierSE(currentOpCode);
-        break;
-    case CPU_IDENTIFIER_SNE:
-        cpuIdentifierSNE(currentOpCode);
-        break;
-    case CPU_IDENTIFIER_SE_VXVY:
-        cpuIdentifierSEVxVy(currentOpCode);
-        break;
-    case CPU_IDENTIFIER_JUMP:
-        cpuIdentifierJump(currentOpCode);
-        break;
-    case CPU_IDENTIFIER_SET_VX:
-        cpuIdentifierSetVx(currentOpCode);
-        break;
-    case CPU_IDENTIFIER_ADD_TO_VX:
-        cpuIdentifierAddToVx(currentOpCode);
-        break;
-    case CPU_IDENTIFIER_8XXX:
-        cpuIdentifier8xxx(currentOpCode);
-        break;
-    case CPU_IDENTIFIER_SNE_VXVY:
-        cpuIdentifierSNEVxVy(currentOpCode);
-        break;
-    case CPU_IDENTIFIER_SET_I:
-        cpuIdentifierSetI(currentOpCode);
-        break;
-    case CPU_IDENTIFIER_JUMP_V0:
-        cpuIdentifierJumpV0(currentOpCode);
-        break;
-    case CPU_IDENTIFIER_RAND_VX:
-        cpuIdentifierRandVx(currentOpCode);
-        break;
-    case CPU_IDENTIFIER_DRAW:
-        cpuIdentifierDraw(currentOpCode);
-        break;
-    case CPU_IDENTIFIER_SKIP_VX:
-        cpuIdentifierSkipVx(currentOpCode);
-        break;
-    case CPU_IDENTIFIER_SKIPN_VX:
-        cpuIdentifierSkipNVx(currentOpCode);
-        break;
-    case CPU_IDENTIFIER_FXXX:
-        cpuIdentifierFxxx(currentOpCode);
-        break;
-    case CPU_IDENTIFIER_INVALID:
-    default:
-        char szText[64];
-        sprintf(szText, "Invalid opCode: %X", identifier);
-        SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR,
-                         "Unknown opcode",
-                         szText,
-                         NULL);
-
-        exit(0);
-        break;
+        cpu->soundCounter--;
     }
 }
 
 /******************************************************************
  * FUNCTION : cpuIdentifierClearScreen()
  *    Description: Clear screen
- *    Parameters:  None
+ *    Parameters:  cpu: emulated cpu
  *    Return:      None
  ******************************************************************/
-static void cpuIdentifierClearScreen()
+static void cpuIdentifierClearScreen(cpuType *cpu)
 {
     /* Clear screen routine */
-    DisplayClearScreen();
+    DisplayClearScreen(cpu->screen);
 
     /* Increment program counter */
-    s_cpu.pc += 2U;
+    cpu->pc += 2U;
 }
 
 /******************************************************************
  * FUNCTION : cpuIdentifierReturn()
  *    Description: Return
- *    Parameters:  None
+ *    Parameters:  cpu: emulated cpu
  *    Return:      None
  ******************************************************************/
-static void cpuIdentifierReturn()
+static void cpuIdentifierReturn(cpuType *cpu)
 {
+    /* Stop on the opcode, nothing to return to */
+    if (cpu->stackLevel < 0)
+    {
+        cpu->status = E_CPU_STACK_UNDERFLOW;
+        return;
+    }
+
     /* Set pc to stack value */
-    s_cpu.pc = s_cpu.stack[s_cpu.stackLevel];
+    cpu->pc = cpu->stack[cpu->stackLevel];
 
     /* Decrement stack level */
-    s_cpu.stackLevel--;
+    cpu->stackLevel--;
 
     /* Increment program counter */
-    s_cpu.pc += 2U;
+    cpu->pc += 2U;
 }
 
 /******************************************************************
  * FUNCTION : cpuIdentifierCall()
  *    Description: Call desired routine
- *    Parameters:  opCode: jump opcode
+ *    Parameters:  cpu: emulated cpu
+ *                 opCode: jump opcode
  *    Return:      None
  ******************************************************************/
-static void cpuIdentifierCall(U16 opCode)
+static void cpuIdentifierCall(cpuType *cpu, U16 opCode)
 {
     U16 routineAddress = opCode & CPU_CALL_MASK;
 
+    /* Stop on the opcode, the stack is full */
+    if (cpu->stackLevel >= (S8)(CPU_STACK_DEPTH_LEVEL - 1U))
+    {
+        cpu->status = E_CPU_STACK_OVERFLOW;
+        return;
+    }
+
     /* Increment stack pointer */
-    s_cpu.stackLevel++; 
+    cpu->stackLevel++;
 
     /* Store pc on stack */
-    s_cpu.stack[s_cpu.stackLevel] = s_cpu.pc;
+    cpu->stack[cpu->stackLevel] = cpu->pc;
 
     /* Set program counter */
-    s_cpu.pc = routineAddress;
+    cpu->pc = routineAddress;
 }
 
 /******************************************************************
  * FUNCTION : cpuIdentifierSE()
  *    Description: Skip next instruction if Vx = kk.
- *    Parameters:  opCode: jump opcode
+ *    Parameters:  cpu: emulated cpu
+ *                 opCode: jump opcode
  *    Return:      None
  ******************************************************************/
-static void cpuIdentifierSE(U16 opCode)
+static void cpuIdentifierSE(cpuType *cpu, U16 opCode)
 {
     U8 vx = (U8)((opCode & CPU_SE_VX_MASK) >> 8U);
     U8 value = (U8)(opCode & CPU_SE_VALUE_MASK);
 
-    if (s_cpu.vx[vx] == value)
+    if (cpu->vx[vx] == value)
     {
         /* Skip next instruction */
-        s_cpu.pc += 4U;
+        cpuSkipNextInstruction(cpu);
     }
     else
     {
         /* Go to next instruction */
-        s_cpu.pc += 2U;
+        cpu->pc += 2U;
     }
 }
 
 /******************************************************************
  * FUNCTION : cpuIdentifierSNE()
  *    Description: Skip next instruction if Vx != kk.
- *    Parameters:  opCode: jump opcode
+ *    Parameters:  cpu: emulated cpu
+ *                 opCode: jump opcode
  *    Return:      None
  ******************************************************************/
-static void cpuIdentifierSNE(U16 opCode)
+static void cpuIdentifierSNE(cpuType *cpu, U16 opCode)
 {
     U8 vx = (U8)((opCode & CPU_SE_VX_MASK) >> 8U);
     U8 value = (U8)(opCode & CPU_SE_VALUE_MASK);
 
-    if (s_cpu.vx[vx] != value)
+    if (cpu->vx[vx] != value)
     {
         /* Skip next instruction */
-        s_cpu.pc += 4U;
+        cpuSkipNextInstruction(cpu);
     }
     else
     {
         /* Go to next instruction */
-        s_cpu.pc += 2U;
+        cpu->pc += 2U;
     }
 }
 
 /******************************************************************
  * FUNCTION : cpuIdentifierSEVxVy()
  *    Description: Skip next instruction if Vx = Vy.
- *    Parameters:  opCode: jump opcode
+ *    Parameters:  cpu: emulated cpu
+ *                 opCode: jump opcode
  *    Return:      None
  ******************************************************************/
-static void cpuIdentifierSEVxVy(U16 opCode)
+static void cpuIdentifierSEVxVy(cpuType *cpu, U16 opCode)
 {
     U8 vx = (U8)((opCode & CPU_SE_VXVY_VX_MASK) >> 8U);
     U8 vy = (U8)((opCode & CPU_SE_VXVY_VY_MASK) >> 4U);
 
-    if (s_cpu.vx[vx] == s_cpu.vx[vy])
+    if (cpu->vx[vx] == cpu->vx[vy])
     {
         /* Skip next instruction */
-        s_cpu.pc += 4U;
+        cpuSkipNextInstruction(cpu);
     }
     else
     {
         /* Go to next instruction */
-        s_cpu.pc += 2U;
-    }
-}
-
-/******************************************************************
- * FUNCTION : cpuIdentifier8xxx()
- *    Description: Handle all similar opcode starting with 8xxx
- *    Parameters:  opCode: jump opcode
- *    Return:      None
- ******************************************************************/
-static void cpuIdentifier8xxx(U16 opCode)
-{
-    U8 vx = (U8)((opCode & CPU_8XXX_VX_MASK) >> 8U);
-    U8 vy = (U8)((opCode & CPU_8XXX_VY_MASK) >> 4U);
-    U8 identifier = (U8)(opCode & CPU_8XXX_IDENTIFIER_MASK);
-    U16 add;
-
-    switch (identifier)
-    {
-    case 0x0:
-        /* Load Vx register with Vy */
-        s_cpu.vx[vx] = s_cpu.vx[vy];
-        break;
-    case 0x1:
-        /* Bitwise OR */
-        s_cpu.vx[vx] |= s_cpu.vx[vy];
-        break;
-    case 0x2:
-        /* Bitwise AND */
-        s_cpu.vx[vx] &= s_cpu.vx[vy];
-        break;
-    case 0x3:
-        /* Bitwise XOR */
-        s_cpu.vx[vx] ^= s_cpu.vx[vy];
-        break;
-    case 0x4:
-        add = s_cpu.vx[vx] + s_cpu.vx[vy];
-
-        /* 8-bit ADD */
-        s_cpu.vx[vx] += s_cpu.vx[vy];
-
-        if (add > 255U)
-        {
-            /* If addition is overflowing set VF to 1 */
-            s_cpu.vx[0xF] = 1U;
-        }
-        else
-        {
-            s_cpu.vx[0xF] = 0U;
-        }
-        break;
-    case 0x5:
-        if (s_cpu.vx[vx] > s_cpu.vx[vy])
-        {
-            /* Not borrow */
-            s_cpu.vx[0xF] = 1U;
-        }
-        else
-        {
-            s_cpu.vx[0xF] = 0U;
-        }
-
-        /* 8-bit SUB */
-        s_cpu.vx[vx] -= s_cpu.vx[vy];
-        break;  
-    case 0x6:
-        /* If the least-significant bit of Vx is 1 */
-        if ((s_cpu.vx[vx] & 0x01) == 1U)
-        {
-            s_cpu.vx[0xF] = 1U;
-        }
-        else
-        {
-            s_cpu.vx[0xF] = 0U;
-        }
-
-        /* Vx is divided by 2 */
-        s_cpu.vx[vx] = s_cpu.vx[vx] / 2U;
-        break;
-    case 0x7:
-        if (s_cpu.vx[vy] > s_cpu.vx[vx])
-        {
-            /* Not borrow */
-            s_cpu.vx[0xF] = 1U;
-        }
-        else
-        {
-            s_cpu.vx[0xF] = 0U;
-        }
-
-        /* 8-bit SUBN */
-        s_cpu.vx[vx] = s_cpu.vx[vy] - s_cpu.vx[vx];
-        break;  
-    case 0xE:
-        /* If the most-significant bit of Vx is 1 */
-        if ((s_cpu.vx[vx] & 0x80) == 1U)
-        {
-            s_cpu.vx[0xF] = 1U;
-        }
-        else
-        {
-            s_cpu.vx[0xF] = 0U;
-        }
-
-        /* Vx is multiplied by 2 */
-        s_cpu.vx[vx] = s_cpu.vx[vx] * 2U;
-        break;
-    default:
-        break;
+        cpu->pc += 2U;
     }
-
-    /* Go to next instruction */
-    s_cpu.pc += 2U;
 }
 
 /******************************************************************
  * FUNCTION : cpuIdentifierSNEVxVy()
  *    Description: Skip next instruction if Vx != Vy.
- *    Parameters:  opCode: jump opcode
+ *    Parameters:  cpu: emulated cpu
+ *                 opCode: jump opcode
  *    Return:      None
  ******************************************************************/
-static void cpuIdentifierSNEVxVy(U16 opCode)
+static void cpuIdentifierSNEVxVy(cpuType *cpu, U16 opCode)
 {
     U8 vx = (U8)((opCode & CPU_SNE_VXVY_VX_MASK) >> 8U);
     U8 vy = (U8)((opCode & CPU_SNE_VXVY_VY_MASK) >> 4U);
 
-    if (s_cpu.vx[vx] != s_cpu.vx[vy])
+    if (cpu->vx[vx] != cpu->vx[vy])
     {
         /* Skip next instruction */
-        s_cpu.pc += 4U;
+        cpuSkipNextInstruction(cpu);
     }
     else
     {
         /* Go to next instruction */
-        s_cpu.pc += 2U;
+        cpu->pc += 2U;
     }
 }
 
 /******************************************************************
  * FUNCTION : cpuIdentifierJump()
  *    Description: Jump to desired address
- *    Parameters:  opCode: jump opcode
+ *    Parameters:  cpu: emulated cpu
+ *                 opCode: jump opcode
  *    Return:      None
  ******************************************************************/
-static void cpuIdentifierJump(U16 opCode)
+static void cpuIdentifierJump(cpuType *cpu, U16 opCode)
 {
     U16 jumpAddress = opCode & CPU_JUMP_MASK;
 
     /* Set program counter */
-    s_cpu.pc = jumpAddress;
+    cpu->pc = jumpAddress;
 }
 
 /******************************************************************
  * FUNCTION : cpuIdentifierSetVx()
  *    Description: Set value to specified register Vx
- *    Parameters:  opCode: jump opcode
+ *    Parameters:  cpu: emulated cpu
+ *                 opCode: jump opcode
  *    Return:      None
  ******************************************************************/
-static void cpuIdentifierSetVx(U16 opCode)
+static void cpuIdentifierSetVx(cpuType *cpu, U16 opCode)
 {
     U8 reg = (U8)((opCode & CPU_SET_VX_REGISTER_MASK) >> 8U);
     U8 value = (U8)(opCode & CPU_SET_VX_VALUE_MASK);
 
     /* Set value to specified register */
-    s_cpu.vx[reg] = value;
+    cpu->vx[reg] = value;
 
     /* Increment program counter */
-    s_cpu.pc += 2U;
+    cpu->pc += 2U;
 }
 
 /******************************************************************
  * FUNCTION : cpuIdentifierAddToVx()
  *    Description: Add value to specified register Vx
- *    Parameters:  opCode: jump opcode
+ *    Parameters:  cpu: emulated cpu
+ *                 opCode: jump opcode
  *    Return:      None
  ******************************************************************/
-static void cpuIdentifierAddToVx(U16 opCode)
+static void cpuIdentifierAddToVx(cpuType *cpu, U16 opCode)
 {
     U8 reg = (U8)((opCode & CPU_SET_VX_REGISTER_MASK) >> 8U);
     U8 value = (U8)(opCode & CPU_SET_VX_VALUE_MASK);
 
     /* Set value to specified register */
-    s_cpu.vx[reg] += value;
+    cpu->vx[reg] += value;
 
     /* Increment program counter */
-    s_cpu.pc += 2U;
+    cpu->pc += 2U;
 }
 
 /******************************************************************
  * FUNCTION : cpuIdentifierSetI()
  *    Description: Set value to specified register I
- *    Parameters:  opCode: jump opcode
+ *    Parameters:  cpu: emulated cpu
+ *                 opCode: jump opcode
  *    Return:      None
  ******************************************************************/
-static void cpuIdentifierSetI(U16 opCode)
+static void cpuIdentifierSetI(cpuType *cpu, U16 opCode)
 {
     U16 value = opCode & CPU_SET_I_MASK;
 
     /* Set value to specified register */
-    s_cpu.i = value;
+    cpu->i = value;
 
     /* Increment program counter */
-    s_cpu.pc += 2U;
-}
-
-/******************************************************************
- * FUNCTION : cpuIdentifierJumpV0()
- *    Description: Jump to location nnn + V0.
- *    Parameters:  opCode: jump opcode
- *    Return:      None
- ******************************************************************/
-static void cpuIdentifierJumpV0(U16 opCode)
-{
-    U16 jumpAddress = opCode & CPU_JUMP_V0_MASK;
-
-    /* Set program counter */
-    s_cpu.pc = s_cpu.vx[0U] + jumpAddress;
+    cpu->pc += 2U;
 }
 
 /******************************************************************
  * FUNCTION : cpuIdentifierRandVx()
  *    Description: Set Vx = random byte AND kk.
- *    Parameters:  opCode: jump opcode
+ *    Parameters:  cpu: emulated cpu
+ *                 opCode: jump opcode
  *    Return:      None
  ******************************************************************/
-static void cpuIdentifierRandVx(U16 opCode)
+static void cpuIdentifierRandVx(cpuType *cpu, U16 opCode)
 {
     U8 vx = (U8)((opCode & CPU_RAND_VX_VX_MASK) >> 8U);
     U8 byte = (U8)(opCode & CPU_RAND_VX_BYTE_MASK);
+    U8 random;
 
-    /* Perform a modulus 255 to be on 1 byte */
-    U8 random = (U8)(rand() % 255U);
+    /* 32-bit xorshift generator, one byte from the high bits */
+    cpu->random ^= cpu->random << 13U;
+    cpu->random ^= (cpu->random & 0xFFFFFFFFUL) >> 17U;
+    cpu->random ^= cpu->random << 5U;
+    cpu->random &= 0xFFFFFFFFUL;
+
+    random = (U8)(cpu->random >> 24U);
 
     /* AND with the input byte */
     random = random & byte;
 
     /* Set result to vx */
-    s_cpu.vx[vx] = random;
-
-    /* Increment program counter */
-    s_cpu.pc += 2U;
-}
-
-/******************************************************************
- * FUNCTION : cpuIdentifierDraw()
- *    Description: Draw value
- *    Parameters:  opCode: draw opcode
- *    Return:      None
- ******************************************************************/
-static void cpuIdentifierDraw(U16 opCode)
-{
-    U8 vx = (U8)((opCode & CPU_DRAW_VX_MASK) >> 8U);
-    U8 x = s_cpu.vx[vx];
-    U8 vy = (U8)((opCode & CPU_DRAW_VY_MASK) >> 4U);
-    U8 y = s_cpu.vx[vy];
-    U8 n = opCode & CPU_DRAW_N_MASK; /* number of bytes to display */
-
-    DisplayDraw(&s_cpu.memory[s_cpu.i], &s_cpu.vx[0xF], x, y, n);
+    cpu->vx[vx] = random;
 
     /* Increment program counter */
-    s_cpu.pc += 2U;
+    cpu->pc += 2U;
 }
 
 /******************************************************************
  * FUNCTION : cpuIdentifierSkipVx()
  *    Description: Skip next instruction if key with the value of
  *                 Vx is pressed.
- *    Parameters:  opCode: draw opcode
+ *    Parameters:  cpu: emulated cpu
+ *                 opCode: draw opcode
  *    Return:      None
  ******************************************************************/
-static void cpuIdentifierSkipVx(U16 opCode)
+static void cpuIdentifierSkipVx(cpuType *cpu, U16 opCode)
 {
     U8 vx = (U8)((opCode & CPU_SKIP_VX_MASK) >> 8U);
-    U8 index = s_cpu.vx[vx];
-    BOOL * keyboardStatus = InputKeyboardStatus();
+    U8 index = cpu->vx[vx] & CPU_KEY_MASK;
+
+    LATENCY_READ(cpu->keys, index);
 
-    if (keyboardStatus[index] == TRUE)
+    if (cpu->keys[index] == TRUE)
     {
         /* Skip next instruction */
-        s_cpu.pc += 4U;
+        cpuSkipNextInstruction(cpu);
     }
     else
     {
         /* Go to next instruction */
-        s_cpu.pc += 2U;
+        cpu->pc += 2U;
     }
 }
 
@@ -733,154 +742,396 @@ static void cpuIdentifierSkipVx(U16 opCode)
  * FUNCTION : cpuIdentifierSkipNVx()
  *    Description: Skip next instruction if key with the value of
  *                 Vx is not pressed.
- *    Parameters:  opCode: draw opcode
+ *    Parameters:  cpu: emulated cpu
+ *                 opCode: draw opcode
  *    Return:      None
  ******************************************************************/
-static void cpuIdentifierSkipNVx(U16 opCode)
+static void cpuIdentifierSkipNVx(cpuType *cpu, U16 opCode)
 {
     U8 vx = (U8)((opCode & CPU_SKIP_VX_MASK) >> 8U);
-    U8 index = s_cpu.vx[vx];
-    BOOL * keyboardStatus = InputKeyboardStatus();
+    U8 index = cpu->vx[vx] & CPU_KEY_MASK;
 
-    if (keyboardStatus[index] != TRUE)
+    LATENCY_READ(cpu->keys, index);
+
+    if (cpu->keys[index] != TRUE)
     {
         /* Skip next instruction */
-        s_cpu.pc += 4U;
+        cpuSkipNextInstruction(cpu);
     }
     else
     {
         /* Go to next instruction */
-        s_cpu.pc += 2U;
+        cpu->pc += 2U;
     }
 }
 
 /******************************************************************
- * FUNCTION : cpuIdentifierFxxx()
- *    Description: Draw value
- *    Parameters:  opCode: draw opcode
+ * FUNCTION : cpuIdentifierScroll()
+ *    Description: Scroll down n (00Cn), up n (00Dn), right 4
+ *                 (00FB) or left 4 (00FC) pixels
+ *    Parameters:  cpu: emulated cpu
+ *                 opCode: scroll opcode
  *    Return:      None
  ******************************************************************/
-static void cpuIdentifierFxxx(U16 opCode)
+static void cpuIdentifierScroll(cpuType *cpu, U16 opCode)
 {
-    U8 vx = (U8)((opCode & CPU_FXXX_VX_MASK) >> 8U);
-    U8 identifier = (U8)(opCode & CPU_FXXX_IDENTIFIER_MASK);
+    S8 n = (S8)(opCode & CPU_SCROLL_N_MASK);
+
+    if (CPU_IDENTIFIER_SCROLL_RIGHT == opCode)
+    {
+        DisplayScroll(cpu->screen, (S8)DISPLAY_SCROLL_PIXELS, 0);
+    }
+    else if (CPU_IDENTIFIER_SCROLL_LEFT == opCode)
+    {
+        DisplayScroll(cpu->screen, -(S8)DISPLAY_SCROLL_PIXELS, 0);
+    }
+    else if (CPU_IDENTIFIER_SCROLL_DOWN == (opCode & ~CPU_SCROLL_N_MASK))
+    {
+        DisplayScroll(cpu->screen, 0, n);
+    }
+    else
+    {
+        DisplayScroll(cpu->screen, 0, (S8)-n);
+    }
+
+    /* Go to next instruction */
+    cpu->pc += 2U;
+}
+
+/******************************************************************
+ * FUNCTION : cpuIdentifierResolution()
+ *    Description: Low (00FE) or high (00FF) resolution
+ *    Parameters:  cpu: emulated cpu
+ *                 opCode: resolution opcode
+ *    Return:      None
+ ******************************************************************/
+static void cpuIdentifierResolution(cpuType *cpu, U16 opCode)
+{
+    DisplaySetHighResolution(cpu->screen, (CPU_IDENTIFIER_HIRES == opCode) ? TRUE : FALSE);
+
+    /* Go to next instruction */
+    cpu->pc += 2U;
+}
+
+/******************************************************************
+ * FUNCTION : cpuIdentifierExit()
+ *    Description: Exit the interpreter (00FD), pc stays on the
+ *                 instruction
+ *    Parameters:  cpu: emulated cpu
+ *    Return:      None
+ ******************************************************************/
+static void cpuIdentifierExit(cpuType *cpu)
+{
+    cpu->status = E_CPU_EXITED;
+}
+
+/******************************************************************
+ * FUNCTION : cpuIdentifierVxVyRange()
+ *    Description: Store (5xy2) or load (5xy3) Vx to Vy inclusive,
+ *                 in either order, at address I. I is unchanged.
+ *    Parameters:  cpu: emulated cpu
+ *                 opCode: range opcode
+ *    Return:      None
+ ******************************************************************/
+static void cpuIdentifierVxVyRange(cpuType *cpu, U16 opCode)
+{
+    U8 vx = (U8)((opCode & CPU_RANGE_VX_MASK) >> 8U);
+    U8 vy = (U8)((opCode & CPU_RANGE_VY_MASK) >> 4U);
+    U8 count = (U8)(((vx <= vy) ? (vy - vx) : (vx - vy)) + 1U);
+    U8 reg;
     U8 i;
 
-    switch (identifier)
+    for (i = 0U; i < count; i++)
     {
-    case 0x07:
-        /* Set Vx = sysCounter value */
-        s_cpu.vx[vx] = s_cpu.sysCounter;
+        reg = (vx <= vy) ? (U8)(vx + i) : (U8)(vx - i);
 
-        /* Go to next instruction */
-        s_cpu.pc += 2U;
-        break;
-    case 0x0A:
-        /* Wait for a key press, store the value of the key in Vx. */
-        s_cpu.vx[vx] = InputWaitKeyboardPressed();
+        if (CPU_IDENTIFIER_SAVE_VXVY == (opCode & CPU_RANGE_IDENTIFIER_MASK))
+        {
+            cpu->memory[cpu->i + i] = cpu->vx[reg];
+        }
+        else
+        {
+            cpu->vx[reg] = cpu->memory[cpu->i + i];
+        }
+    }
 
-        /* Go to next instruction */
-        s_cpu.pc += 2U;
-        break;
-    case 0x15:
-        /* Set delay timer = Vx */
-        s_cpu.sysCounter = s_cpu.vx[vx];
+    if (CPU_IDENTIFIER_SAVE_VXVY == (opCode & CPU_RANGE_IDENTIFIER_MASK))
+    {
+        TRACE_MEMORY(cpu->i, &cpu->memory[cpu->i], count);
+        DEBUGGER_WRITE(cpu, cpu->i, count);
+    }
 
-        /* Go to next instruction */
-        s_cpu.pc += 2U;
-        break;
-    case 0x18:
-        /* Set sound timer = Vx */
-        s_cpu.soundCounter = s_cpu.vx[vx];
+    /* Go to next instruction */
+    cpu->pc += 2U;
+}
 
-        /* Go to next instruction */
-        s_cpu.pc += 2U;
-        break;
-    case 0x1E:
-        /* Set I = I + Vx */
-        s_cpu.i += s_cpu.vx[vx];
+/******************************************************************
+ * FUNCTION : cpuSkipNextInstruction()
+ *    Description: Skip the next instruction, which is four bytes
+ *                 long for the XO-CHIP F000 nnnn
+ *    Parameters:  cpu: emulated cpu
+ *    Return:      None
+ ******************************************************************/
+static void cpuSkipNextInstruction(cpuType *cpu)
+{
+    U16 nextOpCode = (U16)((cpu->memory[cpu->pc + 2U] << 8U) + cpu->memory[cpu->pc + 3U]);
 
-        /* Go to next instruction */
-        s_cpu.pc += 2U;
-        break;
-    case 0x29:
-        /* Set I = location of sprite for digit Vx */
-        s_cpu.i = s_cpu.vx[vx] * CPU_SYSTEM_CHARACTER_FONT_SIZE;
+    if ((E_CPU_PROFILE_XOCHIP == cpu->profile) && (CPU_LONG_I_OPCODE == nextOpCode))
+    {
+        cpu->pc += 6U;
+    }
+    else
+    {
+        cpu->pc += 4U;
+    }
+}
 
-        /* Go to next instruction */
-        s_cpu.pc += 2U;
-        break;
-    case 0x33:
-        /* BCD: hundreds */
-        s_cpu.memory[s_cpu.i] = s_cpu.vx[vx] / 100U;
+/******************************************************************
+ * FUNCTION : CpuMain()
+ *    Description: One frame of the emulator cpu: timers, sound and
+ *                 CPU_INSTRUCTIONS_PER_FRAME instructions. Key
+ *                 events since the previous frame are spread over
+ *                 its instructions by timestamp.
+ *    Parameters:  None
+ *    Return:      E_OK if loop succeed, E_NOT_OK once the program
+ *                 exited or faulted, see cpuType status.
+ ******************************************************************/
+Std_ReturnType CpuMain(void)
+{
+    Std_ReturnType returnValue = E_OK;
+    U32 now = SDL_GetTicks();
+    U32 i;
 
-        /* BCD: tens */ 
-        s_cpu.memory[s_cpu.i + 1U] = (s_cpu.vx[vx] % 100U) / 10U;
+    if (FALSE != s_cpuPaused)
+    {
+        /* Keys wait in the queue until the pause ends */
+        return E_OK;
+    }
 
-        /* BCD: decimal */
-        s_cpu.memory[s_cpu.i + 2U] = s_cpu.vx[vx] % 10U;
-        
-        /* Go to next instruction */
-        s_cpu.pc += 2U;
-        break;
-    case 0x55:
-        /* Store the values of registers V0 to VX inclusive in memory starting at address I. */
-        for (i = 0U; i <= vx ; i++)
+    if (NULL != s_cpuNetplay)
+    {
+        /* The session paces the frames, both peers run the same ones */
+        (void)InputApplyKeys(now);
+        returnValue = NetplayUpdate(s_cpuNetplay, InputKeyboardStatus());
+    }
+    else
+    {
+        /* Play sound only one time, on the last tick of the sound
+         * timer so that Fx18 with 1 plays too */
+        if (1U == s_cpu.soundCounter)
         {
-            s_cpu.memory[s_cpu.i + i] = s_cpu.vx[i];
+            SoundPlay();
         }
 
-        /*  I is set to I + X + 1 after operation */
-        s_cpu.i += vx + 1U;
+        /* Update cpu counters */
+        CpuTimers(&s_cpu);
 
-        /* Go to next instruction */
-        s_cpu.pc += 2U;
-        break;
-    case 0x65:
-        /* Fill registers V0 to VX inclusive with the values stored in memory starting at address I. */
-        for (i = 0U; i <= vx ; i++)
+        for (i = 0U; (i < CPU_INSTRUCTIONS_PER_FRAME) && (E_OK == returnValue); i++)
+        {
+            /* Key events of this slice of the frame */
+            (void)InputApplyKeys(s_cpuKeyTicks + (((now - s_cpuKeyTicks) * (i + 1U)) / CPU_INSTRUCTIONS_PER_FRAME));
+
+            returnValue = CpuStep(&s_cpu);
+        }
+        METRICS_INSTRUCTIONS(i);
+
+        /* Audio comes up in the frame where Fx18 first sets the sound
+         * timer, at least a tick before it plays */
+        if (0U != s_cpu.soundCounter)
         {
-            s_cpu.vx[i] = s_cpu.memory[s_cpu.i + i];
+            SoundOpen();
         }
+    }
 
-        /*  I is set to I + X + 1 after operation */
-        s_cpu.i += vx + 1U;
+    s_cpuKeyTicks = now;
 
-        /* Go to next instruction */
-        s_cpu.pc += 2U;
-        break; 
+    METRICS_MACHINES((E_CPU_RUNNING == s_cpu.status) ? 1U : 0U, (FALSE != CpuWaitingKey(&s_cpu)) ? 1U : 0U);
+
+    return returnValue;
+}
+
+/******************************************************************
+ * FUNCTION : CpuTogglePause()
+ *    Description: Pause or resume the emulator cpu, a netplay
+ *                 session is never paused since the peer runs on
+ *    Parameters:  None
+ *    Return:      TRUE if paused
+ ******************************************************************/
+BOOL CpuTogglePause(void)
+{
+    s_cpuPaused = ((FALSE == s_cpuPaused) && (NULL == s_cpuNetplay)) ? TRUE : FALSE;
+
+    return s_cpuPaused;
+}
+
+/******************************************************************
+ * FUNCTION : CpuIdle()
+ *    Description: Nothing changes in the emulator cpu until an
+ *                 event: paused, or waiting for a key (Fx0A) with
+ *                 the timers stopped and no key queued
+ *    Parameters:  None
+ *    Return:      TRUE if frames can stop until the next event
+ ******************************************************************/
+BOOL CpuIdle(void)
+{
+    U8 i;
+
+    if (NULL != s_cpuNetplay)
+    {
+        return FALSE;
+    }
+
+    if (FALSE != s_cpuPaused)
+    {
+        return TRUE;
+    }
+
+    if ((FALSE == CpuWaitingKey(&s_cpu)) || (0U != s_cpu.sysCounter) || (0U != s_cpu.soundCounter)
+        || (FALSE != InputPending()))
+    {
+        return FALSE;
+    }
+
+    /* A key already down ends the wait at the next instruction */
+    for (i = 0U; i < INPUT_NUMBER_OF_KEYBOARD_KEYS; i++)
+    {
+        if (TRUE == s_cpu.keys[i])
+        {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+/******************************************************************
+ * FUNCTION : CpuStep()
+ *    Description: Execute one instruction, timers are left to
+ *                 CpuTimers()
+ *    Parameters:  cpu: emulated cpu
+ *    Return:      E_OK while running, E_NOT_OK once the program
+ *                 exited or faulted, see status.
+ ******************************************************************/
+Std_ReturnType CpuStep(cpuType *cpu)
+{
+    DEBUGGER_INSTRUCTION(cpu);
+
+    LATENCY_INSTRUCTION();
+
+    if (E_CPU_RUNNING != cpu->status)
+    {
+        return E_NOT_OK;
+    }
+
+    PROFILER_INSTRUCTION(cpu->pc, (U16)((cpu->memory[cpu->pc] << 8U) + cpu->memory[cpu->pc + 1U]));
+
+    TRACE_BEGIN(cpu->pc, (U16)((cpu->memory[cpu->pc] << 8U) + cpu->memory[cpu->pc + 1U]), cpu->vx, cpu->i);
+
+    /* Execute one instruction with the interpreter of the profile */
+    switch (cpu->profile)
+    {
+    case E_CPU_PROFILE_SCHIP:
+        cpuStepSchip(cpu);
+        break;
+    case E_CPU_PROFILE_XOCHIP:
+        cpuStepXochip(cpu);
+        break;
+    case E_CPU_PROFILE_VIP:
     default:
-        /* Go to next instruction */
-        s_cpu.pc += 2U;
+        cpuStepVip(cpu);
         break;
     }
+
+    TRACE_END(cpu->vx, cpu->i);
+
+    return (E_CPU_RUNNING == cpu->status) ? E_OK : E_NOT_OK;
 }
 
 /******************************************************************
- * FUNCTION : CpuMain()
- *    Description: Main cpu loop
- *    Parameters:  None
- *    Return:      E_OK if loop succeed, E_NOT_OK
- *                 otherwise.
+ * FUNCTION : CpuRun()
+ *    Description: Execute instructions like as many CpuStep(),
+ *                 running common idioms as one fused operation
+ *    Parameters:  cpu: emulated cpu
+ *                 instructions: instructions to execute at most
+ *    Return:      Instructions executed before the budget ran out
+ *                 or the program exited or faulted, see status
  ******************************************************************/
-Std_ReturnType CpuMain(void)
+U32 CpuRun(cpuType *cpu, U32 instructions)
 {
-    U16 identifier = CPU_IDENTIFIER_INVALID;
+    U32 count = 0U;
 
-    /* Update cpu counters */
-    cpuCounters();
-
-    /* Play sound only one time */
-    if (s_cpu.soundCounter == 1U)
+#if CPU_FUSION
+    switch (cpu->profile)
+    {
+    case E_CPU_PROFILE_SCHIP:
+        count = cpuRunSchip(cpu, instructions);
+        break;
+    case E_CPU_PROFILE_XOCHIP:
+        count = cpuRunXochip(cpu, instructions);
+        break;
+    case E_CPU_PROFILE_VIP:
+    default:
+        count = cpuRunVip(cpu, instructions);
+        break;
+    }
+#else
+    while ((count < instructions) && (E_OK == CpuStep(cpu)))
     {
-        SoundPlay();
+        count++;
     }
+#endif
 
-    /* Parse opcode and get identifier */
-    identifier = cpuParseOpcode();
+    return count;
+}
+
+/******************************************************************
+ * FUNCTION : CpuWaitingKey()
+ *    Description: Tell if the program waits for a key press (Fx0A)
+ *    Parameters:  cpu: emulated cpu
+ *    Return:      TRUE if waiting, FALSE otherwise
+ ******************************************************************/
+BOOL CpuWaitingKey(const cpuType *cpu)
+{
+    U16 opCode = (U16)((cpu->memory[cpu->pc] << 8U) + cpu->memory[cpu->pc + 1U]);
 
-    /* Execute one instruction */
-    cpuExecute(identifier);
+    return ((E_CPU_RUNNING == cpu->status) && (CPU_IDENTIFIER_WAIT_KEY == (opCode & CPU_WAIT_KEY_MASK))) ? TRUE : FALSE;
+}
 
-    return E_OK;
-}
\ No newline at end of file
+/******************************************************************
+ * Interpreter instances, see cpuprofile.h
+ ******************************************************************/
+#define CPU_PROFILE_FUNCTION(name)                         name##Vip
+#define CPU_PROFILE_ID                             E_CPU_PROFILE_VIP
+#define CPU_PROFILE_SCHIP_OPCODES                              FALSE
+#define CPU_PROFILE_XOCHIP_OPCODES                             FALSE
+#define CPU_PROFILE_ADDRESS_MASK              (CPU_MEMORY_SIZE - 1U)
+#define CPU_QUIRK_VF_RESET                                      TRUE
+#define CPU_QUIRK_INCREMENT_I                                   TRUE
+#define CPU_QUIRK_SHIFT_VY                                      TRUE
+#define CPU_QUIRK_JUMP_VX                                      FALSE
+#define CPU_QUIRK_WRAP                                         FALSE
+#include "cpuprofile.h"
+
+#define CPU_PROFILE_FUNCTION(name)                       name##Schip
+#define CPU_PROFILE_ID                           E_CPU_PROFILE_SCHIP
+#define CPU_PROFILE_SCHIP_OPCODES                               TRUE
+#define CPU_PROFILE_XOCHIP_OPCODES                             FALSE
+#define CPU_PROFILE_ADDRESS_MASK              (CPU_MEMORY_SIZE - 1U)
+#define CPU_QUIRK_VF_RESET                                     FALSE
+#define CPU_QUIRK_INCREMENT_I                                  FALSE
+#define CPU_QUIRK_SHIFT_VY                                     FALSE
+#define CPU_QUIRK_JUMP_VX                                       TRUE
+#define CPU_QUIRK_WRAP                                         FALSE
+#include "cpuprofile.h"
+
+#define CPU_PROFILE_FUNCTION(name)                      name##Xochip
+#define CPU_PROFILE_ID                          E_CPU_PROFILE_XOCHIP
+#define CPU_PROFILE_SCHIP_OPCODES                               TRUE
+#define CPU_PROFILE_XOCHIP_OPCODES                              TRUE
+#define CPU_PROFILE_ADDRESS_MASK           (CPU_XO_MEMORY_SIZE - 1U)
+#define CPU_QUIRK_VF_RESET                                     FALSE
+#define CPU_QUIRK_INCREMENT_I                                   TRUE
+#define CPU_QUIRK_SHIFT_VY                                      TRUE
+#define CPU_QUIRK_JUMP_VX                                      FALSE
+#define CPU_QUIRK_WRAP                                          TRUE
+#include "cpuprofile.h"
@@ -7,11 +7,14 @@
  * DESCRIPTION : Cpu emulator
  *
  ******************************************************************/
+#ifndef CPU_H_
+#define CPU_H_
 
 /******************************************************************
  * 1. Included files (microcontroller ones then user defined ones)
  ******************************************************************/
 #include "../headers/typedef.h"
+#include "../display/display.h"
 
 /******************************************************************
  * 2. Define declarations (macros then function macros)
@@ -20,11 +23,79 @@
 #define CPU_NUMBER_OF_VX_REGISTER                                16U
 #define CPU_STACK_DEPTH_LEVEL                                    16U
 #define CPU_START_ADDRESS                                     0x200U
-#define CPU_MAX_PROGRAM_SIZE     CPU_MEMORY_SIZE - CPU_START_ADDRESS
+
+/* Instructions of one 60 Hz frame run by CpuMain() */
+#define CPU_INSTRUCTIONS_PER_FRAME                               10U
+#define CPU_MAX_PROGRAM_SIZE     (CPU_MEMORY_SIZE - CPU_START_ADDRESS)
+#define CPU_FLAGS_REGISTERS                                      16U
+
+/* Sprites and register ranges may be read past the last address */
+#define CPU_MEMORY_GUARD                                         64U
+
+/* XO-CHIP addresses 64 KB */
+#define CPU_XO_MEMORY_SIZE                                   65536UL
+#define CPU_XO_MAX_PROGRAM_SIZE  (CPU_XO_MEMORY_SIZE - CPU_START_ADDRESS)
+
+/* Hot registers of cpuType, see the compile time check in cpu.c */
+#define CPU_CACHE_LINE                                           64U
+
+/* Largest machine memory, see CPU_MEMORY_BYTES() */
+#define CPU_MAX_MEMORY_BYTES    (CPU_XO_MEMORY_SIZE + CPU_MEMORY_GUARD)
+
+/* Addressable memory of a profile, pc and I wrap around it */
+#define CPU_ADDRESS_SPACE(profile) \
+    ((E_CPU_PROFILE_XOCHIP == (profile)) ? CPU_XO_MEMORY_SIZE : (U32)CPU_MEMORY_SIZE)
+
+/* Memory given to CpuAttach() for a machine of the profile */
+#define CPU_MEMORY_BYTES(profile)  (CPU_ADDRESS_SPACE(profile) + CPU_MEMORY_GUARD)
 
 /******************************************************************
  * 3. Typedef definitions (simple typedef, then enum and structs)
  ******************************************************************/
+/* Instruction set and quirks of one platform, each instruction set
+ * extends the previous one */
+typedef enum
+{
+    E_CPU_PROFILE_VIP,      /* COSMAC VIP: original instruction set, 64x32 */
+    E_CPU_PROFILE_SCHIP,    /* SUPER-CHIP 1.1: 128x64, 16x16 sprites, scrolling */
+    E_CPU_PROFILE_XOCHIP,   /* XO-CHIP: SUPER-CHIP plus 64 KB memory and two planes */
+    E_CPU_PROFILE_NUMBER
+} cpuProfileType;
+
+typedef enum
+{
+    E_CPU_RUNNING,
+    E_CPU_EXITED,           /* 00FD executed */
+    E_CPU_INVALID_OPCODE,   /* pc is left on the opcode */
+    E_CPU_STACK_OVERFLOW,   /* 2nnn with a full stack, pc is left on the opcode */
+    E_CPU_STACK_UNDERFLOW   /* 00EE with an empty stack, pc is left on the opcode */
+} cpuStatusType;
+
+/* State of one emulated machine. The memory, screen and keypad belong
+ * to the caller, see CpuAttach(), so a VIP machine does not carry
+ * XO-CHIP memory. pc, I, V0-VF, the timers and the stack fill the
+ * first cache line, status and profile are kept as bytes for it.
+ * Copy machines with CpuCopy(). */
+typedef struct
+{
+    U16 pc;
+    U16 i;
+    U8 vx[CPU_NUMBER_OF_VX_REGISTER];
+    U8 sysCounter;
+    U8 soundCounter;
+    S8 stackLevel;
+    U8 status;                      /* cpuStatusType */
+    U8 profile;                     /* cpuProfileType */
+    U16 stack[CPU_STACK_DEPTH_LEVEL];
+    U8 *memory;
+    displayScreenType *screen;
+    const BOOL *keys;
+    U32 random;
+    U8 flags[CPU_FLAGS_REGISTERS];
+} cpuType;
+
+/* Netplay session, see netplay.h */
+struct netplayType;
 
 /******************************************************************
  * 4. Variable definitions (static then global)
@@ -33,5 +104,21 @@
 /******************************************************************
  * 5. Functions prototypes (static only)
  ******************************************************************/
-extern Std_ReturnType CpuInit(void);
+extern void CpuSetProfile(cpuProfileType profile);
+extern Std_ReturnType CpuInit(const char *romPath);
+extern Std_ReturnType CpuLoadProgram(const U8 *program, U16 size);
 extern Std_ReturnType CpuMain(void);
+extern cpuType * CpuGetDefault(void);
+extern void CpuSetNetplay(struct netplayType *netplay);
+extern void CpuAttach(cpuType *cpu, U8 *memory, displayScreenType *screen, const BOOL *keys);
+extern void CpuCopy(cpuType *to, const cpuType *from);
+extern void CpuReset(cpuType *cpu, cpuProfileType profile, U32 seed);
+extern Std_ReturnType CpuLoad(cpuType *cpu, const U8 *program, U32 size);
+extern Std_ReturnType CpuStep(cpuType *cpu);
+extern U32 CpuRun(cpuType *cpu, U32 instructions);
+extern void CpuTimers(cpuType *cpu);
+extern BOOL CpuWaitingKey(const cpuType *cpu);
+extern BOOL CpuTogglePause(void);
+extern BOOL CpuIdle(void);
+
+#endif /* CPU_H_ */
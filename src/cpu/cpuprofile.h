@@ -0,0 +1,695 @@
+/******************************************************************
+ *
+ *
+ * FILE        : cpuprofile.h
+ * PROJECT     : chip8
+ * AUTHOR      : danpham
+ * DESCRIPTION : Interpreter specialized for one quirk profile.
+ *
+ *               cpu.c includes this file once per profile, with
+ *               CPU_PROFILE_FUNCTION() naming the functions of the
+ *               instance and the macros below set for the
+ *               profile. Quirks are resolved by
+ *               the preprocessor, so an instance holds no branch
+ *               on them. Not to be included anywhere else.
+ *
+ *               With CPU_FUSION, cpuRun<Profile>() matches idioms
+ *               at the pc before each dispatch and runs them as one
+ *               operation with the same result as the instructions
+ *               one by one. The match is made on the live memory at
+ *               every pc, so a jump into the middle of an idiom
+ *               just runs the rest instruction by instruction.
+ *
+ *               CPU_PROFILE_ID            profile of the instance,
+ *                                         opcodes of later profiles
+ *                                         are invalid
+ *               CPU_PROFILE_SCHIP_OPCODES SUPER-CHIP opcodes decoded
+ *               CPU_PROFILE_XOCHIP_OPCODES
+ *                                         XO-CHIP opcodes decoded
+ *               CPU_PROFILE_ADDRESS_MASK  pc and I wrap around the
+ *                                         memory of the profile
+ *               CPU_QUIRK_VF_RESET        8xy1, 8xy2, 8xy3 clear VF
+ *               CPU_QUIRK_INCREMENT_I     Fx55, Fx65 leave I past
+ *                                         the last register
+ *               CPU_QUIRK_SHIFT_VY        8xy6, 8xyE shift Vy into
+ *                                         Vx instead of Vx in place
+ *               CPU_QUIRK_JUMP_VX         Bxnn jumps to xnn + Vx
+ *                                         instead of nnn + V0
+ *               CPU_QUIRK_WRAP            sprites wrap around the
+ *                                         screen edges instead of
+ *                                         being clipped
+ *
+ ******************************************************************/
+
+/******************************************************************
+ * 1. Included files (microcontroller ones then user defined ones)
+ ******************************************************************/
+
+/******************************************************************
+ * 2. Define declarations (macros then function macros)
+ ******************************************************************/
+
+/******************************************************************
+ * 3. Typedef definitions (simple typedef, then enum and structs)
+ ******************************************************************/
+
+/******************************************************************
+ * 4. Variable definitions (static then global)
+ ******************************************************************/
+
+/******************************************************************
+ * 5. Functions prototypes (static only)
+ ******************************************************************/
+static U16 CPU_PROFILE_FUNCTION(cpuParseOpcode)(cpuType *cpu);
+static void CPU_PROFILE_FUNCTION(cpuExecute)(cpuType *cpu, U16 identifier);
+static void CPU_PROFILE_FUNCTION(cpuIdentifier8xxx)(cpuType *cpu, U16 opCode);
+static void CPU_PROFILE_FUNCTION(cpuIdentifierJumpV0)(cpuType *cpu, U16 opCode);
+static void CPU_PROFILE_FUNCTION(cpuIdentifierDraw)(cpuType *cpu, U16 opCode);
+static void CPU_PROFILE_FUNCTION(cpuIdentifierFxxx)(cpuType *cpu, U16 opCode);
+#if CPU_FUSION
+static U32 CPU_PROFILE_FUNCTION(cpuFuse)(cpuType *cpu, U32 budget);
+#endif
+
+/******************************************************************
+ * FUNCTION : cpuStep<Profile>()
+ *    Description: Decode and execute one instruction
+ *    Parameters:  cpu: emulated cpu
+ *    Return:      None
+ ******************************************************************/
+static void CPU_PROFILE_FUNCTION(cpuStep)(cpuType *cpu)
+{
+    /* Parse opcode and get identifier */
+    U16 identifier = CPU_PROFILE_FUNCTION(cpuParseOpcode)(cpu);
+
+    /* Execute one instruction */
+    CPU_PROFILE_FUNCTION(cpuExecute)(cpu, identifier);
+
+    /* Addresses wrap around the memory of the profile */
+    cpu->pc &= CPU_PROFILE_ADDRESS_MASK;
+    cpu->i &= CPU_PROFILE_ADDRESS_MASK;
+}
+
+#if CPU_FUSION
+/******************************************************************
+ * FUNCTION : cpuRun<Profile>()
+ *    Description: Execute instructions, fused when possible
+ *    Parameters:  cpu: emulated cpu
+ *                 instructions: instructions to execute at most
+ *    Return:      Instructions executed, see CpuRun()
+ ******************************************************************/
+static U32 CPU_PROFILE_FUNCTION(cpuRun)(cpuType *cpu, U32 instructions)
+{
+    U32 count = 0U;
+    U32 executed;
+
+    while ((count < instructions) && (E_CPU_RUNNING == cpu->status))
+    {
+        executed = CPU_PROFILE_FUNCTION(cpuFuse)(cpu, instructions - count);
+        if (0U == executed)
+        {
+            CPU_PROFILE_FUNCTION(cpuStep)(cpu);
+
+            /* An exit or a fault is not counted, like in CpuStep() */
+            executed = (E_CPU_RUNNING == cpu->status) ? 1U : 0U;
+        }
+        count += executed;
+    }
+
+    return count;
+}
+
+/******************************************************************
+ * FUNCTION : cpuFuse<Profile>()
+ *    Description: Run the idiom starting at pc, if any:
+ *                 6xkk 6xkk ...  register loads
+ *                 Annn Dxyn      sprite draw
+ *                 Fx07 3xkk 1nnn delay timer spin, 4xkk as well,
+ *                                run up to the budget since the
+ *                                timer is still within a frame
+ *                 Fx1E Fx65      table lookup
+ *                 None of them can fault.
+ *    Parameters:  cpu: emulated cpu
+ *                 budget: instructions left to execute
+ *    Return:      Instructions executed, 0 if no idiom fits
+ ******************************************************************/
+static U32 CPU_PROFILE_FUNCTION(cpuFuse)(cpuType *cpu, U32 budget)
+{
+    U16 opCode = CPU_FUSE_OPCODE(cpu, 0U);
+    U16 next;
+    U16 last;
+    U16 skip;
+    U8 vx = (U8)((opCode & CPU_FXXX_VX_MASK) >> 8U);
+    U8 vy;
+    U32 count = 0U;
+    BOOL equal;
+    U8 i;
+
+    if (budget < 2U)
+    {
+        return 0U;
+    }
+
+    next = CPU_FUSE_OPCODE(cpu, 2U);
+
+    switch (opCode & CPU_FUSE_OPCODE_MASK)
+    {
+    case CPU_IDENTIFIER_SET_VX:
+        do
+        {
+            cpu->vx[(opCode & CPU_SET_VX_REGISTER_MASK) >> 8U] = (U8)(opCode & CPU_SET_VX_VALUE_MASK);
+            cpu->pc = (cpu->pc + 2U) & CPU_PROFILE_ADDRESS_MASK;
+            count++;
+            opCode = CPU_FUSE_OPCODE(cpu, 0U);
+        } while ((count < budget) && (CPU_IDENTIFIER_SET_VX == (opCode & CPU_FUSE_OPCODE_MASK)));
+        break;
+    case CPU_IDENTIFIER_SET_I:
+        if (CPU_IDENTIFIER_DRAW == (next & CPU_FUSE_OPCODE_MASK))
+        {
+            cpu->i = opCode & CPU_SET_I_MASK;
+            cpu->pc += 2U;
+            CPU_PROFILE_FUNCTION(cpuIdentifierDraw)(cpu, next);
+            count = 2U;
+        }
+        break;
+    case CPU_IDENTIFIER_FXXX:
+        skip = next & CPU_FUSE_OPCODE_MASK;
+        last = CPU_FUSE_OPCODE(cpu, 4U);
+        if ((CPU_FUSE_GET_DELAY == (opCode & CPU_FUSE_FXXX_MASK))
+            && ((CPU_IDENTIFIER_SE == skip) || (CPU_IDENTIFIER_SNE == skip))
+            && (CPU_IDENTIFIER_JUMP == (last & CPU_FUSE_OPCODE_MASK)) && (cpu->pc == (last & CPU_JUMP_MASK)))
+        {
+            cpu->vx[vx] = cpu->sysCounter;
+            equal = (cpu->vx[(next & CPU_SE_VX_MASK) >> 8U] == (U8)(next & CPU_SE_VALUE_MASK)) ? TRUE : FALSE;
+
+            if (((CPU_IDENTIFIER_SE == skip) && (FALSE != equal)) || ((CPU_IDENTIFIER_SNE == skip) && (FALSE == equal)))
+            {
+                /* Skip over the jump, the spin is over */
+                cpu->pc += 6U;
+                count = 2U;
+            }
+            else
+            {
+                /* Same outcome every turn, stop where the budget ends */
+                cpu->pc += (U16)(2U * (budget % CPU_FUSE_SPIN_LENGTH));
+                count = budget;
+            }
+        }
+        else if ((CPU_FUSE_ADD_I == (opCode & CPU_FUSE_FXXX_MASK)) && (CPU_FUSE_LOAD_VX == (next & CPU_FUSE_FXXX_MASK)))
+        {
+            cpu->i = (cpu->i + cpu->vx[vx]) & CPU_PROFILE_ADDRESS_MASK;
+
+            vy = (U8)((next & CPU_FXXX_VX_MASK) >> 8U);
+            for (i = 0U; i <= vy; i++)
+            {
+                cpu->vx[i] = cpu->memory[cpu->i + i];
+            }
+
+#if CPU_QUIRK_INCREMENT_I
+            cpu->i += vy + 1U;
+#endif
+
+            cpu->pc += 4U;
+            count = 2U;
+        }
+        break;
+    default:
+        break;
+    }
+
+    /* Addresses wrap around the memory of the profile */
+    cpu->pc &= CPU_PROFILE_ADDRESS_MASK;
+    cpu->i &= CPU_PROFILE_ADDRESS_MASK;
+
+    return count;
+}
+#endif
+
+/******************************************************************
+ * FUNCTION : cpuParseOpcode<Profile>()
+ *    Description: Find the identifier of the current opcode among
+ *                 the opcodes of the profile
+ *    Parameters:  cpu: emulated cpu
+ *    Return:      Found identifier
+ ******************************************************************/
+static U16 CPU_PROFILE_FUNCTION(cpuParseOpcode)(cpuType *cpu)
+{
+    U16 currentOpCode = (cpu->memory[cpu->pc] << 8U) + cpu->memory[cpu->pc + 1U];
+    U8 i;
+    U16 identifier = currentOpCode;
+
+    for (i = 0U; i < CPU_OPCODES_NUMBER; i++)
+    {
+        if (((currentOpCode & opCodeReference[i].mask) == opCodeReference[i].identifier) && (opCodeReference[i].profile <= CPU_PROFILE_ID))
+        {
+            identifier = opCodeReference[i].identifier;
+            break;
+        }
+    }
+
+    return identifier;
+}
+
+/******************************************************************
+ * FUNCTION : cpuExecute<Profile>()
+ *    Description: Route on the correct identifier to execute
+ *    Parameters:  cpu: emulated cpu
+ *                 identifier
+ *    Return:      None
+ ******************************************************************/
+static void CPU_PROFILE_FUNCTION(cpuExecute)(cpuType *cpu, U16 identifier)
+{
+    U16 currentOpCode = (cpu->memory[cpu->pc] << 8U) + cpu->memory[cpu->pc + 1U];
+
+    switch (identifier)
+    {
+    case CPU_IDENTIFIER_CLEAR_SCREEN:
+        cpuIdentifierClearScreen(cpu);
+        break;
+    case CPU_IDENTIFIER_RETURN:
+        cpuIdentifierReturn(cpu);
+        break;
+    case CPU_IDENTIFIER_CALL:
+        cpuIdentifierCall(cpu, currentOpCode);
+        break;
+    case CPU_IDENTIFIER_SE:
+        cpuIdentifierSE(cpu, currentOpCode);
+        break;
+    case CPU_IDENTIFIER_SNE:
+        cpuIdentifierSNE(cpu, currentOpCode);
+        break;
+    case CPU_IDENTIFIER_SE_VXVY:
+        cpuIdentifierSEVxVy(cpu, currentOpCode);
+        break;
+    case CPU_IDENTIFIER_JUMP:
+        cpuIdentifierJump(cpu, currentOpCode);
+        break;
+    case CPU_IDENTIFIER_SET_VX:
+        cpuIdentifierSetVx(cpu, currentOpCode);
+        break;
+    case CPU_IDENTIFIER_ADD_TO_VX:
+        cpuIdentifierAddToVx(cpu, currentOpCode);
+        break;
+    case CPU_IDENTIFIER_8XXX:
+        CPU_PROFILE_FUNCTION(cpuIdentifier8xxx)(cpu, currentOpCode);
+        break;
+    case CPU_IDENTIFIER_SNE_VXVY:
+        cpuIdentifierSNEVxVy(cpu, currentOpCode);
+        break;
+    case CPU_IDENTIFIER_SET_I:
+        cpuIdentifierSetI(cpu, currentOpCode);
+        break;
+    case CPU_IDENTIFIER_JUMP_V0:
+        CPU_PROFILE_FUNCTION(cpuIdentifierJumpV0)(cpu, currentOpCode);
+        break;
+    case CPU_IDENTIFIER_RAND_VX:
+        cpuIdentifierRandVx(cpu, currentOpCode);
+        break;
+    case CPU_IDENTIFIER_DRAW:
+        CPU_PROFILE_FUNCTION(cpuIdentifierDraw)(cpu, currentOpCode);
+        break;
+    case CPU_IDENTIFIER_SKIP_VX:
+        cpuIdentifierSkipVx(cpu, currentOpCode);
+        break;
+    case CPU_IDENTIFIER_SKIPN_VX:
+        cpuIdentifierSkipNVx(cpu, currentOpCode);
+        break;
+    case CPU_IDENTIFIER_FXXX:
+        CPU_PROFILE_FUNCTION(cpuIdentifierFxxx)(cpu, currentOpCode);
+        break;
+    case CPU_IDENTIFIER_SCROLL_DOWN:
+    case CPU_IDENTIFIER_SCROLL_UP:
+    case CPU_IDENTIFIER_SCROLL_RIGHT:
+    case CPU_IDENTIFIER_SCROLL_LEFT:
+        cpuIdentifierScroll(cpu, currentOpCode);
+        break;
+    case CPU_IDENTIFIER_LORES:
+    case CPU_IDENTIFIER_HIRES:
+        cpuIdentifierResolution(cpu, currentOpCode);
+        break;
+    case CPU_IDENTIFIER_EXIT:
+        cpuIdentifierExit(cpu);
+        break;
+    case CPU_IDENTIFIER_SAVE_VXVY:
+    case CPU_IDENTIFIER_LOAD_VXVY:
+        cpuIdentifierVxVyRange(cpu, currentOpCode);
+        break;
+    case CPU_IDENTIFIER_INVALID:
+    default:
+        /* Stop on the opcode, see CpuMain() */
+        cpu->status = E_CPU_INVALID_OPCODE;
+        break;
+    }
+}
+
+/******************************************************************
+ * FUNCTION : cpuIdentifier8xxx<Profile>()
+ *    Description: Handle all similar opcode starting with 8xxx
+ *    Parameters:  cpu: emulated cpu
+ *                 opCode: jump opcode
+ *    Return:      None
+ ******************************************************************/
+static void CPU_PROFILE_FUNCTION(cpuIdentifier8xxx)(cpuType *cpu, U16 opCode)
+{
+    U8 vx = (U8)((opCode & CPU_8XXX_VX_MASK) >> 8U);
+    U8 vy = (U8)((opCode & CPU_8XXX_VY_MASK) >> 4U);
+    U8 identifier = (U8)(opCode & CPU_8XXX_IDENTIFIER_MASK);
+    U16 add;
+    U8 shifted;
+    U8 flag;
+
+#if CPU_QUIRK_SHIFT_VY
+    shifted = cpu->vx[vy];
+#else
+    shifted = cpu->vx[vx];
+#endif
+
+    switch (identifier)
+    {
+    case 0x0:
+        /* Load Vx register with Vy */
+        cpu->vx[vx] = cpu->vx[vy];
+        break;
+    case 0x1:
+        /* Bitwise OR */
+        cpu->vx[vx] |= cpu->vx[vy];
+#if CPU_QUIRK_VF_RESET
+        cpu->vx[0xF] = 0U;
+#endif
+        break;
+    case 0x2:
+        /* Bitwise AND */
+        cpu->vx[vx] &= cpu->vx[vy];
+#if CPU_QUIRK_VF_RESET
+        cpu->vx[0xF] = 0U;
+#endif
+        break;
+    case 0x3:
+        /* Bitwise XOR */
+        cpu->vx[vx] ^= cpu->vx[vy];
+#if CPU_QUIRK_VF_RESET
+        cpu->vx[0xF] = 0U;
+#endif
+        break;
+    case 0x4:
+        add = cpu->vx[vx] + cpu->vx[vy];
+
+        /* 8-bit ADD */
+        cpu->vx[vx] += cpu->vx[vy];
+
+        if (add > 255U)
+        {
+            /* If addition is overflowing set VF to 1 */
+            cpu->vx[0xF] = 1U;
+        }
+        else
+        {
+            cpu->vx[0xF] = 0U;
+        }
+        break;
+    case 0x5:
+        if (cpu->vx[vx] > cpu->vx[vy])
+        {
+            /* Not borrow */
+            cpu->vx[0xF] = 1U;
+        }
+        else
+        {
+            cpu->vx[0xF] = 0U;
+        }
+
+        /* 8-bit SUB */
+        cpu->vx[vx] -= cpu->vx[vy];
+        break;
+    case 0x6:
+        /* Least-significant bit shifted out */
+        flag = shifted & 0x01;
+
+        /* Divided by 2 */
+        cpu->vx[vx] = shifted >> 1U;
+        cpu->vx[0xF] = flag;
+        break;
+    case 0x7:
+        if (cpu->vx[vy] > cpu->vx[vx])
+        {
+            /* Not borrow */
+            cpu->vx[0xF] = 1U;
+        }
+        else
+        {
+            cpu->vx[0xF] = 0U;
+        }
+
+        /* 8-bit SUBN */
+        cpu->vx[vx] = cpu->vx[vy] - cpu->vx[vx];
+        break;
+    case 0xE:
+        /* Most-significant bit shifted out */
+        flag = (U8)(shifted >> 7U);
+
+        /* Multiplied by 2 */
+        cpu->vx[vx] = (U8)(shifted << 1U);
+        cpu->vx[0xF] = flag;
+        break;
+    default:
+        break;
+    }
+
+    /* Go to next instruction */
+    cpu->pc += 2U;
+}
+
+/******************************************************************
+ * FUNCTION : cpuIdentifierJumpV0<Profile>()
+ *    Description: Jump to location nnn + V0, or xnn + Vx
+ *    Parameters:  cpu: emulated cpu
+ *                 opCode: jump opcode
+ *    Return:      None
+ ******************************************************************/
+static void CPU_PROFILE_FUNCTION(cpuIdentifierJumpV0)(cpuType *cpu, U16 opCode)
+{
+    U16 jumpAddress = opCode & CPU_JUMP_V0_MASK;
+
+    /* Set program counter */
+#if CPU_QUIRK_JUMP_VX
+    cpu->pc = cpu->vx[(jumpAddress >> 8U) & 0xF] + jumpAddress;
+#else
+    cpu->pc = cpu->vx[0U] + jumpAddress;
+#endif
+}
+
+/******************************************************************
+ * FUNCTION : cpuIdentifierDraw<Profile>()
+ *    Description: Draw value
+ *    Parameters:  cpu: emulated cpu
+ *                 opCode: draw opcode
+ *    Return:      None
+ ******************************************************************/
+static void CPU_PROFILE_FUNCTION(cpuIdentifierDraw)(cpuType *cpu, U16 opCode)
+{
+    U8 vx = (U8)((opCode & CPU_DRAW_VX_MASK) >> 8U);
+    U8 x = cpu->vx[vx];
+    U8 vy = (U8)((opCode & CPU_DRAW_VY_MASK) >> 4U);
+    U8 y = cpu->vx[vy];
+    U8 n = opCode & CPU_DRAW_N_MASK; /* number of bytes to display */
+
+#if CPU_PROFILE_SCHIP_OPCODES
+    if (0U == n)
+    {
+        /* 16x16 sprite */
+        DisplayDrawWide(cpu->screen, &cpu->memory[cpu->i], &cpu->vx[0xF], x, y, CPU_QUIRK_WRAP);
+    }
+    else
+#endif
+    {
+        DisplayDraw(cpu->screen, &cpu->memory[cpu->i], &cpu->vx[0xF], x, y, n, CPU_QUIRK_WRAP);
+    }
+
+    /* Increment program counter */
+    cpu->pc += 2U;
+}
+
+/******************************************************************
+ * FUNCTION : cpuIdentifierFxxx<Profile>()
+ *    Description: Handle all similar opcode starting with Fxxx
+ *    Parameters:  cpu: emulated cpu
+ *                 opCode: Fxxx opcode
+ *    Return:      None
+ ******************************************************************/
+static void CPU_PROFILE_FUNCTION(cpuIdentifierFxxx)(cpuType *cpu, U16 opCode)
+{
+    U8 vx = (U8)((opCode & CPU_FXXX_VX_MASK) >> 8U);
+    U8 identifier = (U8)(opCode & CPU_FXXX_IDENTIFIER_MASK);
+    U8 i;
+
+    switch (identifier)
+    {
+#if CPU_PROFILE_XOCHIP_OPCODES
+    case 0x00:
+        if (CPU_LONG_I_OPCODE == opCode)
+        {
+            /* Set I = 16-bit address stored in the next word */
+            cpu->i = (U16)((cpu->memory[cpu->pc + 2U] << 8U) + cpu->memory[cpu->pc + 3U]);
+
+            /* Go after the address word */
+            cpu->pc += 2U;
+        }
+
+        /* Go to next instruction */
+        cpu->pc += 2U;
+        break;
+    case 0x01:
+        /* Select drawing planes, x is the plane mask */
+        DisplaySelectPlanes(cpu->screen, vx);
+
+        /* Go to next instruction */
+        cpu->pc += 2U;
+        break;
+#endif
+    case 0x07:
+        /* Set Vx = sysCounter value */
+        cpu->vx[vx] = cpu->sysCounter;
+
+        /* Go to next instruction */
+        cpu->pc += 2U;
+        break;
+    case 0x0A:
+        /* Wait for a key press, store the value of the key in Vx.
+         * The instruction repeats until a key is down. */
+        for (i = 0U; i < INPUT_NUMBER_OF_KEYBOARD_KEYS; i++)
+        {
+            if (TRUE == cpu->keys[i])
+            {
+                LATENCY_READ(cpu->keys, i);
+                cpu->vx[vx] = i;
+
+                /* Go to next instruction */
+                cpu->pc += 2U;
+                break;
+            }
+        }
+        break;
+    case 0x15:
+        /* Set delay timer = Vx */
+        cpu->sysCounter = cpu->vx[vx];
+
+        /* Go to next instruction */
+        cpu->pc += 2U;
+        break;
+    case 0x18:
+        /* Set sound timer = Vx */
+        cpu->soundCounter = cpu->vx[vx];
+
+        /* Go to next instruction */
+        cpu->pc += 2U;
+        break;
+    case 0x1E:
+        /* Set I = I + Vx */
+        cpu->i += cpu->vx[vx];
+
+        /* Go to next instruction */
+        cpu->pc += 2U;
+        break;
+    case 0x29:
+        /* Set I = location of sprite for digit Vx */
+        cpu->i = cpu->vx[vx] * CPU_SYSTEM_CHARACTER_FONT_SIZE;
+
+        /* Go to next instruction */
+        cpu->pc += 2U;
+        break;
+#if CPU_PROFILE_SCHIP_OPCODES
+    case 0x30:
+        /* Set I = location of big sprite for digit Vx */
+        cpu->i = CPU_SYSTEM_BIG_FONT_ADDRESS + ((cpu->vx[vx] & 0x0F) * CPU_SYSTEM_BIG_CHARACTER_FONT_SIZE);
+
+        /* Go to next instruction */
+        cpu->pc += 2U;
+        break;
+#endif
+    case 0x33:
+        /* BCD: hundreds */
+        cpu->memory[cpu->i] = cpu->vx[vx] / 100U;
+
+        /* BCD: tens */
+        cpu->memory[cpu->i + 1U] = (cpu->vx[vx] % 100U) / 10U;
+
+        /* BCD: decimal */
+        cpu->memory[cpu->i + 2U] = cpu->vx[vx] % 10U;
+
+        TRACE_MEMORY(cpu->i, &cpu->memory[cpu->i], 3U);
+        DEBUGGER_WRITE(cpu, cpu->i, 3U);
+
+        /* Go to next instruction */
+        cpu->pc += 2U;
+        break;
+    case 0x55:
+        /* Store the values of registers V0 to VX inclusive in memory starting at address I. */
+        for (i = 0U; i <= vx ; i++)
+        {
+            cpu->memory[cpu->i + i] = cpu->vx[i];
+        }
+
+        TRACE_MEMORY(cpu->i, &cpu->memory[cpu->i], (U8)(vx + 1U));
+        DEBUGGER_WRITE(cpu, cpu->i, vx + 1U);
+
+#if CPU_QUIRK_INCREMENT_I
+        /*  I is set to I + X + 1 after operation */
+        cpu->i += vx + 1U;
+#endif
+
+        /* Go to next instruction */
+        cpu->pc += 2U;
+        break;
+    case 0x65:
+        /* Fill registers V0 to VX inclusive with the values stored in memory starting at address I. */
+        for (i = 0U; i <= vx ; i++)
+        {
+            cpu->vx[i] = cpu->memory[cpu->i + i];
+        }
+
+#if CPU_QUIRK_INCREMENT_I
+        /*  I is set to I + X + 1 after operation */
+        cpu->i += vx + 1U;
+#endif
+
+        /* Go to next instruction */
+        cpu->pc += 2U;
+        break;
+#if CPU_PROFILE_SCHIP_OPCODES
+    case 0x75:
+        /* Store V0 to VX inclusive in the flags registers */
+        for (i = 0U; i <= vx ; i++)
+        {
+            cpu->flags[i] = cpu->vx[i];
+        }
+
+        /* Go to next instruction */
+        cpu->pc += 2U;
+        break;
+    case 0x85:
+        /* Fill V0 to VX inclusive from the flags registers */
+        for (i = 0U; i <= vx ; i++)
+        {
+            cpu->vx[i] = cpu->flags[i];
+        }
+
+        /* Go to next instruction */
+        cpu->pc += 2U;
+        break;
+#endif
+    default:
+        /* Go to next instruction */
+        cpu->pc += 2U;
+        break;
+    }
+}
+
+#undef CPU_PROFILE_FUNCTION
+#undef CPU_PROFILE_ID
+#undef CPU_PROFILE_SCHIP_OPCODES
+#undef CPU_PROFILE_XOCHIP_OPCODES
+#undef CPU_PROFILE_ADDRESS_MASK
+#undef CPU_QUIRK_VF_RESET
+#undef CPU_QUIRK_INCREMENT_I
+#undef CPU_QUIRK_SHIFT_VY
+#undef CPU_QUIRK_JUMP_VX
+#undef CPU_QUIRK_WRAP
@@ -0,0 +1,405 @@
+/******************************************************************
+ *
+ *
+ * FILE        : debugger.c
+ * PROJECT     : chip8
+ * AUTHOR      : danpham
+ * DESCRIPTION : Console debugger of the emulator cpu. The emulator
+ *               stops inside CpuStep() before an instruction and
+ *               reads commands from the console until it is told
+ *               to go on, the window is not refreshed meanwhile.
+ *
+ ******************************************************************/
+
+/******************************************************************
+ * 1. Included files (microcontroller ones then user defined ones)
+ ******************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include "debugger.h"
+#include "../analysis/analysis.h"
+
+/******************************************************************
+ * 2. Define declarations (macros then function macros)
+ ******************************************************************/
+#define DEBUGGER_LINE_SIZE                                      128U
+#define DEBUGGER_COMMAND_SIZE                                    16U
+#define DEBUGGER_LIST_COUNT                                       8U
+#define DEBUGGER_DUMP_COUNT                                      64U
+#define DEBUGGER_DUMP_PER_LINE                                   16U
+
+/******************************************************************
+ * 3. Typedef definitions (simple typedef, then enum and structs)
+ ******************************************************************/
+typedef struct
+{
+    U32 steps;                      /* Instructions left to step */
+    BOOL written;                   /* A watched address was written */
+    U16 writePc;
+    U32 writeAddress;
+    U32 writeCount;
+} debuggerType;
+
+/******************************************************************
+ * 4. Variable definitions (static then global)
+ ******************************************************************/
+static debuggerType s_debugger;
+
+debuggerPointsType debuggerPoints;
+
+/******************************************************************
+ * 5. Functions prototypes (static only)
+ ******************************************************************/
+static BOOL debuggerCommand(cpuType *cpu, const char *line);
+static void debuggerRegisters(const cpuType *cpu);
+static void debuggerList(const cpuType *cpu, U32 address, U32 count);
+static void debuggerDump(const cpuType *cpu, U32 address, U32 count);
+static void debuggerInfo(void);
+static U32 debuggerMemorySize(const cpuType *cpu);
+
+/******************************************************************
+ * FUNCTION : DebuggerInit()
+ *    Description: Clear breakpoints and watchpoints
+ *    Parameters:  stop: stop before the first instruction
+ *    Return:      None
+ ******************************************************************/
+void DebuggerInit(BOOL stop)
+{
+    (void)memset((void *)&debuggerPoints, 0, sizeof(debuggerPoints));
+    (void)memset((void *)&s_debugger, 0, sizeof(s_debugger));
+
+    debuggerPoints.stop = stop;
+    s_debugger.steps = 1U;
+
+    printf("Debugger: F12 stops the emulator, h lists the commands.\n");
+}
+
+/******************************************************************
+ * FUNCTION : DebuggerStop()
+ *    Description: Stop before the instruction at pc if a breakpoint,
+ *                 watchpoint or step asks for it, then run commands
+ *                 until continue or step
+ *    Parameters:  cpu: emulated cpu
+ *    Return:      None
+ ******************************************************************/
+void DebuggerStop(cpuType *cpu)
+{
+    char line[DEBUGGER_LINE_SIZE];
+    BOOL breakpoint = DEBUGGER_BIT(debuggerPoints.breakpoints, cpu->pc) ? TRUE : FALSE;
+
+    /* Stepping over several instructions */
+    if ((FALSE == breakpoint) && (FALSE == s_debugger.written) && (s_debugger.steps > 1U))
+    {
+        s_debugger.steps--;
+        return;
+    }
+
+    if (FALSE != s_debugger.written)
+    {
+        printf("Watchpoint: %03X wrote %lu bytes at %04lX\n", s_debugger.writePc,
+               (unsigned long)s_debugger.writeCount, (unsigned long)s_debugger.writeAddress);
+        s_debugger.written = FALSE;
+    }
+    else if (FALSE != breakpoint)
+    {
+        printf("Breakpoint %03X\n", cpu->pc);
+    }
+
+    debuggerRegisters(cpu);
+    debuggerList(cpu, cpu->pc, 1U);
+
+    debuggerPoints.stop = FALSE;
+    s_debugger.steps = 1U;
+
+    do
+    {
+        printf("(chip8) ");
+        (void)fflush(stdout);
+
+        /* End of input: run without stopping */
+        if (NULL == fgets(line, sizeof(line), stdin))
+        {
+            (void)memset((void *)&debuggerPoints, 0, sizeof(debuggerPoints));
+            break;
+        }
+    } while (FALSE == debuggerCommand(cpu, line));
+}
+
+/******************************************************************
+ * FUNCTION : DebuggerWrite()
+ *    Description: Stop at the next instruction if a write touches a
+ *                 watched address
+ *    Parameters:  cpu: emulated cpu, pc still on the writing opcode
+ *                 address: first address written
+ *                 count: bytes written
+ *    Return:      None
+ ******************************************************************/
+void DebuggerWrite(const cpuType *cpu, U32 address, U32 count)
+{
+    U32 k;
+
+    for (k = 0U; (k < count) && ((address + k) < CPU_XO_MEMORY_SIZE); k++)
+    {
+        if (DEBUGGER_BIT(debuggerPoints.watchpoints, address + k))
+        {
+            s_debugger.written = TRUE;
+            s_debugger.writePc = cpu->pc;
+            s_debugger.writeAddress = address;
+            s_debugger.writeCount = count;
+            debuggerPoints.stop = TRUE;
+            break;
+        }
+    }
+}
+
+/******************************************************************
+ * FUNCTION : DebuggerSetBreakpoint()
+ *    Description: Set or clear a breakpoint
+ *    Parameters:  address: instruction address
+ *                 set: TRUE to set, FALSE to clear
+ *    Return:      None
+ ******************************************************************/
+void DebuggerSetBreakpoint(U16 address, BOOL set)
+{
+    if (FALSE != set)
+    {
+        debuggerPoints.breakpoints[address >> 3U] |= (U8)(1U << (address & 7U));
+    }
+    else
+    {
+        debuggerPoints.breakpoints[address >> 3U] &= (U8)~(1U << (address & 7U));
+    }
+}
+
+/******************************************************************
+ * FUNCTION : DebuggerSetWatchpoint()
+ *    Description: Watch or stop watching writes to an address range
+ *    Parameters:  first, last: range, inclusive
+ *                 set: TRUE to watch, FALSE to stop watching
+ *    Return:      None
+ ******************************************************************/
+void DebuggerSetWatchpoint(U32 first, U32 last, BOOL set)
+{
+    U32 address;
+
+    for (address = first; (address <= last) && (address < CPU_XO_MEMORY_SIZE); address++)
+    {
+        if (FALSE != set)
+        {
+            debuggerPoints.watchpoints[address >> 3U] |= (U8)(1U << (address & 7U));
+        }
+        else
+        {
+            debuggerPoints.watchpoints[address >> 3U] &= (U8)~(1U << (address & 7U));
+        }
+    }
+
+    /* The write hook is skipped once nothing is watched */
+    debuggerPoints.watching = FALSE;
+    for (address = 0U; address < DEBUGGER_BITMAP_SIZE; address++)
+    {
+        if (0U != debuggerPoints.watchpoints[address])
+        {
+            debuggerPoints.watching = TRUE;
+            break;
+        }
+    }
+}
+
+/******************************************************************
+ * FUNCTION : debuggerCommand()
+ *    Description: Run one command line, addresses in hexadecimal
+ *    Parameters:  cpu: emulated cpu
+ *                 line: command line
+ *    Return:      TRUE when the emulator goes on, FALSE to read
+ *                 another command
+ ******************************************************************/
+static BOOL debuggerCommand(cpuType *cpu, const char *line)
+{
+    char command[DEBUGGER_COMMAND_SIZE] = "";
+    unsigned long first = 0UL;
+    unsigned long second = 0UL;
+    int count = sscanf(line, "%15s %lx %lx", command, &first, &second);
+
+    /* Empty line steps */
+    if ((count <= 0) || (0 == strcmp(command, "s")))
+    {
+        s_debugger.steps = ((count >= 2) && (0UL != first)) ? (U32)first : 1U;
+        debuggerPoints.stop = TRUE;
+        return TRUE;
+    }
+    if (0 == strcmp(command, "c"))
+    {
+        return TRUE;
+    }
+    if (0 == strcmp(command, "q"))
+    {
+        /* Closes the window like 00FD */
+        cpu->status = E_CPU_EXITED;
+        return TRUE;
+    }
+
+    if (((0 == strcmp(command, "b")) || (0 == strcmp(command, "d"))) && (count >= 2))
+    {
+        DebuggerSetBreakpoint((U16)first, (0 == strcmp(command, "b")) ? TRUE : FALSE);
+    }
+    else if (((0 == strcmp(command, "w")) || (0 == strcmp(command, "u"))) && (count >= 2))
+    {
+        DebuggerSetWatchpoint((U32)first, (count >= 3) ? (U32)second : (U32)first,
+                              (0 == strcmp(command, "w")) ? TRUE : FALSE);
+    }
+    else if (0 == strcmp(command, "r"))
+    {
+        debuggerRegisters(cpu);
+    }
+    else if (0 == strcmp(command, "l"))
+    {
+        debuggerList(cpu, (count >= 2) ? (U32)first : cpu->pc, (count >= 3) ? (U32)second : DEBUGGER_LIST_COUNT);
+    }
+    else if (0 == strcmp(command, "x"))
+    {
+        debuggerDump(cpu, (count >= 2) ? (U32)first : cpu->i, (count >= 3) ? (U32)second : DEBUGGER_DUMP_COUNT);
+    }
+    else if (0 == strcmp(command, "i"))
+    {
+        debuggerInfo();
+    }
+    else
+    {
+        printf("s [N]          step N instructions, also an empty line\n"
+               "c              continue\n"
+               "b ADDR         set a breakpoint\n"
+               "d ADDR         delete a breakpoint\n"
+               "w FIRST [LAST] watch writes to a range\n"
+               "u FIRST [LAST] stop watching a range\n"
+               "i              list breakpoints and watchpoints\n"
+               "r              registers and stack\n"
+               "l [ADDR [N]]   disassemble N instructions\n"
+               "x [ADDR [N]]   dump N bytes, at I by default\n"
+               "q              quit\n");
+    }
+
+    return FALSE;
+}
+
+/******************************************************************
+ * FUNCTION : debuggerRegisters()
+ *    Description: Print registers, timers and stack
+ *    Parameters:  cpu: emulated cpu
+ *    Return:      None
+ ******************************************************************/
+static void debuggerRegisters(const cpuType *cpu)
+{
+    S8 level;
+    U8 i;
+
+    printf("PC %04X  I %04X  DT %02X  ST %02X\n", cpu->pc, cpu->i, cpu->sysCounter, cpu->soundCounter);
+    for (i = 0U; i < CPU_NUMBER_OF_VX_REGISTER; i++)
+    {
+        printf("V%X %02X%s", i, cpu->vx[i], (7U == (i % 8U)) ? "\n" : "  ");
+    }
+
+    printf("Stack");
+    for (level = cpu->stackLevel; level >= 0; level--)
+    {
+        printf(" %04X", cpu->stack[level]);
+    }
+    printf("\n");
+}
+
+/******************************************************************
+ * FUNCTION : debuggerList()
+ *    Description: Disassemble instructions
+ *    Parameters:  cpu: emulated cpu
+ *                 address: first instruction
+ *                 count: instructions to print
+ *    Return:      None
+ ******************************************************************/
+static void debuggerList(const cpuType *cpu, U32 address, U32 count)
+{
+    char text[ANALYSIS_TEXT_SIZE];
+    U32 memorySize = debuggerMemorySize(cpu);
+    U32 k;
+
+    for (k = 0U; (k < count) && (address < memorySize); k++)
+    {
+        (void)AnalysisDisassemble(cpu->memory, memorySize, (U16)address, (cpuProfileType)cpu->profile, text, sizeof(text));
+        printf("%c%c %04lX  %02X%02X  %s\n", (address == cpu->pc) ? '>' : ' ',
+               DEBUGGER_BIT(debuggerPoints.breakpoints, address) ? '*' : ' ',
+               (unsigned long)address, cpu->memory[address], cpu->memory[address + 1U], text);
+
+        /* Listing goes on by opcode pairs, data is shown as DW */
+        address += 2U;
+    }
+}
+
+/******************************************************************
+ * FUNCTION : debuggerDump()
+ *    Description: Print memory bytes
+ *    Parameters:  cpu: emulated cpu
+ *                 address: first byte
+ *                 count: bytes to print
+ *    Return:      None
+ ******************************************************************/
+static void debuggerDump(const cpuType *cpu, U32 address, U32 count)
+{
+    U32 memorySize = debuggerMemorySize(cpu);
+    U32 k;
+
+    for (k = 0U; (k < count) && ((address + k) < memorySize); k++)
+    {
+        if (0U == (k % DEBUGGER_DUMP_PER_LINE))
+        {
+            printf("%s%04lX ", (0U == k) ? "" : "\n", (unsigned long)(address + k));
+        }
+        printf(" %02X", cpu->memory[address + k]);
+    }
+    printf("\n");
+}
+
+/******************************************************************
+ * FUNCTION : debuggerInfo()
+ *    Description: Print breakpoints, then watched ranges
+ *    Parameters:  None
+ *    Return:      None
+ ******************************************************************/
+static void debuggerInfo(void)
+{
+    U32 address;
+    U32 first;
+
+    printf("Breakpoints:");
+    for (address = 0U; address < CPU_XO_MEMORY_SIZE; address++)
+    {
+        if (DEBUGGER_BIT(debuggerPoints.breakpoints, address))
+        {
+            printf(" %04lX", (unsigned long)address);
+        }
+    }
+
+    printf("\nWatchpoints:");
+    for (address = 0U; address < CPU_XO_MEMORY_SIZE; address++)
+    {
+        if (DEBUGGER_BIT(debuggerPoints.watchpoints, address))
+        {
+            first = address;
+            while (((address + 1U) < CPU_XO_MEMORY_SIZE) && DEBUGGER_BIT(debuggerPoints.watchpoints, address + 1U))
+            {
+                address++;
+            }
+            printf(" %04lX-%04lX", (unsigned long)first, (unsigned long)address);
+        }
+    }
+    printf("\n");
+}
+
+/******************************************************************
+ * FUNCTION : debuggerMemorySize()
+ *    Description: Addressable memory of the cpu profile
+ *    Parameters:  cpu: emulated cpu
+ *    Return:      Size in bytes
+ ******************************************************************/
+static U32 debuggerMemorySize(const cpuType *cpu)
+{
+    return CPU_ADDRESS_SPACE(cpu->profile);
+}
@@ -0,0 +1,80 @@
+/******************************************************************
+ *
+ *
+ * FILE        : debugger.h
+ * PROJECT     : chip8
+ * AUTHOR      : danpham
+ * DESCRIPTION : Console debugger of the emulator cpu: step,
+ *               continue, breakpoints on pc, watchpoints on memory
+ *               writes, registers and memory. Build with
+ *               -DDEBUGGER_ENABLED to turn the hooks on, they are
+ *               compiled out otherwise.
+ *
+ ******************************************************************/
+#ifndef DEBUGGER_H_
+#define DEBUGGER_H_
+
+/******************************************************************
+ * 1. Included files (microcontroller ones then user defined ones)
+ ******************************************************************/
+#include <SDL2/SDL.h>
+#include "../headers/typedef.h"
+#include "../cpu/cpu.h"
+
+/******************************************************************
+ * 2. Define declarations (macros then function macros)
+ ******************************************************************/
+/* One bit per address of the largest memory */
+#define DEBUGGER_BITMAP_SIZE                 (CPU_XO_MEMORY_SIZE / 8U)
+
+/* Stops the emulator at the next instruction */
+#define DEBUGGER_BREAK_KEY                                  SDLK_F12
+
+#define DEBUGGER_BIT(bitmap, address)   (0U != ((bitmap)[(address) >> 3U] & (1U << ((address) & 7U))))
+
+/* The instruction hook costs one bit test and one flag test with
+ * nothing set, writes are only checked by the opcodes storing to
+ * memory (Fx33, Fx55, 5xy2) while a watchpoint is set */
+#ifdef DEBUGGER_ENABLED
+#define DEBUGGER_START(stop)                  DebuggerInit(stop)
+#define DEBUGGER_INSTRUCTION(cpu)             do { if ((FALSE != debuggerPoints.stop) \
+                                                       || DEBUGGER_BIT(debuggerPoints.breakpoints, (cpu)->pc)) \
+                                                   { DebuggerStop(cpu); } } while (0)
+#define DEBUGGER_WRITE(cpu, address, count)   do { if (FALSE != debuggerPoints.watching) \
+                                                   { DebuggerWrite((cpu), (address), (count)); } } while (0)
+#define DEBUGGER_KEY(sym)                     do { if (DEBUGGER_BREAK_KEY == (sym)) \
+                                                   { debuggerPoints.stop = TRUE; } } while (0)
+#else
+#define DEBUGGER_START(stop)                  (void)(stop)
+#define DEBUGGER_INSTRUCTION(cpu)
+#define DEBUGGER_WRITE(cpu, address, count)
+#define DEBUGGER_KEY(sym)
+#endif
+
+/******************************************************************
+ * 3. Typedef definitions (simple typedef, then enum and structs)
+ ******************************************************************/
+/* State read by the hooks on every instruction */
+typedef struct
+{
+    BOOL stop;                      /* Stop at the next instruction */
+    BOOL watching;                  /* At least one watched address */
+    U8 breakpoints[DEBUGGER_BITMAP_SIZE];
+    U8 watchpoints[DEBUGGER_BITMAP_SIZE];
+} debuggerPointsType;
+
+/******************************************************************
+ * 4. Variable definitions (static then global)
+ ******************************************************************/
+extern debuggerPointsType debuggerPoints;
+
+/******************************************************************
+ * 5. Functions prototypes (static only)
+ ******************************************************************/
+extern void DebuggerInit(BOOL stop);
+extern void DebuggerStop(cpuType *cpu);
+extern void DebuggerWrite(const cpuType *cpu, U32 address, U32 count);
+extern void DebuggerSetBreakpoint(U16 address, BOOL set);
+extern void DebuggerSetWatchpoint(U32 first, U32 last, BOOL set);
+
+#endif /* DEBUGGER_H_ */
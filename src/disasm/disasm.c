@@ -0,0 +1,240 @@
+/******************************************************************
+ *
+ *
+ * FILE        : disasm.c
+ * PROJECT     : chip8
+ * AUTHOR      : danpham
+ * DESCRIPTION : Print the analysis of a rom: listing with code,
+ *               data and labels, or its control flow graph in
+ *               Graphviz format
+ *
+ ******************************************************************/
+
+/******************************************************************
+ * 1. Included files (microcontroller ones then user defined ones)
+ ******************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../analysis/analysis.h"
+#include "../import/import.h"
+
+/******************************************************************
+ * 2. Define declarations (macros then function macros)
+ ******************************************************************/
+#define DISASM_DATA_PER_LINE                                      8U
+
+/******************************************************************
+ * 3. Typedef definitions (simple typedef, then enum and structs)
+ ******************************************************************/
+
+/******************************************************************
+ * 4. Variable definitions (static then global)
+ ******************************************************************/
+
+/******************************************************************
+ * 5. Functions prototypes (static only)
+ ******************************************************************/
+static void disasmListing(const analysisType *analysis);
+static void disasmGraph(const analysisType *analysis);
+static const char * disasmNote(U8 flags);
+
+/******************************************************************
+ * FUNCTION : main(int argc, char** argv)
+ *    Description: Usage: disasm [--vip | --schip | --xochip] [--dot]
+ *                               ROM
+ *    Parameters:  None
+ *    Return:      0 on success, 1 otherwise
+ ******************************************************************/
+int main(int argc, char **argv)
+{
+    cpuProfileType profile = E_CPU_PROFILE_VIP;
+    const analysisType *analysis;
+    const char *romPath = NULL;
+    const U8 *rom;
+    U32 size = 0U;
+    BOOL graph = FALSE;
+    int arg;
+
+    for (arg = 1; arg < argc; arg++)
+    {
+        if (0 == strcmp(argv[arg], "--vip"))
+        {
+            profile = E_CPU_PROFILE_VIP;
+        }
+        else if (0 == strcmp(argv[arg], "--schip"))
+        {
+            profile = E_CPU_PROFILE_SCHIP;
+        }
+        else if (0 == strcmp(argv[arg], "--xochip"))
+        {
+            profile = E_CPU_PROFILE_XOCHIP;
+        }
+        else if (0 == strcmp(argv[arg], "--dot"))
+        {
+            graph = TRUE;
+        }
+        else
+        {
+            romPath = argv[arg];
+        }
+    }
+
+    if (NULL == romPath)
+    {
+        printf("Usage: disasm [--vip | --schip | --xochip] [--dot] ROM\n");
+        return 1;
+    }
+
+    rom = ImportRomCached(romPath, &size);
+    analysis = (NULL != rom) ? AnalysisGet(rom, size, profile) : NULL;
+    if (NULL == analysis)
+    {
+        printf("Unable to analyse %s\n", romPath);
+        ImportExit();
+        return 1;
+    }
+
+    if (FALSE != graph)
+    {
+        disasmGraph(analysis);
+    }
+    else
+    {
+        disasmListing(analysis);
+    }
+
+    AnalysisExit();
+    ImportExit();
+
+    return 0;
+}
+
+/******************************************************************
+ * FUNCTION : disasmListing()
+ *    Description: Print the rom as code and data, with a label on
+ *                 every block
+ *    Parameters:  analysis: analysis
+ *    Return:      None
+ ******************************************************************/
+static void disasmListing(const analysisType *analysis)
+{
+    char text[ANALYSIS_TEXT_SIZE];
+    U32 address = CPU_START_ADDRESS;
+    U32 end = CPU_START_ADDRESS + analysis->romSize;
+    U32 length;
+    U32 k;
+    U8 flags;
+
+    printf("; rom %016llX, %lu bytes, %lu instructions, %lu blocks%s%s%s\n",
+           (unsigned long long)analysis->hash, (unsigned long)analysis->romSize,
+           (unsigned long)analysis->instructionCount, (unsigned long)analysis->blockCount,
+           (FALSE != analysis->indirect) ? ", indirect jumps" : "",
+           (FALSE != analysis->selfModifying) ? ", self-modifying" : "",
+           (FALSE != analysis->unknownWrites) ? ", writes through unknown I" : "");
+
+    while (address < end)
+    {
+        flags = analysis->flags[address];
+
+        if (0U != (flags & ANALYSIS_CODE))
+        {
+            if (0U != (flags & ANALYSIS_BLOCK))
+            {
+                printf("\n%c%03lX:\n", (0U != (flags & ANALYSIS_CALL)) ? 'S' : 'L', (unsigned long)address);
+            }
+
+            length = AnalysisDisassemble(analysis->memory, analysis->memorySize, (U16)address, analysis->profile,
+                                         text, sizeof(text));
+            printf("    %03lX  %02X%02X  %-20s%s\n", (unsigned long)address, analysis->memory[address],
+                   analysis->memory[(address + 1U) % analysis->memorySize], text, disasmNote(flags));
+            address += length;
+        }
+        else
+        {
+            /* Data up to the next instruction */
+            printf("    %03lX  DB   ", (unsigned long)address);
+            for (k = 0U; (k < DISASM_DATA_PER_LINE) && ((address + k) < end)
+                         && (0U == (analysis->flags[address + k] & ANALYSIS_CODE)); k++)
+            {
+                printf("%s0x%02X", (0U == k) ? "" : ", ", analysis->memory[address + k]);
+                flags |= analysis->flags[address + k];
+            }
+            printf("%s%s\n", ('\0' != disasmNote(flags)[0U]) ? "  " : "", disasmNote(flags));
+            address += k;
+        }
+    }
+}
+
+/******************************************************************
+ * FUNCTION : disasmGraph()
+ *    Description: Print the blocks and their successors as a dot
+ *                 graph
+ *    Parameters:  analysis: analysis
+ *    Return:      None
+ ******************************************************************/
+static void disasmGraph(const analysisType *analysis)
+{
+    char text[ANALYSIS_TEXT_SIZE];
+    const analysisBlockType *block;
+    U32 address;
+    U32 length;
+    U32 i;
+    U32 s;
+
+    printf("digraph rom {\n    node [shape=box, fontname=monospace];\n");
+
+    for (i = 0U; i < analysis->blockCount; i++)
+    {
+        block = &analysis->blocks[i];
+
+        printf("    b%03X [label=\"", block->start);
+        for (address = block->start; address < block->end; address += length)
+        {
+            length = AnalysisDisassemble(analysis->memory, analysis->memorySize, (U16)address, analysis->profile,
+                                         text, sizeof(text));
+            printf("%03lX  %s\\l", (unsigned long)address, text);
+        }
+        printf("\"%s];\n", (0U != (analysis->flags[block->start] & ANALYSIS_CALL)) ? ", style=bold" : "");
+
+        for (s = 0U; s < block->successorCount; s++)
+        {
+            printf("    b%03X -> b%03X%s;\n", block->start, block->successors[s],
+                   ((ANALYSIS_END_CALL == block->kind) && (1U == s)) ? " [style=dashed]" : "");
+        }
+    }
+
+    printf("}\n");
+}
+
+/******************************************************************
+ * FUNCTION : disasmNote()
+ *    Description: Comment for the flags of a line
+ *    Parameters:  flags: ANALYSIS_* of the line
+ *    Return:      Comment, empty if nothing to note
+ ******************************************************************/
+static const char * disasmNote(U8 flags)
+{
+    if (0U != (flags & ANALYSIS_INVALID))
+    {
+        return "; invalid";
+    }
+    if ((0U != (flags & ANALYSIS_WRITTEN)) && (0U != (flags & (ANALYSIS_CODE | ANALYSIS_OPERAND))))
+    {
+        return "; self-modified";
+    }
+    if (0U != (flags & ANALYSIS_INDIRECT))
+    {
+        return "; indirect target";
+    }
+    if (0U != (flags & ANALYSIS_WRITTEN))
+    {
+        return "; written";
+    }
+    if (0U != (flags & ANALYSIS_READ))
+    {
+        return "; sprite or table";
+    }
+
+    return "";
+}
@@ -12,22 +12,35 @@
  * 1. Included files (microcontroller ones then user defined ones)
  ******************************************************************/
 #include <stdio.h>
+#include <string.h>
 #include "display.h"
 #include "../cpu/cpu.h"
 #include "../input/input.h"
 #include "../sound/sound.h"
+#include "../profiler/profiler.h"
+#include "../framedump/framedump.h"
+#include "../shm/shm.h"
+#include "../stream/stream.h"
+#include "../debugger/debugger.h"
+#include "../metrics/metrics.h"
+#include "../latency/latency.h"
+#include "../pacer/pacer.h"
+#include "../render/render.h"
+#include "../startup/startup.h"
 
 /******************************************************************
  * 2. Define declarations (macros then function macros)
  ******************************************************************/
-#define DISPLAY_HEIGHT                                           32U
-#define DISPLAY_WIDTH                                            64U
-
 #define DISPLAY_PIXEL_HEIGH_IN_PIXELS                             8U
 #define DISPLAY_PIXEL_WIDTH_IN_PIXELS                             8U
 #define DISPLAY_HEIGHT_SIZED                                        DISPLAY_HEIGHT * DISPLAY_PIXEL_HEIGH_IN_PIXELS
 #define DISPLAY_WIDTH_SIZED                                         DISPLAY_WIDTH * DISPLAY_PIXEL_WIDTH_IN_PIXELS
-#define DISPLAY_GET_BIT_MASK                                    0x80
+#define DISPLAY_WIDE_SPRITE_ROWS                                 16U
+#define DISPLAY_RENDER_SCALE                                        (DISPLAY_WIDTH_SIZED / RENDER_WIDTH)
+
+#define DISPLAY_TITLE                                "Chip8 emulator"
+#define DISPLAY_PAUSED_TITLE                "Chip8 emulator (paused)"
+#define DISPLAY_PAUSE_KEY                                    SDLK_p
 
 /******************************************************************
  * 3. Typedef definitions (simple typedef, then enum and structs)
@@ -36,15 +49,24 @@ typedef struct
 {
     SDL_Window *window;
     SDL_Renderer *renderer;
-    BOOL screen[DISPLAY_WIDTH][DISPLAY_HEIGHT];
+    SDL_Texture *texture;           /* Window sized, filled by RenderScale() */
+    BOOL textureCurrent;            /* Texture holds the last blended image */
+    BOOL settled;                   /* Last RenderFrame() left the image unchanged */
+    displayScreenType screen;
+    renderType render;
 } displayType;
 
 /******************************************************************
  * 4. Variable definitions (static then global)
  ******************************************************************/
 static displayType display;
+static void displayBlend(void);
 static void displayUpdate(void);
-static BOOL displayGetBit(U8 byte, U8 n);
+static BOOL displayEvent(const SDL_Event *event);
+static void displayFault(void);
+static void displayDrawSprite(displayScreenType *screen, const U8 *memory, U8 *vf, U8 x, U8 y, U8 n, U8 bytesPerRow, BOOL wrap);
+static displayRowType displayShift(displayRowType row, S16 n);
+static displayRowType displayVisibleMask(const displayScreenType *screen);
 
 /******************************************************************
  * 5. Functions prototypes (static only)
@@ -61,9 +83,12 @@ void DisplayInit()
     U8 i;
     U8 j;
 
-    SDL_Init(SDL_INIT_EVERYTHING);
+    /* Audio is initialized on the first sound, see SoundOpen() */
+    SDL_Init(SDL_INIT_VIDEO | SDL_INIT_EVENTS);
+    STARTUP_PHASE("SDL video");
 
-    display.window = SDL_CreateWindow("Chip8 emulator", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, DISPLAY_WIDTH_SIZED, DISPLAY_HEIGHT_SIZED, 0);
+    display.window = SDL_CreateWindow(DISPLAY_TITLE, SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, DISPLAY_WIDTH_SIZED, DISPLAY_HEIGHT_SIZED, 0);
+    STARTUP_PHASE("window");
 
     if (NULL == display.window)
     {
@@ -71,82 +96,331 @@ void DisplayInit()
     }
 
     /* Initialize screen */
-    DisplayClearScreen();
+    DisplayReset(&display.screen);
+    RenderInit(&display.render, RENDER_PERSISTENCE);
+}
+
+/******************************************************************
+ * FUNCTION : DisplayReset()
+ *    Description: Back to low resolution with plane 0 selected,
+ *                 every plane cleared
+ *    Parameters:  screen: screen planes
+ *    Return:      None
+ ******************************************************************/
+void DisplayReset(displayScreenType *screen)
+{
+    (void)memset(screen->rows, 0, sizeof(screen->rows));
+    screen->width = DISPLAY_WIDTH;
+    screen->height = DISPLAY_HEIGHT;
+    screen->planes = 0x1U;
 }
 
 /******************************************************************
  * FUNCTION : DisplayClearScreen()
- *    Description: Clear screen instruction
- *    Parameters:  None
+ *    Description: Clear screen instruction, only the selected
+ *                 planes are cleared
+ *    Parameters:  screen: screen planes
+ *    Return:      None
+ ******************************************************************/
+void DisplayClearScreen(displayScreenType *screen)
+{
+    U8 plane;
+
+    for (plane = 0U; plane < DISPLAY_PLANES; plane++)
+    {
+        if (screen->planes & (1U << plane))
+        {
+            (void)memset(screen->rows[plane], 0, sizeof(screen->rows[plane]));
+        }
+    }
+}
+
+/******************************************************************
+ * FUNCTION : DisplaySetHighResolution()
+ *    Description: Switch between 64x32 and 128x64, the screen is
+ *                 cleared
+ *    Parameters:  screen: screen planes
+ *                 hires: TRUE for 128x64
  *    Return:      None
  ******************************************************************/
-void DisplayClearScreen()
+void DisplaySetHighResolution(displayScreenType *screen, BOOL hires)
 {
-    /* Clear screen array */
-    (void)memset(display.screen, FALSE, DISPLAY_WIDTH * DISPLAY_HEIGHT);
+    screen->width = (TRUE == hires) ? DISPLAY_HIRES_WIDTH : DISPLAY_WIDTH;
+    screen->height = (TRUE == hires) ? DISPLAY_HIRES_HEIGHT : DISPLAY_HEIGHT;
+    (void)memset(screen->rows, 0, sizeof(screen->rows));
 }
 
 /******************************************************************
- * FUNCTION : DisplayDraw()
- *    Description: Draw instruction
+ * FUNCTION : DisplaySelectPlanes()
+ *    Description: Select the planes used by draw, clear and
+ *                 scroll instructions
+ *    Parameters:  screen: screen planes
+ *                 planes: plane mask, bit 0 is plane 0
+ *    Return:      None
+ ******************************************************************/
+void DisplaySelectPlanes(displayScreenType *screen, U8 planes)
+{
+    screen->planes = planes & ((1U << DISPLAY_PLANES) - 1U);
+}
+
+/******************************************************************
+ * FUNCTION : DisplayGetScreen()
+ *    Description: Give access to the screen planes shown in the
+ *                 window
  *    Parameters:  None
+ *    Return:      Screen
+ ******************************************************************/
+displayScreenType * DisplayGetScreen(void)
+{
+    return &display.screen;
+}
+
+/******************************************************************
+ * FUNCTION : DisplayDraw()
+ *    Description: Draw instruction, 8 pixels wide and n rows
+ *    Parameters:  screen: screen planes
+ *                 memory: sprite, one byte per row and plane
+ *                 vf: set to 1 on collision, 0 otherwise
+ *                 x, y: sprite position
+ *                 n: number of rows
+ *                 wrap: TRUE to wrap pixels past the edges, FALSE
+ *                       to clip them
  *    Return:      None
  ******************************************************************/
-void DisplayDraw(U8 *memory, U8 *vf, U8 x, U8 y, U8 n)
+void DisplayDraw(displayScreenType *screen, const U8 *memory, U8 *vf, U8 x, U8 y, U8 n, BOOL wrap)
 {
+    PROFILER_BEGIN(E_PROFILER_DRAW);
+    METRICS_DRAW();
+
+    displayDrawSprite(screen, memory, vf, x, y, n, 1U, wrap);
+
+    PROFILER_END(E_PROFILER_DRAW);
+}
+
+/******************************************************************
+ * FUNCTION : DisplayDrawWide()
+ *    Description: Draw instruction for 16x16 sprites (Dxy0)
+ *    Parameters:  screen: screen planes
+ *                 memory: sprite, two bytes per row and plane
+ *                 vf: set to 1 on collision, 0 otherwise
+ *                 x, y: sprite position
+ *                 wrap: TRUE to wrap pixels past the edges, FALSE
+ *                       to clip them
+ *    Return:      None
+ ******************************************************************/
+void DisplayDrawWide(displayScreenType *screen, const U8 *memory, U8 *vf, U8 x, U8 y, BOOL wrap)
+{
+    PROFILER_BEGIN(E_PROFILER_DRAW);
+    METRICS_DRAW();
+
+    displayDrawSprite(screen, memory, vf, x, y, DISPLAY_WIDE_SPRITE_ROWS, 2U, wrap);
+
+    PROFILER_END(E_PROFILER_DRAW);
+}
+
+/******************************************************************
+ * FUNCTION : displayDrawSprite()
+ *    Description: XOR a sprite on every selected plane. The shifts
+ *                 of the position and of the wrapped copy, and the
+ *                 rows left after clipping, are worked out once per
+ *                 draw. Each sprite row is then placed with one
+ *                 128 bit shift, XORed and tested for collision in
+ *                 one operation. The position wraps around the
+ *                 screen, pixels past the edges wrap or are clipped.
+ *    Parameters:  screen: screen planes
+ *                 memory: sprite, planes stored one after another
+ *                 vf: set to 1 on collision, 0 otherwise
+ *                 x, y: sprite position
+ *                 n: number of rows
+ *                 bytesPerRow: 1 or 2
+ *                 wrap: TRUE to wrap, FALSE to clip
+ *    Return:      None
+ ******************************************************************/
+static void displayDrawSprite(displayScreenType *screen, const U8 *memory, U8 *vf, U8 x, U8 y, U8 n, U8 bytesPerRow, BOOL wrap)
+{
+    displayRowType visible = displayVisibleMask(screen);
+    displayRowType sprite = { 0U, 0U };
+    displayRowType hit;
+    displayRowType *row;
+    displayLineType line;
+    displayLineType placed;
+    displayLineType wrapMask = 0U;
+    U32 wrapShift = 0U;
+    U8 heightMask = (U8)(screen->height - 1U);
+    U8 count = n;
+    U64 collision = 0U;
+    U8 plane;
     U8 i;
-    U8 j;
-    U8 xMod;
-    U8 yMod;
 
-    /* Clear vf */
-    *vf = 0U;
+    /* Both resolutions are powers of two */
+    x = x & (U8)(screen->width - 1U);
+    y = y & heightMask;
 
-    /* Number of bytes in the sprite (height) */
-    for (i = 0U; i < n; i++)
+    if (TRUE == wrap)
     {
-        yMod = (y+i) % DISPLAY_HEIGHT;
+        /* Pixels past the right edge come back on the left, nothing
+         * is past it at x = 0 */
+        if (0U != x)
+        {
+            wrapShift = (U32)(screen->width - x);
+            wrapMask = ~(displayLineType)0U;
+        }
+    }
+    else if ((y + n) > screen->height)
+    {
+        /* Clipped at the bottom */
+        count = (U8)(screen->height - y);
+    }
 
-        /* Go on bits (width) */
-        for (j = 0U; j < 8U; j++)
+    for (plane = 0U; plane < DISPLAY_PLANES; plane++)
+    {
+        if (0U == (screen->planes & (1U << plane)))
         {
-            xMod = (x+j) % DISPLAY_WIDTH;
+            continue;
+        }
 
-            /* Check if edge of screen is not reach */
-            if ((x+j) < DISPLAY_WIDTH)
+        for (i = 0U; i < count; i++)
+        {
+            /* Sprite row in the leftmost pixels */
+            if (2U == bytesPerRow)
             {
-                /* If the current pixel in the sprite row is on */
-                if (displayGetBit(memory[i], j))
-                {
-                    /* If pixel on screen is on set vf to 1 */
-                    if (display.screen[xMod][yMod] == TRUE)
-                    {
-                        *vf = 1U;
-                        display.screen[xMod][yMod] = FALSE;
-                    }
-                    else
-                    {
-                        display.screen[xMod][yMod] = TRUE;
-                    }
-                }
+                line = (displayLineType)(((U32)memory[2U * i] << 8U) | memory[(2U * i) + 1U]) << 112U;
             }
+            else
+            {
+                line = (displayLineType)memory[i] << 120U;
+            }
+
+            placed = (line >> x) | ((line << wrapShift) & wrapMask);
+            sprite[0U] = (U64)(placed >> 64U);
+            sprite[1U] = (U64)placed;
+            sprite &= visible;
+
+            row = &screen->rows[plane][(y + i) & heightMask];
+            hit = *row & sprite;
+            collision |= hit[0U] | hit[1U];
+            *row ^= sprite;
         }
+
+        /* Next plane, after the rows clipped away */
+        memory += n * bytesPerRow;
     }
+
+    /* Set vf to 1 if any pixel was turned off */
+    *vf = (0U != collision) ? 1U : 0U;
 }
 
 /******************************************************************
- * FUNCTION : displayGetBit()
- *    Description: Find bit to display in a byte
- *    Parameters:  None
+ * FUNCTION : DisplayScroll()
+ *    Description: Scroll the selected planes. Vertical scrolls
+ *                 move whole rows, horizontal ones shift each
+ *                 row, pixels scrolled out are lost.
+ *    Parameters:  screen: screen planes
+ *                 dx: pixels to the right, negative to the left
+ *                 dy: pixels down, negative up
  *    Return:      None
  ******************************************************************/
-static BOOL displayGetBit(U8 byte, U8 n)
+void DisplayScroll(displayScreenType *screen, S8 dx, S8 dy)
 {
-    U8 value = byte & (U8)(DISPLAY_GET_BIT_MASK >> n);
+    displayRowType visible = displayVisibleMask(screen);
+    displayRowType *rows;
+    U8 count = (U8)((dy < 0) ? -dy : dy);
+    U8 plane;
+    U8 i;
 
-    value = value >> (7U - n);
+    if (count > screen->height)
+    {
+        count = screen->height;
+    }
+
+    for (plane = 0U; plane < DISPLAY_PLANES; plane++)
+    {
+        if (0U == (screen->planes & (1U << plane)))
+        {
+            continue;
+        }
 
-    return value;
+        rows = screen->rows[plane];
+
+        if (dy > 0)
+        {
+            (void)memmove(&rows[count], &rows[0U], (screen->height - count) * sizeof(displayRowType));
+            (void)memset(&rows[0U], 0, count * sizeof(displayRowType));
+        }
+        else if (dy < 0)
+        {
+            (void)memmove(&rows[0U], &rows[count], (screen->height - count) * sizeof(displayRowType));
+            (void)memset(&rows[screen->height - count], 0, count * sizeof(displayRowType));
+        }
+
+        if (0 != dx)
+        {
+            for (i = 0U; i < screen->height; i++)
+            {
+                rows[i] = displayShift(rows[i], dx) & visible;
+            }
+        }
+    }
+}
+
+/******************************************************************
+ * FUNCTION : displayShift()
+ *    Description: Shift a row by n pixels across both words
+ *    Parameters:  row: row to shift
+ *                 n: pixels to the right, negative to the left
+ *    Return:      Shifted row
+ ******************************************************************/
+static displayRowType displayShift(displayRowType row, S16 n)
+{
+    displayRowType result = { 0U, 0U };
+
+    if (n >= 128)
+    {
+        /* Everything out of the screen */
+    }
+    else if (n >= 64)
+    {
+        result[1U] = row[0U] >> (n - 64);
+    }
+    else if (n > 0)
+    {
+        result[0U] = row[0U] >> n;
+        result[1U] = (row[1U] >> n) | (row[0U] << (64 - n));
+    }
+    else if (0 == n)
+    {
+        result = row;
+    }
+    else if (n > -64)
+    {
+        result[0U] = (row[0U] << -n) | (row[1U] >> (64 + n));
+        result[1U] = row[1U] << -n;
+    }
+    else if (n > -128)
+    {
+        result[0U] = row[1U] << (-n - 64);
+    }
+
+    return result;
+}
+
+/******************************************************************
+ * FUNCTION : displayVisibleMask()
+ *    Description: Row mask of the pixels inside the current
+ *                 resolution
+ *    Parameters:  screen: screen planes
+ *    Return:      Mask
+ ******************************************************************/
+static displayRowType displayVisibleMask(const displayScreenType *screen)
+{
+    displayRowType mask = { ~(U64)0U, ~(U64)0U };
+
+    if (DISPLAY_WIDTH == screen->width)
+    {
+        mask[1U] = 0U;
+    }
+
+    return mask;
 }
 
 /******************************************************************
@@ -157,82 +431,187 @@ static BOOL displayGetBit(U8 byte, U8 n)
  ******************************************************************/
 void DisplayUpdate(void)
 {
-    display.renderer = SDL_CreateRenderer(display.window, -1, SDL_RENDERER_ACCELERATED);
+    display.renderer = SDL_CreateRenderer(display.window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
+    display.texture = SDL_CreateTexture(display.renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING,
+                                        DISPLAY_WIDTH_SIZED, DISPLAY_HEIGHT_SIZED);
 
     BOOL isRunning = TRUE;
     SDL_Event event;
+    U32 frames;
+
+    PacerInit(display.window, display.renderer);
+    STARTUP_PHASE("renderer");
 
     while (isRunning)
     {
+        PROFILER_BEGIN(E_PROFILER_INPUT);
+
+        /* Paused or waiting for a key: once the fading pixels have
+         * settled, sleep in the event queue, the frames start again
+         * from the first event */
+        if ((FALSE != CpuIdle()) && (FALSE != display.settled))
+        {
+            if ((0 != SDL_WaitEvent(&event)) && (FALSE == displayEvent(&event)))
+            {
+                isRunning = FALSE;
+            }
+            PacerRestart();
+        }
+
         while (SDL_PollEvent(&event))
         {
-            switch (event.type)
+            if (FALSE == displayEvent(&event))
             {
-            case SDL_QUIT:
                 isRunning = FALSE;
-                break;
-
-            case SDL_KEYDOWN:
-                (void)InputUpdateKeyboardDown(event.key.keysym.sym);
-                break;
-            case SDL_KEYUP:
-                InputUpdateKeyboardUp(event.key.keysym.sym);
-                break;
             }
         }
 
-        /* Run Cpu main loop */
-        (void)CpuMain();
+        PROFILER_END(E_PROFILER_INPUT);
 
+        /* Run the emulated frames due, stop when the program exits.
+         * The phosphor fades once per emulated frame, a repeated
+         * frame presents the same texture again */
+        PROFILER_BEGIN(E_PROFILER_CPU);
+        for (frames = PacerFrames(); (frames > 0U) && (FALSE != isRunning); frames--)
+        {
+            if (E_OK != CpuMain())
+            {
+                displayFault();
+                isRunning = FALSE;
+            }
+            displayBlend();
+        }
+        PROFILER_END(E_PROFILER_CPU);
+
+        PROFILER_BEGIN(E_PROFILER_PRESENT);
         displayUpdate();
+        PROFILER_END(E_PROFILER_PRESENT);
 
-        /* 50 FPS */
-        SDL_Delay(1U);
+        FRAMEDUMP_FRAME(&display.screen);
+
+        SHM_FRAME(CpuGetDefault());
+
+        STREAM_FRAME(&display.screen);
+
+        /* Next frame deadline, or the vertical blank with vsync */
+        PacerWait();
     }
 }
 
 /******************************************************************
- * FUNCTION : displayUpdate()
- *    Description: Draw pixels on screen from display.screen array
+ * FUNCTION : displayFault()
+ *    Description: Tell the user why the program stopped, once since
+ *                 the window closes after it. Exits stay silent.
  *    Parameters:  None
  *    Return:      None
  ******************************************************************/
-static void displayUpdate(void)
+static void displayFault(void)
 {
-    U8 i;
-    U8 j;
-
-    /* Clear display buffer */
-    SDL_RenderClear(display.renderer);
-
-    /* Set back color */
-    SDL_SetRenderDrawColor(display.renderer, 0U, 0U, 0U, 255U);
+    const cpuType *cpu = CpuGetDefault();
+    char szText[64];
 
-    SDL_Rect rect = {0, 0, DISPLAY_WIDTH_SIZED, DISPLAY_HEIGHT_SIZED};
+    if ((E_CPU_RUNNING == cpu->status) || (E_CPU_EXITED == cpu->status))
+    {
+        return;
+    }
 
-    SDL_RenderFillRect(display.renderer, &rect);
+    sprintf(szText, "%s: %X at %03X", (E_CPU_INVALID_OPCODE == cpu->status) ? "Invalid opCode" : "Stack fault",
+            (U16)((cpu->memory[cpu->pc] << 8U) + cpu->memory[cpu->pc + 1U]), cpu->pc);
+    SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR,
+                     (E_CPU_INVALID_OPCODE == cpu->status) ? "Unknown opcode" : "Stack fault",
+                     szText,
+                     NULL);
+}
 
-    /* Set color for white pixel */
-    SDL_SetRenderDrawColor(display.renderer, 255U, 255U, 255U, 255U);
+/******************************************************************
+ * FUNCTION : displayEvent()
+ *    Description: Handle one window event
+ *    Parameters:  event: SDL event
+ *    Return:      FALSE if the window is closed, TRUE otherwise
+ ******************************************************************/
+static BOOL displayEvent(const SDL_Event *event)
+{
+    BOOL isRunning = TRUE;
 
-    /* Initialize screen */
-    for (i = 0U; i < DISPLAY_WIDTH; i++)
+    switch (event->type)
     {
-        for (j = 0U; j < DISPLAY_HEIGHT; j++)
+    case SDL_QUIT:
+        isRunning = FALSE;
+        break;
+
+    /* Keys are applied by the cpu at the instruction matching their
+     * timestamp, auto repeat changes nothing */
+    case SDL_KEYDOWN:
+        if (DISPLAY_PAUSE_KEY == event->key.keysym.sym)
         {
-            /* TRUE is white pixel */
-            if (display.screen[i][j] == TRUE)
+            if (0U == event->key.repeat)
             {
-                SDL_Rect rect2 = {
-                    (int)(DISPLAY_PIXEL_WIDTH_IN_PIXELS * i), (int)(DISPLAY_PIXEL_HEIGH_IN_PIXELS * j),
-                    DISPLAY_PIXEL_WIDTH_IN_PIXELS, DISPLAY_PIXEL_HEIGH_IN_PIXELS
-                };
-                SDL_RenderFillRect(display.renderer, &rect2);
+                SDL_SetWindowTitle(display.window, (FALSE != CpuTogglePause()) ? DISPLAY_PAUSED_TITLE : DISPLAY_TITLE);
             }
         }
+        else if (0U == event->key.repeat)
+        {
+            InputQueueKey(event->key.keysym.sym, TRUE, event->key.timestamp);
+        }
+        DEBUGGER_KEY(event->key.keysym.sym);
+        break;
+    case SDL_KEYUP:
+        InputQueueKey(event->key.keysym.sym, FALSE, event->key.timestamp);
+        break;
     }
 
+    return isRunning;
+}
+
+/******************************************************************
+ * FUNCTION : displayBlend()
+ *    Description: Blend display.screen over the previous image, once
+ *                 per emulated frame
+ *    Parameters:  None
+ *    Return:      None
+ ******************************************************************/
+static void displayBlend(void)
+{
+    if (FALSE != RenderFrame(&display.render, &display.screen))
+    {
+        display.settled = FALSE;
+        display.textureCurrent = FALSE;
+    }
+    else
+    {
+        display.settled = TRUE;
+    }
+}
+
+/******************************************************************
+ * FUNCTION : displayUpdate()
+ *    Description: Draw pixels on screen from the blended image
+ *    Parameters:  None
+ *    Return:      None
+ ******************************************************************/
+static void displayUpdate(void)
+{
+    void *pixels;
+    int pitch;
+
+    /* Only a new blended image is uploaded, the texture is presented
+     * again otherwise */
+    if ((FALSE == display.textureCurrent) && (0 == SDL_LockTexture(display.texture, NULL, &pixels, &pitch)))
+    {
+        RenderScale(&display.render, (Uint32 *)pixels, (U32)pitch / sizeof(Uint32), DISPLAY_RENDER_SCALE);
+        SDL_UnlockTexture(display.texture);
+        display.textureCurrent = TRUE;
+    }
+
+    SDL_RenderClear(display.renderer);
+    SDL_RenderCopy(display.renderer, display.texture, NULL, NULL);
     SDL_RenderPresent(display.renderer);
+
+    STARTUP_FRAME();
+
+    METRICS_FRAME();
+
+    LATENCY_FRAME(&display.screen);
 }
 
 /******************************************************************
@@ -244,6 +623,7 @@ static void displayUpdate(void)
 void DisplayExit()
 {
     SoundExit();
+    SDL_DestroyTexture(display.texture);
     SDL_DestroyRenderer(display.renderer);
     SDL_DestroyWindow(display.window);
     SDL_Quit();
@@ -7,6 +7,8 @@
  * DESCRIPTION : Screen implementation of the chip8
  *
  ******************************************************************/
+#ifndef DISPLAY_H_
+#define DISPLAY_H_
 
 /******************************************************************
  * 1. Included files (microcontroller ones then user defined ones)
@@ -17,11 +19,40 @@
 /******************************************************************
  * 2. Define declarations (macros then function macros)
  ******************************************************************/
+#define DISPLAY_HEIGHT                                           32U
+#define DISPLAY_WIDTH                                            64U
+#define DISPLAY_HIRES_HEIGHT                                     64U
+#define DISPLAY_HIRES_WIDTH                                     128U
+#define DISPLAY_PLANES                                            2U
+#define DISPLAY_COLORS                                            4U
+#define DISPLAY_SCROLL_PIXELS                                     4U
 
+/* 0xRRGGBB color of each plane combination */
+#define DISPLAY_PALETTE      { 0x000000UL, 0xFFFFFFUL, 0xAAAAAAUL, 0x555555UL }
+
+/* Pixel x of a row, pixel 0 is the most significant bit of word 0 */
+#define DISPLAY_ROW_PIXEL(row, x)           ((U8)(((row)[(x) >> 6U] >> (63U - ((x) & 63U))) & 1U))
+
+/* Palette index of pixel (x, y) */
+#define DISPLAY_PIXEL(screen, x, y)         (DISPLAY_ROW_PIXEL((screen)->rows[0U][y], x) | (DISPLAY_ROW_PIXEL((screen)->rows[1U][y], x) << 1U))
 
 /******************************************************************
  * 3. Typedef definitions (simple typedef, then enum and structs)
  ******************************************************************/
+/* One 128 pixel row, held in a single SIMD register */
+typedef U64 displayRowType __attribute__((vector_size(16)));
+
+/* One 128 pixel row as an integer, pixel 0 is the most significant
+ * bit, used to shift sprite rows in place */
+typedef unsigned __int128 displayLineType;
+
+typedef struct
+{
+    displayRowType rows[DISPLAY_PLANES][DISPLAY_HIRES_HEIGHT];
+    U8 width;       /* DISPLAY_WIDTH or DISPLAY_HIRES_WIDTH */
+    U8 height;      /* DISPLAY_HEIGHT or DISPLAY_HIRES_HEIGHT */
+    U8 planes;      /* Planes selected for drawing, bit 0 is plane 0 */
+} displayScreenType;
 
 /******************************************************************
  * 4. Variable definitions (static then global)
@@ -33,5 +64,13 @@
 extern void DisplayInit();
 extern void DisplayUpdate();
 extern void DisplayExit();
-extern void DisplayClearScreen();
-extern void DisplayDraw(U8 *memory, U8 *vf, U8 x, U8 y, U8 n);
\ No newline at end of file
+extern void DisplayReset(displayScreenType *screen);
+extern void DisplayClearScreen(displayScreenType *screen);
+extern void DisplayDraw(displayScreenType *screen, const U8 *memory, U8 *vf, U8 x, U8 y, U8 n, BOOL wrap);
+extern void DisplayDrawWide(displayScreenType *screen, const U8 *memory, U8 *vf, U8 x, U8 y, BOOL wrap);
+extern void DisplayScroll(displayScreenType *screen, S8 dx, S8 dy);
+extern void DisplaySetHighResolution(displayScreenType *screen, BOOL hires);
+extern void DisplaySelectPlanes(displayScreenType *screen, U8 planes);
+extern displayScreenType * DisplayGetScreen(void);
+
+#endif /* DISPLAY_H_ */
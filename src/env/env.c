@@ -0,0 +1,590 @@
+/******************************************************************
+ *
+ *
+ * FILE        : env.c
+ * PROJECT     : chip8
+ * AUTHOR      : danpham
+ * DESCRIPTION : Vectorized environment.
+ *
+ *               Every machine draws straight into its slot of the
+ *               caller's observation array and the step results
+ *               are written in the caller's reward and done arrays,
+ *               nothing is copied out. The machines are split in
+ *               chunks claimed by the caller and a pool of worker
+ *               threads kept alive between steps. A finished
+ *               episode restarts from the cpu image taken after
+ *               the rom was loaded. The cpus live in a pool arena,
+ *               their memories sized for the profile in its memory
+ *               array, the keys and episode counters of the machines
+ *               in its data array, away from the hot cpu lines.
+ *
+ ******************************************************************/
+
+/******************************************************************
+ * 1. Included files (microcontroller ones then user defined ones)
+ ******************************************************************/
+#include <stdlib.h>
+#include <string.h>
+#include <SDL2/SDL.h>
+#include "env.h"
+#include "../cpu/cpu.h"
+#include "../display/display.h"
+#include "../import/import.h"
+#include "../input/input.h"
+#include "../metrics/metrics.h"
+#include "../pool/pool.h"
+
+/******************************************************************
+ * 2. Define declarations (macros then function macros)
+ ******************************************************************/
+/* Machines claimed at once by a thread */
+#define ENV_CHUNK_SIZE                                            8U
+
+/* Seed spacing between machines (golden ratio) */
+#define ENV_SEED_STEP                                    0x9E3779B9UL
+
+/******************************************************************
+ * 3. Typedef definitions (simple typedef, then enum and structs)
+ ******************************************************************/
+/* Data of a machine kept out of its cpu */
+typedef struct
+{
+    BOOL keys[INPUT_NUMBER_OF_KEYBOARD_KEYS];
+    U32 episodeFrames;
+    S64 score;
+} envMachineType;
+
+struct envType
+{
+    envConfigType config;
+    U32 count;
+    poolType pool;
+    cpuType *snapshot;              /* Cpu right after the rom load */
+    U8 *snapshotMemory;
+
+    /* Caller arrays */
+    displayScreenType *observations;
+    S32 *rewards;
+    U8 *dones;
+
+    /* Current step, set before the workers are woken up */
+    const U16 *actions;
+    U32 frames;
+    SDL_atomic_t nextMachine;
+
+    /* Worker pool */
+    SDL_Thread **workers;
+    U32 workerCount;
+    SDL_mutex *mutex;
+    SDL_cond *start;
+    SDL_cond *finished;
+    U32 generation;
+    U32 busyWorkers;
+    BOOL stopping;
+};
+
+/******************************************************************
+ * 4. Variable definitions (static then global)
+ ******************************************************************/
+
+/******************************************************************
+ * 5. Functions prototypes (static only)
+ ******************************************************************/
+static int envWorker(void *data);
+static void envRun(envType *env);
+static void envStepMachine(envType *env, U32 index);
+static void envResetMachine(envType *env, U32 index);
+static S64 envScore(const envType *env, const cpuType *cpu);
+static BOOL envIsDone(const envType *env, const cpuType *cpu, const envMachineType *machine);
+static BOOL envAddressesFit(const envConfigType *config);
+static Std_ReturnType envStartWorkers(envType *env);
+
+/******************************************************************
+ * FUNCTION : EnvCreate()
+ *    Description: Create count machines running the same rom
+ *    Parameters:  rom, romSize: rom bytes, copied
+ *                 count: number of machines
+ *                 config: profile, rewards and episode rules, the
+ *                         addresses within the profile memory
+ *                 observations: count screens, written by EnvStep()
+ *                 rewards: count rewards, written by EnvStep()
+ *                 dones: count episode end flags, written by
+ *                        EnvStep()
+ *    Return:      Environment, NULL on error
+ ******************************************************************/
+envType * EnvCreate(const U8 *rom, U32 romSize, U32 count, const envConfigType *config,
+                    displayScreenType *observations, S32 *rewards, U8 *dones)
+{
+    envType *env;
+    cpuType *cpu;
+    U32 i;
+
+    if ((NULL == config) || (0U == count) || (NULL == observations) || (NULL == rewards) || (NULL == dones)
+        || (config->rewardCount > ENV_MAX_REWARDS) || (FALSE == envAddressesFit(config)))
+    {
+        return NULL;
+    }
+
+    env = (envType *)calloc(1U, sizeof(envType));
+    if (NULL == env)
+    {
+        return NULL;
+    }
+
+    /* Served once for all the environments of the process */
+    METRICS_START();
+
+    env->config = *config;
+    if (0U == env->config.instructionsPerFrame)
+    {
+        env->config.instructionsPerFrame = ENV_DEFAULT_INSTRUCTIONS_PER_FRAME;
+    }
+    env->count = count;
+    env->observations = observations;
+    env->rewards = rewards;
+    env->dones = dones;
+
+    env->snapshot = (cpuType *)calloc(1U, sizeof(cpuType));
+    env->snapshotMemory = (U8 *)calloc(1U, CPU_MEMORY_BYTES(env->config.profile));
+    if ((E_OK != PoolCreate(&env->pool, count, CPU_MEMORY_BYTES(env->config.profile), sizeof(envMachineType),
+                            env->config.hugePages))
+        || (NULL == env->snapshot) || (NULL == env->snapshotMemory))
+    {
+        EnvDestroy(env);
+        return NULL;
+    }
+
+    /* Snapshot taken once, the screen is only cleared by CpuReset() */
+    CpuAttach(env->snapshot, env->snapshotMemory, &observations[0U], NULL);
+    CpuReset(env->snapshot, env->config.profile, env->config.seed);
+    if (E_OK != CpuLoad(env->snapshot, rom, romSize))
+    {
+        EnvDestroy(env);
+        return NULL;
+    }
+
+    if (E_OK != envStartWorkers(env))
+    {
+        EnvDestroy(env);
+        return NULL;
+    }
+
+    for (i = 0U; i < count; i++)
+    {
+        /* Distinct random sequences, kept across episodes */
+        cpu = POOL_CPU(&env->pool, i);
+        CpuAttach(cpu, POOL_MEMORY(&env->pool, i), &observations[i],
+                  ((envMachineType *)POOL_DATA(&env->pool, i))->keys);
+        cpu->random = env->snapshot->random + (i * ENV_SEED_STEP);
+        if (0U == cpu->random)
+        {
+            cpu->random = ENV_SEED_STEP;
+        }
+    }
+    EnvReset(env);
+
+    return env;
+}
+
+/******************************************************************
+ * FUNCTION : EnvCreateFromFile()
+ *    Description: Create count machines running a rom file, see
+ *                 EnvCreate()
+ *    Parameters:  romPath: rom file
+ *                 count, config, observations, rewards, dones: see
+ *                 EnvCreate()
+ *    Return:      Environment, NULL on error
+ ******************************************************************/
+envType * EnvCreateFromFile(const char *romPath, U32 count, const envConfigType *config,
+                            displayScreenType *observations, S32 *rewards, U8 *dones)
+{
+    const U8 *rom;
+    U32 size = 0U;
+
+    rom = ImportRomCached(romPath, &size);
+    if (NULL == rom)
+    {
+        return NULL;
+    }
+
+    return EnvCreate(rom, size, count, config, observations, rewards, dones);
+}
+
+/******************************************************************
+ * FUNCTION : EnvStep()
+ *    Description: Run frames frames on every machine. Machines
+ *                 whose episode ends are reset, their observation
+ *                 is then the first one of the next episode.
+ *    Parameters:  env: environment
+ *                 actions: count key masks, bit k holds key k
+ *                 frames: frames to run, timers tick once a frame
+ *    Return:      None
+ ******************************************************************/
+void EnvStep(envType *env, const U16 *actions, U32 frames)
+{
+    env->actions = actions;
+    env->frames = frames;
+    SDL_AtomicSet(&env->nextMachine, 0);
+
+    if (0U != env->workerCount)
+    {
+        SDL_LockMutex(env->mutex);
+        env->generation++;
+        env->busyWorkers = env->workerCount;
+        SDL_CondBroadcast(env->start);
+        SDL_UnlockMutex(env->mutex);
+    }
+
+    /* The caller steps machines too */
+    envRun(env);
+
+    if (0U != env->workerCount)
+    {
+        SDL_LockMutex(env->mutex);
+        while (0U != env->busyWorkers)
+        {
+            SDL_CondWait(env->finished, env->mutex);
+        }
+        SDL_UnlockMutex(env->mutex);
+    }
+}
+
+/******************************************************************
+ * FUNCTION : EnvReset()
+ *    Description: Start a new episode on every machine
+ *    Parameters:  env: environment
+ *    Return:      None
+ ******************************************************************/
+void EnvReset(envType *env)
+{
+    U32 i;
+
+    for (i = 0U; i < env->count; i++)
+    {
+        envResetMachine(env, i);
+        env->rewards[i] = 0;
+        env->dones[i] = 0U;
+    }
+}
+
+/******************************************************************
+ * FUNCTION : EnvCount()
+ *    Description: Number of machines
+ *    Parameters:  env: environment
+ *    Return:      Number of machines
+ ******************************************************************/
+U32 EnvCount(const envType *env)
+{
+    return env->count;
+}
+
+/******************************************************************
+ * FUNCTION : EnvDestroy()
+ *    Description: Stop the workers and free the environment, the
+ *                 caller arrays are left untouched
+ *    Parameters:  env: environment, may be NULL
+ *    Return:      None
+ ******************************************************************/
+void EnvDestroy(envType *env)
+{
+    U32 i;
+
+    if (NULL == env)
+    {
+        return;
+    }
+
+    if (NULL != env->workers)
+    {
+        SDL_LockMutex(env->mutex);
+        env->stopping = TRUE;
+        SDL_CondBroadcast(env->start);
+        SDL_UnlockMutex(env->mutex);
+
+        for (i = 0U; i < env->workerCount; i++)
+        {
+            SDL_WaitThread(env->workers[i], NULL);
+        }
+        free(env->workers);
+    }
+
+    if (NULL != env->start)
+    {
+        SDL_DestroyCond(env->start);
+    }
+    if (NULL != env->finished)
+    {
+        SDL_DestroyCond(env->finished);
+    }
+    if (NULL != env->mutex)
+    {
+        SDL_DestroyMutex(env->mutex);
+    }
+
+    free(env->snapshot);
+    free(env->snapshotMemory);
+    PoolDestroy(&env->pool);
+    free(env);
+}
+
+/******************************************************************
+ * FUNCTION : envStartWorkers()
+ *    Description: Start config.threads - 1 worker threads
+ *    Parameters:  env: environment
+ *    Return:      E_OK if every worker started, E_NOT_OK otherwise
+ ******************************************************************/
+static Std_ReturnType envStartWorkers(envType *env)
+{
+    U32 wanted = (env->config.threads > 1U) ? (env->config.threads - 1U) : 0U;
+
+    if (0U == wanted)
+    {
+        return E_OK;
+    }
+
+    env->mutex = SDL_CreateMutex();
+    env->start = SDL_CreateCond();
+    env->finished = SDL_CreateCond();
+    env->workers = (SDL_Thread **)calloc(wanted, sizeof(SDL_Thread *));
+    if ((NULL == env->mutex) || (NULL == env->start) || (NULL == env->finished) || (NULL == env->workers))
+    {
+        return E_NOT_OK;
+    }
+
+    while (env->workerCount < wanted)
+    {
+        env->workers[env->workerCount] = SDL_CreateThread(envWorker, "chip8 env", env);
+        if (NULL == env->workers[env->workerCount])
+        {
+            return E_NOT_OK;
+        }
+        env->workerCount++;
+    }
+
+    return E_OK;
+}
+
+/******************************************************************
+ * FUNCTION : envWorker()
+ *    Description: Worker thread, runs its share of every step
+ *    Parameters:  data: environment
+ *    Return:      0
+ ******************************************************************/
+static int envWorker(void *data)
+{
+    envType *env = (envType *)data;
+
+    /* Steps are counted from the creation of the environment, a step
+     * posted before this thread first takes the mutex is not missed */
+    U32 generation = 0U;
+
+    METRICS_THREAD("env worker");
+
+    SDL_LockMutex(env->mutex);
+
+    for (;;)
+    {
+        while ((generation == env->generation) && (FALSE == env->stopping))
+        {
+            SDL_CondWait(env->start, env->mutex);
+        }
+
+        if (FALSE != env->stopping)
+        {
+            break;
+        }
+
+        generation = env->generation;
+        SDL_UnlockMutex(env->mutex);
+
+        envRun(env);
+
+        SDL_LockMutex(env->mutex);
+        env->busyWorkers--;
+        if (0U == env->busyWorkers)
+        {
+            SDL_CondSignal(env->finished);
+        }
+    }
+
+    SDL_UnlockMutex(env->mutex);
+
+    return 0;
+}
+
+/******************************************************************
+ * FUNCTION : envRun()
+ *    Description: Step chunks of machines until none is left
+ *    Parameters:  env: environment
+ *    Return:      None
+ ******************************************************************/
+static void envRun(envType *env)
+{
+    U32 first;
+    U32 last;
+    U32 i;
+#ifdef METRICS_ENABLED
+    U32 running = 0U;
+    U32 blocked = 0U;
+#endif
+
+    for (;;)
+    {
+        first = (U32)SDL_AtomicAdd(&env->nextMachine, (int)ENV_CHUNK_SIZE);
+        if (first >= env->count)
+        {
+            break;
+        }
+
+        last = ((env->count - first) > ENV_CHUNK_SIZE) ? (first + ENV_CHUNK_SIZE) : env->count;
+        for (i = first; i < last; i++)
+        {
+            envStepMachine(env, i);
+#ifdef METRICS_ENABLED
+            running += (E_CPU_RUNNING == POOL_CPU(&env->pool, i)->status) ? 1U : 0U;
+            blocked += (FALSE != CpuWaitingKey(POOL_CPU(&env->pool, i))) ? 1U : 0U;
+#endif
+        }
+    }
+
+    METRICS_MACHINES(running, blocked);
+}
+
+/******************************************************************
+ * FUNCTION : envStepMachine()
+ *    Description: Apply the action of a machine and run the step
+ *    Parameters:  env: environment
+ *                 index: machine
+ *    Return:      None
+ ******************************************************************/
+static void envStepMachine(envType *env, U32 index)
+{
+    envMachineType *machine = (envMachineType *)POOL_DATA(&env->pool, index);
+    cpuType *cpu = POOL_CPU(&env->pool, index);
+    U16 action = env->actions[index];
+    BOOL done = FALSE;
+    S64 score;
+    U32 frame;
+    U32 instruction;
+    U8 key;
+
+    for (key = 0U; key < INPUT_NUMBER_OF_KEYBOARD_KEYS; key++)
+    {
+        machine->keys[key] = (BOOL)((action >> key) & 1U);
+    }
+
+    for (frame = 0U; (frame < env->frames) && (FALSE == done); frame++)
+    {
+        instruction = CpuRun(cpu, env->config.instructionsPerFrame);
+        CpuTimers(cpu);
+        METRICS_INSTRUCTIONS(instruction);
+        machine->episodeFrames++;
+
+        done = envIsDone(env, cpu, machine);
+    }
+
+    score = envScore(env, cpu);
+    env->rewards[index] = (S32)(score - machine->score);
+    machine->score = score;
+    env->dones[index] = (U8)done;
+
+    if (FALSE != done)
+    {
+        envResetMachine(env, index);
+    }
+}
+
+/******************************************************************
+ * FUNCTION : envResetMachine()
+ *    Description: Restore a machine from the snapshot, its random
+ *                 generator keeps running
+ *    Parameters:  env: environment
+ *                 index: machine
+ *    Return:      None
+ ******************************************************************/
+static void envResetMachine(envType *env, U32 index)
+{
+    envMachineType *machine = (envMachineType *)POOL_DATA(&env->pool, index);
+    cpuType *cpu = POOL_CPU(&env->pool, index);
+    U32 random = cpu->random;
+
+    CpuCopy(cpu, env->snapshot);
+    cpu->random = random;
+    DisplayReset(&env->observations[index]);
+
+    machine->episodeFrames = 0U;
+    machine->score = envScore(env, cpu);
+}
+
+/******************************************************************
+ * FUNCTION : envScore()
+ *    Description: Weighted sum of the reward bytes
+ *    Parameters:  env: environment
+ *                 cpu: machine cpu
+ *    Return:      Score
+ ******************************************************************/
+static S64 envScore(const envType *env, const cpuType *cpu)
+{
+    S64 score = 0;
+    U8 i;
+
+    for (i = 0U; i < env->config.rewardCount; i++)
+    {
+        score += (S64)env->config.rewards[i].weight * cpu->memory[env->config.rewards[i].address];
+    }
+
+    return score;
+}
+
+/******************************************************************
+ * FUNCTION : envIsDone()
+ *    Description: Tell if the episode of a machine is over
+ *    Parameters:  env: environment
+ *                 cpu: machine cpu
+ *                 machine: machine data
+ *    Return:      TRUE if over
+ ******************************************************************/
+static BOOL envIsDone(const envType *env, const cpuType *cpu, const envMachineType *machine)
+{
+    BOOL done = FALSE;
+
+    if (E_CPU_RUNNING != cpu->status)
+    {
+        done = TRUE;
+    }
+    else if ((0U != env->config.maxEpisodeFrames) && (machine->episodeFrames >= env->config.maxEpisodeFrames))
+    {
+        done = TRUE;
+    }
+    else if ((0U != env->config.doneMask)
+             && ((cpu->memory[env->config.doneAddress] & env->config.doneMask) == env->config.doneValue))
+    {
+        done = TRUE;
+    }
+
+    return done;
+}
+
+/******************************************************************
+ * FUNCTION : envAddressesFit()
+ *    Description: Check the reward and done addresses against the
+ *                 memory of the profile
+ *    Parameters:  config: environment configuration
+ *    Return:      TRUE if every address is readable
+ ******************************************************************/
+static BOOL envAddressesFit(const envConfigType *config)
+{
+    U32 size = CPU_ADDRESS_SPACE(config->profile);
+    BOOL fit = ((0U == config->doneMask) || (config->doneAddress < size)) ? TRUE : FALSE;
+    U8 i;
+
+    for (i = 0U; (i < config->rewardCount) && (i < ENV_MAX_REWARDS); i++)
+    {
+        if (config->rewards[i].address >= size)
+        {
+            fit = FALSE;
+        }
+    }
+
+    return fit;
+}
@@ -0,0 +1,76 @@
+/******************************************************************
+ *
+ *
+ * FILE        : env.h
+ * PROJECT     : chip8
+ * AUTHOR      : danpham
+ * DESCRIPTION : Vectorized environment: N machines running one rom,
+ *               stepped together for training loops
+ *
+ ******************************************************************/
+#ifndef ENV_H_
+#define ENV_H_
+
+/******************************************************************
+ * 1. Included files (microcontroller ones then user defined ones)
+ ******************************************************************/
+#include "../headers/typedef.h"
+#include "../cpu/cpu.h"
+#include "../display/display.h"
+
+/******************************************************************
+ * 2. Define declarations (macros then function macros)
+ ******************************************************************/
+#define ENV_MAX_REWARDS                                           8U
+#define ENV_DEFAULT_INSTRUCTIONS_PER_FRAME                       10U
+
+/******************************************************************
+ * 3. Typedef definitions (simple typedef, then enum and structs)
+ ******************************************************************/
+/* One memory byte contributing to the score, e.g. a BCD digit */
+typedef struct
+{
+    U16 address;
+    S32 weight;
+} envRewardType;
+
+typedef struct
+{
+    cpuProfileType profile;
+    U32 instructionsPerFrame;   /* Instructions between two timer ticks, 0 for the default */
+    U32 maxEpisodeFrames;       /* Episode truncation, 0 for none */
+    U32 threads;                /* Threads stepping the machines, the caller is one of them */
+    U32 seed;                   /* Random generator seed of machine 0 */
+    BOOL hugePages;             /* Back the machine pool with huge pages */
+
+    /* The score is the weighted sum of the reward bytes, the reward
+     * of a step is its variation */
+    envRewardType rewards[ENV_MAX_REWARDS];
+    U8 rewardCount;
+
+    /* The episode ends when (memory[doneAddress] & doneMask) == doneValue,
+     * a zero mask disables the test */
+    U16 doneAddress;
+    U8 doneMask;
+    U8 doneValue;
+} envConfigType;
+
+typedef struct envType envType;
+
+/******************************************************************
+ * 4. Variable definitions (static then global)
+ ******************************************************************/
+
+/******************************************************************
+ * 5. Functions prototypes (static only)
+ ******************************************************************/
+extern envType * EnvCreate(const U8 *rom, U32 romSize, U32 count, const envConfigType *config,
+                           displayScreenType *observations, S32 *rewards, U8 *dones);
+extern envType * EnvCreateFromFile(const char *romPath, U32 count, const envConfigType *config,
+                                   displayScreenType *observations, S32 *rewards, U8 *dones);
+extern void EnvStep(envType *env, const U16 *actions, U32 frames);
+extern void EnvReset(envType *env);
+extern U32 EnvCount(const envType *env);
+extern void EnvDestroy(envType *env);
+
+#endif /* ENV_H_ */
@@ -0,0 +1,482 @@
+/******************************************************************
+ *
+ *
+ * FILE        : framedump.c
+ * PROJECT     : chip8
+ * AUTHOR      : danpham
+ * DESCRIPTION : Raw video frame sink.
+ *
+ *               The emulating thread copies changed screens into a
+ *               ring of slots and only counts unchanged ones. A
+ *               writer thread renders each new screen through the
+ *               render stage of the window, phosphor persistence
+ *               included, and writes the expanded image again for
+ *               every repeat. Repeats are rendered again only until
+ *               the fading pixels have settled.
+ *               When the ring is full the frame is written as a
+ *               repeat of the previous one, so emulation never
+ *               waits on the encoder and the stream keeps its
+ *               timing.
+ *
+ ******************************************************************/
+
+/******************************************************************
+ * 1. Included files (microcontroller ones then user defined ones)
+ ******************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#endif
+#include "framedump.h"
+#include "../display/display.h"
+#include "../render/render.h"
+
+/******************************************************************
+ * 2. Define declarations (macros then function macros)
+ ******************************************************************/
+#define FRAMEDUMP_SLOTS                                          16U
+#define FRAMEDUMP_WRITER_PERIOD_MS                               10U
+#define FRAMEDUMP_CHROMA_NEUTRAL                                128U
+
+/******************************************************************
+ * 3. Typedef definitions (simple typedef, then enum and structs)
+ ******************************************************************/
+typedef struct
+{
+    U32 repeatsBefore;              /* Repeats of the previous frame */
+    BOOL hasScreen;                 /* FALSE for the closing slot */
+    displayScreenType screen;
+} frameDumpSlotType;
+
+typedef struct
+{
+    /* Shared between the emulating thread and the writer */
+    SDL_atomic_t head;
+    SDL_atomic_t tail;
+    SDL_atomic_t running;
+    frameDumpSlotType slots[FRAMEDUMP_SLOTS];
+    SDL_Thread *writer;
+    SDL_mutex *mutex;
+    SDL_cond *wakeUp;
+
+    /* Emulating thread only */
+    displayScreenType lastScreen;
+    BOOL hasLastScreen;
+    U32 pendingRepeats;
+    U32 dropped;
+
+    /* Writer thread only */
+    FILE *file;
+    frameDumpFormatType format;
+    U8 scale;
+    U32 width;
+    U32 height;
+    U8 bytesPerPixel;
+    displayScreenType screen;       /* Last screen, rendered again for repeats */
+    renderType render;
+    BOOL settled;                   /* Repeats leave the image unchanged */
+    U8 *image;
+    U32 imageSize;
+    U8 *chroma;
+    U32 chromaSize;
+    BOOL hasImage;
+} frameDumpType;
+
+/******************************************************************
+ * 4. Variable definitions (static then global)
+ ******************************************************************/
+static frameDumpType *s_frameDump;
+
+/******************************************************************
+ * 5. Functions prototypes (static only)
+ ******************************************************************/
+static int frameDumpWriter(void *data);
+static void frameDumpRender(frameDumpType *dump);
+static void frameDumpExpand(frameDumpType *dump);
+static void frameDumpWrite(frameDumpType *dump);
+static void frameDumpPublish(frameDumpType *dump, const displayScreenType *screen);
+static void frameDumpFree(frameDumpType *dump);
+
+/******************************************************************
+ * FUNCTION : FrameDumpOpen()
+ *    Description: Start recording frames
+ *    Parameters:  path: output file, FRAMEDUMP_STDOUT for the
+ *                       standard output
+ *                 format: stream format
+ *                 scale: integer pixel scale
+ *    Return:      E_OK if recording, E_NOT_OK otherwise
+ ******************************************************************/
+Std_ReturnType FrameDumpOpen(const char *path, frameDumpFormatType format, U8 scale)
+{
+    frameDumpType *dump;
+    Std_ReturnType returnValue = E_NOT_OK;
+
+    if ((NULL != s_frameDump) || (0U == scale))
+    {
+        return E_NOT_OK;
+    }
+
+    dump = (frameDumpType *)calloc(1U, sizeof(frameDumpType));
+    if (NULL == dump)
+    {
+        return E_NOT_OK;
+    }
+
+    dump->format = format;
+    dump->scale = scale;
+    dump->width = RENDER_WIDTH * scale;
+    dump->height = RENDER_HEIGHT * scale;
+    dump->bytesPerPixel = (E_FRAMEDUMP_PPM == format) ? 3U : 1U;
+    RenderInit(&dump->render, RENDER_PERSISTENCE);
+
+    dump->imageSize = dump->width * dump->height * dump->bytesPerPixel;
+    dump->image = (U8 *)malloc(dump->imageSize);
+
+    /* 4:2:0 planes never change for a grey palette */
+    dump->chromaSize = 2U * ((dump->width + 1U) / 2U) * ((dump->height + 1U) / 2U);
+    dump->chroma = (U8 *)malloc(dump->chromaSize);
+
+    if (0 == strcmp(path, FRAMEDUMP_STDOUT))
+    {
+#ifdef _WIN32
+        (void)_setmode(_fileno(stdout), _O_BINARY);
+#endif
+        dump->file = stdout;
+    }
+    else
+    {
+        dump->file = fopen(path, "wb");
+    }
+
+    dump->mutex = SDL_CreateMutex();
+    dump->wakeUp = SDL_CreateCond();
+
+    if ((NULL != dump->image) && (NULL != dump->chroma) && (NULL != dump->file) && (NULL != dump->mutex) && (NULL != dump->wakeUp))
+    {
+        (void)memset(dump->chroma, FRAMEDUMP_CHROMA_NEUTRAL, dump->chromaSize);
+
+        if (E_FRAMEDUMP_Y4M == format)
+        {
+            fprintf(dump->file, "YUV4MPEG2 W%lu H%lu F60:1 Ip A1:1 C420jpeg\n", (unsigned long)dump->width, (unsigned long)dump->height);
+        }
+
+        SDL_AtomicSet(&dump->running, 1);
+        dump->writer = SDL_CreateThread(frameDumpWriter, "frame dump", dump);
+
+        if (NULL != dump->writer)
+        {
+            returnValue = E_OK;
+        }
+    }
+
+    if (E_OK == returnValue)
+    {
+        s_frameDump = dump;
+    }
+    else
+    {
+        printf("Unable to open frame dump %s", path);
+        frameDumpFree(dump);
+    }
+
+    return returnValue;
+}
+
+/******************************************************************
+ * FUNCTION : FrameDumpFrame()
+ *    Description: Record one emulated frame. Never blocks.
+ *    Parameters:  screen: see DisplayGetScreen()
+ *    Return:      None
+ ******************************************************************/
+void FrameDumpFrame(const displayScreenType *screen)
+{
+    frameDumpType *dump = s_frameDump;
+
+    if (NULL == dump)
+    {
+        return;
+    }
+
+    if ((TRUE == dump->hasLastScreen) && (screen->width == dump->lastScreen.width)
+        && (0 == memcmp(screen->rows, dump->lastScreen.rows, sizeof(screen->rows))))
+    {
+        /* Unchanged: the writer repeats the previous image */
+        dump->pendingRepeats++;
+    }
+    else if ((SDL_AtomicGet(&dump->head) - SDL_AtomicGet(&dump->tail)) >= (int)FRAMEDUMP_SLOTS)
+    {
+        /* Writer is behind: keep the timing, lose this image */
+        dump->pendingRepeats++;
+        dump->dropped++;
+    }
+    else
+    {
+        (void)memcpy(&dump->lastScreen, screen, sizeof(displayScreenType));
+        dump->hasLastScreen = TRUE;
+        frameDumpPublish(dump, screen);
+    }
+}
+
+/******************************************************************
+ * FUNCTION : FrameDumpDropped()
+ *    Description: Number of changed frames written as repeats
+ *                 because the writer was behind
+ *    Parameters:  None
+ *    Return:      Dropped frames
+ ******************************************************************/
+U32 FrameDumpDropped(void)
+{
+    return (NULL != s_frameDump) ? s_frameDump->dropped : 0U;
+}
+
+/******************************************************************
+ * FUNCTION : FrameDumpClose()
+ *    Description: Write pending frames and close the stream
+ *    Parameters:  None
+ *    Return:      None
+ ******************************************************************/
+void FrameDumpClose(void)
+{
+    frameDumpType *dump = s_frameDump;
+
+    if (NULL == dump)
+    {
+        return;
+    }
+
+    /* Closing slot carrying the trailing repeats */
+    while ((SDL_AtomicGet(&dump->head) - SDL_AtomicGet(&dump->tail)) >= (int)FRAMEDUMP_SLOTS)
+    {
+        SDL_Delay(1U);
+    }
+    frameDumpPublish(dump, NULL);
+
+    SDL_AtomicSet(&dump->running, 0);
+    SDL_CondSignal(dump->wakeUp);
+    SDL_WaitThread(dump->writer, NULL);
+    dump->writer = NULL;
+
+    s_frameDump = NULL;
+    frameDumpFree(dump);
+}
+
+/******************************************************************
+ * FUNCTION : frameDumpPublish()
+ *    Description: Fill the next slot and hand it to the writer
+ *    Parameters:  dump: sink
+ *                 screen: new screen, NULL for repeats only
+ *    Return:      None
+ ******************************************************************/
+static void frameDumpPublish(frameDumpType *dump, const displayScreenType *screen)
+{
+    int head = SDL_AtomicGet(&dump->head);
+    frameDumpSlotType *slot = &dump->slots[head % FRAMEDUMP_SLOTS];
+
+    slot->repeatsBefore = dump->pendingRepeats;
+    slot->hasScreen = (NULL != screen) ? TRUE : FALSE;
+
+    if (NULL != screen)
+    {
+        (void)memcpy(&slot->screen, screen, sizeof(displayScreenType));
+    }
+
+    dump->pendingRepeats = 0U;
+
+    /* Slot content is visible before the new head */
+    SDL_MemoryBarrierRelease();
+    SDL_AtomicSet(&dump->head, head + 1);
+    SDL_CondSignal(dump->wakeUp);
+}
+
+/******************************************************************
+ * FUNCTION : frameDumpWriter()
+ *    Description: Writer thread: expand and write published slots
+ *    Parameters:  data: sink
+ *    Return:      0
+ ******************************************************************/
+static int frameDumpWriter(void *data)
+{
+    frameDumpType *dump = (frameDumpType *)data;
+    frameDumpSlotType *slot;
+    int tail = SDL_AtomicGet(&dump->tail);
+    U32 repeat;
+    BOOL running = TRUE;
+
+    while ((TRUE == running) || (tail != SDL_AtomicGet(&dump->head)))
+    {
+        running = (0 != SDL_AtomicGet(&dump->running)) ? TRUE : FALSE;
+
+        if (tail == SDL_AtomicGet(&dump->head))
+        {
+            if (TRUE == running)
+            {
+                SDL_LockMutex(dump->mutex);
+                (void)SDL_CondWaitTimeout(dump->wakeUp, dump->mutex, FRAMEDUMP_WRITER_PERIOD_MS);
+                SDL_UnlockMutex(dump->mutex);
+            }
+            continue;
+        }
+
+        SDL_MemoryBarrierAcquire();
+        slot = &dump->slots[tail % FRAMEDUMP_SLOTS];
+
+        if (TRUE == dump->hasImage)
+        {
+            for (repeat = 0U; repeat < slot->repeatsBefore; repeat++)
+            {
+                if (FALSE == dump->settled)
+                {
+                    frameDumpRender(dump);
+                }
+                frameDumpWrite(dump);
+            }
+        }
+
+        if (TRUE == slot->hasScreen)
+        {
+            (void)memcpy(&dump->screen, &slot->screen, sizeof(displayScreenType));
+            frameDumpRender(dump);
+            dump->hasImage = TRUE;
+            frameDumpWrite(dump);
+        }
+
+        tail++;
+        SDL_AtomicSet(&dump->tail, tail);
+    }
+
+    (void)fflush(dump->file);
+
+    return 0;
+}
+
+/******************************************************************
+ * FUNCTION : frameDumpRender()
+ *    Description: Render dump->screen over the previous image and
+ *                 expand the result
+ *    Parameters:  dump: sink
+ *    Return:      None
+ ******************************************************************/
+static void frameDumpRender(frameDumpType *dump)
+{
+    /* The first image is expanded even if black like the initial one */
+    if ((FALSE != RenderFrame(&dump->render, &dump->screen)) || (FALSE == dump->hasImage))
+    {
+        frameDumpExpand(dump);
+        dump->settled = FALSE;
+    }
+    else
+    {
+        dump->settled = TRUE;
+    }
+}
+
+/******************************************************************
+ * FUNCTION : frameDumpExpand()
+ *    Description: Nearest neighbour upscale of the rendered image:
+ *                 each row is expanded once then copied
+ *    Parameters:  dump: sink
+ *    Return:      None
+ ******************************************************************/
+static void frameDumpExpand(frameDumpType *dump)
+{
+    U32 rowSize = dump->width * dump->bytesPerPixel;
+    U32 block = dump->scale;
+    Uint32 pixel;
+    U8 red;
+    U8 green;
+    U8 blue;
+    U8 luma;
+    U8 *row;
+    U8 *out;
+    U32 x;
+    U32 y;
+    U32 copy;
+
+    for (y = 0U; y < RENDER_HEIGHT; y++)
+    {
+        row = &dump->image[y * block * rowSize];
+        out = row;
+
+        for (x = 0U; x < RENDER_WIDTH; x++)
+        {
+            pixel = dump->render.pixels[y][x];
+            red = (U8)(pixel >> 16U);
+            green = (U8)(pixel >> 8U);
+            blue = (U8)pixel;
+
+            if (1U == dump->bytesPerPixel)
+            {
+                /* BT.601 full range luma */
+                luma = (U8)(((77U * red) + (150U * green) + (29U * blue)) >> 8U);
+                (void)memset(out, luma, block);
+                out += block;
+            }
+            else
+            {
+                for (copy = 0U; copy < block; copy++)
+                {
+                    *out++ = red;
+                    *out++ = green;
+                    *out++ = blue;
+                }
+            }
+        }
+
+        for (copy = 1U; copy < block; copy++)
+        {
+            (void)memcpy(&row[copy * rowSize], row, rowSize);
+        }
+    }
+}
+
+/******************************************************************
+ * FUNCTION : frameDumpWrite()
+ *    Description: Write the expanded image as one stream frame
+ *    Parameters:  dump: sink
+ *    Return:      None
+ ******************************************************************/
+static void frameDumpWrite(frameDumpType *dump)
+{
+    if (E_FRAMEDUMP_Y4M == dump->format)
+    {
+        (void)fputs("FRAME\n", dump->file);
+        (void)fwrite(dump->image, 1U, dump->imageSize, dump->file);
+        (void)fwrite(dump->chroma, 1U, dump->chromaSize, dump->file);
+    }
+    else
+    {
+        fprintf(dump->file, "P6\n%lu %lu\n255\n", (unsigned long)dump->width, (unsigned long)dump->height);
+        (void)fwrite(dump->image, 1U, dump->imageSize, dump->file);
+    }
+}
+
+/******************************************************************
+ * FUNCTION : frameDumpFree()
+ *    Description: Release a sink
+ *    Parameters:  dump: sink
+ *    Return:      None
+ ******************************************************************/
+static void frameDumpFree(frameDumpType *dump)
+{
+    if ((NULL != dump->file) && (stdout != dump->file))
+    {
+        fclose(dump->file);
+    }
+
+    if (NULL != dump->wakeUp)
+    {
+        SDL_DestroyCond(dump->wakeUp);
+    }
+
+    if (NULL != dump->mutex)
+    {
+        SDL_DestroyMutex(dump->mutex);
+    }
+
+    free(dump->image);
+    free(dump->chroma);
+    free(dump);
+}
@@ -0,0 +1,61 @@
+/******************************************************************
+ *
+ *
+ * FILE        : framedump.h
+ * PROJECT     : chip8
+ * AUTHOR      : danpham
+ * DESCRIPTION : Raw video frame sink (Y4M or PPM stream). Build
+ *               with -DFRAMEDUMP_ENABLED to record every frame of
+ *               the emulator, the hooks are compiled out otherwise.
+ *
+ ******************************************************************/
+#ifndef FRAMEDUMP_H_
+#define FRAMEDUMP_H_
+
+/******************************************************************
+ * 1. Included files (microcontroller ones then user defined ones)
+ ******************************************************************/
+#include "../headers/typedef.h"
+#include "../display/display.h"
+
+/******************************************************************
+ * 2. Define declarations (macros then function macros)
+ ******************************************************************/
+#define FRAMEDUMP_FILE                              "build/frames.y4m"
+#define FRAMEDUMP_SCALE                                           4U
+
+/* Path writing the stream on the standard output, e.g. to pipe it in an encoder */
+#define FRAMEDUMP_STDOUT                                        "-"
+
+#ifdef FRAMEDUMP_ENABLED
+#define FRAMEDUMP_START()          (void)FrameDumpOpen(FRAMEDUMP_FILE, E_FRAMEDUMP_Y4M, FRAMEDUMP_SCALE)
+#define FRAMEDUMP_FRAME(screen)    FrameDumpFrame(screen)
+#define FRAMEDUMP_STOP()           FrameDumpClose()
+#else
+#define FRAMEDUMP_START()
+#define FRAMEDUMP_FRAME(screen)
+#define FRAMEDUMP_STOP()
+#endif
+
+/******************************************************************
+ * 3. Typedef definitions (simple typedef, then enum and structs)
+ ******************************************************************/
+typedef enum
+{
+    E_FRAMEDUMP_Y4M,    /* YUV4MPEG2, 4:2:0, 60 fps */
+    E_FRAMEDUMP_PPM     /* Concatenated binary PPM images */
+} frameDumpFormatType;
+
+/******************************************************************
+ * 4. Variable definitions (static then global)
+ ******************************************************************/
+
+/******************************************************************
+ * 5. Functions prototypes (static only)
+ ******************************************************************/
+extern Std_ReturnType FrameDumpOpen(const char *path, frameDumpFormatType format, U8 scale);
+extern void FrameDumpFrame(const displayScreenType *screen);
+extern U32 FrameDumpDropped(void);
+extern void FrameDumpClose(void);
+
+#endif /* FRAMEDUMP_H_ */
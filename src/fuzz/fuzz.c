@@ -0,0 +1,326 @@
+/******************************************************************
+ *
+ *
+ * FILE        : fuzz.c
+ * PROJECT     : chip8
+ * AUTHOR      : danpham
+ * DESCRIPTION : libFuzzer harness of the cpu core.
+ *
+ *               Every execution restores a machine from a snapshot
+ *               taken once per profile, nothing is read from disk,
+ *               then runs at most FUZZ_MAX_INSTRUCTIONS headless.
+ *               The first input byte selects the profile, its
+ *               bit 7 runs the execution through CpuRun() and its
+ *               fused idioms instead of one CpuStep() at a time,
+ *               a frame of FUZZ_FRAME_INSTRUCTIONS per call. With
+ *               FUZZ_ROM_VARIABLE unset the rest of the input is
+ *               the rom; otherwise that rom is loaded in the
+ *               snapshots and the input is a key script of byte
+ *               pairs: frames to wait, then key (low nibble) and
+ *               press (bit 7).
+ *
+ *               Faults of the program (invalid opcode, stack
+ *               overflow or underflow) only end the execution; a
+ *               machine left in an impossible state aborts.
+ *
+ *               Build with clang -fsanitize=fuzzer,address, or
+ *               define FUZZ_STANDALONE to run inputs given as files.
+ *
+ ******************************************************************/
+
+/******************************************************************
+ * 1. Included files (microcontroller ones then user defined ones)
+ ******************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../cpu/cpu.h"
+#include "../display/display.h"
+#include "../import/import.h"
+#include "../input/input.h"
+
+/******************************************************************
+ * 2. Define declarations (macros then function macros)
+ ******************************************************************/
+#define FUZZ_MAX_INSTRUCTIONS                                 20000U
+#define FUZZ_FRAME_INSTRUCTIONS                                  10U
+#define FUZZ_SEED                                        0x2545F491UL
+
+#define FUZZ_ROM_VARIABLE                             "CHIP8_FUZZ_ROM"
+
+#define FUZZ_PROFILE_MASK                                      0x7FU
+#define FUZZ_FUSED                                             0x80U
+
+#define FUZZ_KEY_MASK                                          0x0FU
+#define FUZZ_KEY_DOWN                                          0x80U
+
+#define FUZZ_MAX_INPUT_SIZE                                   65536UL
+
+/* libFuzzer looks the entry points up with C linkage */
+#ifdef __cplusplus
+#define FUZZ_ENTRY                                        extern "C"
+#else
+#define FUZZ_ENTRY
+#endif
+
+/******************************************************************
+ * 3. Typedef definitions (simple typedef, then enum and structs)
+ ******************************************************************/
+/* Memories are sized for the profile, an access past the guard is
+ * caught by the sanitizer */
+typedef struct
+{
+    cpuType cpu;
+    displayScreenType screen;
+    U8 *memory;
+    U8 *liveMemory;                 /* Memory of s_fuzz.cpu running the profile */
+} fuzzSnapshotType;
+
+typedef struct
+{
+    BOOL initialized;
+    BOOL script;                    /* Input is a key script on FUZZ_ROM_VARIABLE */
+    BOOL fused;                     /* Execution runs through CpuRun() */
+    fuzzSnapshotType snapshots[E_CPU_PROFILE_NUMBER];
+    cpuType cpu;
+    displayScreenType screen;
+    BOOL keys[INPUT_NUMBER_OF_KEYBOARD_KEYS];
+    U32 remaining;                  /* Instructions left to the execution */
+} fuzzType;
+
+/******************************************************************
+ * 4. Variable definitions (static then global)
+ ******************************************************************/
+static fuzzType s_fuzz;
+
+/******************************************************************
+ * 5. Functions prototypes (static only)
+ ******************************************************************/
+FUZZ_ENTRY int LLVMFuzzerInitialize(int *argc, char ***argv);
+FUZZ_ENTRY int LLVMFuzzerTestOneInput(const U8 *data, size_t size);
+static void fuzzRestore(cpuProfileType profile);
+static void fuzzRun(U32 instructions);
+static void fuzzCheck(void);
+
+/******************************************************************
+ * FUNCTION : LLVMFuzzerInitialize()
+ *    Description: Take the snapshots, once per process
+ *    Parameters:  argc, argv: fuzzer arguments, unused
+ *    Return:      0
+ ******************************************************************/
+FUZZ_ENTRY int LLVMFuzzerInitialize(int *argc, char ***argv)
+{
+    const char *romPath = getenv(FUZZ_ROM_VARIABLE);
+    const U8 *rom = NULL;
+    U32 size = 0U;
+    U32 profile;
+
+    (void)argc;
+    (void)argv;
+
+    if (NULL != romPath)
+    {
+        rom = ImportRomCached(romPath, &size);
+        if (NULL == rom)
+        {
+            printf("Unable to load rom %s\n", romPath);
+            exit(1);
+        }
+        s_fuzz.script = TRUE;
+    }
+
+    for (profile = 0U; profile < (U32)E_CPU_PROFILE_NUMBER; profile++)
+    {
+        s_fuzz.snapshots[profile].memory = (U8 *)malloc(CPU_MEMORY_BYTES(profile));
+        s_fuzz.snapshots[profile].liveMemory = (U8 *)malloc(CPU_MEMORY_BYTES(profile));
+        if ((NULL == s_fuzz.snapshots[profile].memory) || (NULL == s_fuzz.snapshots[profile].liveMemory))
+        {
+            printf("Out of memory\n");
+            exit(1);
+        }
+
+        CpuAttach(&s_fuzz.snapshots[profile].cpu, s_fuzz.snapshots[profile].memory, &s_fuzz.snapshots[profile].screen,
+                  NULL);
+        CpuReset(&s_fuzz.snapshots[profile].cpu, (cpuProfileType)profile, FUZZ_SEED);
+
+        if ((NULL != rom) && (E_OK != CpuLoad(&s_fuzz.snapshots[profile].cpu, rom, size)))
+        {
+            printf("Rom %s does not fit in memory\n", romPath);
+            exit(1);
+        }
+    }
+
+    s_fuzz.initialized = TRUE;
+
+    return 0;
+}
+
+/******************************************************************
+ * FUNCTION : LLVMFuzzerTestOneInput()
+ *    Description: Run one input
+ *    Parameters:  data, size: input
+ *    Return:      0
+ ******************************************************************/
+FUZZ_ENTRY int LLVMFuzzerTestOneInput(const U8 *data, size_t size)
+{
+    size_t offset;
+    U8 event;
+
+    if (FALSE == s_fuzz.initialized)
+    {
+        (void)LLVMFuzzerInitialize(NULL, NULL);
+    }
+
+    if (0U == size)
+    {
+        return 0;
+    }
+
+    fuzzRestore((cpuProfileType)((data[0U] & FUZZ_PROFILE_MASK) % (U8)E_CPU_PROFILE_NUMBER));
+    s_fuzz.fused = (0U != (data[0U] & FUZZ_FUSED)) ? TRUE : FALSE;
+
+    if (FALSE == s_fuzz.script)
+    {
+        /* Rom mode, a rom too large for the profile is not run */
+        if ((size > 1U) && (E_OK == CpuLoad(&s_fuzz.cpu, &data[1U], (U32)(size - 1U))))
+        {
+            fuzzRun(FUZZ_MAX_INSTRUCTIONS);
+        }
+    }
+    else
+    {
+        /* Key script mode */
+        for (offset = 1U; (offset + 1U) < size; offset += 2U)
+        {
+            fuzzRun((U32)data[offset] * FUZZ_FRAME_INSTRUCTIONS);
+            event = data[offset + 1U];
+            s_fuzz.keys[event & FUZZ_KEY_MASK] = (0U != (event & FUZZ_KEY_DOWN)) ? TRUE : FALSE;
+        }
+        fuzzRun(FUZZ_MAX_INSTRUCTIONS);
+    }
+
+    return 0;
+}
+
+/******************************************************************
+ * FUNCTION : fuzzRestore()
+ *    Description: Restore the machine from a snapshot, keys released
+ *                 and instruction budget refilled
+ *    Parameters:  profile: snapshot to restore
+ *    Return:      None
+ ******************************************************************/
+static void fuzzRestore(cpuProfileType profile)
+{
+    CpuAttach(&s_fuzz.cpu, s_fuzz.snapshots[profile].liveMemory, &s_fuzz.screen, s_fuzz.keys);
+    CpuCopy(&s_fuzz.cpu, &s_fuzz.snapshots[profile].cpu);
+    (void)memcpy((void *)&s_fuzz.screen, (const void *)&s_fuzz.snapshots[profile].screen, sizeof(displayScreenType));
+    (void)memset((void *)s_fuzz.keys, 0, sizeof(s_fuzz.keys));
+    s_fuzz.remaining = FUZZ_MAX_INSTRUCTIONS;
+}
+
+/******************************************************************
+ * FUNCTION : fuzzRun()
+ *    Description: Run instructions with the timers ticking every
+ *                 FUZZ_FRAME_INSTRUCTIONS, stop on a fault or once
+ *                 the budget of the execution is spent
+ *    Parameters:  instructions: instructions to run
+ *    Return:      None
+ ******************************************************************/
+static void fuzzRun(U32 instructions)
+{
+    U32 i;
+    U32 frame;
+
+    if (FALSE != s_fuzz.fused)
+    {
+        /* A frame waiting for a key runs nothing but still spends
+         * its budget, as the window does */
+        for (i = 0U; (i < instructions) && (0U != s_fuzz.remaining); i += frame)
+        {
+            frame = FUZZ_FRAME_INSTRUCTIONS - (s_fuzz.remaining % FUZZ_FRAME_INSTRUCTIONS);
+            frame = (frame > s_fuzz.remaining) ? s_fuzz.remaining : frame;
+            (void)CpuRun(&s_fuzz.cpu, frame);
+            fuzzCheck();
+            if (E_CPU_RUNNING != s_fuzz.cpu.status)
+            {
+                break;
+            }
+            s_fuzz.remaining -= frame;
+
+            if (0U == (s_fuzz.remaining % FUZZ_FRAME_INSTRUCTIONS))
+            {
+                CpuTimers(&s_fuzz.cpu);
+            }
+        }
+    }
+    else
+    {
+        for (i = 0U; (i < instructions) && (0U != s_fuzz.remaining); i++)
+        {
+            if (E_OK != CpuStep(&s_fuzz.cpu))
+            {
+                break;
+            }
+            fuzzCheck();
+            s_fuzz.remaining--;
+
+            if (0U == (s_fuzz.remaining % FUZZ_FRAME_INSTRUCTIONS))
+            {
+                CpuTimers(&s_fuzz.cpu);
+            }
+        }
+    }
+}
+
+/******************************************************************
+ * FUNCTION : fuzzCheck()
+ *    Description: Abort on a machine state no program may reach
+ *    Parameters:  None
+ *    Return:      None
+ ******************************************************************/
+static void fuzzCheck(void)
+{
+    const cpuType *cpu = &s_fuzz.cpu;
+
+    if ((cpu->stackLevel < -1) || (cpu->stackLevel >= (S8)CPU_STACK_DEPTH_LEVEL)
+        || (cpu->pc >= CPU_ADDRESS_SPACE(cpu->profile)) || (cpu->i >= CPU_ADDRESS_SPACE(cpu->profile))
+        || (cpu->screen->width > DISPLAY_HIRES_WIDTH) || (cpu->screen->height > DISPLAY_HIRES_HEIGHT))
+    {
+        abort();
+    }
+}
+
+#ifdef FUZZ_STANDALONE
+/******************************************************************
+ * FUNCTION : main(int argc, char** argv)
+ *    Description: Run the input files once each, to replay a crash
+ *                 without libFuzzer. Usage: fuzz FILE...
+ *    Parameters:  None
+ *    Return:      0 on success, 1 if a file cannot be read
+ ******************************************************************/
+int main(int argc, char **argv)
+{
+    static U8 s_input[FUZZ_MAX_INPUT_SIZE];
+    FILE *filePtr;
+    size_t size;
+    int arg;
+
+    (void)LLVMFuzzerInitialize(&argc, &argv);
+
+    for (arg = 1; arg < argc; arg++)
+    {
+        if (NULL == (filePtr = fopen(argv[arg], "rb")))
+        {
+            printf("Unable to open %s\n", argv[arg]);
+            return 1;
+        }
+        size = fread(s_input, 1U, sizeof(s_input), filePtr);
+        fclose(filePtr);
+
+        (void)LLVMFuzzerTestOneInput(s_input, size);
+        printf("%s: status %u after pc %03X\n", argv[arg], (unsigned int)s_fuzz.cpu.status, s_fuzz.cpu.pc);
+    }
+
+    return 0;
+}
+#endif
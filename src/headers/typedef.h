@@ -56,6 +56,10 @@ typedef  volatile unsigned long VU32;
 typedef           signed long S32;
 typedef  volatile signed long VS32;
 
+/* 64 bits typedefs */
+typedef           unsigned long long U64;
+typedef           signed long long S64;
+
 /* 1 bit typedefs */
 typedef           unsigned char BOOL;
 
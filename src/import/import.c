@@ -4,7 +4,13 @@
  * FILE        : import.c
  * PROJECT     : chip8
  * AUTHOR      : danpham
- * DESCRIPTION : Rom file import
+ * DESCRIPTION : Rom file import.
+ *
+ *               Roms are kept in a process wide cache of read-only
+ *               images keyed by content hash, so instances loading
+ *               the same rom share one image and only the first
+ *               load of a path reaches the filesystem. Files are
+ *               memory mapped where mmap is available.
  *
  ******************************************************************/
 
@@ -12,48 +18,451 @@
  * 1. Included files (microcontroller ones then user defined ones)
  ******************************************************************/
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+#include <SDL2/SDL.h>
 #include "import.h"
 #include "../cpu/cpu.h"
 
 /******************************************************************
  * 2. Define declarations (macros then function macros)
  ******************************************************************/
+#define IMPORT_CACHE_INITIAL_SIZE                                16U
+#define IMPORT_HASH_PRIME                      0x00000100000001B3ULL
 
 /******************************************************************
  * 3. Typedef definitions (simple typedef, then enum and structs)
  ******************************************************************/
+typedef struct
+{
+    U64 hash;
+    U32 size;
+    U8 *data;
+    BOOL mapped;            /* data is a file mapping, allocated otherwise */
+} importImageType;
+
+typedef struct
+{
+    char *path;
+    const U8 *data;
+    U32 size;
+} importPathType;
+
+typedef struct
+{
+    SDL_SpinLock lock;
+    importImageType *images;
+    U32 imageCount;
+    U32 imageCapacity;
+    importPathType *paths;
+    U32 pathCount;
+    U32 pathCapacity;
+} importType;
 
 /******************************************************************
  * 4. Variable definitions (static then global)
  ******************************************************************/
+static importType s_import;
 
 /******************************************************************
  * 5. Functions prototypes (static only)
  ******************************************************************/
+static U8 * importReadFile(const char *path, U32 *size, BOOL *mapped);
+static void importReleaseImage(U8 *data, U32 size, BOOL mapped);
+static const U8 * importAddImage(U8 *data, U32 size, BOOL mapped, BOOL copy);
+static BOOL importGrow(void **array, U32 *capacity, U32 count, size_t elementSize);
 
 /******************************************************************
  * FUNCTION : ImportRom()
  *    Description: Import a chip8 rom
- *    Parameters:  memory
+ *    Parameters:  path: rom file
+ *                 memory: cpu memory, rom is copied at
+ *                 CPU_START_ADDRESS
+ *                 memorySize: addressable bytes of memory
  *    Return:      E_OK if import succeed, E_NOT_OK
  *                 otherwise.
  ******************************************************************/
-Std_ReturnType ImportRom(U8 *memory)
+Std_ReturnType ImportRom(const char *path, U8 *memory, U32 memorySize)
 {
-    Std_ReturnType returnValue = E_OK;
-    FILE *filePtr;
+    Std_ReturnType returnValue = E_NOT_OK;
+    const U8 *rom;
+    U32 size = 0U;
+
+    rom = ImportRomCached(path, &size);
 
-    if (NULL == (filePtr = fopen("build/IBMLogo.ch8", "rb")))
+    if (NULL == rom)
     {
-        printf("Unable to open file.");
-        returnValue = E_NOT_OK;
+        printf("Unable to open file %s.", path);
     }
     else
     {
-        /* Load memory starting from CPU_START_ADDRESS index (CPU_START_ADDRESS - 1) */
-        fread(&memory[CPU_START_ADDRESS], 1U, CPU_MAX_PROGRAM_SIZE, filePtr);
-        fclose(filePtr);
+        returnValue = ImportRomBuffer(rom, size, memory, memorySize);
+    }
+
+    return returnValue;
+}
+
+/******************************************************************
+ * FUNCTION : ImportRomBuffer()
+ *    Description: Import a chip8 rom from memory
+ *    Parameters:  rom, size: rom bytes
+ *                 memory: cpu memory, rom is copied at
+ *                 CPU_START_ADDRESS
+ *                 memorySize: addressable bytes of memory
+ *    Return:      E_OK if the rom fits in memory, E_NOT_OK
+ *                 otherwise.
+ ******************************************************************/
+Std_ReturnType ImportRomBuffer(const U8 *rom, U32 size, U8 *memory, U32 memorySize)
+{
+    Std_ReturnType returnValue = E_NOT_OK;
+
+    if ((NULL == rom) || (0U == size) || (memorySize <= CPU_START_ADDRESS) || (size > (memorySize - CPU_START_ADDRESS)))
+    {
+        printf("Invalid rom size: %lu bytes.", (unsigned long)size);
+    }
+    else
+    {
+        /* Load memory starting from CPU_START_ADDRESS index */
+        (void)memcpy(&memory[CPU_START_ADDRESS], rom, size);
+        returnValue = E_OK;
     }
 
     return returnValue;
-}
\ No newline at end of file
+}
+
+/******************************************************************
+ * FUNCTION : ImportRomCached()
+ *    Description: Shared read-only image of a rom file. Only the
+ *                 first call for a path reads the file.
+ *    Parameters:  path: rom file
+ *                 size: output, rom size
+ *    Return:      Image, valid until ImportExit(), NULL if the
+ *                 file cannot be read
+ ******************************************************************/
+const U8 * ImportRomCached(const char *path, U32 *size)
+{
+    const U8 *image = NULL;
+    U8 *data;
+    BOOL mapped = FALSE;
+    U32 i;
+    size_t length;
+
+    SDL_AtomicLock(&s_import.lock);
+    for (i = 0U; i < s_import.pathCount; i++)
+    {
+        if (0 == strcmp(s_import.paths[i].path, path))
+        {
+            image = s_import.paths[i].data;
+            *size = s_import.paths[i].size;
+            break;
+        }
+    }
+    SDL_AtomicUnlock(&s_import.lock);
+
+    if (NULL != image)
+    {
+        return image;
+    }
+
+    data = importReadFile(path, size, &mapped);
+    if (NULL == data)
+    {
+        return NULL;
+    }
+
+    image = importAddImage(data, *size, mapped, FALSE);
+
+    if (NULL != image)
+    {
+        SDL_AtomicLock(&s_import.lock);
+        if (TRUE == importGrow((void **)&s_import.paths, &s_import.pathCapacity, s_import.pathCount, sizeof(importPathType)))
+        {
+            length = strlen(path) + 1U;
+            s_import.paths[s_import.pathCount].path = (char *)malloc(length);
+
+            if (NULL != s_import.paths[s_import.pathCount].path)
+            {
+                (void)memcpy(s_import.paths[s_import.pathCount].path, path, length);
+                s_import.paths[s_import.pathCount].data = image;
+                s_import.paths[s_import.pathCount].size = *size;
+                s_import.pathCount++;
+            }
+        }
+        SDL_AtomicUnlock(&s_import.lock);
+    }
+
+    return image;
+}
+
+/******************************************************************
+ * FUNCTION : ImportRomShare()
+ *    Description: Shared read-only image of a rom held by the
+ *                 caller. The bytes are copied once per content.
+ *    Parameters:  rom, size: rom bytes
+ *    Return:      Image, valid until ImportExit(), NULL on error
+ ******************************************************************/
+const U8 * ImportRomShare(const U8 *rom, U32 size)
+{
+    if ((NULL == rom) || (0U == size))
+    {
+        return NULL;
+    }
+
+    return importAddImage((U8 *)rom, size, FALSE, TRUE);
+}
+
+/******************************************************************
+ * FUNCTION : ImportExit()
+ *    Description: Release every cached image
+ *    Parameters:  None
+ *    Return:      None
+ ******************************************************************/
+void ImportExit(void)
+{
+    U32 i;
+
+    SDL_AtomicLock(&s_import.lock);
+
+    for (i = 0U; i < s_import.imageCount; i++)
+    {
+        importReleaseImage(s_import.images[i].data, s_import.images[i].size, s_import.images[i].mapped);
+    }
+
+    for (i = 0U; i < s_import.pathCount; i++)
+    {
+        free(s_import.paths[i].path);
+    }
+
+    free(s_import.images);
+    free(s_import.paths);
+    s_import.images = NULL;
+    s_import.paths = NULL;
+    s_import.imageCount = 0U;
+    s_import.imageCapacity = 0U;
+    s_import.pathCount = 0U;
+    s_import.pathCapacity = 0U;
+
+    SDL_AtomicUnlock(&s_import.lock);
+}
+
+/******************************************************************
+ * FUNCTION : importAddImage()
+ *    Description: Insert an image in the cache, or return the
+ *                 cached image with the same content
+ *    Parameters:  data, size: rom bytes
+ *                 mapped: data is a file mapping
+ *                 copy: TRUE if data belongs to the caller
+ *    Return:      Cached image, NULL on error
+ ******************************************************************/
+static const U8 * importAddImage(U8 *data, U32 size, BOOL mapped, BOOL copy)
+{
+    U64 hash = ImportHash(IMPORT_HASH_OFFSET, data, size);
+    const U8 *image = NULL;
+    U8 *owned = NULL;
+    U32 i;
+
+    SDL_AtomicLock(&s_import.lock);
+
+    for (i = 0U; i < s_import.imageCount; i++)
+    {
+        if ((s_import.images[i].hash == hash) && (s_import.images[i].size == size)
+            && (0 == memcmp(s_import.images[i].data, data, size)))
+        {
+            image = s_import.images[i].data;
+            break;
+        }
+    }
+
+    if (NULL == image)
+    {
+        owned = data;
+
+        if (TRUE == copy)
+        {
+            owned = (U8 *)malloc(size);
+            if (NULL != owned)
+            {
+                (void)memcpy(owned, data, size);
+            }
+        }
+
+        if ((NULL != owned) && (TRUE == importGrow((void **)&s_import.images, &s_import.imageCapacity, s_import.imageCount, sizeof(importImageType))))
+        {
+            s_import.images[s_import.imageCount].hash = hash;
+            s_import.images[s_import.imageCount].size = size;
+            s_import.images[s_import.imageCount].data = owned;
+            s_import.images[s_import.imageCount].mapped = mapped;
+            s_import.imageCount++;
+            image = owned;
+        }
+    }
+
+    SDL_AtomicUnlock(&s_import.lock);
+
+    /* Same content already cached, or no room: drop our image */
+    if ((FALSE == copy) && (image != data))
+    {
+        importReleaseImage(data, size, mapped);
+    }
+    else if ((TRUE == copy) && (NULL != owned) && (image != owned))
+    {
+        free(owned);
+    }
+
+    return image;
+}
+
+/******************************************************************
+ * FUNCTION : importReadFile()
+ *    Description: Map a rom file, or read it where mmap is not
+ *                 available
+ *    Parameters:  path: rom file
+ *                 size: output, file size
+ *                 mapped: output, TRUE if mapped
+ *    Return:      File bytes, NULL on error
+ ******************************************************************/
+static U8 * importReadFile(const char *path, U32 *size, BOOL *mapped)
+{
+    U8 *data = NULL;
+#ifndef _WIN32
+    int file;
+    struct stat status;
+    void *mapping;
+
+    *mapped = FALSE;
+    file = open(path, O_RDONLY);
+
+    if (file >= 0)
+    {
+        if ((0 == fstat(file, &status)) && (status.st_size > 0) && (status.st_size <= (off_t)CPU_XO_MAX_PROGRAM_SIZE))
+        {
+            mapping = mmap(NULL, (size_t)status.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+
+            if (MAP_FAILED != mapping)
+            {
+                data = (U8 *)mapping;
+                *size = (U32)status.st_size;
+                *mapped = TRUE;
+            }
+        }
+        else
+        {
+            printf("Invalid rom size: %s.", path);
+        }
+
+        (void)close(file);
+    }
+#else
+    FILE *filePtr;
+    long length;
+
+    *mapped = FALSE;
+
+    if (NULL != (filePtr = fopen(path, "rb")))
+    {
+        if ((0 == fseek(filePtr, 0L, SEEK_END)) && ((length = ftell(filePtr)) > 0L)
+            && (length <= (long)CPU_XO_MAX_PROGRAM_SIZE) && (0 == fseek(filePtr, 0L, SEEK_SET)))
+        {
+            data = (U8 *)malloc((size_t)length);
+
+            if ((NULL != data) && (fread(data, 1U, (size_t)length, filePtr) != (size_t)length))
+            {
+                free(data);
+                data = NULL;
+            }
+            *size = (U32)length;
+        }
+        else
+        {
+            printf("Invalid rom size: %s.", path);
+        }
+
+        fclose(filePtr);
+    }
+#endif
+
+    return data;
+}
+
+/******************************************************************
+ * FUNCTION : importReleaseImage()
+ *    Description: Unmap or free an image
+ *    Parameters:  data, size: image
+ *                 mapped: data is a file mapping
+ *    Return:      None
+ ******************************************************************/
+static void importReleaseImage(U8 *data, U32 size, BOOL mapped)
+{
+#ifndef _WIN32
+    if (TRUE == mapped)
+    {
+        (void)munmap(data, size);
+        return;
+    }
+#else
+    (void)size;
+    (void)mapped;
+#endif
+
+    free(data);
+}
+
+/******************************************************************
+ * FUNCTION : ImportHash()
+ *    Description: FNV-1a hash of bytes, shared by the rom caches,
+ *                 the analysis and the compat checkpoints
+ *    Parameters:  hash: IMPORT_HASH_OFFSET, or the hash of the
+ *                       previous bytes to continue it
+ *                 data, size: bytes
+ *    Return:      Hash
+ ******************************************************************/
+U64 ImportHash(U64 hash, const U8 *data, U32 size)
+{
+    U32 i;
+
+    for (i = 0U; i < size; i++)
+    {
+        hash ^= data[i];
+        hash *= IMPORT_HASH_PRIME;
+    }
+
+    return hash;
+}
+
+/******************************************************************
+ * FUNCTION : importGrow()
+ *    Description: Make room for one more element in a cache array
+ *    Parameters:  array, capacity: array to grow
+ *                 count: elements in use
+ *                 elementSize: size of one element
+ *    Return:      TRUE if an element can be added
+ ******************************************************************/
+static BOOL importGrow(void **array, U32 *capacity, U32 count, size_t elementSize)
+{
+    U32 newCapacity;
+    void *newArray;
+
+    if (count < *capacity)
+    {
+        return TRUE;
+    }
+
+    newCapacity = (*capacity == 0U) ? IMPORT_CACHE_INITIAL_SIZE : (*capacity * 2U);
+    newArray = realloc(*array, newCapacity * elementSize);
+
+    if (NULL == newArray)
+    {
+        return FALSE;
+    }
+
+    *array = newArray;
+    *capacity = newCapacity;
+
+    return TRUE;
+}
@@ -16,6 +16,10 @@
 /******************************************************************
  * 2. Define declarations (macros then function macros)
  ******************************************************************/
+#define IMPORT_DEFAULT_ROM                        "build/IBMLogo.ch8"
+
+/* Seed of ImportHash(), FNV-1a offset basis */
+#define IMPORT_HASH_OFFSET                     0xCBF29CE484222325ULL
 
 /******************************************************************
  * 3. Typedef definitions (simple typedef, then enum and structs)
@@ -28,4 +32,9 @@
 /******************************************************************
  * 5. Functions prototypes (static only)
  ******************************************************************/
-extern Std_ReturnType ImportRom(U8 *memory);
+extern Std_ReturnType ImportRom(const char *path, U8 *memory, U32 memorySize);
+extern Std_ReturnType ImportRomBuffer(const U8 *rom, U32 size, U8 *memory, U32 memorySize);
+extern const U8 * ImportRomCached(const char *path, U32 *size);
+extern const U8 * ImportRomShare(const U8 *rom, U32 size);
+extern void ImportExit(void);
+extern U64 ImportHash(U64 hash, const U8 *data, U32 size);
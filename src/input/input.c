@@ -13,6 +13,7 @@
  ******************************************************************/
 #include <stdio.h>
 #include "input.h"
+#include "../latency/latency.h"
 
 /******************************************************************
  * 2. Define declarations (macros then function macros)
@@ -21,10 +22,20 @@
 /******************************************************************
  * 3. Typedef definitions (simple typedef, then enum and structs)
  ******************************************************************/
+typedef struct
+{
+    U8 key;
+    BOOL down;
+    U32 timestamp;                  /* SDL_GetTicks() time of the event */
+} inputEventType;
+
 typedef struct
 {
     SDL_Keycode keyboardMapping[INPUT_NUMBER_OF_KEYBOARD_KEYS];
     BOOL keyboardStatus[INPUT_NUMBER_OF_KEYBOARD_KEYS];
+    inputEventType queue[INPUT_QUEUE_SIZE];
+    U32 queueHead;                  /* Next event to apply */
+    U32 queueTail;                  /* Next free slot */
 } inputType;
 
 /******************************************************************
@@ -35,8 +46,7 @@ inputType s_input;
 /******************************************************************
  * 5. Functions prototypes (static only)
  ******************************************************************/
-
-
+static U8 inputKey(SDL_Keycode sym);
 
 /******************************************************************
  * FUNCTION : InputInit()
@@ -121,31 +131,115 @@ BOOL * InputKeyboardStatus()
 }
 
 /******************************************************************
- * FUNCTION : InputWaitKeyboardPressed()
- *    Description: Wait for a keyboard key to be pressed
- *    Parameters:  None
- *    Return:      Value of key pressed
+ * FUNCTION : InputKeycode()
+ *    Description: Keyboard key mapped on a chip8 key
+ *    Parameters:  key: chip8 key
+ *    Return:      SDL key code, SDLK_UNKNOWN for an invalid key
+ ******************************************************************/
+SDL_Keycode InputKeycode(U8 key)
+{
+    return (key < INPUT_NUMBER_OF_KEYBOARD_KEYS) ? s_input.keyboardMapping[key] : SDLK_UNKNOWN;
+}
+
+/******************************************************************
+ * FUNCTION : InputQueueKey()
+ *    Description: Queue a key event until the next instruction
+ *                 boundary, see InputApplyKeys(). Keys not mapped
+ *                 are ignored, a full queue applies its oldest event
+ *                 at once.
+ *    Parameters:  sym: SDL key code
+ *                 down: TRUE for a press, FALSE for a release
+ *                 timestamp: SDL event timestamp
+ *    Return:      None
+ ******************************************************************/
+void InputQueueKey(SDL_Keycode sym, BOOL down, U32 timestamp)
+{
+    inputEventType *event;
+    U8 key = inputKey(sym);
+
+    if (key >= INPUT_NUMBER_OF_KEYBOARD_KEYS)
+    {
+        return;
+    }
+
+    if ((s_input.queueTail - s_input.queueHead) >= INPUT_QUEUE_SIZE)
+    {
+        event = &s_input.queue[s_input.queueHead % INPUT_QUEUE_SIZE];
+        s_input.keyboardStatus[event->key] = event->down;
+        s_input.queueHead++;
+    }
+
+    event = &s_input.queue[s_input.queueTail % INPUT_QUEUE_SIZE];
+    event->key = key;
+    event->down = down;
+    event->timestamp = timestamp;
+    s_input.queueTail++;
+
+    LATENCY_EVENT(key, down, timestamp);
+}
+
+/******************************************************************
+ * FUNCTION : InputApplyKeys()
+ *    Description: Apply the queued events up to a time, in order,
+ *                 at an instruction boundary. A key changes at most
+ *                 once per call, so a press and release between two
+ *                 boundaries are both seen by the program.
+ *    Parameters:  until: SDL_GetTicks() time of the boundary
+ *    Return:      Events applied
  ******************************************************************/
-U8 InputWaitKeyboardPressed()
+U32 InputApplyKeys(U32 until)
 {
-    BOOL keyPressed = FALSE;
-    U8 keyIndex = 0U;
-    SDL_Event event;
+    inputEventType *event;
+    U16 changed = 0U;
+    U32 applied = 0U;
 
-    while (TRUE != keyPressed)
+    while (s_input.queueHead != s_input.queueTail)
     {
-        while (SDL_PollEvent(&event))
+        event = &s_input.queue[s_input.queueHead % INPUT_QUEUE_SIZE];
+        if (((S32)(event->timestamp - until) > 0) || (0U != (changed & (1U << event->key))))
         {
-            switch (event.type)
-            {
-            case SDL_KEYDOWN:
-                keyIndex = InputUpdateKeyboardDown(event.key.keysym.sym);
-                break;
-            }
+            break;
         }
 
-        SDL_Delay(1U);
+        s_input.keyboardStatus[event->key] = event->down;
+        changed |= (U16)(1U << event->key);
+        s_input.queueHead++;
+        applied++;
+
+        LATENCY_APPLY(event->key, event->down);
     }
 
-    return keyIndex;
-}
\ No newline at end of file
+    return applied;
+}
+
+/******************************************************************
+ * FUNCTION : InputPending()
+ *    Description: Key events not applied yet
+ *    Parameters:  None
+ *    Return:      TRUE if the queue is not empty
+ ******************************************************************/
+BOOL InputPending(void)
+{
+    return (s_input.queueHead != s_input.queueTail) ? TRUE : FALSE;
+}
+
+/******************************************************************
+ * FUNCTION : inputKey()
+ *    Description: Chip8 key mapped on a keyboard key
+ *    Parameters:  sym: SDL key code
+ *    Return:      Key, INPUT_NUMBER_OF_KEYBOARD_KEYS if not mapped
+ ******************************************************************/
+static U8 inputKey(SDL_Keycode sym)
+{
+    U8 i;
+
+    for (i = 0U; i < INPUT_NUMBER_OF_KEYBOARD_KEYS; i++)
+    {
+        if (sym == s_input.keyboardMapping[i])
+        {
+            break;
+        }
+    }
+
+    return i;
+}
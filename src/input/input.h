@@ -19,6 +19,9 @@
  ******************************************************************/
 #define INPUT_NUMBER_OF_KEYBOARD_KEYS                            16U
 
+/* Key events waiting for an instruction boundary */
+#define INPUT_QUEUE_SIZE                                         64U
+
 /******************************************************************
  * 3. Typedef definitions (simple typedef, then enum and structs)
  ******************************************************************/
@@ -34,4 +37,7 @@ extern void InputInit();
 extern void InputUpdateKeyboardUp(SDL_Keycode sym);
 extern U8 InputUpdateKeyboardDown(SDL_Keycode sym);
 extern BOOL * InputKeyboardStatus();
-extern U8 InputWaitKeyboardPressed();
\ No newline at end of file
+extern SDL_Keycode InputKeycode(U8 key);
+extern void InputQueueKey(SDL_Keycode sym, BOOL down, U32 timestamp);
+extern U32 InputApplyKeys(U32 until);
+extern BOOL InputPending(void);
\ No newline at end of file
@@ -0,0 +1,451 @@
+/******************************************************************
+ *
+ *
+ * FILE        : latency.c
+ * PROJECT     : chip8
+ * AUTHOR      : danpham
+ * DESCRIPTION : End to end input latency.
+ *
+ *               A sample starts with a key press event, stamped by
+ *               SDL in milliseconds, then records the host time the
+ *               key is applied to the keyboard, the time the program
+ *               first reads it pressed (Ex9E, ExA1, Fx0A) and the
+ *               time the first frame changed after that read is
+ *               presented. Only presses are measured, one sample per
+ *               key is open at a time.
+ *
+ ******************************************************************/
+
+/******************************************************************
+ * 1. Included files (microcontroller ones then user defined ones)
+ ******************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <SDL2/SDL.h>
+#include "latency.h"
+#include "../input/input.h"
+
+/******************************************************************
+ * 2. Define declarations (macros then function macros)
+ ******************************************************************/
+#define LATENCY_NO_SAMPLE                                    0xFFFFU
+
+/******************************************************************
+ * 3. Typedef definitions (simple typedef, then enum and structs)
+ ******************************************************************/
+typedef enum
+{
+    E_LATENCY_QUEUED,       /* Event waiting in the input queue */
+    E_LATENCY_APPLIED,      /* Key down, not read yet */
+    E_LATENCY_OBSERVED,     /* Read by the program, no frame yet */
+    E_LATENCY_PRESENTED,    /* Complete */
+    E_LATENCY_UNREAD,       /* Released or pressed again unread */
+    E_LATENCY_UNCHANGED     /* Read, no screen change followed */
+} latencyStageType;
+
+typedef enum
+{
+    E_LATENCY_EVENT_APPLY,
+    E_LATENCY_APPLY_READ,
+    E_LATENCY_READ_PRESENT,
+    E_LATENCY_EVENT_PRESENT,
+    E_LATENCY_INTERVALS
+} latencyIntervalType;
+
+typedef struct
+{
+    U64 event;                      /* Host times in microseconds */
+    U64 apply;
+    U64 read;
+    U64 present;
+    U64 applyInstruction;           /* Instructions executed so far */
+    U64 readInstruction;
+    latencyStageType stage;
+} latencySampleType;
+
+typedef struct
+{
+    latencySampleType samples[LATENCY_MAX_SAMPLES];
+    U32 count;
+    U32 waiting;                    /* First sample not closed */
+    U16 keySample[INPUT_NUMBER_OF_KEYBOARD_KEYS];
+    U64 instructions;
+    displayRowType lastRows[DISPLAY_PLANES][DISPLAY_HIRES_HEIGHT];
+    U8 lastWidth;
+    BOOL initialized;
+} latencyType;
+
+/******************************************************************
+ * 4. Variable definitions (static then global)
+ ******************************************************************/
+static latencyType s_latency;
+
+static const char *s_intervalNames[E_LATENCY_INTERVALS] = {
+    "event-apply",
+    "apply-read",
+    "read-present",
+    "event-present"
+};
+
+/******************************************************************
+ * 5. Functions prototypes (static only)
+ ******************************************************************/
+static void latencyInit(void);
+static U64 latencyNow(void);
+static void latencyClose(latencySampleType *sample, latencyStageType stage);
+static U32 latencyCollect(latencyIntervalType interval, U64 *values);
+static void latencyPrint(FILE *filePtr, const char *name, U64 *values, U32 count);
+static int latencyCompare(const void *a, const void *b);
+
+/******************************************************************
+ * FUNCTION : LatencyEvent()
+ *    Description: Start a sample on a key press event
+ *    Parameters:  key: chip8 key
+ *                 down: TRUE for a press
+ *                 timestamp: SDL_GetTicks() time of the event
+ *    Return:      None
+ ******************************************************************/
+void LatencyEvent(U8 key, BOOL down, U32 timestamp)
+{
+    latencySampleType *sample;
+    U64 now = latencyNow();
+    U32 age = SDL_GetTicks() - timestamp;
+
+    latencyInit();
+
+    if ((FALSE == down) || (s_latency.count >= LATENCY_MAX_SAMPLES))
+    {
+        return;
+    }
+
+    /* A press never read is not latency, only a missed input */
+    if (LATENCY_NO_SAMPLE != s_latency.keySample[key])
+    {
+        latencyClose(&s_latency.samples[s_latency.keySample[key]], E_LATENCY_UNREAD);
+    }
+
+    sample = &s_latency.samples[s_latency.count];
+    sample->event = (((U64)age * 1000ULL) < now) ? (now - ((U64)age * 1000ULL)) : now;
+    sample->stage = E_LATENCY_QUEUED;
+    s_latency.keySample[key] = (U16)s_latency.count;
+    s_latency.count++;
+}
+
+/******************************************************************
+ * FUNCTION : LatencyApply()
+ *    Description: Stamp the sample of a key applied to the keyboard
+ *    Parameters:  key: chip8 key
+ *                 down: TRUE for a press
+ *    Return:      None
+ ******************************************************************/
+void LatencyApply(U8 key, BOOL down)
+{
+    latencySampleType *sample;
+
+    latencyInit();
+
+    if (LATENCY_NO_SAMPLE == s_latency.keySample[key])
+    {
+        return;
+    }
+
+    sample = &s_latency.samples[s_latency.keySample[key]];
+    if (FALSE == down)
+    {
+        /* Released before the program read it */
+        if (E_LATENCY_APPLIED == sample->stage)
+        {
+            latencyClose(sample, E_LATENCY_UNREAD);
+            s_latency.keySample[key] = LATENCY_NO_SAMPLE;
+        }
+    }
+    else if (E_LATENCY_QUEUED == sample->stage)
+    {
+        sample->apply = latencyNow();
+        sample->applyInstruction = s_latency.instructions;
+        sample->stage = E_LATENCY_APPLIED;
+    }
+}
+
+/******************************************************************
+ * FUNCTION : LatencyInstruction()
+ *    Description: Count one executed instruction
+ *    Parameters:  None
+ *    Return:      None
+ ******************************************************************/
+void LatencyInstruction(void)
+{
+    s_latency.instructions++;
+}
+
+/******************************************************************
+ * FUNCTION : LatencyRead()
+ *    Description: Stamp the sample of a key the program reads
+ *                 pressed. Keyboards other than the window one are
+ *                 ignored.
+ *    Parameters:  keys: keyboard read by the cpu
+ *                 key: chip8 key
+ *    Return:      None
+ ******************************************************************/
+void LatencyRead(const BOOL *keys, U8 key)
+{
+    latencySampleType *sample;
+
+    latencyInit();
+
+    if ((keys != InputKeyboardStatus()) || (TRUE != keys[key]) || (LATENCY_NO_SAMPLE == s_latency.keySample[key]))
+    {
+        return;
+    }
+
+    sample = &s_latency.samples[s_latency.keySample[key]];
+    if (E_LATENCY_APPLIED == sample->stage)
+    {
+        sample->read = latencyNow();
+        sample->readInstruction = s_latency.instructions;
+        sample->stage = E_LATENCY_OBSERVED;
+        s_latency.keySample[key] = LATENCY_NO_SAMPLE;
+    }
+}
+
+/******************************************************************
+ * FUNCTION : LatencyFrame()
+ *    Description: Complete the samples read before a presented frame
+ *                 that differs from the previous one
+ *    Parameters:  screen: presented screen
+ *    Return:      None
+ ******************************************************************/
+void LatencyFrame(const displayScreenType *screen)
+{
+    latencySampleType *sample;
+    U64 now = latencyNow();
+    BOOL changed;
+    U32 i;
+
+    latencyInit();
+
+    changed = ((screen->width != s_latency.lastWidth)
+               || (0 != memcmp(screen->rows, s_latency.lastRows, sizeof(s_latency.lastRows)))) ? TRUE : FALSE;
+    if (FALSE != changed)
+    {
+        (void)memcpy(s_latency.lastRows, screen->rows, sizeof(s_latency.lastRows));
+        s_latency.lastWidth = screen->width;
+    }
+
+    for (i = s_latency.waiting; i < s_latency.count; i++)
+    {
+        sample = &s_latency.samples[i];
+        if (E_LATENCY_OBSERVED != sample->stage)
+        {
+            continue;
+        }
+
+        if (FALSE != changed)
+        {
+            sample->present = now;
+            sample->stage = E_LATENCY_PRESENTED;
+        }
+        else if ((now - sample->read) > LATENCY_FRAME_TIMEOUT_US)
+        {
+            latencyClose(sample, E_LATENCY_UNCHANGED);
+        }
+    }
+
+    /* Skip the closed samples on the next frames */
+    while ((s_latency.waiting < s_latency.count) && (s_latency.samples[s_latency.waiting].stage >= E_LATENCY_PRESENTED))
+    {
+        s_latency.waiting++;
+    }
+}
+
+/******************************************************************
+ * FUNCTION : LatencyReport()
+ *    Description: Write percentiles of each interval in
+ *                 microseconds and the instructions between apply
+ *                 and read
+ *    Parameters:  path: report file
+ *    Return:      E_OK if report is written, E_NOT_OK otherwise
+ ******************************************************************/
+Std_ReturnType LatencyReport(const char *path)
+{
+    static U64 s_values[LATENCY_MAX_SAMPLES];
+    FILE *filePtr;
+    U32 unread = 0U;
+    U32 unchanged = 0U;
+    U32 count = 0U;
+    U32 i;
+
+    if (NULL == (filePtr = fopen(path, "w")))
+    {
+        return E_NOT_OK;
+    }
+
+    for (i = 0U; i < s_latency.count; i++)
+    {
+        unread += (E_LATENCY_UNREAD == s_latency.samples[i].stage) ? 1U : 0U;
+        unchanged += (E_LATENCY_UNCHANGED == s_latency.samples[i].stage) ? 1U : 0U;
+    }
+
+    fprintf(filePtr, "Key presses:      %lu\n", (unsigned long)s_latency.count);
+    fprintf(filePtr, "Not read:         %lu\n", (unsigned long)unread);
+    fprintf(filePtr, "No screen change: %lu\n\n", (unsigned long)unchanged);
+
+    fprintf(filePtr, "%-14s %8s %10s %10s %10s %10s\n", "interval (us)", "count", "p50", "p90", "p99", "max");
+    for (i = 0U; i < E_LATENCY_INTERVALS; i++)
+    {
+        count = latencyCollect((latencyIntervalType)i, s_values);
+        latencyPrint(filePtr, s_intervalNames[i], s_values, count);
+    }
+
+    /* Instructions the program ran before reading an applied key */
+    count = 0U;
+    for (i = 0U; i < s_latency.count; i++)
+    {
+        if ((E_LATENCY_OBSERVED == s_latency.samples[i].stage) || (E_LATENCY_PRESENTED == s_latency.samples[i].stage))
+        {
+            s_values[count] = s_latency.samples[i].readInstruction - s_latency.samples[i].applyInstruction;
+            count++;
+        }
+    }
+    fprintf(filePtr, "\n%-14s %8s %10s %10s %10s %10s\n", "instructions", "count", "p50", "p90", "p99", "max");
+    latencyPrint(filePtr, "apply-read", s_values, count);
+
+    fclose(filePtr);
+
+    return E_OK;
+}
+
+/******************************************************************
+ * FUNCTION : latencyInit()
+ *    Description: Mark every key without sample on first use
+ *    Parameters:  None
+ *    Return:      None
+ ******************************************************************/
+static void latencyInit(void)
+{
+    U8 i;
+
+    if (FALSE == s_latency.initialized)
+    {
+        for (i = 0U; i < INPUT_NUMBER_OF_KEYBOARD_KEYS; i++)
+        {
+            s_latency.keySample[i] = LATENCY_NO_SAMPLE;
+        }
+        s_latency.initialized = TRUE;
+    }
+}
+
+/******************************************************************
+ * FUNCTION : latencyNow()
+ *    Description: Host time
+ *    Parameters:  None
+ *    Return:      Time in microseconds
+ ******************************************************************/
+static U64 latencyNow(void)
+{
+    return (U64)(((double)SDL_GetPerformanceCounter() * 1000000.0) / (double)SDL_GetPerformanceFrequency());
+}
+
+/******************************************************************
+ * FUNCTION : latencyClose()
+ *    Description: End a sample that will never complete
+ *    Parameters:  sample: sample
+ *                 stage: E_LATENCY_UNREAD or E_LATENCY_UNCHANGED
+ *    Return:      None
+ ******************************************************************/
+static void latencyClose(latencySampleType *sample, latencyStageType stage)
+{
+    if (sample->stage < E_LATENCY_PRESENTED)
+    {
+        sample->stage = stage;
+    }
+}
+
+/******************************************************************
+ * FUNCTION : latencyCollect()
+ *    Description: Values of an interval over the samples that
+ *                 reached its end
+ *    Parameters:  interval: measured interval
+ *                 values: output, LATENCY_MAX_SAMPLES entries
+ *    Return:      Number of values
+ ******************************************************************/
+static U32 latencyCollect(latencyIntervalType interval, U64 *values)
+{
+    const latencySampleType *sample;
+    U32 count = 0U;
+    U32 i;
+
+    for (i = 0U; i < s_latency.count; i++)
+    {
+        sample = &s_latency.samples[i];
+
+        switch (interval)
+        {
+        case E_LATENCY_EVENT_APPLY:
+            if ((E_LATENCY_QUEUED != sample->stage) && (0U != sample->apply))
+            {
+                values[count++] = sample->apply - sample->event;
+            }
+            break;
+        case E_LATENCY_APPLY_READ:
+            if ((E_LATENCY_OBSERVED == sample->stage) || (E_LATENCY_PRESENTED == sample->stage))
+            {
+                values[count++] = sample->read - sample->apply;
+            }
+            break;
+        case E_LATENCY_READ_PRESENT:
+            if (E_LATENCY_PRESENTED == sample->stage)
+            {
+                values[count++] = sample->present - sample->read;
+            }
+            break;
+        case E_LATENCY_EVENT_PRESENT:
+        default:
+            if (E_LATENCY_PRESENTED == sample->stage)
+            {
+                values[count++] = sample->present - sample->event;
+            }
+            break;
+        }
+    }
+
+    return count;
+}
+
+/******************************************************************
+ * FUNCTION : latencyPrint()
+ *    Description: Write one line of percentiles, values are sorted
+ *    Parameters:  filePtr: report file
+ *                 name: line name
+ *                 values, count: measures
+ *    Return:      None
+ ******************************************************************/
+static void latencyPrint(FILE *filePtr, const char *name, U64 *values, U32 count)
+{
+    if (0U == count)
+    {
+        fprintf(filePtr, "%-14s %8d %10s %10s %10s %10s\n", name, 0, "-", "-", "-", "-");
+        return;
+    }
+
+    qsort(values, count, sizeof(U64), latencyCompare);
+
+    fprintf(filePtr, "%-14s %8lu %10llu %10llu %10llu %10llu\n", name, (unsigned long)count,
+            values[(count * 50U) / 100U], values[(count * 90U) / 100U], values[(count * 99U) / 100U],
+            values[count - 1U]);
+}
+
+/******************************************************************
+ * FUNCTION : latencyCompare()
+ *    Description: qsort comparator, ascending value
+ *    Parameters:  a, b: values
+ *    Return:      Ordering of a and b
+ ******************************************************************/
+static int latencyCompare(const void *a, const void *b)
+{
+    U64 left = *(const U64 *)a;
+    U64 right = *(const U64 *)b;
+
+    return (left > right) - (left < right);
+}
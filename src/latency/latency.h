@@ -0,0 +1,66 @@
+/******************************************************************
+ *
+ *
+ * FILE        : latency.h
+ * PROJECT     : chip8
+ * AUTHOR      : danpham
+ * DESCRIPTION : End to end input latency: key event, key applied,
+ *               key read by the program, first changed frame
+ *               presented. Build with -DLATENCY_ENABLED to turn the
+ *               hooks on, they are compiled out otherwise.
+ *
+ ******************************************************************/
+#ifndef LATENCY_H_
+#define LATENCY_H_
+
+/******************************************************************
+ * 1. Included files (microcontroller ones then user defined ones)
+ ******************************************************************/
+#include "../headers/typedef.h"
+#include "../display/display.h"
+
+/******************************************************************
+ * 2. Define declarations (macros then function macros)
+ ******************************************************************/
+#define LATENCY_REPORT_FILE                        "build/latency.txt"
+
+#define LATENCY_MAX_SAMPLES                                    4096U
+
+/* A key read without any screen change for this long is closed */
+#define LATENCY_FRAME_TIMEOUT_US                           1000000ULL
+
+#ifdef LATENCY_ENABLED
+#define LATENCY_EVENT(key, down, timestamp)   LatencyEvent((key), (down), (timestamp))
+#define LATENCY_APPLY(key, down)              LatencyApply((key), (down))
+#define LATENCY_INSTRUCTION()                 LatencyInstruction()
+#define LATENCY_READ(keys, key)               LatencyRead((keys), (key))
+#define LATENCY_FRAME(screen)                 LatencyFrame(screen)
+#define LATENCY_REPORT()                      (void)LatencyReport(LATENCY_REPORT_FILE)
+#else
+#define LATENCY_EVENT(key, down, timestamp)
+#define LATENCY_APPLY(key, down)
+#define LATENCY_INSTRUCTION()
+#define LATENCY_READ(keys, key)
+#define LATENCY_FRAME(screen)
+#define LATENCY_REPORT()
+#endif
+
+/******************************************************************
+ * 3. Typedef definitions (simple typedef, then enum and structs)
+ ******************************************************************/
+
+/******************************************************************
+ * 4. Variable definitions (static then global)
+ ******************************************************************/
+
+/******************************************************************
+ * 5. Functions prototypes (static only)
+ ******************************************************************/
+extern void LatencyEvent(U8 key, BOOL down, U32 timestamp);
+extern void LatencyApply(U8 key, BOOL down);
+extern void LatencyInstruction(void);
+extern void LatencyRead(const BOOL *keys, U8 key);
+extern void LatencyFrame(const displayScreenType *screen);
+extern Std_ReturnType LatencyReport(const char *path);
+
+#endif /* LATENCY_H_ */
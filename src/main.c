@@ -12,11 +12,23 @@
  * 1. Included files (microcontroller ones then user defined ones)
  ******************************************************************/
 #include <stdio.h>
+#include <string.h>
 #include <SDL2/SDL.h>
 #include "cpu/cpu.h"
 #include "input/input.h"
 #include "display/display.h"
+#include "import/import.h"
 #include "sound/sound.h"
+#include "profiler/profiler.h"
+#include "trace/trace.h"
+#include "framedump/framedump.h"
+#include "shm/shm.h"
+#include "stream/stream.h"
+#include "netplay/netplay.h"
+#include "debugger/debugger.h"
+#include "metrics/metrics.h"
+#include "latency/latency.h"
+#include "startup/startup.h"
 
 /******************************************************************
  * 2. Define declarations (macros then function macros)
@@ -37,23 +49,124 @@
 /******************************************************************
  * FUNCTION : main(int argv, char** args)
  *    Description: main
- *    Parameters:  None
+ *    Parameters:  args: [--vip | --schip | --xochip] [--debug]
+ *                       [--netplay PLAYER:PORT:HOST:PORT] [rom file]
  *    Return:      None
  ******************************************************************/
 int main(int argv, char **args)
 {
+    const char *romPath = IMPORT_DEFAULT_ROM;
+    netplayConfigType netplayConfig;
+    netplayType *netplay = NULL;
+    const char *netplayAddress = NULL;
+    char netplayHost[64];
+    unsigned int player;
+    unsigned int localPort;
+    unsigned int remotePort;
+    BOOL debug = FALSE;
+    int arg;
 
-    (void)CpuInit();
+    STARTUP_START();
+
+    for (arg = 1; arg < argv; arg++)
+    {
+        if (0 == strcmp(args[arg], "--vip"))
+        {
+            CpuSetProfile(E_CPU_PROFILE_VIP);
+        }
+        else if (0 == strcmp(args[arg], "--schip"))
+        {
+            CpuSetProfile(E_CPU_PROFILE_SCHIP);
+        }
+        else if (0 == strcmp(args[arg], "--xochip"))
+        {
+            CpuSetProfile(E_CPU_PROFILE_XOCHIP);
+        }
+        else if (0 == strcmp(args[arg], "--debug"))
+        {
+            debug = TRUE;
+        }
+        else if ((0 == strcmp(args[arg], "--netplay")) && ((arg + 1) < argv))
+        {
+            arg++;
+            netplayAddress = args[arg];
+        }
+        else
+        {
+            romPath = args[arg];
+        }
+    }
+
+    /* Rom given on the command line, default rom otherwise */
+    (void)CpuInit(romPath);
+    STARTUP_PHASE("rom");
+
+    /* Player 1 or 2, local port, then the other peer */
+    if (NULL != netplayAddress)
+    {
+        if (4 != sscanf(netplayAddress, "%u:%u:%63[^:]:%u", &player, &localPort, netplayHost, &remotePort))
+        {
+            printf("Netplay address should be PLAYER:PORT:HOST:PORT.\n");
+            return 1;
+        }
+
+        netplayConfig.localPort = (U16)localPort;
+        netplayConfig.remoteHost = netplayHost;
+        netplayConfig.remotePort = (U16)remotePort;
+        netplayConfig.localKeys = (2U == player) ? NETPLAY_PLAYER2_KEYS : NETPLAY_PLAYER1_KEYS;
+        netplayConfig.instructionsPerFrame = 0U;
+
+        netplay = NetplayOpen(CpuGetDefault(), &netplayConfig);
+        if (NULL == netplay)
+        {
+            return 1;
+        }
+        CpuSetNetplay(netplay);
+    }
+
+    /* Stop before the first instruction with --debug */
+    DEBUGGER_START(debug);
+
+    METRICS_START();
+    METRICS_THREAD("main");
+
+    TRACE_START();
 
     InputInit();
+    STARTUP_PHASE("setup");
 
     DisplayInit();
 
-    SoundInit();
+    FRAMEDUMP_START();
+
+    SHM_START();
+
+    STREAM_START();
+    STARTUP_PHASE("services");
 
     DisplayUpdate();
 
+    PROFILER_REPORT();
+
+    LATENCY_REPORT();
+
+    STARTUP_REPORT();
+
+    TRACE_STOP();
+
+    FRAMEDUMP_STOP();
+
+    SHM_STOP();
+
+    STREAM_STOP();
+
+    METRICS_STOP();
+
+    NetplayClose(netplay);
+
     DisplayExit();
 
+    ImportExit();
+
     return 0;
 }
@@ -0,0 +1,694 @@
+/******************************************************************
+ *
+ *
+ * FILE        : metrics.c
+ * PROJECT     : chip8
+ * AUTHOR      : danpham
+ * DESCRIPTION : Performance counters.
+ *
+ *               Every thread owns a block of counters, claimed once
+ *               and found again through thread local storage; only
+ *               its owner writes it, so the hooks take no lock. The
+ *               server thread reads every block when it formats the
+ *               text, a value may lag by one update. Blocks live
+ *               until exit so counters of finished threads are kept.
+ *
+ ******************************************************************/
+
+/******************************************************************
+ * 1. Included files (microcontroller ones then user defined ones)
+ ******************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <string.h>
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <netdb.h>
+#include <unistd.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#endif
+#include <SDL2/SDL.h>
+#include "metrics.h"
+
+/******************************************************************
+ * 2. Define declarations (macros then function macros)
+ ******************************************************************/
+#define METRICS_TEXT_SIZE                                   262144UL
+#define METRICS_ADDRESS_SIZE                                    256U
+#define METRICS_REQUEST_SIZE                                   1024U
+#define METRICS_HEADER_SIZE                                     256U
+#define METRICS_BACKLOG                                           8U
+#define METRICS_POLL_MS                                         200U
+#define METRICS_FILE_PERIOD_MS                                 1000U
+#define METRICS_REQUEST_TIMEOUT_MS                             1000U
+
+#ifdef _WIN32
+#define METRICS_INVALID_SOCKET                       INVALID_SOCKET
+#define metricsCloseSocket(socket)              closesocket(socket)
+#else
+#define METRICS_INVALID_SOCKET                                   -1
+#define metricsCloseSocket(socket)                    close(socket)
+#endif
+
+/******************************************************************
+ * 3. Typedef definitions (simple typedef, then enum and structs)
+ ******************************************************************/
+#ifdef _WIN32
+typedef SOCKET metricsSocketType;
+#else
+typedef int metricsSocketType;
+#endif
+
+typedef struct
+{
+    SDL_atomic_t ready;             /* Set once name is written */
+    char name[METRICS_NAME_SIZE];
+
+    /* Written by the owning thread only */
+    volatile U64 instructions;
+    volatile U64 frames;
+    volatile U64 framesDropped;
+    volatile U64 framesRepeated;
+    volatile U64 draws;
+    volatile U64 sounds;
+    volatile U64 soundDrops;
+    volatile U64 machinesRunning;
+    volatile U64 machinesBlocked;
+    volatile U64 frameTime;         /* Microseconds, sum of the histogram */
+    volatile U64 frameBuckets[METRICS_FRAME_BUCKETS];
+    U64 lastFrame;                  /* Performance counter of the last frame */
+} metricsThreadType;
+
+/* Counter or gauge with one value per thread */
+typedef struct
+{
+    const char *name;
+    const char *help;
+    const char *type;
+    size_t offset;
+} metricsFamilyType;
+
+typedef struct
+{
+    SDL_atomic_t open;
+    SDL_atomic_t running;
+    SDL_atomic_t threadCount;       /* Blocks claimed, may exceed METRICS_MAX_THREADS */
+    SDL_TLSID tls;
+    SDL_Thread *server;
+    metricsSocketType socket;
+    BOOL file;
+    char path[METRICS_ADDRESS_SIZE];
+    char *text;
+    metricsThreadType threads[METRICS_MAX_THREADS];
+} metricsType;
+
+/******************************************************************
+ * 4. Variable definitions (static then global)
+ ******************************************************************/
+static metricsType s_metrics;
+
+static const metricsFamilyType s_metricsFamilies[] =
+{
+    { "chip8_instructions_total", "Instructions executed.", "counter",
+      offsetof(metricsThreadType, instructions) },
+    { "chip8_frames_total", "Frames presented.", "counter",
+      offsetof(metricsThreadType, frames) },
+    { "chip8_frames_dropped_total", "Emulated frames run but never presented.", "counter",
+      offsetof(metricsThreadType, framesDropped) },
+    { "chip8_frames_repeated_total", "Frames presented again without a new emulated frame.", "counter",
+      offsetof(metricsThreadType, framesRepeated) },
+    { "chip8_draws_total", "Sprites drawn.", "counter",
+      offsetof(metricsThreadType, draws) },
+    { "chip8_sounds_total", "Sounds queued to the audio device.", "counter",
+      offsetof(metricsThreadType, sounds) },
+    { "chip8_sound_drops_total", "Sounds the audio device did not take.", "counter",
+      offsetof(metricsThreadType, soundDrops) },
+    { "chip8_machines_running", "Machines run by the thread.", "gauge",
+      offsetof(metricsThreadType, machinesRunning) },
+    { "chip8_machines_blocked", "Machines of the thread waiting for a key.", "gauge",
+      offsetof(metricsThreadType, machinesBlocked) },
+};
+
+/******************************************************************
+ * 5. Functions prototypes (static only)
+ ******************************************************************/
+static metricsThreadType * metricsCurrent(void);
+static metricsThreadType * metricsRegister(const char *name);
+static Std_ReturnType metricsListen(const char *address);
+static int metricsServer(void *data);
+static void metricsServe(metricsSocketType client);
+static void metricsWriteFile(void);
+static void metricsAppend(char *text, U32 size, U32 *length, const char *format, ...);
+
+/******************************************************************
+ * FUNCTION : MetricsOpen()
+ *    Description: Start serving the counters, once per process
+ *    Parameters:  address: "tcp:HOST:PORT" or "file:PATH"
+ *    Return:      E_OK if served, E_NOT_OK otherwise
+ ******************************************************************/
+Std_ReturnType MetricsOpen(const char *address)
+{
+    if (FALSE == SDL_AtomicCAS(&s_metrics.open, 0, 1))
+    {
+        return E_OK;
+    }
+
+    s_metrics.socket = METRICS_INVALID_SOCKET;
+    s_metrics.text = (char *)malloc(METRICS_TEXT_SIZE);
+    s_metrics.tls = SDL_TLSCreate();
+    if ((NULL == s_metrics.text) || (0U == s_metrics.tls))
+    {
+        return E_NOT_OK;
+    }
+
+    if ((0 == strncmp(address, "file:", 5U)) && (strlen(&address[5U]) < sizeof(s_metrics.path)))
+    {
+        (void)strcpy(s_metrics.path, &address[5U]);
+        s_metrics.file = TRUE;
+    }
+    else if (E_OK != metricsListen(address))
+    {
+        printf("Unable to serve metrics on %s\n", address);
+        return E_NOT_OK;
+    }
+
+    SDL_AtomicSet(&s_metrics.running, 1);
+    s_metrics.server = SDL_CreateThread(metricsServer, "chip8 metrics", NULL);
+
+    return (NULL != s_metrics.server) ? E_OK : E_NOT_OK;
+}
+
+/******************************************************************
+ * FUNCTION : MetricsThread()
+ *    Description: Name the counters of the calling thread, threads
+ *                 not named are "thread"
+ *    Parameters:  name: label of the thread
+ *    Return:      None
+ ******************************************************************/
+void MetricsThread(const char *name)
+{
+    if ((0U != s_metrics.tls) && (NULL == SDL_TLSGet(s_metrics.tls)))
+    {
+        (void)metricsRegister(name);
+    }
+}
+
+/******************************************************************
+ * FUNCTION : MetricsInstructions()
+ *    Description: Count instructions executed
+ *    Parameters:  count: instructions
+ *    Return:      None
+ ******************************************************************/
+void MetricsInstructions(U32 count)
+{
+    metricsThreadType *thread = metricsCurrent();
+
+    if (NULL != thread)
+    {
+        thread->instructions += count;
+    }
+}
+
+/******************************************************************
+ * FUNCTION : MetricsFrame()
+ *    Description: Count a presented frame and the time since the
+ *                 previous one
+ *    Parameters:  None
+ *    Return:      None
+ ******************************************************************/
+void MetricsFrame(void)
+{
+    static const U32 s_bounds[METRICS_FRAME_BUCKETS - 1U] = METRICS_FRAME_BOUNDS;
+    metricsThreadType *thread = metricsCurrent();
+    U64 now = SDL_GetPerformanceCounter();
+    U64 elapsed;
+    U32 bucket;
+
+    if (NULL == thread)
+    {
+        return;
+    }
+
+    if (0U != thread->lastFrame)
+    {
+        elapsed = ((now - thread->lastFrame) * 1000000ULL) / SDL_GetPerformanceFrequency();
+        for (bucket = 0U; (bucket < (METRICS_FRAME_BUCKETS - 1U)) && (elapsed > s_bounds[bucket]); bucket++)
+        {
+        }
+        thread->frameBuckets[bucket]++;
+        thread->frameTime += elapsed;
+    }
+
+    thread->lastFrame = now;
+    thread->frames++;
+}
+
+/******************************************************************
+ * FUNCTION : MetricsPace()
+ *    Description: Count the frames the pacer dropped or repeated
+ *    Parameters:  dropped: emulated frames not presented
+ *                 repeated: TRUE if the next present repeats a frame
+ *    Return:      None
+ ******************************************************************/
+void MetricsPace(U32 dropped, BOOL repeated)
+{
+    metricsThreadType *thread = metricsCurrent();
+
+    if (NULL != thread)
+    {
+        thread->framesDropped += dropped;
+        if (FALSE != repeated)
+        {
+            thread->framesRepeated++;
+        }
+    }
+}
+
+/******************************************************************
+ * FUNCTION : MetricsDraw()
+ *    Description: Count a sprite drawn
+ *    Parameters:  None
+ *    Return:      None
+ ******************************************************************/
+void MetricsDraw(void)
+{
+    metricsThreadType *thread = metricsCurrent();
+
+    if (NULL != thread)
+    {
+        thread->draws++;
+    }
+}
+
+/******************************************************************
+ * FUNCTION : MetricsSound()
+ *    Description: Count a sound played
+ *    Parameters:  queued: FALSE if the audio device refused it
+ *    Return:      None
+ ******************************************************************/
+void MetricsSound(BOOL queued)
+{
+    metricsThreadType *thread = metricsCurrent();
+
+    if (NULL != thread)
+    {
+        thread->sounds++;
+        if (FALSE == queued)
+        {
+            thread->soundDrops++;
+        }
+    }
+}
+
+/******************************************************************
+ * FUNCTION : MetricsMachines()
+ *    Description: Machines the calling thread runs now
+ *    Parameters:  running: machines not exited nor faulted
+ *                 blocked: machines among them waiting for a key
+ *    Return:      None
+ ******************************************************************/
+void MetricsMachines(U32 running, U32 blocked)
+{
+    metricsThreadType *thread = metricsCurrent();
+
+    if (NULL != thread)
+    {
+        thread->machinesRunning = running;
+        thread->machinesBlocked = blocked;
+    }
+}
+
+/******************************************************************
+ * FUNCTION : MetricsFormat()
+ *    Description: Merge the counters of every thread in the
+ *                 Prometheus text format
+ *    Parameters:  text: output
+ *                 size: bytes of text
+ *    Return:      Length of the text, truncated to size - 1
+ ******************************************************************/
+U32 MetricsFormat(char *text, U32 size)
+{
+    static const U32 s_bounds[METRICS_FRAME_BUCKETS - 1U] = METRICS_FRAME_BOUNDS;
+    const metricsThreadType *thread;
+    U32 count = (U32)SDL_AtomicGet(&s_metrics.threadCount);
+    U32 length = 0U;
+    U32 family;
+    U32 bucket;
+    U32 t;
+    U64 cumulative;
+
+    text[0U] = '\0';
+    if (count > METRICS_MAX_THREADS)
+    {
+        count = METRICS_MAX_THREADS;
+    }
+
+    for (family = 0U; family < (U32)(sizeof(s_metricsFamilies) / sizeof(s_metricsFamilies[0U])); family++)
+    {
+        metricsAppend(text, size, &length, "# HELP %s %s\n# TYPE %s %s\n", s_metricsFamilies[family].name,
+                      s_metricsFamilies[family].help, s_metricsFamilies[family].name, s_metricsFamilies[family].type);
+
+        for (t = 0U; t < count; t++)
+        {
+            thread = &s_metrics.threads[t];
+            if (0 != SDL_AtomicGet((SDL_atomic_t *)&thread->ready))
+            {
+                metricsAppend(text, size, &length, "%s{thread=\"%lu\",name=\"%s\"} %llu\n",
+                              s_metricsFamilies[family].name, (unsigned long)t, thread->name,
+                              (unsigned long long)*(const volatile U64 *)((const U8 *)thread
+                                                                          + s_metricsFamilies[family].offset));
+            }
+        }
+    }
+
+    metricsAppend(text, size, &length, "# HELP chip8_frame_seconds Time between presented frames.\n"
+                                       "# TYPE chip8_frame_seconds histogram\n");
+    for (t = 0U; t < count; t++)
+    {
+        thread = &s_metrics.threads[t];
+        if ((0 == SDL_AtomicGet((SDL_atomic_t *)&thread->ready)) || (0U == thread->frames))
+        {
+            continue;
+        }
+
+        cumulative = 0U;
+        for (bucket = 0U; bucket < METRICS_FRAME_BUCKETS; bucket++)
+        {
+            cumulative += thread->frameBuckets[bucket];
+            if (bucket < (METRICS_FRAME_BUCKETS - 1U))
+            {
+                metricsAppend(text, size, &length,
+                              "chip8_frame_seconds_bucket{thread=\"%lu\",name=\"%s\",le=\"%g\"} %llu\n",
+                              (unsigned long)t, thread->name, (double)s_bounds[bucket] / 1e6,
+                              (unsigned long long)cumulative);
+            }
+            else
+            {
+                metricsAppend(text, size, &length,
+                              "chip8_frame_seconds_bucket{thread=\"%lu\",name=\"%s\",le=\"+Inf\"} %llu\n",
+                              (unsigned long)t, thread->name, (unsigned long long)cumulative);
+            }
+        }
+        metricsAppend(text, size, &length, "chip8_frame_seconds_sum{thread=\"%lu\",name=\"%s\"} %g\n"
+                                           "chip8_frame_seconds_count{thread=\"%lu\",name=\"%s\"} %llu\n",
+                      (unsigned long)t, thread->name, (double)thread->frameTime / 1e6,
+                      (unsigned long)t, thread->name, (unsigned long long)cumulative);
+    }
+
+    return length;
+}
+
+/******************************************************************
+ * FUNCTION : MetricsClose()
+ *    Description: Stop serving, the file gets the last values
+ *    Parameters:  None
+ *    Return:      None
+ ******************************************************************/
+void MetricsClose(void)
+{
+    if (0 == SDL_AtomicGet(&s_metrics.open))
+    {
+        return;
+    }
+
+    SDL_AtomicSet(&s_metrics.running, 0);
+    if (NULL != s_metrics.server)
+    {
+        SDL_WaitThread(s_metrics.server, NULL);
+        s_metrics.server = NULL;
+    }
+
+    if (METRICS_INVALID_SOCKET != s_metrics.socket)
+    {
+        (void)metricsCloseSocket(s_metrics.socket);
+        s_metrics.socket = METRICS_INVALID_SOCKET;
+#ifdef _WIN32
+        (void)WSACleanup();
+#endif
+    }
+    else if ((FALSE != s_metrics.file) && (NULL != s_metrics.text))
+    {
+        metricsWriteFile();
+    }
+}
+
+/******************************************************************
+ * FUNCTION : metricsCurrent()
+ *    Description: Counters of the calling thread, claimed on first
+ *                 use
+ *    Parameters:  None
+ *    Return:      Counters, NULL if not served or no block is left
+ ******************************************************************/
+static metricsThreadType * metricsCurrent(void)
+{
+    metricsThreadType *thread;
+
+    if (0U == s_metrics.tls)
+    {
+        return NULL;
+    }
+
+    thread = (metricsThreadType *)SDL_TLSGet(s_metrics.tls);
+    if (NULL == thread)
+    {
+        thread = metricsRegister("thread");
+    }
+
+    return thread;
+}
+
+/******************************************************************
+ * FUNCTION : metricsRegister()
+ *    Description: Claim a block of counters for the calling thread
+ *    Parameters:  name: label of the thread
+ *    Return:      Counters, NULL if no block is left
+ ******************************************************************/
+static metricsThreadType * metricsRegister(const char *name)
+{
+    U32 index = (U32)SDL_AtomicAdd(&s_metrics.threadCount, 1);
+    metricsThreadType *thread;
+
+    if (index >= METRICS_MAX_THREADS)
+    {
+        return NULL;
+    }
+
+    thread = &s_metrics.threads[index];
+    (void)snprintf(thread->name, sizeof(thread->name), "%s", name);
+    (void)SDL_TLSSet(s_metrics.tls, (const void *)thread, NULL);
+
+    /* The server reads the block from now on */
+    SDL_AtomicSet(&thread->ready, 1);
+
+    return thread;
+}
+
+/******************************************************************
+ * FUNCTION : metricsListen()
+ *    Description: Open the listening socket
+ *    Parameters:  address: "tcp:HOST:PORT"
+ *    Return:      E_OK if listening, E_NOT_OK otherwise
+ ******************************************************************/
+static Std_ReturnType metricsListen(const char *address)
+{
+    struct addrinfo hints;
+    struct addrinfo *result = NULL;
+    char host[METRICS_ADDRESS_SIZE];
+    const char *port = strrchr(address, ':');
+    int reuse = 1;
+#ifdef _WIN32
+    WSADATA data;
+#endif
+
+    if ((0 != strncmp(address, "tcp:", 4U)) || (port == &address[3U])
+        || ((size_t)(port - &address[4U]) >= sizeof(host)))
+    {
+        return E_NOT_OK;
+    }
+
+    (void)memcpy((void *)host, (const void *)&address[4U], (size_t)(port - &address[4U]));
+    host[port - &address[4U]] = '\0';
+
+#ifdef _WIN32
+    if (0 != WSAStartup(MAKEWORD(2, 2), &data))
+    {
+        return E_NOT_OK;
+    }
+#endif
+
+    (void)memset((void *)&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE;
+    if ((0 == getaddrinfo(('\0' != host[0U]) ? host : NULL, &port[1U], &hints, &result)) && (NULL != result))
+    {
+        s_metrics.socket = socket(result->ai_family, result->ai_socktype, result->ai_protocol);
+        if (METRICS_INVALID_SOCKET != s_metrics.socket)
+        {
+            (void)setsockopt(s_metrics.socket, SOL_SOCKET, SO_REUSEADDR, (const char *)&reuse, sizeof(reuse));
+            if ((0 != bind(s_metrics.socket, result->ai_addr, (int)result->ai_addrlen))
+                || (0 != listen(s_metrics.socket, (int)METRICS_BACKLOG)))
+            {
+                (void)metricsCloseSocket(s_metrics.socket);
+                s_metrics.socket = METRICS_INVALID_SOCKET;
+            }
+        }
+        freeaddrinfo(result);
+    }
+
+    if (METRICS_INVALID_SOCKET == s_metrics.socket)
+    {
+#ifdef _WIN32
+        (void)WSACleanup();
+#endif
+        return E_NOT_OK;
+    }
+
+    return E_OK;
+}
+
+/******************************************************************
+ * FUNCTION : metricsServer()
+ *    Description: Server thread: answer requests one at a time, or
+ *                 rewrite the file every METRICS_FILE_PERIOD_MS
+ *    Parameters:  data: unused
+ *    Return:      0
+ ******************************************************************/
+static int metricsServer(void *data)
+{
+    metricsSocketType client;
+    struct timeval timeout;
+    fd_set readable;
+    U32 lastWrite = SDL_GetTicks();
+
+    (void)data;
+
+    while (0 != SDL_AtomicGet(&s_metrics.running))
+    {
+        if (FALSE != s_metrics.file)
+        {
+            SDL_Delay(METRICS_POLL_MS);
+            if ((U32)(SDL_GetTicks() - lastWrite) >= METRICS_FILE_PERIOD_MS)
+            {
+                metricsWriteFile();
+                lastWrite = SDL_GetTicks();
+            }
+            continue;
+        }
+
+        /* Wake up regularly to see MetricsClose() */
+        FD_ZERO(&readable);
+        FD_SET(s_metrics.socket, &readable);
+        timeout.tv_sec = 0;
+        timeout.tv_usec = (long)METRICS_POLL_MS * 1000L;
+        if (select((int)(s_metrics.socket + 1), &readable, NULL, NULL, &timeout) > 0)
+        {
+            client = accept(s_metrics.socket, NULL, NULL);
+            if (METRICS_INVALID_SOCKET != client)
+            {
+                metricsServe(client);
+                (void)metricsCloseSocket(client);
+            }
+        }
+    }
+
+    return 0;
+}
+
+/******************************************************************
+ * FUNCTION : metricsServe()
+ *    Description: Answer one HTTP request with the counters, the
+ *                 request itself is not parsed
+ *    Parameters:  client: connected socket
+ *    Return:      None
+ ******************************************************************/
+static void metricsServe(metricsSocketType client)
+{
+    char request[METRICS_REQUEST_SIZE];
+    char header[METRICS_HEADER_SIZE];
+    struct timeval timeout;
+    fd_set readable;
+    U32 length;
+    U32 sent;
+    int result;
+
+    FD_ZERO(&readable);
+    FD_SET(client, &readable);
+    timeout.tv_sec = METRICS_REQUEST_TIMEOUT_MS / 1000U;
+    timeout.tv_usec = 0;
+    if ((select((int)(client + 1), &readable, NULL, NULL, &timeout) <= 0)
+        || (recv(client, request, (int)sizeof(request), 0) <= 0))
+    {
+        return;
+    }
+
+    length = MetricsFormat(s_metrics.text, METRICS_TEXT_SIZE);
+    (void)snprintf(header, sizeof(header), "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\n"
+                                           "Content-Length: %lu\r\nConnection: close\r\n\r\n",
+                   (unsigned long)length);
+
+    if (send(client, header, (int)strlen(header), 0) <= 0)
+    {
+        return;
+    }
+
+    for (sent = 0U; sent < length; sent += (U32)result)
+    {
+        result = send(client, &s_metrics.text[sent], (int)(length - sent), 0);
+        if (result <= 0)
+        {
+            break;
+        }
+    }
+}
+
+/******************************************************************
+ * FUNCTION : metricsWriteFile()
+ *    Description: Rewrite the stats file
+ *    Parameters:  None
+ *    Return:      None
+ ******************************************************************/
+static void metricsWriteFile(void)
+{
+    U32 length = MetricsFormat(s_metrics.text, METRICS_TEXT_SIZE);
+    FILE *filePtr = fopen(s_metrics.path, "wb");
+
+    if (NULL != filePtr)
+    {
+        (void)fwrite(s_metrics.text, 1U, length, filePtr);
+        fclose(filePtr);
+    }
+}
+
+/******************************************************************
+ * FUNCTION : metricsAppend()
+ *    Description: printf at the end of the text, nothing once full
+ *    Parameters:  text, size: output
+ *                 length: length of the text, updated
+ *                 format: printf format
+ *    Return:      None
+ ******************************************************************/
+static void metricsAppend(char *text, U32 size, U32 *length, const char *format, ...)
+{
+    va_list arguments;
+    int written;
+
+    if ((*length + 1U) >= size)
+    {
+        return;
+    }
+
+    va_start(arguments, format);
+    written = vsnprintf(&text[*length], size - *length, format, arguments);
+    va_end(arguments);
+
+    if (written > 0)
+    {
+        *length += ((U32)written < (size - *length)) ? (U32)written : (size - *length - 1U);
+    }
+}
@@ -0,0 +1,79 @@
+/******************************************************************
+ *
+ *
+ * FILE        : metrics.h
+ * PROJECT     : chip8
+ * AUTHOR      : danpham
+ * DESCRIPTION : Performance counters served in the Prometheus text
+ *               format. Build with -DMETRICS_ENABLED to turn the
+ *               hooks on, they are compiled out otherwise.
+ *
+ ******************************************************************/
+#ifndef METRICS_H_
+#define METRICS_H_
+
+/******************************************************************
+ * 1. Included files (microcontroller ones then user defined ones)
+ ******************************************************************/
+#include "../headers/typedef.h"
+
+/******************************************************************
+ * 2. Define declarations (macros then function macros)
+ ******************************************************************/
+/* "tcp:HOST:PORT" serves GET requests, "file:PATH" rewrites the
+ * file every second */
+#define METRICS_ADDRESS                           "tcp:127.0.0.1:9108"
+
+#define METRICS_MAX_THREADS                                      64U
+#define METRICS_NAME_SIZE                                        32U
+
+/* Upper bounds of the frame time histogram buckets, in microseconds,
+ * the last bucket has no bound */
+#define METRICS_FRAME_BUCKETS                                     9U
+#define METRICS_FRAME_BOUNDS    { 1000U, 2000U, 4000U, 8000U, 16667U, 33333U, 66667U, 133333U }
+
+#ifdef METRICS_ENABLED
+#define METRICS_START()                       (void)MetricsOpen(METRICS_ADDRESS)
+#define METRICS_THREAD(name)                  MetricsThread(name)
+#define METRICS_INSTRUCTIONS(count)           MetricsInstructions(count)
+#define METRICS_FRAME()                       MetricsFrame()
+#define METRICS_PACE(dropped, repeated)       MetricsPace((dropped), (repeated))
+#define METRICS_DRAW()                        MetricsDraw()
+#define METRICS_SOUND(queued)                 MetricsSound(queued)
+#define METRICS_MACHINES(running, blocked)    MetricsMachines((running), (blocked))
+#define METRICS_STOP()                        MetricsClose()
+#else
+#define METRICS_START()
+#define METRICS_THREAD(name)
+#define METRICS_INSTRUCTIONS(count)           ((void)(count))
+#define METRICS_FRAME()
+#define METRICS_PACE(dropped, repeated)
+#define METRICS_DRAW()
+#define METRICS_SOUND(queued)
+#define METRICS_MACHINES(running, blocked)
+#define METRICS_STOP()
+#endif
+
+/******************************************************************
+ * 3. Typedef definitions (simple typedef, then enum and structs)
+ ******************************************************************/
+
+/******************************************************************
+ * 4. Variable definitions (static then global)
+ ******************************************************************/
+
+/******************************************************************
+ * 5. Functions prototypes (static only)
+ ******************************************************************/
+extern Std_ReturnType MetricsOpen(const char *address);
+extern void MetricsThread(const char *name);
+extern void MetricsInstructions(U32 count);
+extern void MetricsFrame(void);
+extern void MetricsPace(U32 dropped, BOOL repeated);
+extern void MetricsDraw(void);
+extern void MetricsSound(BOOL queued);
+extern void MetricsMachines(U32 running, U32 blocked);
+extern U32 MetricsFormat(char *text, U32 size);
+extern void MetricsClose(void);
+
+#endif /* METRICS_H_ */
@@ -0,0 +1,604 @@
+/******************************************************************
+ *
+ *
+ * FILE        : netplay.c
+ * PROJECT     : chip8
+ * AUTHOR      : danpham
+ * DESCRIPTION : Two player rollback netplay.
+ *
+ *               Both peers run the same machine, each driving part
+ *               of the keypad. Every frame a peer sends the key
+ *               masks the other one has not acknowledged yet,
+ *               numbered by frame, and runs its frame at once with
+ *               the last remote mask as prediction. The state at the
+ *               start of each unconfirmed frame is kept; when a
+ *               remote mask differs from its prediction the machine
+ *               goes back to that frame and runs again, headless, up
+ *               to the current one. A peer more than
+ *               NETPLAY_MAX_ROLLBACK frames ahead waits.
+ *
+ ******************************************************************/
+
+/******************************************************************
+ * 1. Included files (microcontroller ones then user defined ones)
+ ******************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <fcntl.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#endif
+#include <SDL2/SDL.h>
+#include "netplay.h"
+#include "../cpu/cpu.h"
+#include "../display/display.h"
+#include "../input/input.h"
+#include "../metrics/metrics.h"
+#include "../sound/sound.h"
+
+/******************************************************************
+ * 2. Define declarations (macros then function macros)
+ ******************************************************************/
+/* Both peers must start from the same random generator state */
+#define NETPLAY_SEED                                     0x6D2B79F5UL
+
+#define NETPLAY_MAGIC                                           'N'
+#define NETPLAY_VERSION                                           1U
+#define NETPLAY_HEADER_SIZE                                      11U
+#define NETPLAY_PACKET_SIZE     (NETPLAY_HEADER_SIZE + (2U * NETPLAY_MAX_ROLLBACK))
+
+/* Frames run by one update to catch up with the clock */
+#define NETPLAY_MAX_CATCHUP                                       4U
+
+#define NETPLAY_NO_FRAME                                 0xFFFFFFFFUL
+
+#ifdef _WIN32
+#define NETPLAY_INVALID_SOCKET                       INVALID_SOCKET
+#define netplayCloseSocket(socket)              closesocket(socket)
+#else
+#define NETPLAY_INVALID_SOCKET                                   -1
+#define netplayCloseSocket(socket)                    close(socket)
+#endif
+
+/******************************************************************
+ * 3. Typedef definitions (simple typedef, then enum and structs)
+ ******************************************************************/
+#ifdef _WIN32
+typedef SOCKET netplaySocketType;
+#else
+typedef int netplaySocketType;
+#endif
+
+/* Machine state at the start of a frame, the cpu is attached to its
+ * slice of the snapshot memories */
+typedef struct
+{
+    cpuType cpu;
+    displayScreenType screen;
+} netplaySnapshotType;
+
+struct netplayType
+{
+    cpuType *cpu;
+    displayScreenType *screen;
+    BOOL keys[INPUT_NUMBER_OF_KEYBOARD_KEYS];   /* Keypad of both peers */
+    U16 localKeys;
+    U32 instructionsPerFrame;
+
+    /* Frames, the rings are indexed by frame % NETPLAY_MAX_ROLLBACK */
+    U32 frame;                      /* Next frame to run */
+    U32 confirmed;                  /* Remote masks known below this frame */
+    U32 acknowledged;               /* Local masks known by the peer below this frame */
+    U16 localMasks[NETPLAY_MAX_ROLLBACK];
+    U16 remoteMasks[NETPLAY_MAX_ROLLBACK];
+    U32 remoteFrames[NETPLAY_MAX_ROLLBACK];     /* Frame held by each remote slot */
+    U16 usedMasks[NETPLAY_MAX_ROLLBACK];        /* Remote mask each frame ran with */
+    U16 prediction;
+    U32 rollbackFrame;              /* First mispredicted frame, NETPLAY_NO_FRAME if none */
+    netplaySnapshotType *snapshots;
+    U8 *snapshotMemories;           /* NETPLAY_MAX_ROLLBACK memories of the cpu profile */
+
+    /* Link */
+    netplaySocketType socket;
+    struct sockaddr_in remote;
+    BOOL connected;
+    U32 startTicks;
+
+    netplayStatsType stats;
+};
+
+/******************************************************************
+ * 4. Variable definitions (static then global)
+ ******************************************************************/
+
+/******************************************************************
+ * 5. Functions prototypes (static only)
+ ******************************************************************/
+static Std_ReturnType netplayOpenSocket(netplayType *netplay, const netplayConfigType *config);
+static void netplaySend(netplayType *netplay);
+static void netplayReceive(netplayType *netplay, const U8 *packet, U32 length);
+static void netplayRollback(netplayType *netplay);
+static void netplayRun(netplayType *netplay, U32 frame, BOOL live);
+static U32 netplayGetU32(const U8 *data);
+static void netplayPutU32(U8 *data, U32 value);
+
+/******************************************************************
+ * FUNCTION : NetplayOpen()
+ *    Description: Start a session on a loaded machine. Both peers
+ *                 must load the same rom.
+ *    Parameters:  cpu: machine, its screen stays attached and its
+ *                      keypad becomes the one of the session
+ *                 config: ports, peer and keys of this peer
+ *    Return:      Session, NULL on error
+ ******************************************************************/
+netplayType * NetplayOpen(cpuType *cpu, const netplayConfigType *config)
+{
+    netplayType *netplay;
+    U32 i;
+
+    netplay = (netplayType *)calloc(1U, sizeof(netplayType));
+    if (NULL == netplay)
+    {
+        return NULL;
+    }
+
+    netplay->socket = NETPLAY_INVALID_SOCKET;
+    netplay->snapshots = (netplaySnapshotType *)calloc(NETPLAY_MAX_ROLLBACK, sizeof(netplaySnapshotType));
+    netplay->snapshotMemories = (U8 *)calloc(NETPLAY_MAX_ROLLBACK, CPU_MEMORY_BYTES(cpu->profile));
+    if ((NULL == netplay->snapshots) || (NULL == netplay->snapshotMemories) || (NULL == cpu->screen) || (E_OK != netplayOpenSocket(netplay, config)))
+    {
+        NetplayClose(netplay);
+        return NULL;
+    }
+
+    netplay->cpu = cpu;
+    netplay->screen = cpu->screen;
+    netplay->localKeys = config->localKeys;
+    netplay->instructionsPerFrame = (0U != config->instructionsPerFrame) ? config->instructionsPerFrame
+                                                                        : NETPLAY_DEFAULT_INSTRUCTIONS_PER_FRAME;
+    netplay->rollbackFrame = NETPLAY_NO_FRAME;
+    for (i = 0U; i < NETPLAY_MAX_ROLLBACK; i++)
+    {
+        netplay->remoteFrames[i] = NETPLAY_NO_FRAME;
+        CpuAttach(&netplay->snapshots[i].cpu, &netplay->snapshotMemories[i * CPU_MEMORY_BYTES(cpu->profile)],
+                  &netplay->snapshots[i].screen, NULL);
+    }
+
+    CpuAttach(cpu, cpu->memory, cpu->screen, netplay->keys);
+    cpu->random = NETPLAY_SEED;
+
+    return netplay;
+}
+
+/******************************************************************
+ * FUNCTION : NetplayUpdate()
+ *    Description: Run the frames due since the session started, at
+ *                 NETPLAY_FRAMES_PER_SECOND. Call it as often as
+ *                 possible, e.g. from the window loop.
+ *    Parameters:  netplay: session
+ *                 keys: local keypad, only the keys of this peer
+ *                       are used
+ *    Return:      E_OK while the program runs, E_NOT_OK otherwise
+ ******************************************************************/
+Std_ReturnType NetplayUpdate(netplayType *netplay, const BOOL *keys)
+{
+    U16 mask = 0U;
+    U32 due;
+    U32 run = 0U;
+    U8 key;
+
+    for (key = 0U; key < INPUT_NUMBER_OF_KEYBOARD_KEYS; key++)
+    {
+        if (FALSE != keys[key])
+        {
+            mask |= (U16)(1U << key);
+        }
+    }
+
+    NetplayPoll(netplay);
+
+    if (FALSE == netplay->connected)
+    {
+        /* Knock until the peer answers */
+        netplaySend(netplay);
+    }
+    else
+    {
+        due = ((SDL_GetTicks() - netplay->startTicks) * NETPLAY_FRAMES_PER_SECOND) / 1000U;
+        while ((netplay->frame < due) && (run < NETPLAY_MAX_CATCHUP) && (FALSE != NetplayFrame(netplay, mask)))
+        {
+            run++;
+        }
+    }
+
+    return (E_CPU_RUNNING == netplay->cpu->status) ? E_OK : E_NOT_OK;
+}
+
+/******************************************************************
+ * FUNCTION : NetplayFrame()
+ *    Description: Run one frame now, without pacing
+ *    Parameters:  netplay: session
+ *                 localMask: keys pressed on this peer, bit k
+ *                            holds key k
+ *    Return:      TRUE if the frame ran, FALSE if waiting for the
+ *                 peer
+ ******************************************************************/
+BOOL NetplayFrame(netplayType *netplay, U16 localMask)
+{
+    NetplayPoll(netplay);
+
+    if ((FALSE == netplay->connected)
+        || (netplay->frame >= (netplay->confirmed + NETPLAY_MAX_ROLLBACK - 1U))
+        || ((netplay->frame - netplay->acknowledged) >= NETPLAY_MAX_ROLLBACK))
+    {
+        netplay->stats.stalls++;
+        netplaySend(netplay);
+        return FALSE;
+    }
+
+    netplay->localMasks[netplay->frame % NETPLAY_MAX_ROLLBACK] = localMask;
+    netplayRun(netplay, netplay->frame, TRUE);
+    netplay->frame++;
+
+    netplaySend(netplay);
+
+    return TRUE;
+}
+
+/******************************************************************
+ * FUNCTION : NetplayPoll()
+ *    Description: Read the pending packets and roll back when a
+ *                 prediction was wrong
+ *    Parameters:  netplay: session
+ *    Return:      None
+ ******************************************************************/
+void NetplayPoll(netplayType *netplay)
+{
+    U8 packet[NETPLAY_PACKET_SIZE];
+    struct sockaddr_in sender;
+    socklen_t senderSize;
+    int length;
+
+    for (;;)
+    {
+        senderSize = sizeof(sender);
+        length = (int)recvfrom(netplay->socket, (char *)packet, sizeof(packet), 0, (struct sockaddr *)&sender,
+                               &senderSize);
+        if (length <= 0)
+        {
+            break;
+        }
+
+        if ((sender.sin_addr.s_addr == netplay->remote.sin_addr.s_addr)
+            && (sender.sin_port == netplay->remote.sin_port))
+        {
+            netplayReceive(netplay, packet, (U32)length);
+        }
+    }
+
+    netplayRollback(netplay);
+}
+
+/******************************************************************
+ * FUNCTION : NetplayStats()
+ *    Description: Session counters
+ *    Parameters:  netplay: session
+ *                 stats: output
+ *    Return:      None
+ ******************************************************************/
+void NetplayStats(const netplayType *netplay, netplayStatsType *stats)
+{
+    *stats = netplay->stats;
+    stats->frame = netplay->frame;
+    stats->confirmedFrame = netplay->confirmed;
+}
+
+/******************************************************************
+ * FUNCTION : NetplayClose()
+ *    Description: End a session, the machine keeps its state
+ *    Parameters:  netplay: session, may be NULL
+ *    Return:      None
+ ******************************************************************/
+void NetplayClose(netplayType *netplay)
+{
+    if (NULL == netplay)
+    {
+        return;
+    }
+
+    if (NETPLAY_INVALID_SOCKET != netplay->socket)
+    {
+        (void)netplayCloseSocket(netplay->socket);
+#ifdef _WIN32
+        (void)WSACleanup();
+#endif
+    }
+
+    free(netplay->snapshots);
+    free(netplay->snapshotMemories);
+    free(netplay);
+}
+
+/******************************************************************
+ * FUNCTION : netplayOpenSocket()
+ *    Description: Bind the local non blocking UDP socket and
+ *                 resolve the peer
+ *    Parameters:  netplay: session
+ *                 config: ports and peer
+ *    Return:      E_OK if ready, E_NOT_OK otherwise
+ ******************************************************************/
+static Std_ReturnType netplayOpenSocket(netplayType *netplay, const netplayConfigType *config)
+{
+    struct sockaddr_in local;
+    struct addrinfo hints;
+    struct addrinfo *result = NULL;
+#ifdef _WIN32
+    WSADATA data;
+    u_long nonBlocking = 1UL;
+
+    if (0 != WSAStartup(MAKEWORD(2, 2), &data))
+    {
+        return E_NOT_OK;
+    }
+#endif
+
+    netplay->socket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (NETPLAY_INVALID_SOCKET == netplay->socket)
+    {
+#ifdef _WIN32
+        (void)WSACleanup();
+#endif
+        return E_NOT_OK;
+    }
+
+#ifdef _WIN32
+    (void)ioctlsocket(netplay->socket, FIONBIO, &nonBlocking);
+#else
+    (void)fcntl(netplay->socket, F_SETFL, fcntl(netplay->socket, F_GETFL) | O_NONBLOCK);
+#endif
+
+    (void)memset((void *)&local, 0, sizeof(local));
+    local.sin_family = AF_INET;
+    local.sin_addr.s_addr = htonl(INADDR_ANY);
+    local.sin_port = htons(config->localPort);
+    if (0 != bind(netplay->socket, (const struct sockaddr *)&local, sizeof(local)))
+    {
+        printf("Unable to bind netplay port %u.", (unsigned int)config->localPort);
+        return E_NOT_OK;
+    }
+
+    (void)memset((void *)&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+    if ((0 != getaddrinfo(config->remoteHost, NULL, &hints, &result)) || (NULL == result))
+    {
+        printf("Unable to resolve %s.", config->remoteHost);
+        return E_NOT_OK;
+    }
+
+    (void)memcpy((void *)&netplay->remote, (const void *)result->ai_addr, sizeof(netplay->remote));
+    netplay->remote.sin_port = htons(config->remotePort);
+    freeaddrinfo(result);
+
+    return E_OK;
+}
+
+/******************************************************************
+ * FUNCTION : netplaySend()
+ *    Description: Send the local masks not acknowledged yet. Lost
+ *                 packets need no resend: the next one repeats them.
+ *    Parameters:  netplay: session
+ *    Return:      None
+ ******************************************************************/
+static void netplaySend(netplayType *netplay)
+{
+    U8 packet[NETPLAY_PACKET_SIZE];
+    U32 first = netplay->acknowledged;
+    U32 count;
+    U32 i;
+    U16 mask;
+
+    count = netplay->frame - first;
+
+    packet[0U] = NETPLAY_MAGIC;
+    packet[1U] = NETPLAY_VERSION;
+    netplayPutU32(&packet[2U], netplay->confirmed);
+    netplayPutU32(&packet[6U], first);
+    packet[10U] = (U8)count;
+
+    for (i = 0U; i < count; i++)
+    {
+        mask = netplay->localMasks[(first + i) % NETPLAY_MAX_ROLLBACK];
+        packet[NETPLAY_HEADER_SIZE + (2U * i)] = (U8)mask;
+        packet[NETPLAY_HEADER_SIZE + (2U * i) + 1U] = (U8)(mask >> 8U);
+    }
+
+    (void)sendto(netplay->socket, (const char *)packet, (int)(NETPLAY_HEADER_SIZE + (2U * count)), 0,
+                 (const struct sockaddr *)&netplay->remote, sizeof(netplay->remote));
+}
+
+/******************************************************************
+ * FUNCTION : netplayReceive()
+ *    Description: Store the remote masks of a packet and note the
+ *                 first frame that ran with a wrong prediction
+ *    Parameters:  netplay: session
+ *                 packet, length: datagram
+ *    Return:      None
+ ******************************************************************/
+static void netplayReceive(netplayType *netplay, const U8 *packet, U32 length)
+{
+    U32 acknowledged;
+    U32 first;
+    U32 count;
+    U32 frame;
+    U32 slot;
+    U32 i;
+
+    if ((length < NETPLAY_HEADER_SIZE) || (NETPLAY_MAGIC != packet[0U]) || (NETPLAY_VERSION != packet[1U]))
+    {
+        return;
+    }
+
+    acknowledged = netplayGetU32(&packet[2U]);
+    first = netplayGetU32(&packet[6U]);
+    count = packet[10U];
+    if ((count > NETPLAY_MAX_ROLLBACK) || (length < (NETPLAY_HEADER_SIZE + (2U * count))))
+    {
+        return;
+    }
+
+    if (FALSE == netplay->connected)
+    {
+        netplay->connected = TRUE;
+        netplay->startTicks = SDL_GetTicks();
+    }
+
+    if ((acknowledged > netplay->acknowledged) && (acknowledged <= netplay->frame))
+    {
+        netplay->acknowledged = acknowledged;
+    }
+
+    for (i = 0U; i < count; i++)
+    {
+        frame = first + i;
+        if ((frame >= netplay->confirmed) && (frame < (netplay->confirmed + NETPLAY_MAX_ROLLBACK)))
+        {
+            slot = frame % NETPLAY_MAX_ROLLBACK;
+            netplay->remoteMasks[slot] = (U16)(packet[NETPLAY_HEADER_SIZE + (2U * i)]
+                                               | (packet[NETPLAY_HEADER_SIZE + (2U * i) + 1U] << 8U));
+            netplay->remoteFrames[slot] = frame;
+        }
+    }
+
+    /* Confirm consecutive frames, checking those already run */
+    for (;;)
+    {
+        slot = netplay->confirmed % NETPLAY_MAX_ROLLBACK;
+        if (netplay->confirmed != netplay->remoteFrames[slot])
+        {
+            break;
+        }
+
+        if ((netplay->confirmed < netplay->frame) && (netplay->remoteMasks[slot] != netplay->usedMasks[slot])
+            && (netplay->confirmed < netplay->rollbackFrame))
+        {
+            netplay->rollbackFrame = netplay->confirmed;
+        }
+
+        netplay->prediction = netplay->remoteMasks[slot];
+        netplay->confirmed++;
+    }
+}
+
+/******************************************************************
+ * FUNCTION : netplayRollback()
+ *    Description: Restore the first mispredicted frame and run
+ *                 again up to the current frame
+ *    Parameters:  netplay: session
+ *    Return:      None
+ ******************************************************************/
+static void netplayRollback(netplayType *netplay)
+{
+    const netplaySnapshotType *snapshot;
+    U32 frame;
+
+    if (NETPLAY_NO_FRAME == netplay->rollbackFrame)
+    {
+        return;
+    }
+
+    snapshot = &netplay->snapshots[netplay->rollbackFrame % NETPLAY_MAX_ROLLBACK];
+    CpuCopy(netplay->cpu, &snapshot->cpu);
+    (void)memcpy((void *)netplay->screen, (const void *)&snapshot->screen, sizeof(displayScreenType));
+
+    for (frame = netplay->rollbackFrame; frame < netplay->frame; frame++)
+    {
+        netplayRun(netplay, frame, FALSE);
+        netplay->stats.resimulatedFrames++;
+    }
+
+    netplay->stats.rollbacks++;
+    netplay->rollbackFrame = NETPLAY_NO_FRAME;
+}
+
+/******************************************************************
+ * FUNCTION : netplayRun()
+ *    Description: Keep the state at the start of a frame, then run
+ *                 it with the remote mask, or its prediction
+ *    Parameters:  netplay: session
+ *                 frame: frame to run
+ *                 live: frame run from NetplayFrame(), FALSE when
+ *                       run again by a rollback
+ *    Return:      None
+ ******************************************************************/
+static void netplayRun(netplayType *netplay, U32 frame, BOOL live)
+{
+    netplaySnapshotType *snapshot = &netplay->snapshots[frame % NETPLAY_MAX_ROLLBACK];
+    U32 slot = frame % NETPLAY_MAX_ROLLBACK;
+    U32 instruction;
+    U16 remote;
+    U16 mask;
+    U8 key;
+
+    CpuCopy(&snapshot->cpu, netplay->cpu);
+    (void)memcpy((void *)&snapshot->screen, (const void *)netplay->screen, sizeof(displayScreenType));
+
+    remote = (frame < netplay->confirmed) ? netplay->remoteMasks[slot] : netplay->prediction;
+    netplay->usedMasks[slot] = remote;
+
+    mask = (U16)((netplay->localMasks[slot] & netplay->localKeys) | (remote & (U16)~netplay->localKeys));
+    for (key = 0U; key < INPUT_NUMBER_OF_KEYBOARD_KEYS; key++)
+    {
+        netplay->keys[key] = (BOOL)((mask >> key) & 1U);
+    }
+
+    instruction = CpuRun(netplay->cpu, netplay->instructionsPerFrame);
+    METRICS_INSTRUCTIONS(instruction);
+
+    /* Audio comes up once Fx18 sets the sound timer, the sound plays
+     * on its last tick. A frame run again was heard already. */
+    if ((FALSE != live) && (0U != netplay->cpu->soundCounter))
+    {
+        SoundOpen();
+        if (1U == netplay->cpu->soundCounter)
+        {
+            SoundPlay();
+        }
+    }
+
+    CpuTimers(netplay->cpu);
+}
+
+/******************************************************************
+ * FUNCTION : netplayGetU32()
+ *    Description: Read a little endian 32 bit value
+ *    Parameters:  data: input
+ *    Return:      Value
+ ******************************************************************/
+static U32 netplayGetU32(const U8 *data)
+{
+    return (U32)data[0U] | ((U32)data[1U] << 8U) | ((U32)data[2U] << 16U) | ((U32)data[3U] << 24U);
+}
+
+/******************************************************************
+ * FUNCTION : netplayPutU32()
+ *    Description: Write a little endian 32 bit value
+ *    Parameters:  data: output
+ *                 value: value
+ *    Return:      None
+ ******************************************************************/
+static void netplayPutU32(U8 *data, U32 value)
+{
+    data[0U] = (U8)value;
+    data[1U] = (U8)(value >> 8U);
+    data[2U] = (U8)(value >> 16U);
+    data[3U] = (U8)(value >> 24U);
+}
@@ -0,0 +1,69 @@
+/******************************************************************
+ *
+ *
+ * FILE        : netplay.h
+ * PROJECT     : chip8
+ * AUTHOR      : danpham
+ * DESCRIPTION : Two player rollback netplay over UDP
+ *
+ ******************************************************************/
+#ifndef NETPLAY_H_
+#define NETPLAY_H_
+
+/******************************************************************
+ * 1. Included files (microcontroller ones then user defined ones)
+ ******************************************************************/
+#include "../headers/typedef.h"
+#include "../cpu/cpu.h"
+
+/******************************************************************
+ * 2. Define declarations (macros then function macros)
+ ******************************************************************/
+/* Frames a peer may run ahead of the inputs it received */
+#define NETPLAY_MAX_ROLLBACK                                     16U
+
+#define NETPLAY_FRAMES_PER_SECOND                                60U
+#define NETPLAY_DEFAULT_INSTRUCTIONS_PER_FRAME                   10U
+
+/* Player 1 drives keys 0 to B, player 2 keys C to F */
+#define NETPLAY_PLAYER1_KEYS                                0x0FFFU
+#define NETPLAY_PLAYER2_KEYS                                0xF000U
+
+/******************************************************************
+ * 3. Typedef definitions (simple typedef, then enum and structs)
+ ******************************************************************/
+typedef struct
+{
+    U16 localPort;
+    const char *remoteHost;
+    U16 remotePort;
+    U16 localKeys;                  /* Keys driven by this peer, the other peer drives the rest */
+    U32 instructionsPerFrame;       /* 0 for the default */
+} netplayConfigType;
+
+typedef struct
+{
+    U32 frame;                      /* Next frame to run */
+    U32 confirmedFrame;             /* Frames whose remote inputs are known */
+    U32 rollbacks;
+    U32 resimulatedFrames;
+    U32 stalls;                     /* Updates waiting for the other peer */
+} netplayStatsType;
+
+typedef struct netplayType netplayType;
+
+/******************************************************************
+ * 4. Variable definitions (static then global)
+ ******************************************************************/
+
+/******************************************************************
+ * 5. Functions prototypes (static only)
+ ******************************************************************/
+extern netplayType * NetplayOpen(cpuType *cpu, const netplayConfigType *config);
+extern Std_ReturnType NetplayUpdate(netplayType *netplay, const BOOL *keys);
+extern BOOL NetplayFrame(netplayType *netplay, U16 localMask);
+extern void NetplayPoll(netplayType *netplay);
+extern void NetplayStats(const netplayType *netplay, netplayStatsType *stats);
+extern void NetplayClose(netplayType *netplay);
+
+#endif /* NETPLAY_H_ */
@@ -0,0 +1,262 @@
+/******************************************************************
+ *
+ *
+ * FILE        : pacer.c
+ * PROJECT     : chip8
+ * AUTHOR      : danpham
+ * DESCRIPTION : Frame pacing.
+ *
+ *               Frame n is due at start + n / 60 s. Without vsync
+ *               the loop sleeps then spins up to the next deadline
+ *               and runs the frames due, so a late wake up is caught
+ *               up. With vsync the present waits for the vertical
+ *               blank: a 60 Hz display runs one frame per blank and
+ *               becomes the clock, other rates run the frames due
+ *               at each blank, repeating or dropping frames.
+ *
+ ******************************************************************/
+
+/******************************************************************
+ * 1. Included files (microcontroller ones then user defined ones)
+ ******************************************************************/
+#include <string.h>
+#include "pacer.h"
+#include "../metrics/metrics.h"
+
+/******************************************************************
+ * 2. Define declarations (macros then function macros)
+ ******************************************************************/
+#define PACER_US_PER_SECOND                                 1000000ULL
+
+/******************************************************************
+ * 3. Typedef definitions (simple typedef, then enum and structs)
+ ******************************************************************/
+typedef struct
+{
+    pacerStatsType stats;
+    U64 start;                      /* Clock of frame 0, may wrap */
+    U64 frame;                      /* Next frame to run */
+    U64 lastPresent;                /* Clock of the last present */
+    U64 hostPeriod;                 /* Microseconds between blanks */
+    BOOL blocking;                  /* Last present waited for the blank */
+} pacerType;
+
+/******************************************************************
+ * 4. Variable definitions (static then global)
+ ******************************************************************/
+static pacerType s_pacer;
+
+/******************************************************************
+ * 5. Functions prototypes (static only)
+ ******************************************************************/
+static U64 pacerNow(void);
+static U64 pacerOffset(U64 frame);
+static U64 pacerDue(U64 frame);
+static void pacerSleep(U64 deadline);
+
+/******************************************************************
+ * FUNCTION : PacerInit()
+ *    Description: Start the clock and read vsync and refresh rate
+ *                 of the window
+ *    Parameters:  window: emulator window
+ *                 renderer: renderer of the window
+ *    Return:      None
+ ******************************************************************/
+void PacerInit(SDL_Window *window, SDL_Renderer *renderer)
+{
+    SDL_RendererInfo info;
+    SDL_DisplayMode mode;
+    U32 refresh = PACER_FRAMES_PER_SECOND;
+
+    (void)memset(&s_pacer, 0, sizeof(s_pacer));
+
+    if ((NULL != renderer) && (0 == SDL_GetRendererInfo(renderer, &info)))
+    {
+        s_pacer.stats.vsync = (0U != (info.flags & SDL_RENDERER_PRESENTVSYNC)) ? TRUE : FALSE;
+    }
+
+    if ((0 == SDL_GetCurrentDisplayMode(SDL_GetWindowDisplayIndex(window), &mode)) && (mode.refresh_rate > 0))
+    {
+        s_pacer.stats.refreshRate = (U32)mode.refresh_rate;
+        refresh = s_pacer.stats.refreshRate;
+    }
+
+    s_pacer.stats.locked = ((FALSE != s_pacer.stats.vsync) && (0U != s_pacer.stats.refreshRate)
+                            && ((refresh + PACER_LOCK_TOLERANCE_HZ) >= PACER_FRAMES_PER_SECOND)
+                            && (refresh <= (PACER_FRAMES_PER_SECOND + PACER_LOCK_TOLERANCE_HZ))) ? TRUE : FALSE;
+
+    s_pacer.hostPeriod = PACER_US_PER_SECOND / refresh;
+    s_pacer.start = pacerNow();
+}
+
+/******************************************************************
+ * FUNCTION : PacerFrames()
+ *    Description: Emulated frames to run before the next present
+ *    Parameters:  None
+ *    Return:      Frames, 0 to present the same frame again
+ ******************************************************************/
+U32 PacerFrames(void)
+{
+    U64 now = pacerNow();
+    U32 frames = 0U;
+
+    if ((FALSE != s_pacer.stats.locked) && (FALSE != s_pacer.blocking))
+    {
+        /* The blank is the clock, the deadline follows it */
+        frames = 1U;
+        s_pacer.frame++;
+        s_pacer.start = now + pacerOffset(1U) - pacerOffset(s_pacer.frame);
+    }
+    else
+    {
+        while ((frames < PACER_MAX_CATCHUP) && (pacerDue(s_pacer.frame) <= now))
+        {
+            frames++;
+            s_pacer.frame++;
+        }
+
+        /* Too late to catch up, e.g. after the debugger stopped */
+        if (pacerDue(s_pacer.frame) <= now)
+        {
+            s_pacer.start = now + pacerOffset(1U) - pacerOffset(s_pacer.frame);
+            s_pacer.stats.resyncs++;
+        }
+    }
+
+    s_pacer.stats.frames += frames;
+    if (frames > 1U)
+    {
+        s_pacer.stats.dropped += frames - 1U;
+    }
+    else if (0U == frames)
+    {
+        s_pacer.stats.repeated++;
+    }
+
+    METRICS_PACE((frames > 1U) ? (frames - 1U) : 0U, (0U == frames) ? TRUE : FALSE);
+
+    return frames;
+}
+
+/******************************************************************
+ * FUNCTION : PacerWait()
+ *    Description: Time the present just done, then wait for the
+ *                 next frame unless the present waits for the
+ *                 vertical blank
+ *    Parameters:  None
+ *    Return:      None
+ ******************************************************************/
+void PacerWait(void)
+{
+    pacerStatsType *stats = &s_pacer.stats;
+    U64 now = pacerNow();
+    U64 interval;
+    double delta;
+
+    if (0U != s_pacer.lastPresent)
+    {
+        interval = now - s_pacer.lastPresent;
+        if (interval > stats->intervalMax)
+        {
+            stats->intervalMax = interval;
+        }
+
+        /* Running mean and variance of the intervals */
+        stats->intervals++;
+        delta = (double)interval - stats->intervalMean;
+        stats->intervalMean += delta / (double)stats->intervals;
+        stats->intervalSquares += delta * ((double)interval - stats->intervalMean);
+
+        s_pacer.blocking = ((FALSE != stats->vsync) && ((interval * 2U) >= s_pacer.hostPeriod)) ? TRUE : FALSE;
+    }
+
+    s_pacer.lastPresent = now;
+    stats->presents++;
+
+    if (FALSE == s_pacer.blocking)
+    {
+        pacerSleep(pacerDue(s_pacer.frame));
+    }
+}
+
+/******************************************************************
+ * FUNCTION : PacerRestart()
+ *    Description: Make the next frame due now, after the loop slept
+ *                 on events, without counting the gap as late
+ *    Parameters:  None
+ *    Return:      None
+ ******************************************************************/
+void PacerRestart(void)
+{
+    s_pacer.start = pacerNow() - pacerOffset(s_pacer.frame);
+    s_pacer.lastPresent = 0U;
+    s_pacer.blocking = FALSE;
+}
+
+/******************************************************************
+ * FUNCTION : PacerStats()
+ *    Description: Frame pacing statistics
+ *    Parameters:  None
+ *    Return:      Statistics since PacerInit()
+ ******************************************************************/
+const pacerStatsType * PacerStats(void)
+{
+    return &s_pacer.stats;
+}
+
+/******************************************************************
+ * FUNCTION : pacerNow()
+ *    Description: Monotonic clock
+ *    Parameters:  None
+ *    Return:      Time in microseconds
+ ******************************************************************/
+static U64 pacerNow(void)
+{
+    U64 counter = SDL_GetPerformanceCounter();
+    U64 frequency = SDL_GetPerformanceFrequency();
+
+    return ((counter / frequency) * PACER_US_PER_SECOND) + (((counter % frequency) * PACER_US_PER_SECOND) / frequency);
+}
+
+/******************************************************************
+ * FUNCTION : pacerOffset()
+ *    Description: Time of a frame from frame 0, without drift
+ *    Parameters:  frame: frame number
+ *    Return:      Microseconds
+ ******************************************************************/
+static U64 pacerOffset(U64 frame)
+{
+    return (frame * PACER_US_PER_SECOND) / PACER_FRAMES_PER_SECOND;
+}
+
+/******************************************************************
+ * FUNCTION : pacerDue()
+ *    Description: Deadline of a frame
+ *    Parameters:  frame: frame number
+ *    Return:      Clock in microseconds
+ ******************************************************************/
+static U64 pacerDue(U64 frame)
+{
+    return s_pacer.start + pacerOffset(frame);
+}
+
+/******************************************************************
+ * FUNCTION : pacerSleep()
+ *    Description: Sleep up to PACER_SPIN_US before a deadline, then
+ *                 spin on the clock until it
+ *    Parameters:  deadline: clock in microseconds
+ *    Return:      None
+ ******************************************************************/
+static void pacerSleep(U64 deadline)
+{
+    U64 now = pacerNow();
+
+    if (deadline > (now + PACER_SPIN_US))
+    {
+        SDL_Delay((U32)((deadline - now - PACER_SPIN_US) / 1000U));
+    }
+
+    while (pacerNow() < deadline)
+    {
+    }
+}
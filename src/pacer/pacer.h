@@ -0,0 +1,68 @@
+/******************************************************************
+ *
+ *
+ * FILE        : pacer.h
+ * PROJECT     : chip8
+ * AUTHOR      : danpham
+ * DESCRIPTION : Frame pacing of the window: emulated frames at 60 Hz
+ *               against the high resolution clock, locked on vsync
+ *               when the display runs at the same rate
+ *
+ ******************************************************************/
+#ifndef PACER_H_
+#define PACER_H_
+
+/******************************************************************
+ * 1. Included files (microcontroller ones then user defined ones)
+ ******************************************************************/
+#include <SDL2/SDL.h>
+#include "../headers/typedef.h"
+
+/******************************************************************
+ * 2. Define declarations (macros then function macros)
+ ******************************************************************/
+#define PACER_FRAMES_PER_SECOND                                  60U
+
+/* Frames run before one present at most, the rest are dropped */
+#define PACER_MAX_CATCHUP                                         4U
+
+/* Last part of a wait spent spinning, sleeps overshoot by about a
+ * millisecond */
+#define PACER_SPIN_US                                          1000U
+
+/* Display refresh close enough to run one frame per vertical blank */
+#define PACER_LOCK_TOLERANCE_HZ                                   1U
+
+/******************************************************************
+ * 3. Typedef definitions (simple typedef, then enum and structs)
+ ******************************************************************/
+typedef struct
+{
+    U64 frames;                     /* Emulated frames run */
+    U64 presents;                   /* Frames presented */
+    U64 dropped;                    /* Emulated frames never presented */
+    U64 repeated;                   /* Presents without a new frame */
+    U64 resyncs;                    /* Clock restarted after falling behind */
+    U64 intervals;                  /* Present intervals timed */
+    U64 intervalMax;                /* Microseconds between presents */
+    double intervalMean;
+    double intervalSquares;         /* Sum of squared deviations */
+    U32 refreshRate;                /* Display refresh in Hz, 0 if unknown */
+    BOOL vsync;                     /* Present waits for the vertical blank */
+    BOOL locked;                    /* One frame per vertical blank */
+} pacerStatsType;
+
+/******************************************************************
+ * 4. Variable definitions (static then global)
+ ******************************************************************/
+
+/******************************************************************
+ * 5. Functions prototypes (static only)
+ ******************************************************************/
+extern void PacerInit(SDL_Window *window, SDL_Renderer *renderer);
+extern U32 PacerFrames(void);
+extern void PacerWait(void);
+extern void PacerRestart(void);
+extern const pacerStatsType * PacerStats(void);
+
+#endif /* PACER_H_ */
@@ -0,0 +1,197 @@
+/******************************************************************
+ *
+ *
+ * FILE        : pool.c
+ * PROJECT     : chip8
+ * AUTHOR      : danpham
+ * DESCRIPTION : Machine pool.
+ *
+ *               The arena is one anonymous mapping, zero filled
+ *               and page aligned, so every stride starts on a cache
+ *               line. A cpu stride is rounded to CPU_CACHE_LINE but
+ *               never to a multiple of a page: the hot lines of
+ *               consecutive machines then fall in different cache
+ *               sets instead of fighting over one. The memories
+ *               follow in their own array, sized for the profile,
+ *               so stepping a machine touches its cpu line and the
+ *               memory lines the program reads. With huge pages
+ *               the arena is aligned on POOL_HUGE_PAGE_SIZE and
+ *               advised to the kernel, a worker going round
+ *               thousands of machines then needs one TLB entry per
+ *               2 MB instead of one per 4 KB. Windows large pages
+ *               need a privilege, the request is ignored there.
+ *
+ ******************************************************************/
+
+/******************************************************************
+ * 1. Included files (microcontroller ones then user defined ones)
+ ******************************************************************/
+#include <stdint.h>
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+#include "pool.h"
+#include "../cpu/cpu.h"
+
+/******************************************************************
+ * 2. Define declarations (macros then function macros)
+ ******************************************************************/
+#define POOL_ALIGN(size, alignment)     (((size) + (alignment) - 1U) & ~((size_t)(alignment) - 1U))
+
+/******************************************************************
+ * 3. Typedef definitions (simple typedef, then enum and structs)
+ ******************************************************************/
+
+/******************************************************************
+ * 4. Variable definitions (static then global)
+ ******************************************************************/
+
+/******************************************************************
+ * 5. Functions prototypes (static only)
+ ******************************************************************/
+static size_t poolStride(size_t size);
+static U8 * poolMap(size_t size, BOOL hugePages, U8 **mapping, size_t *mappedSize);
+static void poolUnmap(U8 *mapping, size_t mappedSize);
+
+/******************************************************************
+ * FUNCTION : PoolCreate()
+ *    Description: Map the arena of count machines, cpus, memories
+ *                 and data zeroed. The cpus are not attached, see
+ *                 POOL_MEMORY().
+ *    Parameters:  pool: pool to fill
+ *                 count: number of machines
+ *                 memorySize: memory of one machine, see
+ *                 CPU_MEMORY_BYTES()
+ *                 dataSize: caller data of one machine, 0 for none
+ *                 hugePages: back the arena with huge pages
+ *    Return:      E_OK if mapped, E_NOT_OK otherwise
+ ******************************************************************/
+Std_ReturnType PoolCreate(poolType *pool, U32 count, size_t memorySize, size_t dataSize, BOOL hugePages)
+{
+    size_t cpuBytes;
+    size_t memoryBytes;
+
+    (void)memset((void *)pool, 0, sizeof(poolType));
+
+    pool->cpuStride = poolStride(sizeof(cpuType));
+    pool->memoryStride = poolStride(memorySize);
+    pool->dataStride = (0U != dataSize) ? poolStride(dataSize) : 0U;
+    if ((0U == count) || ((SIZE_MAX / (pool->cpuStride + pool->memoryStride + pool->dataStride)) <= count))
+    {
+        return E_NOT_OK;
+    }
+
+    cpuBytes = (size_t)count * pool->cpuStride;
+    memoryBytes = (size_t)count * pool->memoryStride;
+    pool->cpus = poolMap(cpuBytes + memoryBytes + ((size_t)count * pool->dataStride), hugePages, &pool->mapping,
+                         &pool->mappedSize);
+    if (NULL == pool->cpus)
+    {
+        return E_NOT_OK;
+    }
+
+    pool->memories = pool->cpus + cpuBytes;
+    pool->data = pool->memories + memoryBytes;
+    pool->count = count;
+    pool->hugePages = hugePages;
+
+    return E_OK;
+}
+
+/******************************************************************
+ * FUNCTION : PoolDestroy()
+ *    Description: Unmap the arena, the pool may be empty
+ *    Parameters:  pool: pool
+ *    Return:      None
+ ******************************************************************/
+void PoolDestroy(poolType *pool)
+{
+    if (NULL != pool->mapping)
+    {
+        poolUnmap(pool->mapping, pool->mappedSize);
+    }
+
+    (void)memset((void *)pool, 0, sizeof(poolType));
+}
+
+/******************************************************************
+ * FUNCTION : poolStride()
+ *    Description: Distance between two machines of one array
+ *    Parameters:  size: bytes of one machine
+ *    Return:      Size rounded to a cache line, off the page period
+ ******************************************************************/
+static size_t poolStride(size_t size)
+{
+    size_t stride = POOL_ALIGN(size, CPU_CACHE_LINE);
+
+    if (0U == (stride % POOL_SET_PERIOD))
+    {
+        stride += CPU_CACHE_LINE;
+    }
+
+    return stride;
+}
+
+/******************************************************************
+ * FUNCTION : poolMap()
+ *    Description: Map zeroed memory
+ *    Parameters:  size: bytes needed
+ *                 hugePages: align and advise for huge pages
+ *                 mapping, mappedSize: mapping to unmap, filled
+ *    Return:      Start of the arena, NULL on error
+ ******************************************************************/
+static U8 * poolMap(size_t size, BOOL hugePages, U8 **mapping, size_t *mappedSize)
+{
+    U8 *arena;
+
+#ifdef _WIN32
+    (void)hugePages;
+
+    *mappedSize = size;
+    *mapping = (U8 *)VirtualAlloc(NULL, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+    arena = *mapping;
+#else
+    void *address;
+
+    /* Room to slide the arena onto a huge page boundary */
+    *mappedSize = (FALSE != hugePages) ? (POOL_ALIGN(size, POOL_HUGE_PAGE_SIZE) + POOL_HUGE_PAGE_SIZE) : size;
+    address = mmap(NULL, *mappedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (MAP_FAILED == address)
+    {
+        *mapping = NULL;
+        return NULL;
+    }
+
+    *mapping = (U8 *)address;
+    arena = *mapping;
+    if (FALSE != hugePages)
+    {
+        arena = (U8 *)POOL_ALIGN((uintptr_t)arena, POOL_HUGE_PAGE_SIZE);
+#ifdef MADV_HUGEPAGE
+        /* Only advice, the arena works on small pages as well */
+        (void)madvise((void *)arena, POOL_ALIGN(size, POOL_HUGE_PAGE_SIZE), MADV_HUGEPAGE);
+#endif
+    }
+#endif
+
+    return arena;
+}
+
+/******************************************************************
+ * FUNCTION : poolUnmap()
+ *    Description: Release a mapping of poolMap()
+ *    Parameters:  mapping, mappedSize: mapping
+ *    Return:      None
+ ******************************************************************/
+static void poolUnmap(U8 *mapping, size_t mappedSize)
+{
+#ifdef _WIN32
+    (void)mappedSize;
+    (void)VirtualFree((void *)mapping, 0U, MEM_RELEASE);
+#else
+    (void)munmap((void *)mapping, mappedSize);
+#endif
+}
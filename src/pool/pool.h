@@ -0,0 +1,66 @@
+/******************************************************************
+ *
+ *
+ * FILE        : pool.h
+ * PROJECT     : chip8
+ * AUTHOR      : danpham
+ * DESCRIPTION : Machine pool: the cpus of many machines and their
+ *               per machine caller data in one contiguous arena,
+ *               optionally backed by transparent huge pages
+ *
+ ******************************************************************/
+#ifndef POOL_H_
+#define POOL_H_
+
+/******************************************************************
+ * 1. Included files (microcontroller ones then user defined ones)
+ ******************************************************************/
+#include <stddef.h>
+#include "../headers/typedef.h"
+#include "../cpu/cpu.h"
+
+/******************************************************************
+ * 2. Define declarations (macros then function macros)
+ ******************************************************************/
+/* Transparent huge page size of x86-64 and arm64 4 KB kernels */
+#define POOL_HUGE_PAGE_SIZE                               0x200000UL
+
+/* Cache sets repeat every page, strides multiple of it are avoided */
+#define POOL_SET_PERIOD                                        4096U
+
+#define POOL_CPU(pool, index)      ((cpuType *)(void *)((pool)->cpus + ((size_t)(index) * (pool)->cpuStride)))
+#define POOL_MEMORY(pool, index)   ((pool)->memories + ((size_t)(index) * (pool)->memoryStride))
+#define POOL_DATA(pool, index)     ((void *)((pool)->data + ((size_t)(index) * (pool)->dataStride)))
+
+/******************************************************************
+ * 3. Typedef definitions (simple typedef, then enum and structs)
+ ******************************************************************/
+/* The cpus come first, one per CPU_CACHE_LINE aligned stride, so the
+ * hot registers of a machine are one line. The memories of the
+ * machines follow in a parallel array, sized for their profile, then
+ * the data of the machines, both kept out of the cpu lines. */
+typedef struct
+{
+    U8 *mapping;                    /* Start of the mapping */
+    size_t mappedSize;
+    U8 *cpus;
+    U8 *memories;
+    U8 *data;
+    size_t cpuStride;
+    size_t memoryStride;
+    size_t dataStride;
+    U32 count;
+    BOOL hugePages;                 /* Huge pages advised for the arena */
+} poolType;
+
+/******************************************************************
+ * 4. Variable definitions (static then global)
+ ******************************************************************/
+
+/******************************************************************
+ * 5. Functions prototypes (static only)
+ ******************************************************************/
+extern Std_ReturnType PoolCreate(poolType *pool, U32 count, size_t memorySize, size_t dataSize, BOOL hugePages);
+extern void PoolDestroy(poolType *pool);
+
+#endif /* POOL_H_ */
@@ -0,0 +1,298 @@
+/******************************************************************
+ *
+ *
+ * FILE        : profiler.c
+ * PROJECT     : chip8
+ * AUTHOR      : danpham
+ * DESCRIPTION : Opcode execution profiler
+ *
+ ******************************************************************/
+
+/******************************************************************
+ * 1. Included files (microcontroller ones then user defined ones)
+ ******************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <SDL2/SDL.h>
+#include "profiler.h"
+#include "../cpu/cpu.h"
+#include "../pacer/pacer.h"
+
+/******************************************************************
+ * 2. Define declarations (macros then function macros)
+ ******************************************************************/
+/* One class per first nibble, refined by the low byte for 0, 8, E and F */
+#define PROFILER_CLASS_NUMBER                                  4096U
+#define PROFILER_HOT_ADDRESSES                                   32U
+
+/******************************************************************
+ * 3. Typedef definitions (simple typedef, then enum and structs)
+ ******************************************************************/
+typedef struct
+{
+    U64 pcCount[CPU_MEMORY_SIZE];
+    U16 pcOpCode[CPU_MEMORY_SIZE];
+    U64 classCount[PROFILER_CLASS_NUMBER];
+    U64 instructions;
+    U64 sectionStart[E_PROFILER_SECTIONS];
+    U64 sectionTime[E_PROFILER_SECTIONS];
+    U64 sectionCalls[E_PROFILER_SECTIONS];
+    U64 startTime;
+} profilerType;
+
+/******************************************************************
+ * 4. Variable definitions (static then global)
+ ******************************************************************/
+static profilerType s_profiler;
+
+/* Histogram being sorted by profilerCompare() */
+static const U64 *s_sortedCounts;
+
+static const char *s_sectionNames[E_PROFILER_SECTIONS] = {
+    "cpu",
+    "draw",
+    "input",
+    "present"
+};
+
+/******************************************************************
+ * 5. Functions prototypes (static only)
+ ******************************************************************/
+static U16 profilerClass(U16 opCode);
+static void profilerClassName(U16 opClass, char *name, size_t size);
+static U16 profilerSort(const U64 *counts, U16 size, U16 *indexes);
+static int profilerCompare(const void *a, const void *b);
+static double profilerPercent(U64 value, U64 total);
+
+/******************************************************************
+ * FUNCTION : ProfilerInstruction()
+ *    Description: Count one executed instruction
+ *    Parameters:  pc: address of the instruction
+ *                 opCode: instruction
+ *    Return:      None
+ ******************************************************************/
+void ProfilerInstruction(U16 pc, U16 opCode)
+{
+    if (0U == s_profiler.startTime)
+    {
+        s_profiler.startTime = SDL_GetPerformanceCounter();
+    }
+
+    pc &= (CPU_MEMORY_SIZE - 1U);
+
+    s_profiler.pcCount[pc]++;
+    s_profiler.pcOpCode[pc] = opCode;
+    s_profiler.classCount[profilerClass(opCode)]++;
+    s_profiler.instructions++;
+}
+
+/******************************************************************
+ * FUNCTION : ProfilerBegin()
+ *    Description: Start timing a host section
+ *    Parameters:  section: timed section
+ *    Return:      None
+ ******************************************************************/
+void ProfilerBegin(profilerSectionType section)
+{
+    s_profiler.sectionStart[section] = SDL_GetPerformanceCounter();
+
+    if (0U == s_profiler.startTime)
+    {
+        s_profiler.startTime = s_profiler.sectionStart[section];
+    }
+}
+
+/******************************************************************
+ * FUNCTION : ProfilerEnd()
+ *    Description: Stop timing a host section
+ *    Parameters:  section: timed section
+ *    Return:      None
+ ******************************************************************/
+void ProfilerEnd(profilerSectionType section)
+{
+    s_profiler.sectionTime[section] += SDL_GetPerformanceCounter() - s_profiler.sectionStart[section];
+    s_profiler.sectionCalls[section]++;
+}
+
+/******************************************************************
+ * FUNCTION : ProfilerReport()
+ *    Description: Write host time per section, then opcode
+ *                 classes and hot addresses sorted by count
+ *    Parameters:  path: report file
+ *    Return:      E_OK if report is written, E_NOT_OK otherwise
+ ******************************************************************/
+Std_ReturnType ProfilerReport(const char *path)
+{
+    static U16 s_indexes[PROFILER_CLASS_NUMBER];
+    const pacerStatsType *pacing = PacerStats();
+    FILE *filePtr;
+    U16 count;
+    U16 i;
+    U16 index;
+    char name[8];
+    double frequency = (double)SDL_GetPerformanceFrequency();
+    U64 elapsed = SDL_GetPerformanceCounter() - s_profiler.startTime;
+
+    if (NULL == (filePtr = fopen(path, "w")))
+    {
+        return E_NOT_OK;
+    }
+
+    fprintf(filePtr, "Instructions: %llu\n", s_profiler.instructions);
+    fprintf(filePtr, "Elapsed:      %.3f s\n\n", (double)elapsed / frequency);
+
+    fprintf(filePtr, "%-10s %12s %8s %14s %12s\n", "section", "time (ms)", "%", "calls", "avg (us)");
+    for (i = 0U; i < E_PROFILER_SECTIONS; i++)
+    {
+        fprintf(filePtr, "%-10s %12.3f %7.2f%% %14llu %12.3f\n",
+                s_sectionNames[i],
+                (double)s_profiler.sectionTime[i] * 1000.0 / frequency,
+                profilerPercent(s_profiler.sectionTime[i], elapsed),
+                s_profiler.sectionCalls[i],
+                (s_profiler.sectionCalls[i] == 0U) ? 0.0 : ((double)s_profiler.sectionTime[i] * 1000000.0 / frequency / (double)s_profiler.sectionCalls[i]));
+    }
+
+    fprintf(filePtr, "\nFrames:     %llu run, %llu presented, %llu dropped, %llu repeated, %llu resyncs\n",
+            pacing->frames, pacing->presents, pacing->dropped, pacing->repeated, pacing->resyncs);
+    fprintf(filePtr, "Pacing:     %s, %lu Hz display, %.3f ms mean, %.3f ms deviation, %.3f ms max\n",
+            (FALSE != pacing->locked) ? "vsync locked" : ((FALSE != pacing->vsync) ? "vsync" : "clock"),
+            (unsigned long)pacing->refreshRate, pacing->intervalMean / 1000.0,
+            (pacing->intervals > 1U) ? (sqrt(pacing->intervalSquares / (double)(pacing->intervals - 1U)) / 1000.0) : 0.0,
+            (double)pacing->intervalMax / 1000.0);
+
+    fprintf(filePtr, "\n%-10s %14s %8s\n", "class", "count", "%");
+    count = profilerSort(s_profiler.classCount, PROFILER_CLASS_NUMBER, s_indexes);
+    for (i = 0U; i < count; i++)
+    {
+        index = s_indexes[i];
+        profilerClassName(index, name, sizeof(name));
+        fprintf(filePtr, "%-10s %14llu %7.2f%%\n", name, s_profiler.classCount[index],
+                profilerPercent(s_profiler.classCount[index], s_profiler.instructions));
+    }
+
+    fprintf(filePtr, "\n%-10s %-8s %14s %8s\n", "address", "opcode", "count", "%");
+    count = profilerSort(s_profiler.pcCount, CPU_MEMORY_SIZE, s_indexes);
+    for (i = 0U; (i < count) && (i < PROFILER_HOT_ADDRESSES); i++)
+    {
+        index = s_indexes[i];
+        fprintf(filePtr, "0x%03X      %04X     %14llu %7.2f%%\n", index, s_profiler.pcOpCode[index],
+                s_profiler.pcCount[index], profilerPercent(s_profiler.pcCount[index], s_profiler.instructions));
+    }
+
+    fclose(filePtr);
+
+    return E_OK;
+}
+
+/******************************************************************
+ * FUNCTION : profilerClass()
+ *    Description: Histogram index of an opcode
+ *    Parameters:  opCode: instruction
+ *    Return:      Class index
+ ******************************************************************/
+static U16 profilerClass(U16 opCode)
+{
+    U16 nibble = opCode >> 12U;
+    U16 low = 0U;
+
+    switch (nibble)
+    {
+    case 0x0:
+        if (((opCode & 0x0FFF) == 0x00E0) || ((opCode & 0x0FFF) == 0x00EE))
+        {
+            low = opCode & 0x00FF;
+        }
+        break;
+    case 0x8:
+        low = opCode & 0x000F;
+        break;
+    case 0xE:
+    case 0xF:
+        low = opCode & 0x00FF;
+        break;
+    default:
+        break;
+    }
+
+    return (U16)((nibble << 8U) | low);
+}
+
+/******************************************************************
+ * FUNCTION : profilerClassName()
+ *    Description: Mnemonic pattern of a class, e.g. 8xy4 or Dxyn
+ *    Parameters:  opClass: class index
+ *                 name, size: output string
+ *    Return:      None
+ ******************************************************************/
+static void profilerClassName(U16 opClass, char *name, size_t size)
+{
+    static const char *s_patterns[16U] = {
+        "0nnn", "1nnn", "2nnn", "3xkk", "4xkk", "5xy0", "6xkk", "7xkk",
+        "8xy%X", "9xy0", "Annn", "Bnnn", "Cxkk", "Dxyn", "Ex%02X", "Fx%02X"
+    };
+    U16 nibble = opClass >> 8U;
+    U16 low = opClass & 0x00FF;
+
+    if ((0U == nibble) && (0U != low))
+    {
+        (void)snprintf(name, size, "00%02X", low);
+    }
+    else
+    {
+        (void)snprintf(name, size, s_patterns[nibble], low);
+    }
+}
+
+/******************************************************************
+ * FUNCTION : profilerSort()
+ *    Description: List non zero entries of a histogram, highest
+ *                 count first
+ *    Parameters:  counts, size: histogram
+ *                 indexes: output, at least size entries
+ *    Return:      Number of non zero entries
+ ******************************************************************/
+static U16 profilerSort(const U64 *counts, U16 size, U16 *indexes)
+{
+    U16 i;
+    U16 count = 0U;
+
+    for (i = 0U; i < size; i++)
+    {
+        if (counts[i] != 0U)
+        {
+            indexes[count] = i;
+            count++;
+        }
+    }
+
+    s_sortedCounts = counts;
+    qsort(indexes, count, sizeof(U16), profilerCompare);
+
+    return count;
+}
+
+/******************************************************************
+ * FUNCTION : profilerCompare()
+ *    Description: qsort comparator, descending count
+ *    Parameters:  a, b: histogram indexes
+ *    Return:      Ordering of a and b
+ ******************************************************************/
+static int profilerCompare(const void *a, const void *b)
+{
+    U64 left = s_sortedCounts[*(const U16 *)a];
+    U64 right = s_sortedCounts[*(const U16 *)b];
+
+    return (left < right) - (left > right);
+}
+
+/******************************************************************
+ * FUNCTION : profilerPercent()
+ *    Description: Ratio in percent
+ *    Parameters:  value, total
+ *    Return:      Percentage, 0 if total is 0
+ ******************************************************************/
+static double profilerPercent(U64 value, U64 total)
+{
+    return (total == 0U) ? 0.0 : ((double)value * 100.0 / (double)total);
+}
@@ -0,0 +1,61 @@
+/******************************************************************
+ *
+ *
+ * FILE        : profiler.h
+ * PROJECT     : chip8
+ * AUTHOR      : danpham
+ * DESCRIPTION : Opcode execution profiler. Build with
+ *               -DPROFILER_ENABLED to turn the hooks on, they
+ *               are compiled out otherwise.
+ *
+ ******************************************************************/
+#ifndef PROFILER_H_
+#define PROFILER_H_
+
+/******************************************************************
+ * 1. Included files (microcontroller ones then user defined ones)
+ ******************************************************************/
+#include "../headers/typedef.h"
+
+/******************************************************************
+ * 2. Define declarations (macros then function macros)
+ ******************************************************************/
+#define PROFILER_REPORT_FILE                       "build/profile.txt"
+
+#ifdef PROFILER_ENABLED
+#define PROFILER_INSTRUCTION(pc, opCode)      ProfilerInstruction((pc), (opCode))
+#define PROFILER_BEGIN(section)               ProfilerBegin(section)
+#define PROFILER_END(section)                 ProfilerEnd(section)
+#define PROFILER_REPORT()                     (void)ProfilerReport(PROFILER_REPORT_FILE)
+#else
+#define PROFILER_INSTRUCTION(pc, opCode)
+#define PROFILER_BEGIN(section)
+#define PROFILER_END(section)
+#define PROFILER_REPORT()
+#endif
+
+/******************************************************************
+ * 3. Typedef definitions (simple typedef, then enum and structs)
+ ******************************************************************/
+typedef enum
+{
+    E_PROFILER_CPU,      /* CpuMain(), draw time included */
+    E_PROFILER_DRAW,     /* DisplayDraw() */
+    E_PROFILER_INPUT,    /* SDL event polling */
+    E_PROFILER_PRESENT,  /* Screen rendering and present */
+    E_PROFILER_SECTIONS
+} profilerSectionType;
+
+/******************************************************************
+ * 4. Variable definitions (static then global)
+ ******************************************************************/
+
+/******************************************************************
+ * 5. Functions prototypes (static only)
+ ******************************************************************/
+extern void ProfilerInstruction(U16 pc, U16 opCode);
+extern void ProfilerBegin(profilerSectionType section);
+extern void ProfilerEnd(profilerSectionType section);
+extern Std_ReturnType ProfilerReport(const char *path);
+
+#endif /* PROFILER_H_ */
@@ -0,0 +1,1327 @@
+/******************************************************************
+ *
+ *
+ * FILE        : python.c
+ * PROJECT     : chip8
+ * AUTHOR      : danpham
+ * DESCRIPTION : Python extension module "chip8".
+ *
+ *               chip8.Machine is one emulated machine and
+ *               chip8.VecEnv wraps the vectorized environment.
+ *               Screens, memory, registers and step results are
+ *               exported through the buffer protocol, so memoryview
+ *               or numpy.asarray() see the emulator storage itself
+ *               and stay up to date without copies. Stepping runs
+ *               without the GIL; a machine or environment refuses a
+ *               second step while one is in progress.
+ *
+ ******************************************************************/
+
+/******************************************************************
+ * 1. Included files (microcontroller ones then user defined ones)
+ ******************************************************************/
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../headers/typedef.h"
+#include "../cpu/cpu.h"
+#include "../display/display.h"
+#include "../env/env.h"
+#include "../import/import.h"
+#include "../input/input.h"
+
+/******************************************************************
+ * 2. Define declarations (macros then function macros)
+ ******************************************************************/
+#define PYTHON_STATE_MAGIC                               0x43385353UL
+#define PYTHON_VIEW_MAX_DIMENSIONS                                4U
+#define PYTHON_SCREEN_WORDS   (sizeof(displayRowType) / sizeof(U64))
+
+/******************************************************************
+ * 3. Typedef definitions (simple typedef, then enum and structs)
+ ******************************************************************/
+/* Buffer exporter over storage owned by a machine or environment */
+typedef struct
+{
+    PyObject_HEAD
+    PyObject *owner;
+    void *data;
+    const char *format;
+    Py_ssize_t itemSize;
+    int dimensions;
+    Py_ssize_t shape[PYTHON_VIEW_MAX_DIMENSIONS];
+    Py_ssize_t strides[PYTHON_VIEW_MAX_DIMENSIONS];
+} pythonViewType;
+
+typedef struct
+{
+    PyObject_HEAD
+    cpuType cpu;
+    displayScreenType screen;
+    BOOL keys[INPUT_NUMBER_OF_KEYBOARD_KEYS];
+    U8 memory[CPU_MAX_MEMORY_BYTES]; /* Kept in place for the memory views */
+    cpuType *initial;               /* Cpu right after the rom load */
+    U8 *initialMemory;
+    U32 instructionsPerFrame;
+    BOOL busy;
+} pythonMachineType;
+
+typedef struct
+{
+    PyObject_HEAD
+    envType *env;
+    U32 count;
+    displayScreenType *observations;
+    S32 *rewards;
+    U8 *dones;
+    U16 *actions;                   /* Used when actions are not a uint16 buffer */
+    BOOL busy;
+} pythonEnvType;
+
+/* Save state layout, only valid for the build that wrote it */
+typedef struct
+{
+    U32 magic;
+    U32 size;
+    cpuType cpu;
+    displayScreenType screen;
+    U8 memory[CPU_MAX_MEMORY_BYTES];
+} pythonStateType;
+
+typedef enum
+{
+    E_PYTHON_REGISTER_PC,
+    E_PYTHON_REGISTER_I,
+    E_PYTHON_REGISTER_DELAY,
+    E_PYTHON_REGISTER_SOUND
+} pythonRegisterType;
+
+/******************************************************************
+ * 4. Variable definitions (static then global)
+ ******************************************************************/
+static PyTypeObject *s_viewType;
+
+/******************************************************************
+ * 5. Functions prototypes (static only)
+ ******************************************************************/
+static PyObject * pythonView(PyObject *owner, void *data, const char *format, Py_ssize_t itemSize,
+                             int dimensions, const Py_ssize_t *shape, Py_ssize_t outerStride);
+static int pythonViewGetBuffer(PyObject *self, Py_buffer *view, int flags);
+static void pythonViewDealloc(PyObject *self);
+static const U8 * pythonRom(PyObject *rom, Py_buffer *buffer, U32 *size);
+static BOOL pythonStart(BOOL *busy);
+static int pythonMachineInit(PyObject *self, PyObject *args, PyObject *kwargs);
+static void pythonMachineDealloc(PyObject *self);
+static void pythonMachineRun(pythonMachineType *machine, U32 frames);
+static PyObject * pythonMachineStep(PyObject *self, PyObject *args, PyObject *kwargs);
+static void pythonMachineRestart(pythonMachineType *machine);
+static PyObject * pythonMachineReset(PyObject *self, PyObject *unused);
+static PyObject * pythonMachineSaveState(PyObject *self, PyObject *unused);
+static PyObject * pythonMachineLoadState(PyObject *self, PyObject *state);
+static PyObject * pythonMachineGetScreen(PyObject *self, void *closure);
+static PyObject * pythonMachineGetMemory(PyObject *self, void *closure);
+static PyObject * pythonMachineGetVx(PyObject *self, void *closure);
+static PyObject * pythonMachineGetRegister(PyObject *self, void *closure);
+static int pythonMachineSetRegister(PyObject *self, PyObject *value, void *closure);
+static PyObject * pythonMachineGetKeys(PyObject *self, void *closure);
+static int pythonMachineSetKeys(PyObject *self, PyObject *value, void *closure);
+static PyObject * pythonMachineGetStatus(PyObject *self, void *closure);
+static int pythonEnvInit(PyObject *self, PyObject *args, PyObject *kwargs);
+static void pythonEnvDealloc(PyObject *self);
+static void pythonEnvFree(pythonEnvType *env);
+static PyObject * pythonEnvStep(PyObject *self, PyObject *args, PyObject *kwargs);
+static PyObject * pythonEnvReset(PyObject *self, PyObject *unused);
+static PyObject * pythonEnvGetObservations(PyObject *self, void *closure);
+static PyObject * pythonEnvGetRewards(PyObject *self, void *closure);
+static PyObject * pythonEnvGetDones(PyObject *self, void *closure);
+static PyObject * pythonEnvGetCount(PyObject *self, void *closure);
+
+static PyType_Slot s_viewSlots[] =
+{
+    { Py_tp_dealloc, (void *)pythonViewDealloc },
+    { Py_bf_getbuffer, (void *)pythonViewGetBuffer },
+    { 0, NULL }
+};
+
+static PyType_Spec s_viewSpec =
+{
+    "chip8.View", sizeof(pythonViewType), 0, Py_TPFLAGS_DEFAULT, s_viewSlots
+};
+
+static PyMethodDef s_machineMethods[] =
+{
+    { "step", (PyCFunction)(void (*)(void))pythonMachineStep, METH_VARARGS | METH_KEYWORDS,
+      "step(frames=1): run frames frames without the GIL, return True while the program runs" },
+    { "reset", pythonMachineReset, METH_NOARGS, "reset(): restart the program" },
+    { "save_state", pythonMachineSaveState, METH_NOARGS, "save_state() -> bytes" },
+    { "load_state", pythonMachineLoadState, METH_O, "load_state(state): restore a save_state() result" },
+    { NULL, NULL, 0, NULL }
+};
+
+static PyGetSetDef s_machineGetSets[] =
+{
+    { "screen", pythonMachineGetScreen, NULL, "uint64 planes x rows x words view, pixel 0 is the MSB of word 0", NULL },
+    { "memory", pythonMachineGetMemory, NULL, "uint8 memory view", NULL },
+    { "v", pythonMachineGetVx, NULL, "uint8 V0-VF view", NULL },
+    { "pc", pythonMachineGetRegister, pythonMachineSetRegister, "program counter", (void *)E_PYTHON_REGISTER_PC },
+    { "i", pythonMachineGetRegister, pythonMachineSetRegister, "I register", (void *)E_PYTHON_REGISTER_I },
+    { "delay", pythonMachineGetRegister, pythonMachineSetRegister, "delay timer", (void *)E_PYTHON_REGISTER_DELAY },
+    { "sound", pythonMachineGetRegister, pythonMachineSetRegister, "sound timer", (void *)E_PYTHON_REGISTER_SOUND },
+    { "keys", pythonMachineGetKeys, pythonMachineSetKeys, "key mask, bit k holds key k", NULL },
+    { "status", pythonMachineGetStatus, NULL, "STATUS_RUNNING, STATUS_EXITED, STATUS_INVALID_OPCODE or STATUS_STACK_*", NULL },
+    { NULL, NULL, NULL, NULL, NULL }
+};
+
+static PyType_Slot s_machineSlots[] =
+{
+    { Py_tp_doc, (void *)"Machine(rom, profile=PROFILE_VIP, seed=0, instructions_per_frame=10)\n"
+                         "rom is a file path or a bytes-like object." },
+    { Py_tp_new, (void *)PyType_GenericNew },
+    { Py_tp_init, (void *)pythonMachineInit },
+    { Py_tp_dealloc, (void *)pythonMachineDealloc },
+    { Py_tp_methods, (void *)s_machineMethods },
+    { Py_tp_getset, (void *)s_machineGetSets },
+    { 0, NULL }
+};
+
+static PyType_Spec s_machineSpec =
+{
+    "chip8.Machine", sizeof(pythonMachineType), 0, Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE, s_machineSlots
+};
+
+static PyMethodDef s_envMethods[] =
+{
+    { "step", (PyCFunction)(void (*)(void))pythonEnvStep, METH_VARARGS | METH_KEYWORDS,
+      "step(actions, frames=1): apply one key mask per machine and run frames frames without the GIL" },
+    { "reset", pythonEnvReset, METH_NOARGS, "reset(): start a new episode on every machine" },
+    { NULL, NULL, 0, NULL }
+};
+
+static PyGetSetDef s_envGetSets[] =
+{
+    { "observations", pythonEnvGetObservations, NULL, "uint64 machines x planes x rows x words view", NULL },
+    { "rewards", pythonEnvGetRewards, NULL, "rewards of the last step", NULL },
+    { "dones", pythonEnvGetDones, NULL, "uint8 episode end flags of the last step", NULL },
+    { "count", pythonEnvGetCount, NULL, "number of machines", NULL },
+    { NULL, NULL, NULL, NULL, NULL }
+};
+
+static PyType_Slot s_envSlots[] =
+{
+    { Py_tp_doc, (void *)"VecEnv(rom, count, profile=PROFILE_VIP, threads=1, seed=0, instructions_per_frame=10,\n"
+                         "       max_episode_frames=0, rewards=(), done=None, huge_pages=False)\n"
+                         "rewards is a sequence of (address, weight), done an (address, mask, value) tuple,\n"
+                         "huge_pages backs the machines with transparent huge pages." },
+    { Py_tp_new, (void *)PyType_GenericNew },
+    { Py_tp_init, (void *)pythonEnvInit },
+    { Py_tp_dealloc, (void *)pythonEnvDealloc },
+    { Py_tp_methods, (void *)s_envMethods },
+    { Py_tp_getset, (void *)s_envGetSets },
+    { 0, NULL }
+};
+
+static PyType_Spec s_envSpec =
+{
+    "chip8.VecEnv", sizeof(pythonEnvType), 0, Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE, s_envSlots
+};
+
+static struct PyModuleDef s_module =
+{
+    PyModuleDef_HEAD_INIT, "chip8", "CHIP-8, SUPER-CHIP and XO-CHIP emulator", -1, NULL, NULL, NULL, NULL, NULL
+};
+
+/******************************************************************
+ * FUNCTION : PyInit_chip8()
+ *    Description: Module entry point
+ *    Parameters:  None
+ *    Return:      Module, NULL on error
+ ******************************************************************/
+PyMODINIT_FUNC PyInit_chip8(void)
+{
+    PyObject *module;
+    PyObject *machineType;
+    PyObject *envType;
+
+    module = PyModule_Create(&s_module);
+    if (NULL == module)
+    {
+        return NULL;
+    }
+
+    s_viewType = (PyTypeObject *)PyType_FromSpec(&s_viewSpec);
+    machineType = PyType_FromSpec(&s_machineSpec);
+    envType = PyType_FromSpec(&s_envSpec);
+
+    if ((NULL == s_viewType) || (NULL == machineType) || (NULL == envType)
+        || (0 != PyModule_AddObject(module, "Machine", machineType))
+        || (0 != PyModule_AddObject(module, "VecEnv", envType))
+        || (0 != PyModule_AddIntConstant(module, "PROFILE_VIP", E_CPU_PROFILE_VIP))
+        || (0 != PyModule_AddIntConstant(module, "PROFILE_SCHIP", E_CPU_PROFILE_SCHIP))
+        || (0 != PyModule_AddIntConstant(module, "PROFILE_XOCHIP", E_CPU_PROFILE_XOCHIP))
+        || (0 != PyModule_AddIntConstant(module, "STATUS_RUNNING", E_CPU_RUNNING))
+        || (0 != PyModule_AddIntConstant(module, "STATUS_EXITED", E_CPU_EXITED))
+        || (0 != PyModule_AddIntConstant(module, "STATUS_INVALID_OPCODE", E_CPU_INVALID_OPCODE))
+        || (0 != PyModule_AddIntConstant(module, "STATUS_STACK_OVERFLOW", E_CPU_STACK_OVERFLOW))
+        || (0 != PyModule_AddIntConstant(module, "STATUS_STACK_UNDERFLOW", E_CPU_STACK_UNDERFLOW)))
+    {
+        Py_XDECREF(envType);
+        Py_XDECREF(machineType);
+        Py_DECREF(module);
+        return NULL;
+    }
+
+    return module;
+}
+
+/******************************************************************
+ * FUNCTION : pythonView()
+ *    Description: Memoryview over storage of an owner, which is
+ *                 kept alive as long as the view
+ *    Parameters:  owner: object owning the storage
+ *                 data: first item
+ *                 format: struct module item format
+ *                 itemSize: item size in bytes
+ *                 dimensions, shape: array shape, C order
+ *                 outerStride: bytes between two items of the
+ *                              first dimension, 0 when packed
+ *    Return:      Memoryview, NULL on error
+ ******************************************************************/
+static PyObject * pythonView(PyObject *owner, void *data, const char *format, Py_ssize_t itemSize,
+                             int dimensions, const Py_ssize_t *shape, Py_ssize_t outerStride)
+{
+    pythonViewType *view;
+    PyObject *memoryView;
+    Py_ssize_t stride = itemSize;
+    int i;
+
+    view = PyObject_New(pythonViewType, s_viewType);
+    if (NULL == view)
+    {
+        return NULL;
+    }
+
+    Py_INCREF(owner);
+    view->owner = owner;
+    view->data = data;
+    view->format = format;
+    view->itemSize = itemSize;
+    view->dimensions = dimensions;
+
+    for (i = dimensions - 1; i >= 0; i--)
+    {
+        view->shape[i] = shape[i];
+        view->strides[i] = stride;
+        stride *= shape[i];
+    }
+
+    if (0 != outerStride)
+    {
+        view->strides[0] = outerStride;
+    }
+
+    memoryView = PyMemoryView_FromObject((PyObject *)view);
+    Py_DECREF(view);
+
+    return memoryView;
+}
+
+/******************************************************************
+ * FUNCTION : pythonViewGetBuffer()
+ *    Description: Buffer protocol export
+ *    Parameters:  self: view
+ *                 view: buffer to fill
+ *                 flags: consumer request
+ *    Return:      0, -1 on error
+ ******************************************************************/
+static int pythonViewGetBuffer(PyObject *self, Py_buffer *view, int flags)
+{
+    pythonViewType *source = (pythonViewType *)self;
+    Py_ssize_t length = source->itemSize;
+    Py_ssize_t packed = source->itemSize;
+    int i;
+
+    for (i = source->dimensions - 1; i > 0; i--)
+    {
+        packed *= source->shape[i];
+    }
+
+    /* Padded items can only be described with strides */
+    if ((packed != source->strides[0]) && (PyBUF_STRIDES != (flags & PyBUF_STRIDES)))
+    {
+        PyErr_SetString(PyExc_BufferError, "strided buffer");
+        view->obj = NULL;
+        return -1;
+    }
+
+    for (i = 0; i < source->dimensions; i++)
+    {
+        length *= source->shape[i];
+    }
+
+    view->buf = source->data;
+    view->obj = self;
+    Py_INCREF(self);
+    view->len = length;
+    view->readonly = 0;
+    view->itemsize = source->itemSize;
+    view->format = (0 != (flags & PyBUF_FORMAT)) ? (char *)source->format : NULL;
+    view->ndim = source->dimensions;
+    view->shape = (0 != (flags & PyBUF_ND)) ? source->shape : NULL;
+    view->strides = (PyBUF_STRIDES == (flags & PyBUF_STRIDES)) ? source->strides : NULL;
+    view->suboffsets = NULL;
+    view->internal = NULL;
+
+    return 0;
+}
+
+/******************************************************************
+ * FUNCTION : pythonViewDealloc()
+ *    Description: Release the owner
+ *    Parameters:  self: view
+ *    Return:      None
+ ******************************************************************/
+static void pythonViewDealloc(PyObject *self)
+{
+    PyTypeObject *type = Py_TYPE(self);
+
+    Py_DECREF(((pythonViewType *)self)->owner);
+    PyObject_Free(self);
+    Py_DECREF(type);
+}
+
+/******************************************************************
+ * FUNCTION : pythonRom()
+ *    Description: Rom bytes of a path or a bytes-like object
+ *    Parameters:  rom: str path or bytes-like object
+ *                 buffer: output, to release with PyBuffer_Release()
+ *                         when buffer->obj is not NULL
+ *                 size: output, rom size
+ *    Return:      Rom bytes, NULL with an exception set on error
+ ******************************************************************/
+static const U8 * pythonRom(PyObject *rom, Py_buffer *buffer, U32 *size)
+{
+    const U8 *data = NULL;
+    const char *path;
+
+    buffer->obj = NULL;
+
+    if (PyUnicode_Check(rom))
+    {
+        path = PyUnicode_AsUTF8(rom);
+        if (NULL != path)
+        {
+            data = ImportRomCached(path, size);
+            if (NULL == data)
+            {
+                PyErr_Format(PyExc_OSError, "unable to read %s", path);
+            }
+        }
+    }
+    else if (0 == PyObject_GetBuffer(rom, buffer, PyBUF_SIMPLE))
+    {
+        data = (const U8 *)buffer->buf;
+        *size = (U32)buffer->len;
+    }
+
+    return data;
+}
+
+/******************************************************************
+ * FUNCTION : pythonStart()
+ *    Description: Mark an object busy before the GIL is released
+ *    Parameters:  busy: busy flag of the object
+ *    Return:      TRUE if the caller may proceed, FALSE with an
+ *                 exception set otherwise
+ ******************************************************************/
+static BOOL pythonStart(BOOL *busy)
+{
+    if (FALSE != *busy)
+    {
+        PyErr_SetString(PyExc_RuntimeError, "already stepping in another thread");
+        return FALSE;
+    }
+
+    *busy = TRUE;
+
+    return TRUE;
+}
+
+/******************************************************************
+ * FUNCTION : pythonMachineInit()
+ *    Description: Machine(rom, profile, seed, instructions_per_frame)
+ *    Parameters:  self: machine
+ *                 args, kwargs: constructor arguments
+ *    Return:      0, -1 on error
+ ******************************************************************/
+static int pythonMachineInit(PyObject *self, PyObject *args, PyObject *kwargs)
+{
+    static const char *keywords[] = { "rom", "profile", "seed", "instructions_per_frame", NULL };
+    pythonMachineType *machine = (pythonMachineType *)self;
+    PyObject *rom;
+    Py_buffer buffer;
+    const U8 *data;
+    U32 size = 0U;
+    int profile = E_CPU_PROFILE_VIP;
+    unsigned long seed = 0UL;
+    unsigned long instructionsPerFrame = ENV_DEFAULT_INSTRUCTIONS_PER_FRAME;
+    Std_ReturnType loaded;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|ikk", (char **)keywords, &rom, &profile, &seed,
+                                     &instructionsPerFrame))
+    {
+        return -1;
+    }
+
+    if ((profile < 0) || (profile >= E_CPU_PROFILE_NUMBER))
+    {
+        PyErr_SetString(PyExc_ValueError, "unknown profile");
+        return -1;
+    }
+
+    if (FALSE != machine->busy)
+    {
+        PyErr_SetString(PyExc_RuntimeError, "already stepping in another thread");
+        return -1;
+    }
+
+    data = pythonRom(rom, &buffer, &size);
+    if (NULL == data)
+    {
+        return -1;
+    }
+
+    if (NULL == machine->initial)
+    {
+        machine->initial = (cpuType *)PyMem_Malloc(sizeof(cpuType));
+    }
+    if (NULL == machine->initialMemory)
+    {
+        machine->initialMemory = (U8 *)PyMem_Malloc(CPU_MAX_MEMORY_BYTES);
+    }
+
+    if ((NULL == machine->initial) || (NULL == machine->initialMemory))
+    {
+        loaded = E_NOT_OK;
+        PyErr_NoMemory();
+    }
+    else
+    {
+        (void)memset((void *)machine->keys, 0, sizeof(machine->keys));
+        CpuAttach(machine->initial, machine->initialMemory, &machine->screen, machine->keys);
+        CpuReset(machine->initial, (cpuProfileType)profile, (U32)seed);
+        loaded = CpuLoad(machine->initial, data, size);
+        if (E_OK != loaded)
+        {
+            PyErr_SetString(PyExc_ValueError, "rom does not fit in memory");
+        }
+    }
+
+    if (NULL != buffer.obj)
+    {
+        PyBuffer_Release(&buffer);
+    }
+
+    if (E_OK != loaded)
+    {
+        return -1;
+    }
+
+    machine->instructionsPerFrame = (0UL != instructionsPerFrame) ? (U32)instructionsPerFrame
+                                                                  : ENV_DEFAULT_INSTRUCTIONS_PER_FRAME;
+    machine->cpu.random = 0U;
+    pythonMachineRestart(machine);
+
+    return 0;
+}
+
+/******************************************************************
+ * FUNCTION : pythonMachineDealloc()
+ *    Description: Free a machine
+ *    Parameters:  self: machine
+ *    Return:      None
+ ******************************************************************/
+static void pythonMachineDealloc(PyObject *self)
+{
+    PyTypeObject *type = Py_TYPE(self);
+
+    PyMem_Free(((pythonMachineType *)self)->initial);
+    PyMem_Free(((pythonMachineType *)self)->initialMemory);
+    type->tp_free(self);
+    Py_DECREF(type);
+}
+
+/******************************************************************
+ * FUNCTION : pythonMachineRun()
+ *    Description: Run frames, called without the GIL
+ *    Parameters:  machine: machine
+ *                 frames: frames to run
+ *    Return:      None
+ ******************************************************************/
+static void pythonMachineRun(pythonMachineType *machine, U32 frames)
+{
+    U32 frame;
+
+    for (frame = 0U; (frame < frames) && (E_CPU_RUNNING == machine->cpu.status); frame++)
+    {
+        (void)CpuRun(&machine->cpu, machine->instructionsPerFrame);
+        CpuTimers(&machine->cpu);
+    }
+}
+
+/******************************************************************
+ * FUNCTION : pythonMachineStep()
+ *    Description: Machine.step(frames=1)
+ *    Parameters:  self: machine
+ *                 args, kwargs: frames
+ *    Return:      True while the program runs, NULL on error
+ ******************************************************************/
+static PyObject * pythonMachineStep(PyObject *self, PyObject *args, PyObject *kwargs)
+{
+    static const char *keywords[] = { "frames", NULL };
+    pythonMachineType *machine = (pythonMachineType *)self;
+    unsigned long frames = 1UL;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|k", (char **)keywords, &frames))
+    {
+        return NULL;
+    }
+
+    if (NULL == machine->initial)
+    {
+        PyErr_SetString(PyExc_RuntimeError, "machine not initialized");
+        return NULL;
+    }
+
+    if (FALSE == pythonStart(&machine->busy))
+    {
+        return NULL;
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    pythonMachineRun(machine, (U32)frames);
+    Py_END_ALLOW_THREADS
+
+    machine->busy = FALSE;
+
+    return PyBool_FromLong(E_CPU_RUNNING == machine->cpu.status);
+}
+
+/******************************************************************
+ * FUNCTION : pythonMachineRestart()
+ *    Description: Restore the rom load state, the random generator
+ *                 keeps running
+ *    Parameters:  machine: machine
+ *    Return:      None
+ ******************************************************************/
+static void pythonMachineRestart(pythonMachineType *machine)
+{
+    U32 random = machine->cpu.random;
+
+    CpuAttach(&machine->cpu, machine->memory, &machine->screen, machine->keys);
+    CpuCopy(&machine->cpu, machine->initial);
+    DisplayReset(&machine->screen);
+
+    if (0U != random)
+    {
+        machine->cpu.random = random;
+    }
+}
+
+/******************************************************************
+ * FUNCTION : pythonMachineReset()
+ *    Description: Machine.reset()
+ *    Parameters:  self: machine
+ *                 unused: None
+ *    Return:      None, NULL on error
+ ******************************************************************/
+static PyObject * pythonMachineReset(PyObject *self, PyObject *unused)
+{
+    pythonMachineType *machine = (pythonMachineType *)self;
+
+    (void)unused;
+
+    if ((NULL == machine->initial) || (FALSE != machine->busy))
+    {
+        PyErr_SetString(PyExc_RuntimeError, "machine not initialized or stepping");
+        return NULL;
+    }
+
+    pythonMachineRestart(machine);
+
+    Py_RETURN_NONE;
+}
+
+/******************************************************************
+ * FUNCTION : pythonMachineSaveState()
+ *    Description: Machine.save_state()
+ *    Parameters:  self: machine
+ *                 unused: None
+ *    Return:      State bytes, NULL on error
+ ******************************************************************/
+static PyObject * pythonMachineSaveState(PyObject *self, PyObject *unused)
+{
+    pythonMachineType *machine = (pythonMachineType *)self;
+    PyObject *state;
+    char *data;
+    U32 magic = PYTHON_STATE_MAGIC;
+    U32 size = sizeof(pythonStateType);
+
+    (void)unused;
+
+    state = PyBytes_FromStringAndSize(NULL, sizeof(pythonStateType));
+    if (NULL == state)
+    {
+        return NULL;
+    }
+
+    /* Bytes objects are not aligned for the screen rows */
+    data = PyBytes_AS_STRING(state);
+    (void)memset((void *)data, 0, sizeof(pythonStateType));
+    (void)memcpy((void *)&data[offsetof(pythonStateType, magic)], (const void *)&magic, sizeof(magic));
+    (void)memcpy((void *)&data[offsetof(pythonStateType, size)], (const void *)&size, sizeof(size));
+    (void)memcpy((void *)&data[offsetof(pythonStateType, cpu)], (const void *)&machine->cpu, sizeof(cpuType));
+    (void)memcpy((void *)&data[offsetof(pythonStateType, screen)], (const void *)&machine->screen,
+                 sizeof(displayScreenType));
+    (void)memcpy((void *)&data[offsetof(pythonStateType, memory)], (const void *)machine->memory,
+                 CPU_MEMORY_BYTES(machine->cpu.profile));
+
+    return state;
+}
+
+/******************************************************************
+ * FUNCTION : pythonMachineLoadState()
+ *    Description: Machine.load_state(state)
+ *    Parameters:  self: machine
+ *                 state: save_state() result
+ *    Return:      None, NULL on error
+ ******************************************************************/
+static PyObject * pythonMachineLoadState(PyObject *self, PyObject *state)
+{
+    pythonMachineType *machine = (pythonMachineType *)self;
+    Py_buffer buffer;
+    const char *data;
+    cpuType saved;
+    U32 magic;
+    U32 size;
+
+    if (FALSE != machine->busy)
+    {
+        PyErr_SetString(PyExc_RuntimeError, "already stepping in another thread");
+        return NULL;
+    }
+
+    if (0 != PyObject_GetBuffer(state, &buffer, PyBUF_SIMPLE))
+    {
+        return NULL;
+    }
+
+    data = (const char *)buffer.buf;
+    if ((Py_ssize_t)sizeof(pythonStateType) != buffer.len)
+    {
+        PyBuffer_Release(&buffer);
+        PyErr_SetString(PyExc_ValueError, "state size mismatch");
+        return NULL;
+    }
+
+    (void)memcpy((void *)&magic, (const void *)&data[offsetof(pythonStateType, magic)], sizeof(magic));
+    (void)memcpy((void *)&size, (const void *)&data[offsetof(pythonStateType, size)], sizeof(size));
+    if ((PYTHON_STATE_MAGIC != magic) || (sizeof(pythonStateType) != size))
+    {
+        PyBuffer_Release(&buffer);
+        PyErr_SetString(PyExc_ValueError, "not a state of this build");
+        return NULL;
+    }
+
+    /* The saved cpu reads its memory from the state, see CpuCopy() */
+    (void)memcpy((void *)&saved, (const void *)&data[offsetof(pythonStateType, cpu)], sizeof(cpuType));
+    saved.memory = (U8 *)&data[offsetof(pythonStateType, memory)];
+    CpuAttach(&machine->cpu, machine->memory, &machine->screen, machine->keys);
+    CpuCopy(&machine->cpu, &saved);
+    (void)memcpy((void *)&machine->screen, (const void *)&data[offsetof(pythonStateType, screen)],
+                 sizeof(displayScreenType));
+    PyBuffer_Release(&buffer);
+
+    Py_RETURN_NONE;
+}
+
+/******************************************************************
+ * FUNCTION : pythonMachineGetScreen()
+ *    Description: Machine.screen
+ *    Parameters:  self: machine
+ *                 closure: None
+ *    Return:      View, NULL on error
+ ******************************************************************/
+static PyObject * pythonMachineGetScreen(PyObject *self, void *closure)
+{
+    static const Py_ssize_t shape[3U] = { DISPLAY_PLANES, DISPLAY_HIRES_HEIGHT, PYTHON_SCREEN_WORDS };
+    pythonMachineType *machine = (pythonMachineType *)self;
+
+    (void)closure;
+
+    return pythonView(self, (void *)machine->screen.rows, "Q", sizeof(U64), 3, shape, 0);
+}
+
+/******************************************************************
+ * FUNCTION : pythonMachineGetMemory()
+ *    Description: Machine.memory, sized for the profile
+ *    Parameters:  self: machine
+ *                 closure: None
+ *    Return:      View, NULL on error
+ ******************************************************************/
+static PyObject * pythonMachineGetMemory(PyObject *self, void *closure)
+{
+    pythonMachineType *machine = (pythonMachineType *)self;
+    Py_ssize_t shape = (Py_ssize_t)CPU_ADDRESS_SPACE(machine->cpu.profile);
+
+    (void)closure;
+
+    return pythonView(self, (void *)machine->memory, "B", 1, 1, &shape, 0);
+}
+
+/******************************************************************
+ * FUNCTION : pythonMachineGetVx()
+ *    Description: Machine.v
+ *    Parameters:  self: machine
+ *                 closure: None
+ *    Return:      View, NULL on error
+ ******************************************************************/
+static PyObject * pythonMachineGetVx(PyObject *self, void *closure)
+{
+    static const Py_ssize_t shape = CPU_NUMBER_OF_VX_REGISTER;
+    pythonMachineType *machine = (pythonMachineType *)self;
+
+    (void)closure;
+
+    return pythonView(self, (void *)machine->cpu.vx, "B", 1, 1, &shape, 0);
+}
+
+/******************************************************************
+ * FUNCTION : pythonMachineGetRegister()
+ *    Description: Machine.pc, i, delay and sound
+ *    Parameters:  self: machine
+ *                 closure: pythonRegisterType
+ *    Return:      Register value
+ ******************************************************************/
+static PyObject * pythonMachineGetRegister(PyObject *self, void *closure)
+{
+    pythonMachineType *machine = (pythonMachineType *)self;
+    unsigned long value;
+
+    switch ((pythonRegisterType)(size_t)closure)
+    {
+        case E_PYTHON_REGISTER_PC:
+            value = machine->cpu.pc;
+            break;
+        case E_PYTHON_REGISTER_I:
+            value = machine->cpu.i;
+            break;
+        case E_PYTHON_REGISTER_DELAY:
+            value = machine->cpu.sysCounter;
+            break;
+        default:
+            value = machine->cpu.soundCounter;
+            break;
+    }
+
+    return PyLong_FromUnsignedLong(value);
+}
+
+/******************************************************************
+ * FUNCTION : pythonMachineSetRegister()
+ *    Description: Machine.pc, i, delay and sound assignment
+ *    Parameters:  self: machine
+ *                 value: new value
+ *                 closure: pythonRegisterType
+ *    Return:      0, -1 on error
+ ******************************************************************/
+static int pythonMachineSetRegister(PyObject *self, PyObject *value, void *closure)
+{
+    pythonMachineType *machine = (pythonMachineType *)self;
+    pythonRegisterType reg = (pythonRegisterType)(size_t)closure;
+    unsigned long number;
+    unsigned long maximum = ((E_PYTHON_REGISTER_PC == reg) || (E_PYTHON_REGISTER_I == reg))
+                                ? (CPU_ADDRESS_SPACE(machine->cpu.profile) - 1UL) : 0xFFUL;
+
+    if ((NULL == value) || (FALSE != machine->busy))
+    {
+        PyErr_SetString(PyExc_AttributeError, "register cannot be deleted or set while stepping");
+        return -1;
+    }
+
+    number = PyLong_AsUnsignedLong(value);
+    if (PyErr_Occurred())
+    {
+        return -1;
+    }
+    if (number > maximum)
+    {
+        PyErr_SetString(PyExc_OverflowError, "register value out of range");
+        return -1;
+    }
+
+    switch (reg)
+    {
+        case E_PYTHON_REGISTER_PC:
+            machine->cpu.pc = (U16)number;
+            break;
+        case E_PYTHON_REGISTER_I:
+            machine->cpu.i = (U16)number;
+            break;
+        case E_PYTHON_REGISTER_DELAY:
+            machine->cpu.sysCounter = (U8)number;
+            break;
+        default:
+            machine->cpu.soundCounter = (U8)number;
+            break;
+    }
+
+    return 0;
+}
+
+/******************************************************************
+ * FUNCTION : pythonMachineGetKeys()
+ *    Description: Machine.keys
+ *    Parameters:  self: machine
+ *                 closure: None
+ *    Return:      Key mask
+ ******************************************************************/
+static PyObject * pythonMachineGetKeys(PyObject *self, void *closure)
+{
+    pythonMachineType *machine = (pythonMachineType *)self;
+    unsigned long mask = 0UL;
+    U8 key;
+
+    (void)closure;
+
+    for (key = 0U; key < INPUT_NUMBER_OF_KEYBOARD_KEYS; key++)
+    {
+        if (FALSE != machine->keys[key])
+        {
+            mask |= 1UL << key;
+        }
+    }
+
+    return PyLong_FromUnsignedLong(mask);
+}
+
+/******************************************************************
+ * FUNCTION : pythonMachineSetKeys()
+ *    Description: Machine.keys assignment
+ *    Parameters:  self: machine
+ *                 value: key mask
+ *                 closure: None
+ *    Return:      0, -1 on error
+ ******************************************************************/
+static int pythonMachineSetKeys(PyObject *self, PyObject *value, void *closure)
+{
+    pythonMachineType *machine = (pythonMachineType *)self;
+    unsigned long mask;
+    U8 key;
+
+    (void)closure;
+
+    if (NULL == value)
+    {
+        PyErr_SetString(PyExc_AttributeError, "keys cannot be deleted");
+        return -1;
+    }
+
+    mask = PyLong_AsUnsignedLong(value);
+    if (PyErr_Occurred())
+    {
+        return -1;
+    }
+
+    for (key = 0U; key < INPUT_NUMBER_OF_KEYBOARD_KEYS; key++)
+    {
+        machine->keys[key] = (BOOL)((mask >> key) & 1UL);
+    }
+
+    return 0;
+}
+
+/******************************************************************
+ * FUNCTION : pythonMachineGetStatus()
+ *    Description: Machine.status
+ *    Parameters:  self: machine
+ *                 closure: None
+ *    Return:      Status
+ ******************************************************************/
+static PyObject * pythonMachineGetStatus(PyObject *self, void *closure)
+{
+    (void)closure;
+
+    return PyLong_FromLong(((pythonMachineType *)self)->cpu.status);
+}
+
+/******************************************************************
+ * FUNCTION : pythonEnvInit()
+ *    Description: VecEnv(rom, count, ...), see s_envSlots
+ *    Parameters:  self: environment
+ *                 args, kwargs: constructor arguments
+ *    Return:      0, -1 on error
+ ******************************************************************/
+static int pythonEnvInit(PyObject *self, PyObject *args, PyObject *kwargs)
+{
+    static const char *keywords[] = { "rom", "count", "profile", "threads", "seed", "instructions_per_frame",
+                                      "max_episode_frames", "rewards", "done", "huge_pages", NULL };
+    pythonEnvType *env = (pythonEnvType *)self;
+    envConfigType config;
+    PyObject *rom;
+    PyObject *rewards = NULL;
+    PyObject *done = Py_None;
+    PyObject *sequence;
+    PyObject *item;
+    Py_buffer buffer;
+    const U8 *data;
+    U32 size = 0U;
+    unsigned long count;
+    int profile = E_CPU_PROFILE_VIP;
+    unsigned long threads = 1UL;
+    unsigned long seed = 0UL;
+    unsigned long instructionsPerFrame = 0UL;
+    unsigned long maxEpisodeFrames = 0UL;
+    int hugePages = 0;
+    unsigned int address;
+    long weight;
+    unsigned int mask;
+    unsigned int value;
+    Py_ssize_t i;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "Ok|ikkkkOOp", (char **)keywords, &rom, &count, &profile,
+                                     &threads, &seed, &instructionsPerFrame, &maxEpisodeFrames, &rewards, &done,
+                                     &hugePages))
+    {
+        return -1;
+    }
+
+    if ((profile < 0) || (profile >= E_CPU_PROFILE_NUMBER) || (0UL == count))
+    {
+        PyErr_SetString(PyExc_ValueError, "unknown profile or no machine");
+        return -1;
+    }
+
+    if (FALSE != env->busy)
+    {
+        PyErr_SetString(PyExc_RuntimeError, "already stepping in another thread");
+        return -1;
+    }
+
+    (void)memset((void *)&config, 0, sizeof(config));
+    config.profile = (cpuProfileType)profile;
+    config.threads = (U32)threads;
+    config.seed = (U32)seed;
+    config.instructionsPerFrame = (U32)instructionsPerFrame;
+    config.maxEpisodeFrames = (U32)maxEpisodeFrames;
+    config.hugePages = (0 != hugePages) ? TRUE : FALSE;
+
+    if (NULL != rewards)
+    {
+        sequence = PySequence_Fast(rewards, "rewards must be a sequence of (address, weight)");
+        if (NULL == sequence)
+        {
+            return -1;
+        }
+        if (PySequence_Fast_GET_SIZE(sequence) > (Py_ssize_t)ENV_MAX_REWARDS)
+        {
+            Py_DECREF(sequence);
+            PyErr_Format(PyExc_ValueError, "at most %u reward addresses", ENV_MAX_REWARDS);
+            return -1;
+        }
+        for (i = 0; i < PySequence_Fast_GET_SIZE(sequence); i++)
+        {
+            item = PySequence_Fast_GET_ITEM(sequence, i);
+            if (!PyArg_ParseTuple(item, "Il", &address, &weight) || (address > 0xFFFFU))
+            {
+                Py_DECREF(sequence);
+                if (!PyErr_Occurred())
+                {
+                    PyErr_SetString(PyExc_ValueError, "reward address out of range");
+                }
+                return -1;
+            }
+            config.rewards[i].address = (U16)address;
+            config.rewards[i].weight = (S32)weight;
+        }
+        config.rewardCount = (U8)PySequence_Fast_GET_SIZE(sequence);
+        Py_DECREF(sequence);
+    }
+
+    if (Py_None != done)
+    {
+        if (!PyArg_ParseTuple(done, "III", &address, &mask, &value) || (address > 0xFFFFU))
+        {
+            if (!PyErr_Occurred())
+            {
+                PyErr_SetString(PyExc_ValueError, "done address out of range");
+            }
+            return -1;
+        }
+        config.doneAddress = (U16)address;
+        config.doneMask = (U8)mask;
+        config.doneValue = (U8)value;
+    }
+
+    pythonEnvFree(env);
+    env->count = (U32)count;
+    env->observations = (displayScreenType *)PyMem_Calloc(count, sizeof(displayScreenType));
+    env->rewards = (S32 *)PyMem_Calloc(count, sizeof(S32));
+    env->dones = (U8 *)PyMem_Calloc(count, sizeof(U8));
+    env->actions = (U16 *)PyMem_Calloc(count, sizeof(U16));
+    if ((NULL == env->observations) || (NULL == env->rewards) || (NULL == env->dones) || (NULL == env->actions))
+    {
+        pythonEnvFree(env);
+        PyErr_NoMemory();
+        return -1;
+    }
+
+    data = pythonRom(rom, &buffer, &size);
+    if (NULL == data)
+    {
+        pythonEnvFree(env);
+        return -1;
+    }
+
+    env->env = EnvCreate(data, size, env->count, &config, env->observations, env->rewards, env->dones);
+
+    if (NULL != buffer.obj)
+    {
+        PyBuffer_Release(&buffer);
+    }
+
+    if (NULL == env->env)
+    {
+        pythonEnvFree(env);
+        PyErr_SetString(PyExc_ValueError, "unable to create the environment");
+        return -1;
+    }
+
+    return 0;
+}
+
+/******************************************************************
+ * FUNCTION : pythonEnvFree()
+ *    Description: Free the environment and its arrays
+ *    Parameters:  env: environment object
+ *    Return:      None
+ ******************************************************************/
+static void pythonEnvFree(pythonEnvType *env)
+{
+    EnvDestroy(env->env);
+    PyMem_Free(env->observations);
+    PyMem_Free(env->rewards);
+    PyMem_Free(env->dones);
+    PyMem_Free(env->actions);
+    env->env = NULL;
+    env->observations = NULL;
+    env->rewards = NULL;
+    env->dones = NULL;
+    env->actions = NULL;
+    env->count = 0U;
+}
+
+/******************************************************************
+ * FUNCTION : pythonEnvDealloc()
+ *    Description: Free an environment object
+ *    Parameters:  self: environment
+ *    Return:      None
+ ******************************************************************/
+static void pythonEnvDealloc(PyObject *self)
+{
+    PyTypeObject *type = Py_TYPE(self);
+
+    pythonEnvFree((pythonEnvType *)self);
+    type->tp_free(self);
+    Py_DECREF(type);
+}
+
+/******************************************************************
+ * FUNCTION : pythonEnvStep()
+ *    Description: VecEnv.step(actions, frames=1). A contiguous
+ *                 uint16 buffer of count actions is used in place,
+ *                 any other sequence of ints is converted.
+ *    Parameters:  self: environment
+ *                 args, kwargs: actions, frames
+ *    Return:      None, NULL on error
+ ******************************************************************/
+static PyObject * pythonEnvStep(PyObject *self, PyObject *args, PyObject *kwargs)
+{
+    static const char *keywords[] = { "actions", "frames", NULL };
+    pythonEnvType *env = (pythonEnvType *)self;
+    PyObject *actions;
+    PyObject *sequence;
+    Py_buffer buffer;
+    const U16 *data = env->actions;
+    unsigned long frames = 1UL;
+    unsigned long mask;
+    Py_ssize_t i;
+
+    buffer.obj = NULL;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|k", (char **)keywords, &actions, &frames))
+    {
+        return NULL;
+    }
+
+    if (NULL == env->env)
+    {
+        PyErr_SetString(PyExc_RuntimeError, "environment not initialized");
+        return NULL;
+    }
+
+    if ((0 == PyObject_GetBuffer(actions, &buffer, PyBUF_FORMAT | PyBUF_C_CONTIGUOUS))
+        && (sizeof(U16) == buffer.itemsize) && ((Py_ssize_t)(env->count * sizeof(U16)) == buffer.len)
+        && (NULL != buffer.format) && (NULL != strchr("Hh", buffer.format[strlen(buffer.format) - 1U])))
+    {
+        data = (const U16 *)buffer.buf;
+    }
+    else
+    {
+        if (NULL != buffer.obj)
+        {
+            PyBuffer_Release(&buffer);
+            buffer.obj = NULL;
+        }
+        PyErr_Clear();
+
+        sequence = PySequence_Fast(actions, "actions must be a sequence of key masks");
+        if (NULL == sequence)
+        {
+            return NULL;
+        }
+        if ((Py_ssize_t)env->count != PySequence_Fast_GET_SIZE(sequence))
+        {
+            Py_DECREF(sequence);
+            PyErr_SetString(PyExc_ValueError, "one action per machine is expected");
+            return NULL;
+        }
+        for (i = 0; i < (Py_ssize_t)env->count; i++)
+        {
+            mask = PyLong_AsUnsignedLong(PySequence_Fast_GET_ITEM(sequence, i));
+            if (PyErr_Occurred())
+            {
+                Py_DECREF(sequence);
+                return NULL;
+            }
+            env->actions[i] = (U16)mask;
+        }
+        Py_DECREF(sequence);
+    }
+
+    if (FALSE == pythonStart(&env->busy))
+    {
+        if (NULL != buffer.obj)
+        {
+            PyBuffer_Release(&buffer);
+        }
+        return NULL;
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    EnvStep(env->env, data, (U32)frames);
+    Py_END_ALLOW_THREADS
+
+    env->busy = FALSE;
+    if (NULL != buffer.obj)
+    {
+        PyBuffer_Release(&buffer);
+    }
+
+    Py_RETURN_NONE;
+}
+
+/******************************************************************
+ * FUNCTION : pythonEnvReset()
+ *    Description: VecEnv.reset()
+ *    Parameters:  self: environment
+ *                 unused: None
+ *    Return:      None, NULL on error
+ ******************************************************************/
+static PyObject * pythonEnvReset(PyObject *self, PyObject *unused)
+{
+    pythonEnvType *env = (pythonEnvType *)self;
+
+    (void)unused;
+
+    if ((NULL == env->env) || (FALSE != env->busy))
+    {
+        PyErr_SetString(PyExc_RuntimeError, "environment not initialized or stepping");
+        return NULL;
+    }
+
+    EnvReset(env->env);
+
+    Py_RETURN_NONE;
+}
+
+/******************************************************************
+ * FUNCTION : pythonEnvGetObservations()
+ *    Description: VecEnv.observations. Each observation is a
+ *                 screen with its width, height and plane selection
+ *                 after the rows, so the view steps over them.
+ *    Parameters:  self: environment
+ *                 closure: None
+ *    Return:      View, NULL on error
+ ******************************************************************/
+static PyObject * pythonEnvGetObservations(PyObject *self, void *closure)
+{
+    pythonEnvType *env = (pythonEnvType *)self;
+    Py_ssize_t shape[4U] = { 0, DISPLAY_PLANES, DISPLAY_HIRES_HEIGHT, PYTHON_SCREEN_WORDS };
+
+    (void)closure;
+
+    shape[0U] = env->count;
+
+    return pythonView(self, (void *)env->observations, "Q", sizeof(U64), 4, shape, sizeof(displayScreenType));
+}
+
+/******************************************************************
+ * FUNCTION : pythonEnvGetRewards()
+ *    Description: VecEnv.rewards
+ *    Parameters:  self: environment
+ *                 closure: None
+ *    Return:      View, NULL on error
+ ******************************************************************/
+static PyObject * pythonEnvGetRewards(PyObject *self, void *closure)
+{
+    pythonEnvType *env = (pythonEnvType *)self;
+    Py_ssize_t shape = env->count;
+
+    (void)closure;
+
+    /* S32 is a long, "l" follows its native size */
+    return pythonView(self, (void *)env->rewards, "l", sizeof(S32), 1, &shape, 0);
+}
+
+/******************************************************************
+ * FUNCTION : pythonEnvGetDones()
+ *    Description: VecEnv.dones
+ *    Parameters:  self: environment
+ *                 closure: None
+ *    Return:      View, NULL on error
+ ******************************************************************/
+static PyObject * pythonEnvGetDones(PyObject *self, void *closure)
+{
+    pythonEnvType *env = (pythonEnvType *)self;
+    Py_ssize_t shape = env->count;
+
+    (void)closure;
+
+    return pythonView(self, (void *)env->dones, "B", 1, 1, &shape, 0);
+}
+
+/******************************************************************
+ * FUNCTION : pythonEnvGetCount()
+ *    Description: VecEnv.count
+ *    Parameters:  self: environment
+ *                 closure: None
+ *    Return:      Number of machines
+ ******************************************************************/
+static PyObject * pythonEnvGetCount(PyObject *self, void *closure)
+{
+    (void)closure;
+
+    return PyLong_FromUnsignedLong(((pythonEnvType *)self)->count);
+}
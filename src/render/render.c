@@ -0,0 +1,217 @@
+/******************************************************************
+ *
+ *
+ * FILE        : render.c
+ * PROJECT     : chip8
+ * AUTHOR      : danpham
+ * DESCRIPTION : Render stage.
+ *
+ *               RenderFrame() turns the planes into palette colors
+ *               at 128x64 and keeps, channel by channel, the
+ *               brighter of the new color and the decayed previous
+ *               one. RenderScale() expands each pixel into a
+ *               scale x scale block: a row is expanded once with
+ *               vector stores, then copied down. Both work on
+ *               RENDER_LANES pixels per vector operation, which
+ *               the compiler maps onto SSE2, or AVX2 with -mavx2.
+ *
+ ******************************************************************/
+
+/******************************************************************
+ * 1. Included files (microcontroller ones then user defined ones)
+ ******************************************************************/
+#include <string.h>
+#include "render.h"
+#include "../display/display.h"
+
+/******************************************************************
+ * 2. Define declarations (macros then function macros)
+ ******************************************************************/
+#define RENDER_OPAQUE                                    0xFF000000UL
+
+/******************************************************************
+ * 3. Typedef definitions (simple typedef, then enum and structs)
+ ******************************************************************/
+/* RENDER_LANES pixels, loads and stores need not be aligned */
+typedef Uint32 renderPixelsType __attribute__((vector_size(4U * RENDER_LANES), aligned(4)));
+
+/* The same pixels as bytes, then widened for the decay product */
+typedef U8 renderBytesType __attribute__((vector_size(4U * RENDER_LANES), aligned(4)));
+typedef U16 renderChannelsType __attribute__((vector_size(8U * RENDER_LANES)));
+
+/******************************************************************
+ * 4. Variable definitions (static then global)
+ ******************************************************************/
+
+/******************************************************************
+ * 5. Functions prototypes (static only)
+ ******************************************************************/
+static void renderColors(const renderType *render, const displayScreenType *screen, U32 y, Uint32 *colors);
+static void renderExpand(const Uint32 *pixels, Uint32 *out, U32 scale);
+
+/******************************************************************
+ * FUNCTION : RenderInit()
+ *    Description: Start from a black image
+ *    Parameters:  render: render stage
+ *                 persistence: brightness kept per frame out of
+ *                              256, RENDER_PERSISTENCE_OFF for none
+ *    Return:      None
+ ******************************************************************/
+void RenderInit(renderType *render, U16 persistence)
+{
+    static const U32 palette[DISPLAY_COLORS] = DISPLAY_PALETTE;
+    U8 color;
+
+    for (color = 0U; color < DISPLAY_COLORS; color++)
+    {
+        render->palette[color] = (Uint32)(RENDER_OPAQUE | palette[color]);
+    }
+
+    (void)memset(render->pixels, 0, sizeof(render->pixels));
+    render->persistence = (persistence > 255U) ? 255U : persistence;
+}
+
+/******************************************************************
+ * FUNCTION : RenderFrame()
+ *    Description: Render a screen over the previous image
+ *    Parameters:  render: render stage
+ *                 screen: screen planes
+ *    Return:      TRUE if the image changed, FALSE once a still
+ *                 screen has fully settled
+ ******************************************************************/
+BOOL RenderFrame(renderType *render, const displayScreenType *screen)
+{
+    Uint32 colors[RENDER_WIDTH];
+    renderChannelsType decayed;
+    renderBytesType target;
+    renderBytesType previous;
+    renderBytesType result;
+    renderPixelsType changed = { 0U };
+    Uint32 *pixels;
+    U32 x;
+    U32 y;
+    U8 lane;
+
+    for (y = 0U; y < RENDER_HEIGHT; y++)
+    {
+        renderColors(render, screen, y, colors);
+        pixels = render->pixels[y];
+
+        for (x = 0U; x < RENDER_WIDTH; x += RENDER_LANES)
+        {
+            target = *(const renderBytesType *)&colors[x];
+            previous = *(const renderBytesType *)&pixels[x];
+
+            /* Brighter of the new and the decayed color, the alpha
+             * channel stays opaque since the new one is */
+            decayed = (__builtin_convertvector(previous, renderChannelsType) * render->persistence) >> 8U;
+            result = __builtin_convertvector(decayed, renderBytesType);
+            result = (target > result) ? target : result;
+
+            changed |= (renderPixelsType)(result ^ previous);
+            *(renderBytesType *)&pixels[x] = result;
+        }
+    }
+
+    for (lane = 1U; lane < RENDER_LANES; lane++)
+    {
+        changed[0U] |= changed[lane];
+    }
+
+    return (0U != changed[0U]) ? TRUE : FALSE;
+}
+
+/******************************************************************
+ * FUNCTION : RenderScale()
+ *    Description: Nearest neighbour upscale of the image
+ *    Parameters:  render: render stage
+ *                 out: RENDER_WIDTH * scale by RENDER_HEIGHT *
+ *                      scale ARGB pixels
+ *                 pitch: pixels from one out row to the next
+ *                 scale: integer pixel scale
+ *    Return:      None
+ ******************************************************************/
+void RenderScale(const renderType *render, Uint32 *out, U32 pitch, U32 scale)
+{
+    Uint32 *row;
+    U32 y;
+    U32 copy;
+
+    for (y = 0U; y < RENDER_HEIGHT; y++)
+    {
+        row = &out[(size_t)y * scale * pitch];
+        renderExpand(render->pixels[y], row, scale);
+
+        for (copy = 1U; copy < scale; copy++)
+        {
+            (void)memcpy(&row[(size_t)copy * pitch], row, RENDER_WIDTH * scale * sizeof(Uint32));
+        }
+    }
+}
+
+/******************************************************************
+ * FUNCTION : renderColors()
+ *    Description: Palette colors of one image row
+ *    Parameters:  render: render stage
+ *                 screen: screen planes
+ *                 y: image row
+ *                 colors: RENDER_WIDTH colors, filled
+ *    Return:      None
+ ******************************************************************/
+static void renderColors(const renderType *render, const displayScreenType *screen, U32 y, Uint32 *colors)
+{
+    /* Low resolution pixels cover 2x2 image pixels */
+    U32 shift = (DISPLAY_WIDTH == screen->width) ? 1U : 0U;
+    const displayRowType *plane0 = &screen->rows[0U][y >> shift];
+    const displayRowType *plane1 = &screen->rows[1U][y >> shift];
+    U32 x;
+    U32 source;
+
+    if (0U == ((*plane0)[0U] | (*plane0)[1U] | (*plane1)[0U] | (*plane1)[1U]))
+    {
+        for (x = 0U; x < RENDER_WIDTH; x++)
+        {
+            colors[x] = render->palette[0U];
+        }
+        return;
+    }
+
+    for (x = 0U; x < RENDER_WIDTH; x++)
+    {
+        source = x >> shift;
+        colors[x] = render->palette[DISPLAY_ROW_PIXEL(*plane0, source) | (DISPLAY_ROW_PIXEL(*plane1, source) << 1U)];
+    }
+}
+
+/******************************************************************
+ * FUNCTION : renderExpand()
+ *    Description: Repeat each pixel of a row scale times
+ *    Parameters:  pixels: RENDER_WIDTH pixels
+ *                 out: RENDER_WIDTH * scale pixels
+ *                 scale: integer pixel scale
+ *    Return:      None
+ ******************************************************************/
+static void renderExpand(const Uint32 *pixels, Uint32 *out, U32 scale)
+{
+    renderPixelsType zero = { 0U };
+    renderPixelsType block;
+    U32 x;
+    U32 i;
+
+    for (x = 0U; x < RENDER_WIDTH; x++)
+    {
+        block = zero + pixels[x];
+
+        for (i = 0U; (i + RENDER_LANES) <= scale; i += RENDER_LANES)
+        {
+            *(renderPixelsType *)&out[i] = block;
+        }
+
+        for (; i < scale; i++)
+        {
+            out[i] = pixels[x];
+        }
+
+        out += scale;
+    }
+}
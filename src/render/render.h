@@ -0,0 +1,59 @@
+/******************************************************************
+ *
+ *
+ * FILE        : render.h
+ * PROJECT     : chip8
+ * AUTHOR      : danpham
+ * DESCRIPTION : Render stage shared by the window and the frame
+ *               dumps: screen planes to ARGB with phosphor
+ *               persistence, then integer upscale
+ *
+ ******************************************************************/
+#ifndef RENDER_H_
+#define RENDER_H_
+
+/******************************************************************
+ * 1. Included files (microcontroller ones then user defined ones)
+ ******************************************************************/
+#include <SDL2/SDL.h>
+#include "../headers/typedef.h"
+#include "../display/display.h"
+
+/******************************************************************
+ * 2. Define declarations (macros then function macros)
+ ******************************************************************/
+/* Rendered image, low resolution pixels are twice as large */
+#define RENDER_WIDTH                               DISPLAY_HIRES_WIDTH
+#define RENDER_HEIGHT                             DISPLAY_HIRES_HEIGHT
+
+/* Share of the previous brightness kept each frame, out of 256. A
+ * pixel erased then drawn again by the next frame only dims, which
+ * hides the flicker of XOR redraws. 0 turns persistence off. */
+#define RENDER_PERSISTENCE                                      160U
+#define RENDER_PERSISTENCE_OFF                                    0U
+
+/* Pixels handled at once, one AVX2 register */
+#define RENDER_LANES                                              8U
+
+/******************************************************************
+ * 3. Typedef definitions (simple typedef, then enum and structs)
+ ******************************************************************/
+typedef struct
+{
+    Uint32 pixels[RENDER_HEIGHT][RENDER_WIDTH]; /* 0xAARRGGBB as displayed, 32 bits like texture pixels */
+    Uint32 palette[DISPLAY_COLORS];             /* 0xAARRGGBB of each plane combination */
+    U16 persistence;                            /* Out of 256 */
+} renderType;
+
+/******************************************************************
+ * 4. Variable definitions (static then global)
+ ******************************************************************/
+
+/******************************************************************
+ * 5. Functions prototypes (static only)
+ ******************************************************************/
+extern void RenderInit(renderType *render, U16 persistence);
+extern BOOL RenderFrame(renderType *render, const displayScreenType *screen);
+extern void RenderScale(const renderType *render, Uint32 *out, U32 pitch, U32 scale);
+
+#endif /* RENDER_H_ */
@@ -0,0 +1,408 @@
+/******************************************************************
+ *
+ *
+ * FILE        : shm.c
+ * PROJECT     : chip8
+ * AUTHOR      : danpham
+ * DESCRIPTION : Shared memory export of machine states.
+ *
+ *               Each slot is a seqlock: the emulator makes the
+ *               sequence odd, copies the state and makes it even
+ *               again, without ever waiting on readers. Readers
+ *               map the segment read-only and retry their copy when
+ *               the sequence moved meanwhile.
+ *
+ ******************************************************************/
+
+/******************************************************************
+ * 1. Included files (microcontroller ones then user defined ones)
+ ******************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+#include "shm.h"
+#include "../cpu/cpu.h"
+#include "../display/display.h"
+
+/******************************************************************
+ * 2. Define declarations (macros then function macros)
+ ******************************************************************/
+#define SHM_ALIGNMENT                                            64U
+#define SHM_NAME_SIZE                                            64U
+
+/* Copies a reader attempts before giving up on a stalled writer,
+ * sleeping now and then to let a preempted writer finish */
+#define SHM_READ_RETRIES                                       1000U
+#define SHM_READ_SPINS                                          100U
+
+#define SHM_ALIGN(size)      (((size) + SHM_ALIGNMENT - 1U) & ~(U64)(SHM_ALIGNMENT - 1U))
+
+/******************************************************************
+ * 3. Typedef definitions (simple typedef, then enum and structs)
+ ******************************************************************/
+typedef struct
+{
+    shmHeaderType *header;
+    U64 size;
+    char name[SHM_NAME_SIZE];
+#ifdef _WIN32
+    HANDLE mapping;
+#else
+    int file;
+#endif
+} shmWriterType;
+
+/******************************************************************
+ * 4. Variable definitions (static then global)
+ ******************************************************************/
+static shmWriterType s_shm;
+
+/******************************************************************
+ * 5. Functions prototypes (static only)
+ ******************************************************************/
+static shmSlotType * shmSlot(const shmHeaderType *header, U32 slot);
+static void * shmMap(const char *name, U64 size, BOOL create, void **handle, U64 *mappedSize);
+static void shmUnmap(void *address, U64 size, void *handle);
+
+/******************************************************************
+ * FUNCTION : ShmOpen()
+ *    Description: Create the segment and start publishing
+ *    Parameters:  name: POSIX shared memory name, e.g. SHM_NAME
+ *                 slots: number of machines published
+ *    Return:      E_OK if the segment is mapped, E_NOT_OK otherwise
+ ******************************************************************/
+Std_ReturnType ShmOpen(const char *name, U32 slots)
+{
+    U64 slotOffset = SHM_ALIGN(sizeof(shmHeaderType));
+    U64 slotSize = SHM_ALIGN(sizeof(shmSlotType));
+    U64 mappedSize;
+    void *handle = NULL;
+    shmHeaderType *header;
+
+    if ((NULL != s_shm.header) || (0U == slots) || (strlen(name) >= SHM_NAME_SIZE))
+    {
+        return E_NOT_OK;
+    }
+
+    header = (shmHeaderType *)shmMap(name, slotOffset + (slots * slotSize), TRUE, &handle, &mappedSize);
+    if (NULL == header)
+    {
+        printf("Unable to create shared memory %s.", name);
+        return E_NOT_OK;
+    }
+
+    (void)memset((void *)header, 0, (size_t)mappedSize);
+    header->slotCount = slots;
+    header->slotSize = slotSize;
+    header->slotOffset = slotOffset;
+
+    /* Readers check the magic last written */
+    SDL_MemoryBarrierRelease();
+    header->magic = SHM_MAGIC;
+
+    s_shm.header = header;
+    s_shm.size = mappedSize;
+    (void)strcpy(s_shm.name, name);
+#ifdef _WIN32
+    s_shm.mapping = (HANDLE)handle;
+#else
+    s_shm.file = (int)(size_t)handle;
+#endif
+
+    return E_OK;
+}
+
+/******************************************************************
+ * FUNCTION : ShmPublish()
+ *    Description: Copy the state of a machine into its slot
+ *    Parameters:  slot: slot index
+ *                 cpu: machine, with its screen attached
+ *    Return:      None
+ ******************************************************************/
+void ShmPublish(U32 slot, const cpuType *cpu)
+{
+    shmSlotType *target;
+
+    if ((NULL == s_shm.header) || (slot >= s_shm.header->slotCount) || (NULL == cpu->screen))
+    {
+        return;
+    }
+
+    target = shmSlot(s_shm.header, slot);
+
+    /* Odd: readers retry */
+    (void)SDL_AtomicAdd(&target->sequence, 1);
+
+    target->frame++;
+    (void)memcpy((void *)target->rows, (const void *)cpu->screen->rows, sizeof(target->rows));
+    target->pc = cpu->pc;
+    target->i = cpu->i;
+    (void)memcpy((void *)target->stack, (const void *)cpu->stack, sizeof(target->stack));
+    (void)memcpy((void *)target->vx, (const void *)cpu->vx, sizeof(target->vx));
+    target->stackLevel = cpu->stackLevel;
+    target->delay = cpu->sysCounter;
+    target->sound = cpu->soundCounter;
+    target->status = (U8)cpu->status;
+    target->profile = (U8)cpu->profile;
+    target->width = cpu->screen->width;
+    target->height = cpu->screen->height;
+    target->planes = cpu->screen->planes;
+
+    /* Even: slot consistent */
+    (void)SDL_AtomicAdd(&target->sequence, 1);
+}
+
+/******************************************************************
+ * FUNCTION : ShmClose()
+ *    Description: Stop publishing and remove the segment name,
+ *                 attached readers keep their mapping
+ *    Parameters:  None
+ *    Return:      None
+ ******************************************************************/
+void ShmClose(void)
+{
+    if (NULL == s_shm.header)
+    {
+        return;
+    }
+
+#ifdef _WIN32
+    shmUnmap((void *)s_shm.header, s_shm.size, (void *)s_shm.mapping);
+#else
+    shmUnmap((void *)s_shm.header, s_shm.size, (void *)(size_t)s_shm.file);
+    (void)shm_unlink(s_shm.name);
+#endif
+
+    (void)memset((void *)&s_shm, 0, sizeof(s_shm));
+}
+
+/******************************************************************
+ * FUNCTION : ShmAttach()
+ *    Description: Map a published segment read-only, from any
+ *                 process
+ *    Parameters:  name: name given to ShmOpen()
+ *                 reader: output, attached segment
+ *    Return:      E_OK if attached, E_NOT_OK otherwise
+ ******************************************************************/
+Std_ReturnType ShmAttach(const char *name, shmReaderType *reader)
+{
+    const shmHeaderType *header;
+    U64 mappedSize = 0U;
+    void *handle = NULL;
+
+    header = (const shmHeaderType *)shmMap(name, 0U, FALSE, &handle, &mappedSize);
+    if (NULL == header)
+    {
+        return E_NOT_OK;
+    }
+
+    if ((mappedSize < sizeof(shmHeaderType)) || (SHM_MAGIC != header->magic)
+        || (header->slotSize < sizeof(shmSlotType))
+        || (mappedSize < (header->slotOffset + (header->slotCount * header->slotSize))))
+    {
+        shmUnmap((void *)header, mappedSize, handle);
+        return E_NOT_OK;
+    }
+
+    reader->header = header;
+    reader->size = mappedSize;
+    reader->handle = handle;
+
+    return E_OK;
+}
+
+/******************************************************************
+ * FUNCTION : ShmRead()
+ *    Description: Consistent copy of a slot
+ *    Parameters:  reader: attached segment
+ *                 slot: slot index
+ *                 copy: output, slot state
+ *    Return:      E_OK if copied, E_NOT_OK if the slot does not
+ *                 exist or kept changing
+ ******************************************************************/
+Std_ReturnType ShmRead(const shmReaderType *reader, U32 slot, shmSlotType *copy)
+{
+    const shmSlotType *source;
+    int before;
+    int after;
+    U32 retry;
+
+    if (slot >= reader->header->slotCount)
+    {
+        return E_NOT_OK;
+    }
+
+    source = shmSlot(reader->header, slot);
+
+    /* Plain loads: the mapping is read-only, atomic read-modify-write
+     * helpers would fault */
+    for (retry = 0U; retry < SHM_READ_RETRIES; retry++)
+    {
+        before = *(volatile const int *)&source->sequence.value;
+        SDL_MemoryBarrierAcquire();
+
+        if (0 == (before & 1))
+        {
+            (void)memcpy((void *)copy, (const void *)source, sizeof(shmSlotType));
+            SDL_MemoryBarrierAcquire();
+
+            after = *(volatile const int *)&source->sequence.value;
+            if (before == after)
+            {
+                return E_OK;
+            }
+        }
+
+        if ((SHM_READ_SPINS - 1U) == (retry % SHM_READ_SPINS))
+        {
+            SDL_Delay(1U);
+        }
+    }
+
+    return E_NOT_OK;
+}
+
+/******************************************************************
+ * FUNCTION : ShmDetach()
+ *    Description: Unmap a segment mapped by ShmAttach()
+ *    Parameters:  reader: attached segment
+ *    Return:      None
+ ******************************************************************/
+void ShmDetach(shmReaderType *reader)
+{
+    if (NULL != reader->header)
+    {
+        shmUnmap((void *)reader->header, reader->size, reader->handle);
+        reader->header = NULL;
+    }
+}
+
+/******************************************************************
+ * FUNCTION : shmSlot()
+ *    Description: Address of a slot
+ *    Parameters:  header: segment
+ *                 slot: slot index
+ *    Return:      Slot
+ ******************************************************************/
+static shmSlotType * shmSlot(const shmHeaderType *header, U32 slot)
+{
+    return (shmSlotType *)((U8 *)header + header->slotOffset + (slot * header->slotSize));
+}
+
+/******************************************************************
+ * FUNCTION : shmMap()
+ *    Description: Map a named segment
+ *    Parameters:  name: segment name
+ *                 size: size to create, ignored when attaching
+ *                 create: TRUE to create read-write, FALSE to
+ *                         attach read-only
+ *                 handle: output, file descriptor or mapping handle
+ *                 mappedSize: output, mapped bytes
+ *    Return:      Address, NULL on error
+ ******************************************************************/
+static void * shmMap(const char *name, U64 size, BOOL create, void **handle, U64 *mappedSize)
+{
+    void *address = NULL;
+#ifdef _WIN32
+    char mapName[SHM_NAME_SIZE + 8U];
+    HANDLE mapping;
+    MEMORY_BASIC_INFORMATION info;
+
+    /* POSIX names start with a slash */
+    (void)snprintf(mapName, sizeof(mapName), "Local\\%s", ('/' == name[0]) ? &name[1] : name);
+
+    if (FALSE != create)
+    {
+        mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, (DWORD)(size >> 32U),
+                                     (DWORD)size, mapName);
+    }
+    else
+    {
+        mapping = OpenFileMappingA(FILE_MAP_READ, FALSE, mapName);
+    }
+
+    if (NULL != mapping)
+    {
+        address = MapViewOfFile(mapping, (FALSE != create) ? FILE_MAP_ALL_ACCESS : FILE_MAP_READ, 0U, 0U,
+                                (FALSE != create) ? (SIZE_T)size : 0U);
+        if ((NULL != address) && (0U != VirtualQuery(address, &info, sizeof(info))))
+        {
+            *mappedSize = (FALSE != create) ? size : (U64)info.RegionSize;
+            *handle = (void *)mapping;
+        }
+        else
+        {
+            if (NULL != address)
+            {
+                (void)UnmapViewOfFile(address);
+                address = NULL;
+            }
+            (void)CloseHandle(mapping);
+        }
+    }
+#else
+    int file;
+    struct stat status;
+
+    file = shm_open(name, (FALSE != create) ? (O_CREAT | O_RDWR) : O_RDONLY, 0644);
+    if (file < 0)
+    {
+        return NULL;
+    }
+
+    if ((FALSE != create) && (0 != ftruncate(file, (off_t)size)))
+    {
+        (void)close(file);
+        return NULL;
+    }
+
+    if ((0 == fstat(file, &status)) && (status.st_size > 0))
+    {
+        address = mmap(NULL, (size_t)status.st_size, (FALSE != create) ? (PROT_READ | PROT_WRITE) : PROT_READ,
+                       MAP_SHARED, file, 0);
+        if (MAP_FAILED == address)
+        {
+            address = NULL;
+        }
+    }
+
+    if (NULL == address)
+    {
+        (void)close(file);
+    }
+    else
+    {
+        *mappedSize = (U64)status.st_size;
+        *handle = (void *)(size_t)file;
+    }
+#endif
+
+    return address;
+}
+
+/******************************************************************
+ * FUNCTION : shmUnmap()
+ *    Description: Unmap a segment and release its handle
+ *    Parameters:  address, size: mapping
+ *                 handle: file descriptor or mapping handle
+ *    Return:      None
+ ******************************************************************/
+static void shmUnmap(void *address, U64 size, void *handle)
+{
+#ifdef _WIN32
+    (void)size;
+    (void)UnmapViewOfFile(address);
+    (void)CloseHandle((HANDLE)handle);
+#else
+    (void)munmap(address, (size_t)size);
+    (void)close((int)(size_t)handle);
+#endif
+}
@@ -0,0 +1,102 @@
+/******************************************************************
+ *
+ *
+ * FILE        : shm.h
+ * PROJECT     : chip8
+ * AUTHOR      : danpham
+ * DESCRIPTION : Shared memory export of machine states for other
+ *               processes. Build with -DSHM_ENABLED to publish the
+ *               emulator every frame, the hooks are compiled out
+ *               otherwise.
+ *
+ ******************************************************************/
+#ifndef SHM_H_
+#define SHM_H_
+
+/******************************************************************
+ * 1. Included files (microcontroller ones then user defined ones)
+ ******************************************************************/
+#include <SDL2/SDL.h>
+#include "../headers/typedef.h"
+#include "../cpu/cpu.h"
+#include "../display/display.h"
+
+/******************************************************************
+ * 2. Define declarations (macros then function macros)
+ ******************************************************************/
+/* POSIX object name, "Local\chip8" file mapping on Windows */
+#define SHM_NAME                                            "/chip8"
+
+/* "CHIP8SHM" */
+#define SHM_MAGIC                                0x4348495038534D48ULL
+
+#define SHM_WORDS_PER_ROW                                         2U
+
+#ifdef SHM_ENABLED
+#define SHM_START()                (void)ShmOpen(SHM_NAME, 1U)
+#define SHM_FRAME(cpu)             ShmPublish(0U, cpu)
+#define SHM_STOP()                 ShmClose()
+#else
+#define SHM_START()
+#define SHM_FRAME(cpu)
+#define SHM_STOP()
+#endif
+
+/******************************************************************
+ * 3. Typedef definitions (simple typedef, then enum and structs)
+ ******************************************************************/
+/* Start of the segment, slots follow at slotOffset + n * slotSize.
+ * Every field has the same size on all platforms. */
+typedef struct
+{
+    U64 magic;
+    U64 slotCount;
+    U64 slotSize;
+    U64 slotOffset;
+} shmHeaderType;
+
+/* State of one machine. sequence is odd while the emulator writes
+ * the slot: a reader copies the slot between two reads of an equal,
+ * even sequence, see ShmRead(). */
+typedef struct
+{
+    SDL_atomic_t sequence;
+    U64 frame;                  /* Frames published in this slot */
+    U64 rows[DISPLAY_PLANES][DISPLAY_HIRES_HEIGHT][SHM_WORDS_PER_ROW];
+    U16 pc;
+    U16 i;
+    U16 stack[CPU_STACK_DEPTH_LEVEL];
+    U8 vx[CPU_NUMBER_OF_VX_REGISTER];
+    S8 stackLevel;
+    U8 delay;
+    U8 sound;
+    U8 status;                  /* cpuStatusType */
+    U8 profile;                 /* cpuProfileType */
+    U8 width;
+    U8 height;
+    U8 planes;
+} shmSlotType;
+
+/* Read side of a segment */
+typedef struct
+{
+    const shmHeaderType *header;
+    U64 size;
+    void *handle;
+} shmReaderType;
+
+/******************************************************************
+ * 4. Variable definitions (static then global)
+ ******************************************************************/
+
+/******************************************************************
+ * 5. Functions prototypes (static only)
+ ******************************************************************/
+extern Std_ReturnType ShmOpen(const char *name, U32 slots);
+extern void ShmPublish(U32 slot, const cpuType *cpu);
+extern void ShmClose(void);
+extern Std_ReturnType ShmAttach(const char *name, shmReaderType *reader);
+extern Std_ReturnType ShmRead(const shmReaderType *reader, U32 slot, shmSlotType *copy);
+extern void ShmDetach(shmReaderType *reader);
+
+#endif /* SHM_H_ */
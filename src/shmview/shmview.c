@@ -0,0 +1,135 @@
+/******************************************************************
+ *
+ *
+ * FILE        : shmview.c
+ * PROJECT     : chip8
+ * AUTHOR      : danpham
+ * DESCRIPTION : Print the screen and registers of a machine
+ *               published in shared memory
+ *
+ ******************************************************************/
+
+/******************************************************************
+ * 1. Included files (microcontroller ones then user defined ones)
+ ******************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../shm/shm.h"
+
+/******************************************************************
+ * 2. Define declarations (macros then function macros)
+ ******************************************************************/
+#define SHMVIEW_PERIOD_MS                                       500U
+
+/******************************************************************
+ * 3. Typedef definitions (simple typedef, then enum and structs)
+ ******************************************************************/
+
+/******************************************************************
+ * 4. Variable definitions (static then global)
+ ******************************************************************/
+
+/******************************************************************
+ * 5. Functions prototypes (static only)
+ ******************************************************************/
+static void shmviewPrint(const shmSlotType *slot);
+
+/******************************************************************
+ * FUNCTION : main(int argc, char** argv)
+ *    Description: Usage: shmview [NAME] [--slot N] [--follow]
+ *    Parameters:  None
+ *    Return:      0 on success, 1 otherwise
+ ******************************************************************/
+int main(int argc, char **argv)
+{
+    shmReaderType reader;
+    shmSlotType slot;
+    const char *name = SHM_NAME;
+    U32 index = 0U;
+    BOOL follow = FALSE;
+    U64 lastFrame = 0U;
+    int arg;
+
+    for (arg = 1; arg < argc; arg++)
+    {
+        if ((0 == strcmp(argv[arg], "--slot")) && ((arg + 1) < argc))
+        {
+            arg++;
+            index = (U32)strtoul(argv[arg], NULL, 0);
+        }
+        else if (0 == strcmp(argv[arg], "--follow"))
+        {
+            follow = TRUE;
+        }
+        else
+        {
+            name = argv[arg];
+        }
+    }
+
+    if (E_OK != ShmAttach(name, &reader))
+    {
+        printf("Unable to attach %s.\n", name);
+        return 1;
+    }
+
+    do
+    {
+        if (E_OK != ShmRead(&reader, index, &slot))
+        {
+            printf("Unable to read slot %lu.\n", (unsigned long)index);
+            ShmDetach(&reader);
+            return 1;
+        }
+
+        if ((FALSE == follow) || (slot.frame != lastFrame))
+        {
+            shmviewPrint(&slot);
+            lastFrame = slot.frame;
+        }
+
+        if (FALSE != follow)
+        {
+            SDL_Delay(SHMVIEW_PERIOD_MS);
+        }
+    } while (FALSE != follow);
+
+    ShmDetach(&reader);
+
+    return 0;
+}
+
+/******************************************************************
+ * FUNCTION : shmviewPrint()
+ *    Description: Print a slot, one character per pixel
+ *    Parameters:  slot: slot copy
+ *    Return:      None
+ ******************************************************************/
+static void shmviewPrint(const shmSlotType *slot)
+{
+    static const char shades[DISPLAY_COLORS] = { '.', '#', '+', '-' };
+    U32 x;
+    U32 y;
+    U8 color;
+    U8 reg;
+
+    printf("frame %llu pc %03X i %03X status %u\n", (unsigned long long)slot->frame, slot->pc, slot->i,
+           slot->status);
+    for (reg = 0U; reg < CPU_NUMBER_OF_VX_REGISTER; reg++)
+    {
+        printf("V%X=%02X ", reg, slot->vx[reg]);
+    }
+    printf("\n");
+
+    for (y = 0U; y < slot->height; y++)
+    {
+        for (x = 0U; x < slot->width; x++)
+        {
+            color = (U8)(((slot->rows[0U][y][x >> 6U] >> (63U - (x & 63U))) & 1U)
+                         | (((slot->rows[1U][y][x >> 6U] >> (63U - (x & 63U))) & 1U) << 1U));
+            putchar(shades[color]);
+        }
+        putchar('\n');
+    }
+}
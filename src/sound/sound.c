@@ -4,7 +4,9 @@
  * FILE        : sound.c
  * PROJECT     : chip8
  * AUTHOR      : danpham
- * DESCRIPTION : Sound
+ * DESCRIPTION : Sound. The audio subsystem, the WAV file and the
+ *               device come up on the first sound of the program,
+ *               silent programs never pay for them.
  *
  ******************************************************************/
 
@@ -13,10 +15,12 @@
  ******************************************************************/
 #include <SDL2/SDL.h>
 #include "sound.h"
+#include "../metrics/metrics.h"
 
 /******************************************************************
  * 2. Define declarations (macros then function macros)
  ******************************************************************/
+#define SOUND_FILE                                   "build/sound.wav"
 
 /******************************************************************
  * 3. Typedef definitions (simple typedef, then enum and structs)
@@ -29,25 +33,32 @@ static SDL_AudioSpec s_wavSpec;
 static uint32_t s_wavLength;
 static uint8_t * s_wavBuffer;
 static SDL_AudioDeviceID s_deviceId;
+static BOOL s_opened;               /* Opening tried, whatever the result */
 
 /******************************************************************
  * 5. Functions prototypes (static only)
  ******************************************************************/
 
 /******************************************************************
- * FUNCTION : SoundInit()
- *    Description: Initialize sound
+ * FUNCTION : SoundOpen()
+ *    Description: Bring sound up on first call, a failure is not
+ *                 retried
  *    Parameters:  None
  *    Return:      None
  ******************************************************************/
-void SoundInit(void)
+void SoundOpen(void)
 {
-    /* Sound init should be after SDL_Init */
-	SDL_LoadWAV("build/sound.wav", &s_wavSpec, &s_wavBuffer, &s_wavLength);
-
-    /* Opening the audio device */
-	s_deviceId = SDL_OpenAudioDevice(NULL, 0, &s_wavSpec, NULL, 0);
+    if (FALSE != s_opened)
+    {
+        return;
+    }
+    s_opened = TRUE;
 
+    /* Only video and events are initialized at startup */
+    if ((0 == SDL_InitSubSystem(SDL_INIT_AUDIO)) && (NULL != SDL_LoadWAV(SOUND_FILE, &s_wavSpec, &s_wavBuffer, &s_wavLength)))
+    {
+        s_deviceId = SDL_OpenAudioDevice(NULL, 0, &s_wavSpec, NULL, 0);
+    }
 }
 
 /******************************************************************
@@ -58,8 +69,19 @@ void SoundInit(void)
  ******************************************************************/
 void SoundPlay(void)
 {
-	U32 success = SDL_QueueAudio(s_deviceId, s_wavBuffer, s_wavLength);
-	SDL_PauseAudioDevice(s_deviceId, 0);
+    U32 success;
+
+    SoundOpen();
+
+    if (0U == s_deviceId)
+    {
+        METRICS_SOUND(FALSE);
+        return;
+    }
+
+    success = SDL_QueueAudio(s_deviceId, s_wavBuffer, s_wavLength);
+    METRICS_SOUND((0U == success) ? TRUE : FALSE);
+    SDL_PauseAudioDevice(s_deviceId, 0);
 }
 
 /******************************************************************
@@ -70,6 +92,17 @@ void SoundPlay(void)
  ******************************************************************/
 void SoundExit(void)
 {
-	SDL_CloseAudioDevice(s_deviceId);
-	SDL_FreeWAV(s_wavBuffer);
+    if (0U != s_deviceId)
+    {
+        SDL_CloseAudioDevice(s_deviceId);
+    }
+
+    if (NULL != s_wavBuffer)
+    {
+        SDL_FreeWAV(s_wavBuffer);
+    }
+
+    s_deviceId = 0U;
+    s_wavBuffer = NULL;
+    s_opened = FALSE;
 }
@@ -28,6 +28,6 @@
 /******************************************************************
  * 5. Functions prototypes (static only)
  ******************************************************************/
-extern void SoundInit(void);
+extern void SoundOpen(void);
 extern void SoundPlay(void);
 extern void SoundExit(void);
\ No newline at end of file
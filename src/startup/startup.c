@@ -0,0 +1,133 @@
+/******************************************************************
+ *
+ *
+ * FILE        : startup.c
+ * PROJECT     : chip8
+ * AUTHOR      : danpham
+ * DESCRIPTION : Cold start timing.
+ *
+ *               StartupStart() takes the origin at the top of
+ *               main(), each StartupPhase() then closes the phase
+ *               that just ended. The first presented frame closes
+ *               the last one, later frames are ignored.
+ *
+ ******************************************************************/
+
+/******************************************************************
+ * 1. Included files (microcontroller ones then user defined ones)
+ ******************************************************************/
+#include <stdio.h>
+#include <SDL2/SDL.h>
+#include "startup.h"
+
+/******************************************************************
+ * 2. Define declarations (macros then function macros)
+ ******************************************************************/
+
+/******************************************************************
+ * 3. Typedef definitions (simple typedef, then enum and structs)
+ ******************************************************************/
+typedef struct
+{
+    const char *names[STARTUP_MAX_PHASES];
+    U64 ends[STARTUP_MAX_PHASES];   /* Performance counter at the end of each phase */
+    U64 start;
+    U32 count;
+    BOOL started;
+    BOOL framePresented;
+} startupType;
+
+/******************************************************************
+ * 4. Variable definitions (static then global)
+ ******************************************************************/
+static startupType s_startup;
+
+/******************************************************************
+ * 5. Functions prototypes (static only)
+ ******************************************************************/
+
+/******************************************************************
+ * FUNCTION : StartupStart()
+ *    Description: Take the origin of the startup phases
+ *    Parameters:  None
+ *    Return:      None
+ ******************************************************************/
+void StartupStart(void)
+{
+    /* The performance counter needs no SDL_Init() */
+    s_startup.start = SDL_GetPerformanceCounter();
+    s_startup.count = 0U;
+    s_startup.started = TRUE;
+    s_startup.framePresented = FALSE;
+}
+
+/******************************************************************
+ * FUNCTION : StartupPhase()
+ *    Description: Close the phase ending now
+ *    Parameters:  name: phase name, a string literal
+ *    Return:      None
+ ******************************************************************/
+void StartupPhase(const char *name)
+{
+    if ((FALSE == s_startup.started) || (FALSE != s_startup.framePresented) || (s_startup.count >= STARTUP_MAX_PHASES))
+    {
+        return;
+    }
+
+    s_startup.names[s_startup.count] = name;
+    s_startup.ends[s_startup.count] = SDL_GetPerformanceCounter();
+    s_startup.count++;
+}
+
+/******************************************************************
+ * FUNCTION : StartupFrame()
+ *    Description: Frame presented, the first one ends startup
+ *    Parameters:  None
+ *    Return:      None
+ ******************************************************************/
+void StartupFrame(void)
+{
+    if (FALSE == s_startup.framePresented)
+    {
+        StartupPhase("first frame");
+        s_startup.framePresented = TRUE;
+    }
+}
+
+/******************************************************************
+ * FUNCTION : StartupReport()
+ *    Description: Write the duration of each phase and the time
+ *                 elapsed since the origin, in milliseconds
+ *    Parameters:  path: report file
+ *    Return:      E_OK if report is written, E_NOT_OK otherwise
+ ******************************************************************/
+Std_ReturnType StartupReport(const char *path)
+{
+    double frequency = (double)SDL_GetPerformanceFrequency();
+    U64 previous = s_startup.start;
+    FILE *filePtr;
+    U32 i;
+
+    if (NULL == (filePtr = fopen(path, "w")))
+    {
+        return E_NOT_OK;
+    }
+
+    fprintf(filePtr, "%-16s %10s %10s\n", "phase (ms)", "duration", "elapsed");
+    for (i = 0U; i < s_startup.count; i++)
+    {
+        fprintf(filePtr, "%-16s %10.3f %10.3f\n", s_startup.names[i],
+                ((double)(s_startup.ends[i] - previous) * 1000.0) / frequency,
+                ((double)(s_startup.ends[i] - s_startup.start) * 1000.0) / frequency);
+        previous = s_startup.ends[i];
+    }
+
+    if (FALSE == s_startup.framePresented)
+    {
+        fprintf(filePtr, "No frame presented\n");
+    }
+
+    fclose(filePtr);
+
+    return E_OK;
+}
@@ -0,0 +1,56 @@
+/******************************************************************
+ *
+ *
+ * FILE        : startup.h
+ * PROJECT     : chip8
+ * AUTHOR      : danpham
+ * DESCRIPTION : Cold start timing: host time of each startup phase
+ *               up to the first presented frame. Build with
+ *               -DSTARTUP_ENABLED to turn the hooks on, they are
+ *               compiled out otherwise.
+ *
+ ******************************************************************/
+#ifndef STARTUP_H_
+#define STARTUP_H_
+
+/******************************************************************
+ * 1. Included files (microcontroller ones then user defined ones)
+ ******************************************************************/
+#include "../headers/typedef.h"
+
+/******************************************************************
+ * 2. Define declarations (macros then function macros)
+ ******************************************************************/
+#define STARTUP_REPORT_FILE                        "build/startup.txt"
+
+#define STARTUP_MAX_PHASES                                       16U
+
+#ifdef STARTUP_ENABLED
+#define STARTUP_START()                       StartupStart()
+#define STARTUP_PHASE(name)                   StartupPhase(name)
+#define STARTUP_FRAME()                       StartupFrame()
+#define STARTUP_REPORT()                      (void)StartupReport(STARTUP_REPORT_FILE)
+#else
+#define STARTUP_START()
+#define STARTUP_PHASE(name)
+#define STARTUP_FRAME()
+#define STARTUP_REPORT()
+#endif
+
+/******************************************************************
+ * 3. Typedef definitions (simple typedef, then enum and structs)
+ ******************************************************************/
+
+/******************************************************************
+ * 4. Variable definitions (static then global)
+ ******************************************************************/
+
+/******************************************************************
+ * 5. Functions prototypes (static only)
+ ******************************************************************/
+extern void StartupStart(void);
+extern void StartupPhase(const char *name);
+extern void StartupFrame(void);
+extern Std_ReturnType StartupReport(const char *path);
+
+#endif /* STARTUP_H_ */
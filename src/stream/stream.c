@@ -0,0 +1,1028 @@
+/******************************************************************
+ *
+ *
+ * FILE        : stream.c
+ * PROJECT     : chip8
+ * AUTHOR      : danpham
+ * DESCRIPTION : Frame streaming server.
+ *
+ *               The emulating thread only copies each published
+ *               screen into the mailbox of its machine and wakes
+ *               the server up. The server thread multiplexes the
+ *               listening socket, the wake-up eventfd and every
+ *               client with epoll: it encodes each new screen once
+ *               as XOR runs against the previous one and queues the
+ *               result to the clients watching that machine. A
+ *               client whose queue is full skips frames and gets a
+ *               keyframe once it has drained, so a slow client
+ *               never delays the others or the emulation.
+ *
+ *               epoll is Linux only, other systems get stubs.
+ *
+ ******************************************************************/
+
+/******************************************************************
+ * 1. Included files (microcontroller ones then user defined ones)
+ ******************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <SDL2/SDL.h>
+#ifdef __linux__
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#endif
+#include "stream.h"
+#include "../display/display.h"
+#include "../input/input.h"
+
+#ifdef __linux__
+
+/******************************************************************
+ * 2. Define declarations (macros then function macros)
+ ******************************************************************/
+#define STREAM_ROW_BYTES                 (DISPLAY_HIRES_WIDTH / 8U)
+#define STREAM_HEADER_SIZE                                       12U
+#define STREAM_RUN_HEADER_SIZE                                    4U
+#define STREAM_MAX_PAYLOAD   (2U + (DISPLAY_PLANES * DISPLAY_HIRES_HEIGHT * (STREAM_RUN_HEADER_SIZE + STREAM_ROW_BYTES)))
+#define STREAM_CLIENT_BUFFER                                 65536U
+#define STREAM_INPUT_SIZE                                         8U
+#define STREAM_EVENTS                                            64U
+#define STREAM_BACKLOG                                           16U
+#define STREAM_ADDRESS_SIZE                                     108U
+
+#define STREAM_HELLO_SIZE                                         4U
+#define STREAM_SUBSCRIBE_SIZE                                     3U
+#define STREAM_KEY_SIZE                                           5U
+
+/******************************************************************
+ * 3. Typedef definitions (simple typedef, then enum and structs)
+ ******************************************************************/
+typedef struct
+{
+    /* Mailbox, shared with the emulating thread */
+    SDL_SpinLock lock;
+    U32 published;
+    displayScreenType latest;
+
+    /* Server thread only */
+    U32 encoded;
+    displayScreenType sent;         /* Screen of the last queued frame */
+    U8 delta[STREAM_MAX_PAYLOAD];
+    U32 deltaLength;
+
+    /* Written by the server thread, read by the machine */
+    BOOL keys[INPUT_NUMBER_OF_KEYBOARD_KEYS];
+} streamMachineType;
+
+typedef struct streamClientType
+{
+    int socket;
+    U32 machine;
+    BOOL needsKeyframe;
+    BOOL writing;                   /* EPOLLOUT armed */
+    U8 output[STREAM_CLIENT_BUFFER];
+    U32 outputStart;
+    U32 outputEnd;
+    U8 input[STREAM_INPUT_SIZE];
+    U32 inputLength;
+    struct streamClientType *next;
+} streamClientType;
+
+typedef struct
+{
+    SDL_atomic_t running;
+    SDL_atomic_t pending;           /* Wake-up written, not consumed yet */
+    SDL_Thread *server;
+    U32 machineCount;
+    streamMachineType *machines;
+    int listenSocket;
+    int wake;
+    int poll;
+    streamClientType *clients;
+    streamClientType *closed;       /* Freed after the epoll batch */
+    char unixPath[STREAM_ADDRESS_SIZE];
+    U8 keyframe[STREAM_MAX_PAYLOAD];
+} streamType;
+
+/******************************************************************
+ * 4. Variable definitions (static then global)
+ ******************************************************************/
+static streamType *s_stream;
+
+/******************************************************************
+ * 5. Functions prototypes (static only)
+ ******************************************************************/
+static int streamListen(streamType *stream, const char *address);
+static int streamServer(void *data);
+static void streamAccept(streamType *stream);
+static void streamEncode(streamType *stream);
+static U32 streamDiff(const displayScreenType *previous, const displayScreenType *current, U8 *payload);
+static void streamRowBytes(const displayRowType *row, U8 *bytes);
+static void streamQueueFrame(streamClientType *client, U32 machine, U32 frame, U8 flags, const U8 *payload, U32 length);
+static void streamQueueKeyframe(streamType *stream, streamClientType *client);
+static BOOL streamQueue(streamClientType *client, const U8 *data, U32 length);
+static BOOL streamFlush(streamType *stream, streamClientType *client);
+static BOOL streamRead(streamType *stream, streamClientType *client);
+static void streamKey(streamType *stream, U32 machine, U8 key, BOOL down);
+static void streamCloseClient(streamType *stream, streamClientType *client);
+static void streamFreeClosed(streamType *stream);
+static void streamPutU16(U8 *data, U32 value);
+static void streamPutU32(U8 *data, U32 value);
+static void streamFree(streamType *stream);
+
+/******************************************************************
+ * FUNCTION : StreamOpen()
+ *    Description: Start the server
+ *    Parameters:  address: "unix:PATH" or "tcp:HOST:PORT"
+ *                 machines: number of machines published
+ *    Return:      E_OK if listening, E_NOT_OK otherwise
+ ******************************************************************/
+Std_ReturnType StreamOpen(const char *address, U32 machines)
+{
+    streamType *stream;
+    struct epoll_event event;
+
+    if ((NULL != s_stream) || (0U == machines) || (machines > 0xFFFFU))
+    {
+        return E_NOT_OK;
+    }
+
+    stream = (streamType *)calloc(1U, sizeof(streamType));
+    if (NULL == stream)
+    {
+        return E_NOT_OK;
+    }
+
+    stream->listenSocket = -1;
+    stream->wake = -1;
+    stream->poll = -1;
+    stream->machineCount = machines;
+    stream->machines = (streamMachineType *)calloc(machines, sizeof(streamMachineType));
+    if (NULL == stream->machines)
+    {
+        streamFree(stream);
+        return E_NOT_OK;
+    }
+
+    stream->listenSocket = streamListen(stream, address);
+    stream->wake = eventfd(0U, EFD_NONBLOCK | EFD_CLOEXEC);
+    stream->poll = epoll_create1(EPOLL_CLOEXEC);
+    if ((stream->listenSocket < 0) || (stream->wake < 0) || (stream->poll < 0))
+    {
+        printf("Unable to stream on %s.", address);
+        streamFree(stream);
+        return E_NOT_OK;
+    }
+
+    event.events = EPOLLIN;
+    event.data.ptr = (void *)&stream->listenSocket;
+    (void)epoll_ctl(stream->poll, EPOLL_CTL_ADD, stream->listenSocket, &event);
+    event.events = EPOLLIN;
+    event.data.ptr = (void *)&stream->wake;
+    (void)epoll_ctl(stream->poll, EPOLL_CTL_ADD, stream->wake, &event);
+
+    SDL_AtomicSet(&stream->running, 1);
+    stream->server = SDL_CreateThread(streamServer, "chip8 stream", stream);
+    if (NULL == stream->server)
+    {
+        streamFree(stream);
+        return E_NOT_OK;
+    }
+
+    s_stream = stream;
+
+    return E_OK;
+}
+
+/******************************************************************
+ * FUNCTION : StreamPublish()
+ *    Description: Hand a screen to the server, called by the
+ *                 emulating thread of the machine
+ *    Parameters:  machine: machine index
+ *                 screen: screen to stream
+ *    Return:      None
+ ******************************************************************/
+void StreamPublish(U32 machine, const displayScreenType *screen)
+{
+    streamType *stream = s_stream;
+    streamMachineType *mailbox;
+    U64 one = 1U;
+
+    if ((NULL == stream) || (machine >= stream->machineCount))
+    {
+        return;
+    }
+
+    mailbox = &stream->machines[machine];
+
+    SDL_AtomicLock(&mailbox->lock);
+    (void)memcpy((void *)&mailbox->latest, (const void *)screen, sizeof(displayScreenType));
+    mailbox->published++;
+    SDL_AtomicUnlock(&mailbox->lock);
+
+    /* One wake-up until the server looks at the mailboxes */
+    if (SDL_AtomicCAS(&stream->pending, 0, 1))
+    {
+        (void)write(stream->wake, (const void *)&one, sizeof(one));
+    }
+}
+
+/******************************************************************
+ * FUNCTION : StreamKeys()
+ *    Description: Keys pressed by the clients on a machine, to give
+ *                 to CpuAttach()
+ *    Parameters:  machine: machine index
+ *    Return:      INPUT_NUMBER_OF_KEYBOARD_KEYS key states, NULL
+ *                 if the server is not running
+ ******************************************************************/
+const BOOL * StreamKeys(U32 machine)
+{
+    if ((NULL == s_stream) || (machine >= s_stream->machineCount))
+    {
+        return NULL;
+    }
+
+    return s_stream->machines[machine].keys;
+}
+
+/******************************************************************
+ * FUNCTION : StreamClose()
+ *    Description: Stop the server and disconnect the clients
+ *    Parameters:  None
+ *    Return:      None
+ ******************************************************************/
+void StreamClose(void)
+{
+    streamType *stream = s_stream;
+    U64 one = 1U;
+
+    if (NULL == stream)
+    {
+        return;
+    }
+
+    s_stream = NULL;
+    SDL_AtomicSet(&stream->running, 0);
+    (void)write(stream->wake, (const void *)&one, sizeof(one));
+    SDL_WaitThread(stream->server, NULL);
+    stream->server = NULL;
+
+    streamFree(stream);
+}
+
+/******************************************************************
+ * FUNCTION : streamListen()
+ *    Description: Open the non blocking listening socket
+ *    Parameters:  stream: server
+ *                 address: "unix:PATH" or "tcp:HOST:PORT"
+ *    Return:      Socket, -1 on error
+ ******************************************************************/
+static int streamListen(streamType *stream, const char *address)
+{
+    struct sockaddr_un local;
+    struct addrinfo hints;
+    struct addrinfo *result = NULL;
+    char host[STREAM_ADDRESS_SIZE];
+    const char *port;
+    int listenSocket = -1;
+    int reuse = 1;
+
+    if (0 == strncmp(address, "unix:", 5U))
+    {
+        if (strlen(&address[5U]) >= sizeof(local.sun_path))
+        {
+            return -1;
+        }
+
+        (void)memset((void *)&local, 0, sizeof(local));
+        local.sun_family = AF_UNIX;
+        (void)strcpy(local.sun_path, &address[5U]);
+        (void)strcpy(stream->unixPath, &address[5U]);
+        (void)unlink(local.sun_path);
+
+        listenSocket = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if ((listenSocket >= 0) && (0 != bind(listenSocket, (const struct sockaddr *)&local, sizeof(local))))
+        {
+            (void)close(listenSocket);
+            listenSocket = -1;
+        }
+    }
+    else if (0 == strncmp(address, "tcp:", 4U))
+    {
+        port = strrchr(address, ':');
+        if ((port == &address[3U]) || ((size_t)(port - &address[4U]) >= sizeof(host)))
+        {
+            return -1;
+        }
+
+        (void)memcpy((void *)host, (const void *)&address[4U], (size_t)(port - &address[4U]));
+        host[port - &address[4U]] = '\0';
+
+        (void)memset((void *)&hints, 0, sizeof(hints));
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        hints.ai_flags = AI_PASSIVE;
+        if ((0 == getaddrinfo(('\0' != host[0U]) ? host : NULL, &port[1U], &hints, &result)) && (NULL != result))
+        {
+            listenSocket = socket(result->ai_family, result->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC,
+                                  result->ai_protocol);
+            if (listenSocket >= 0)
+            {
+                (void)setsockopt(listenSocket, SOL_SOCKET, SO_REUSEADDR, (const void *)&reuse, sizeof(reuse));
+                if (0 != bind(listenSocket, result->ai_addr, result->ai_addrlen))
+                {
+                    (void)close(listenSocket);
+                    listenSocket = -1;
+                }
+            }
+            freeaddrinfo(result);
+        }
+    }
+
+    if ((listenSocket >= 0) && (0 != listen(listenSocket, STREAM_BACKLOG)))
+    {
+        (void)close(listenSocket);
+        listenSocket = -1;
+    }
+
+    return listenSocket;
+}
+
+/******************************************************************
+ * FUNCTION : streamServer()
+ *    Description: Server thread, the only one touching sockets
+ *    Parameters:  data: server
+ *    Return:      0
+ ******************************************************************/
+static int streamServer(void *data)
+{
+    streamType *stream = (streamType *)data;
+    struct epoll_event events[STREAM_EVENTS];
+    streamClientType *client;
+    U64 counter;
+    int count;
+    int i;
+
+    while (0 != SDL_AtomicGet(&stream->running))
+    {
+        count = epoll_wait(stream->poll, events, (int)STREAM_EVENTS, -1);
+
+        for (i = 0; i < count; i++)
+        {
+            if ((void *)&stream->listenSocket == events[i].data.ptr)
+            {
+                streamAccept(stream);
+            }
+            else if ((void *)&stream->wake == events[i].data.ptr)
+            {
+                (void)read(stream->wake, (void *)&counter, sizeof(counter));
+
+                /* Publications from now on wake the server again */
+                SDL_AtomicSet(&stream->pending, 0);
+                streamEncode(stream);
+            }
+            else
+            {
+                client = (streamClientType *)events[i].data.ptr;
+
+                /* Closed earlier in this batch */
+                if (client->socket < 0)
+                {
+                    continue;
+                }
+
+                if (0 != (events[i].events & (EPOLLERR | EPOLLHUP)))
+                {
+                    streamCloseClient(stream, client);
+                }
+                else if (((0 != (events[i].events & EPOLLIN)) && (FALSE == streamRead(stream, client)))
+                         || ((0 != (events[i].events & EPOLLOUT)) && (FALSE == streamFlush(stream, client))))
+                {
+                    streamCloseClient(stream, client);
+                }
+            }
+        }
+
+        streamFreeClosed(stream);
+    }
+
+    return 0;
+}
+
+/******************************************************************
+ * FUNCTION : streamAccept()
+ *    Description: Accept pending clients, each one watches machine
+ *                 0 and gets a hello and a keyframe
+ *    Parameters:  stream: server
+ *    Return:      None
+ ******************************************************************/
+static void streamAccept(streamType *stream)
+{
+    streamClientType *client;
+    struct epoll_event event;
+    U8 hello[STREAM_HELLO_SIZE];
+    int clientSocket;
+
+    for (;;)
+    {
+        clientSocket = accept(stream->listenSocket, NULL, NULL);
+        if (clientSocket < 0)
+        {
+            break;
+        }
+
+        (void)fcntl(clientSocket, F_SETFL, fcntl(clientSocket, F_GETFL) | O_NONBLOCK);
+        (void)fcntl(clientSocket, F_SETFD, FD_CLOEXEC);
+
+        client = (streamClientType *)calloc(1U, sizeof(streamClientType));
+        if (NULL == client)
+        {
+            (void)close(clientSocket);
+            continue;
+        }
+
+        client->socket = clientSocket;
+        event.events = EPOLLIN | EPOLLRDHUP;
+        event.data.ptr = (void *)client;
+        if (0 != epoll_ctl(stream->poll, EPOLL_CTL_ADD, clientSocket, &event))
+        {
+            (void)close(clientSocket);
+            free(client);
+            continue;
+        }
+
+        client->next = stream->clients;
+        stream->clients = client;
+
+        hello[0U] = 'H';
+        hello[1U] = STREAM_VERSION;
+        streamPutU16(&hello[2U], stream->machineCount);
+        (void)streamQueue(client, hello, sizeof(hello));
+        streamQueueKeyframe(stream, client);
+        if (FALSE == streamFlush(stream, client))
+        {
+            streamCloseClient(stream, client);
+        }
+    }
+}
+
+/******************************************************************
+ * FUNCTION : streamEncode()
+ *    Description: Encode the new screen of every machine once and
+ *                 queue it to the clients watching it
+ *    Parameters:  stream: server
+ *    Return:      None
+ ******************************************************************/
+static void streamEncode(streamType *stream)
+{
+    static displayScreenType current;
+    streamMachineType *machine;
+    streamClientType *client;
+    streamClientType *next;
+    BOOL changed;
+    U32 index;
+
+    for (index = 0U; index < stream->machineCount; index++)
+    {
+        machine = &stream->machines[index];
+
+        SDL_AtomicLock(&machine->lock);
+        changed = (BOOL)(machine->published != machine->encoded);
+        if (FALSE != changed)
+        {
+            (void)memcpy((void *)&current, (const void *)&machine->latest, sizeof(displayScreenType));
+            machine->encoded = machine->published;
+        }
+        SDL_AtomicUnlock(&machine->lock);
+
+        if (FALSE == changed)
+        {
+            continue;
+        }
+
+        machine->deltaLength = streamDiff(&machine->sent, &current, machine->delta);
+        (void)memcpy((void *)&machine->sent, (const void *)&current, sizeof(displayScreenType));
+
+        /* Identical screens are not sent */
+        if (0U == machine->deltaLength)
+        {
+            continue;
+        }
+
+        for (client = stream->clients; NULL != client; client = next)
+        {
+            next = client->next;
+
+            if ((index == client->machine) && (FALSE == client->needsKeyframe))
+            {
+                streamQueueFrame(client, index, machine->encoded, 0U, machine->delta, machine->deltaLength);
+                if (FALSE == streamFlush(stream, client))
+                {
+                    streamCloseClient(stream, client);
+                }
+            }
+        }
+    }
+}
+
+/******************************************************************
+ * FUNCTION : streamDiff()
+ *    Description: XOR runs turning a screen into another one
+ *    Parameters:  previous: screen known by the client
+ *                 current: new screen
+ *                 payload: output, STREAM_MAX_PAYLOAD bytes
+ *    Return:      Payload length, 0 if nothing changed
+ ******************************************************************/
+static U32 streamDiff(const displayScreenType *previous, const displayScreenType *current, U8 *payload)
+{
+    U8 before[STREAM_ROW_BYTES];
+    U8 after[STREAM_ROW_BYTES];
+    U32 length = 2U;
+    U8 plane;
+    U8 row;
+    U8 first;
+    U8 last;
+    U8 i;
+
+    payload[0U] = current->width;
+    payload[1U] = current->height;
+
+    for (plane = 0U; plane < DISPLAY_PLANES; plane++)
+    {
+        for (row = 0U; row < DISPLAY_HIRES_HEIGHT; row++)
+        {
+            streamRowBytes(&previous->rows[plane][row], before);
+            streamRowBytes(&current->rows[plane][row], after);
+
+            for (first = 0U; (first < STREAM_ROW_BYTES) && (before[first] == after[first]); first++)
+            {
+            }
+            if (STREAM_ROW_BYTES == first)
+            {
+                continue;
+            }
+            for (last = STREAM_ROW_BYTES - 1U; before[last] == after[last]; last--)
+            {
+            }
+
+            payload[length] = plane;
+            payload[length + 1U] = row;
+            payload[length + 2U] = first;
+            payload[length + 3U] = (U8)(last - first + 1U);
+            length += STREAM_RUN_HEADER_SIZE;
+            for (i = first; i <= last; i++)
+            {
+                payload[length] = (U8)(before[i] ^ after[i]);
+                length++;
+            }
+        }
+    }
+
+    /* A resolution change alone is still a frame */
+    if ((2U == length) && (previous->width == current->width) && (previous->height == current->height))
+    {
+        length = 0U;
+    }
+
+    return length;
+}
+
+/******************************************************************
+ * FUNCTION : streamRowBytes()
+ *    Description: Row as bytes, pixel 0 is the MSB of byte 0
+ *    Parameters:  row: screen row
+ *                 bytes: output, STREAM_ROW_BYTES bytes
+ *    Return:      None
+ ******************************************************************/
+static void streamRowBytes(const displayRowType *row, U8 *bytes)
+{
+    U8 i;
+
+    for (i = 0U; i < STREAM_ROW_BYTES; i++)
+    {
+        bytes[i] = (U8)((*row)[i >> 3U] >> (56U - ((i & 7U) << 3U)));
+    }
+}
+
+/******************************************************************
+ * FUNCTION : streamQueueFrame()
+ *    Description: Queue a frame message, or mark the client for a
+ *                 keyframe when its queue is full
+ *    Parameters:  client: client
+ *                 machine, frame, flags: message header
+ *                 payload, length: runs
+ *    Return:      None
+ ******************************************************************/
+static void streamQueueFrame(streamClientType *client, U32 machine, U32 frame, U8 flags, const U8 *payload, U32 length)
+{
+    U8 header[STREAM_HEADER_SIZE];
+
+    if ((STREAM_CLIENT_BUFFER - (client->outputEnd - client->outputStart)) < (STREAM_HEADER_SIZE + length))
+    {
+        client->needsKeyframe = TRUE;
+        return;
+    }
+
+    header[0U] = 'F';
+    header[1U] = flags;
+    streamPutU16(&header[2U], machine);
+    streamPutU32(&header[4U], frame);
+    streamPutU32(&header[8U], length);
+
+    (void)streamQueue(client, header, STREAM_HEADER_SIZE);
+    (void)streamQueue(client, payload, length);
+}
+
+/******************************************************************
+ * FUNCTION : streamQueueKeyframe()
+ *    Description: Queue the last sent screen of the client machine
+ *                 as a keyframe
+ *    Parameters:  stream: server
+ *                 client: client
+ *    Return:      None
+ ******************************************************************/
+static void streamQueueKeyframe(streamType *stream, streamClientType *client)
+{
+    static displayScreenType blank;
+    streamMachineType *machine = &stream->machines[client->machine];
+    U32 length;
+
+    length = streamDiff(&blank, &machine->sent, stream->keyframe);
+    if (0U == length)
+    {
+        /* Blank screen: the header alone clears the client */
+        stream->keyframe[0U] = machine->sent.width;
+        stream->keyframe[1U] = machine->sent.height;
+        length = 2U;
+    }
+
+    client->needsKeyframe = FALSE;
+    streamQueueFrame(client, client->machine, machine->encoded, STREAM_FLAG_KEYFRAME, stream->keyframe, length);
+}
+
+/******************************************************************
+ * FUNCTION : streamQueue()
+ *    Description: Append bytes to the output queue of a client
+ *    Parameters:  client: client
+ *                 data, length: bytes
+ *    Return:      TRUE if queued, FALSE if the queue is full
+ ******************************************************************/
+static BOOL streamQueue(streamClientType *client, const U8 *data, U32 length)
+{
+    if ((STREAM_CLIENT_BUFFER - client->outputEnd) < length)
+    {
+        /* Move the unsent bytes to the front */
+        (void)memmove((void *)client->output, (const void *)&client->output[client->outputStart],
+                      client->outputEnd - client->outputStart);
+        client->outputEnd -= client->outputStart;
+        client->outputStart = 0U;
+
+        if ((STREAM_CLIENT_BUFFER - client->outputEnd) < length)
+        {
+            return FALSE;
+        }
+    }
+
+    (void)memcpy((void *)&client->output[client->outputEnd], (const void *)data, length);
+    client->outputEnd += length;
+
+    return TRUE;
+}
+
+/******************************************************************
+ * FUNCTION : streamFlush()
+ *    Description: Send what the socket accepts, wait for EPOLLOUT
+ *                 for the rest. A drained client owed a keyframe
+ *                 gets it.
+ *    Parameters:  stream: server
+ *                 client: client
+ *    Return:      FALSE if the connection failed
+ ******************************************************************/
+static BOOL streamFlush(streamType *stream, streamClientType *client)
+{
+    struct epoll_event event;
+    ssize_t sent;
+    BOOL blocked = FALSE;
+
+    while ((client->outputStart < client->outputEnd) && (FALSE == blocked))
+    {
+        sent = send(client->socket, (const void *)&client->output[client->outputStart],
+                    client->outputEnd - client->outputStart, MSG_NOSIGNAL);
+        if (sent > 0)
+        {
+            client->outputStart += (U32)sent;
+        }
+        else if ((sent < 0) && ((EAGAIN == errno) || (EWOULDBLOCK == errno)))
+        {
+            blocked = TRUE;
+        }
+        else if ((sent < 0) && (EINTR == errno))
+        {
+            continue;
+        }
+        else
+        {
+            return FALSE;
+        }
+
+        if ((client->outputStart == client->outputEnd) && (FALSE != client->needsKeyframe))
+        {
+            client->outputStart = 0U;
+            client->outputEnd = 0U;
+            streamQueueKeyframe(stream, client);
+        }
+    }
+
+    if (client->outputStart == client->outputEnd)
+    {
+        client->outputStart = 0U;
+        client->outputEnd = 0U;
+    }
+
+    if (blocked != client->writing)
+    {
+        event.events = EPOLLIN | EPOLLRDHUP | ((FALSE != blocked) ? EPOLLOUT : 0U);
+        event.data.ptr = (void *)client;
+        (void)epoll_ctl(stream->poll, EPOLL_CTL_MOD, client->socket, &event);
+        client->writing = blocked;
+    }
+
+    return TRUE;
+}
+
+/******************************************************************
+ * FUNCTION : streamRead()
+ *    Description: Read and apply client messages
+ *    Parameters:  stream: server
+ *                 client: client
+ *    Return:      FALSE if the connection closed or the client
+ *                 sent an unknown message
+ ******************************************************************/
+static BOOL streamRead(streamType *stream, streamClientType *client)
+{
+    ssize_t received;
+    U32 size;
+    U32 machine;
+
+    for (;;)
+    {
+        received = recv(client->socket, (void *)&client->input[client->inputLength],
+                        STREAM_INPUT_SIZE - client->inputLength, 0);
+        if (0 == received)
+        {
+            return FALSE;
+        }
+        if (received < 0)
+        {
+            return (BOOL)((EAGAIN == errno) || (EWOULDBLOCK == errno) || (EINTR == errno));
+        }
+
+        client->inputLength += (U32)received;
+
+        while (0U != client->inputLength)
+        {
+            if ('S' == client->input[0U])
+            {
+                size = STREAM_SUBSCRIBE_SIZE;
+            }
+            else if ('K' == client->input[0U])
+            {
+                size = STREAM_KEY_SIZE;
+            }
+            else
+            {
+                return FALSE;
+            }
+
+            if (client->inputLength < size)
+            {
+                break;
+            }
+
+            machine = (U32)client->input[1U] | ((U32)client->input[2U] << 8U);
+            if (machine < stream->machineCount)
+            {
+                if ('S' == client->input[0U])
+                {
+                    client->machine = machine;
+                    streamQueueKeyframe(stream, client);
+                    if (FALSE == streamFlush(stream, client))
+                    {
+                        return FALSE;
+                    }
+                }
+                else
+                {
+                    streamKey(stream, machine, client->input[3U], (BOOL)(0U != client->input[4U]));
+                }
+            }
+
+            client->inputLength -= size;
+            (void)memmove((void *)client->input, (const void *)&client->input[size], client->inputLength);
+        }
+    }
+}
+
+/******************************************************************
+ * FUNCTION : streamKey()
+ *    Description: Apply a remote key. Keys of machine 0 are also
+ *                 posted as keyboard events, so the window queues
+ *                 them with InputQueueKey() like local keys.
+ *    Parameters:  stream: server
+ *                 machine: machine index
+ *                 key: chip8 key
+ *                 down: TRUE if pressed
+ *    Return:      None
+ ******************************************************************/
+static void streamKey(streamType *stream, U32 machine, U8 key, BOOL down)
+{
+    SDL_Event event;
+
+    if (key >= INPUT_NUMBER_OF_KEYBOARD_KEYS)
+    {
+        return;
+    }
+
+    stream->machines[machine].keys[key] = down;
+
+    if ((0U == machine) && (0U != SDL_WasInit(SDL_INIT_EVENTS)))
+    {
+        (void)memset((void *)&event, 0, sizeof(event));
+        event.type = (FALSE != down) ? SDL_KEYDOWN : SDL_KEYUP;
+        event.key.state = (FALSE != down) ? SDL_PRESSED : SDL_RELEASED;
+        event.key.keysym.sym = InputKeycode(key);
+        (void)SDL_PushEvent(&event);
+    }
+}
+
+/******************************************************************
+ * FUNCTION : streamCloseClient()
+ *    Description: Disconnect a client. It is freed after the epoll
+ *                 batch, which may still list it.
+ *    Parameters:  stream: server
+ *                 client: client
+ *    Return:      None
+ ******************************************************************/
+static void streamCloseClient(streamType *stream, streamClientType *client)
+{
+    streamClientType **link = &stream->clients;
+
+    if (client->socket < 0)
+    {
+        return;
+    }
+
+    while (client != *link)
+    {
+        link = &(*link)->next;
+    }
+    *link = client->next;
+
+    (void)epoll_ctl(stream->poll, EPOLL_CTL_DEL, client->socket, NULL);
+    (void)close(client->socket);
+    client->socket = -1;
+
+    client->next = stream->closed;
+    stream->closed = client;
+}
+
+/******************************************************************
+ * FUNCTION : streamFreeClosed()
+ *    Description: Free the clients closed during the epoll batch
+ *    Parameters:  stream: server
+ *    Return:      None
+ ******************************************************************/
+static void streamFreeClosed(streamType *stream)
+{
+    streamClientType *client;
+
+    while (NULL != stream->closed)
+    {
+        client = stream->closed;
+        stream->closed = client->next;
+        free(client);
+    }
+}
+
+/******************************************************************
+ * FUNCTION : streamPutU16()
+ *    Description: Write a little endian 16 bit value
+ *    Parameters:  data: output
+ *                 value: value
+ *    Return:      None
+ ******************************************************************/
+static void streamPutU16(U8 *data, U32 value)
+{
+    data[0U] = (U8)value;
+    data[1U] = (U8)(value >> 8U);
+}
+
+/******************************************************************
+ * FUNCTION : streamPutU32()
+ *    Description: Write a little endian 32 bit value
+ *    Parameters:  data: output
+ *                 value: value
+ *    Return:      None
+ ******************************************************************/
+static void streamPutU32(U8 *data, U32 value)
+{
+    streamPutU16(data, value);
+    streamPutU16(&data[2U], value >> 16U);
+}
+
+/******************************************************************
+ * FUNCTION : streamFree()
+ *    Description: Close every socket and free the server, whose
+ *                 thread is stopped
+ *    Parameters:  stream: server
+ *    Return:      None
+ ******************************************************************/
+static void streamFree(streamType *stream)
+{
+    while (NULL != stream->clients)
+    {
+        streamCloseClient(stream, stream->clients);
+    }
+    streamFreeClosed(stream);
+
+    if (stream->listenSocket >= 0)
+    {
+        (void)close(stream->listenSocket);
+        if ('\0' != stream->unixPath[0U])
+        {
+            (void)unlink(stream->unixPath);
+        }
+    }
+    if (stream->wake >= 0)
+    {
+        (void)close(stream->wake);
+    }
+    if (stream->poll >= 0)
+    {
+        (void)close(stream->poll);
+    }
+
+    free(stream->machines);
+    free(stream);
+}
+
+#else
+
+/******************************************************************
+ * FUNCTION : StreamOpen()
+ *    Description: Streaming needs epoll, not available here
+ *    Parameters:  address: unused
+ *                 machines: unused
+ *    Return:      E_NOT_OK
+ ******************************************************************/
+Std_ReturnType StreamOpen(const char *address, U32 machines)
+{
+    (void)machines;
+    printf("Unable to stream on %s: epoll is not available.", address);
+
+    return E_NOT_OK;
+}
+
+/******************************************************************
+ * FUNCTION : StreamPublish()
+ *    Description: Nothing to publish to
+ *    Parameters:  machine, screen: unused
+ *    Return:      None
+ ******************************************************************/
+void StreamPublish(U32 machine, const displayScreenType *screen)
+{
+    (void)machine;
+    (void)screen;
+}
+
+/******************************************************************
+ * FUNCTION : StreamKeys()
+ *    Description: No remote keys
+ *    Parameters:  machine: unused
+ *    Return:      NULL
+ ******************************************************************/
+const BOOL * StreamKeys(U32 machine)
+{
+    (void)machine;
+
+    return NULL;
+}
+
+/******************************************************************
+ * FUNCTION : StreamClose()
+ *    Description: Nothing to close
+ *    Parameters:  None
+ *    Return:      None
+ ******************************************************************/
+void StreamClose(void)
+{
+}
+
+#endif
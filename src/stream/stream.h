@@ -0,0 +1,68 @@
+/******************************************************************
+ *
+ *
+ * FILE        : stream.h
+ * PROJECT     : chip8
+ * AUTHOR      : danpham
+ * DESCRIPTION : Frame streaming server. Build with -DSTREAM_ENABLED
+ *               to serve the emulator screen and take keys from the
+ *               clients, the hooks are compiled out otherwise.
+ *
+ *               Protocol, integers are little endian:
+ *               - server hello: 'H', version (1), machines (2)
+ *               - server frame: 'F', flags (1), machine (2),
+ *                 frame (4), length (4), then length bytes: width
+ *                 (1), height (1) and runs of plane (1), row (1),
+ *                 first byte (1), count (1), count bytes XORed on
+ *                 the row. Rows are 16 bytes, pixel 0 is the most
+ *                 significant bit of byte 0. Keyframes have flag
+ *                 STREAM_FLAG_KEYFRAME and apply on a clear screen.
+ *               - client subscribe: 'S', machine (2)
+ *               - client key: 'K', machine (2), key (1), down (1)
+ *
+ ******************************************************************/
+#ifndef STREAM_H_
+#define STREAM_H_
+
+/******************************************************************
+ * 1. Included files (microcontroller ones then user defined ones)
+ ******************************************************************/
+#include "../headers/typedef.h"
+#include "../display/display.h"
+
+/******************************************************************
+ * 2. Define declarations (macros then function macros)
+ ******************************************************************/
+/* "unix:PATH" or "tcp:HOST:PORT" */
+#define STREAM_ADDRESS                          "tcp:127.0.0.1:8008"
+
+#define STREAM_VERSION                                            1U
+#define STREAM_FLAG_KEYFRAME                                      1U
+
+#ifdef STREAM_ENABLED
+#define STREAM_START()             (void)StreamOpen(STREAM_ADDRESS, 1U)
+#define STREAM_FRAME(screen)       StreamPublish(0U, screen)
+#define STREAM_STOP()              StreamClose()
+#else
+#define STREAM_START()
+#define STREAM_FRAME(screen)
+#define STREAM_STOP()
+#endif
+
+/******************************************************************
+ * 3. Typedef definitions (simple typedef, then enum and structs)
+ ******************************************************************/
+
+/******************************************************************
+ * 4. Variable definitions (static then global)
+ ******************************************************************/
+
+/******************************************************************
+ * 5. Functions prototypes (static only)
+ ******************************************************************/
+extern Std_ReturnType StreamOpen(const char *address, U32 machines);
+extern void StreamPublish(U32 machine, const displayScreenType *screen);
+extern const BOOL * StreamKeys(U32 machine);
+extern void StreamClose(void);
+
+#endif /* STREAM_H_ */
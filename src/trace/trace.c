@@ -0,0 +1,504 @@
+/******************************************************************
+ *
+ *
+ * FILE        : trace.c
+ * PROJECT     : chip8
+ * AUTHOR      : danpham
+ * DESCRIPTION : Binary instruction trace writer.
+ *
+ *               Each emulating thread owns a stream: records are
+ *               appended to the current block of a ring of blocks
+ *               without any lock. Full blocks are published with an
+ *               atomic head index; a single background thread
+ *               compresses and writes them, then releases them with
+ *               an atomic tail index.
+ *
+ ******************************************************************/
+
+/******************************************************************
+ * 1. Included files (microcontroller ones then user defined ones)
+ ******************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <SDL2/SDL.h>
+#include "trace.h"
+#include "tracefile.h"
+
+/******************************************************************
+ * 2. Define declarations (macros then function macros)
+ ******************************************************************/
+#define TRACE_MAX_STREAMS                                         8U
+#define TRACE_BLOCKS_PER_STREAM                                   8U
+#define TRACE_WRITER_PERIOD_MS                                   10U
+
+/******************************************************************
+ * 3. Typedef definitions (simple typedef, then enum and structs)
+ ******************************************************************/
+typedef struct
+{
+    /* Shared between the emulating thread and the writer */
+    SDL_atomic_t head;                  /* Blocks published */
+    SDL_atomic_t tail;                  /* Blocks written */
+    SDL_atomic_t closed;
+    U8 *blocks[TRACE_BLOCKS_PER_STREAM];
+    traceBlockHeaderType headers[TRACE_BLOCKS_PER_STREAM];
+
+    /* Emulating thread only */
+    U64 instructions;
+    U32 records;
+    U32 size;
+    traceRecordType pending;
+    U8 registers[TRACEFILE_REGISTERS];
+    U16 i;
+
+    /* Writer thread only */
+    FILE *file;
+    U8 *compressed;
+    traceIndexEntryType *index;
+    U32 blockCount;
+    U32 indexCapacity;
+} traceStreamType;
+
+typedef struct
+{
+    SDL_Thread *writer;
+    SDL_mutex *mutex;
+    SDL_cond *wakeUp;
+    SDL_atomic_t running;
+    traceStreamType *streams[TRACE_MAX_STREAMS];
+} traceType;
+
+/******************************************************************
+ * 4. Variable definitions (static then global)
+ ******************************************************************/
+static traceType s_trace;
+
+/* Stream of the calling thread */
+static __thread traceStreamType *s_stream;
+
+/******************************************************************
+ * 5. Functions prototypes (static only)
+ ******************************************************************/
+static int traceWriter(void *data);
+static BOOL traceDrain(traceStreamType *stream);
+static void tracePublish(traceStreamType *stream);
+static void traceFree(traceStreamType *stream);
+
+/******************************************************************
+ * FUNCTION : TraceInit()
+ *    Description: Start the background writer
+ *    Parameters:  None
+ *    Return:      E_OK if the writer runs, E_NOT_OK otherwise
+ ******************************************************************/
+Std_ReturnType TraceInit(void)
+{
+    if (NULL != s_trace.writer)
+    {
+        return E_OK;
+    }
+
+    s_trace.mutex = SDL_CreateMutex();
+    s_trace.wakeUp = SDL_CreateCond();
+    SDL_AtomicSet(&s_trace.running, 1);
+
+    if ((NULL == s_trace.mutex) || (NULL == s_trace.wakeUp))
+    {
+        return E_NOT_OK;
+    }
+
+    s_trace.writer = SDL_CreateThread(traceWriter, "trace writer", NULL);
+
+    return (NULL != s_trace.writer) ? E_OK : E_NOT_OK;
+}
+
+/******************************************************************
+ * FUNCTION : TraceOpen()
+ *    Description: Start tracing the calling thread into a file
+ *    Parameters:  path: trace file
+ *    Return:      E_OK if tracing, E_NOT_OK otherwise
+ ******************************************************************/
+Std_ReturnType TraceOpen(const char *path)
+{
+    traceStreamType *stream;
+    Std_ReturnType returnValue = E_NOT_OK;
+    U8 i;
+
+    if ((NULL == s_trace.writer) || (NULL != s_stream))
+    {
+        return E_NOT_OK;
+    }
+
+    stream = (traceStreamType *)calloc(1U, sizeof(traceStreamType));
+    if (NULL == stream)
+    {
+        return E_NOT_OK;
+    }
+
+    stream->compressed = (U8 *)malloc(TRACEFILE_COMPRESS_BOUND(TRACEFILE_BLOCK_MAX_SIZE));
+    stream->file = fopen(path, "wb");
+    returnValue = ((NULL != stream->compressed) && (NULL != stream->file)) ? E_OK : E_NOT_OK;
+
+    for (i = 0U; (i < TRACE_BLOCKS_PER_STREAM) && (E_OK == returnValue); i++)
+    {
+        stream->blocks[i] = (U8 *)malloc(TRACEFILE_BLOCK_MAX_SIZE);
+        if (NULL == stream->blocks[i])
+        {
+            returnValue = E_NOT_OK;
+        }
+    }
+
+    if (E_OK == returnValue)
+    {
+        returnValue = TraceFileWriteHeader(stream->file);
+    }
+
+    if (E_OK == returnValue)
+    {
+        returnValue = E_NOT_OK;
+
+        SDL_LockMutex(s_trace.mutex);
+        for (i = 0U; i < TRACE_MAX_STREAMS; i++)
+        {
+            if (NULL == s_trace.streams[i])
+            {
+                s_trace.streams[i] = stream;
+                returnValue = E_OK;
+                break;
+            }
+        }
+        SDL_UnlockMutex(s_trace.mutex);
+    }
+
+    if (E_OK == returnValue)
+    {
+        s_stream = stream;
+    }
+    else
+    {
+        printf("Unable to open trace %s", path);
+        traceFree(stream);
+    }
+
+    return returnValue;
+}
+
+/******************************************************************
+ * FUNCTION : TraceBegin()
+ *    Description: Remember state before an instruction executes
+ *    Parameters:  pc, opCode: instruction
+ *                 vx: V registers
+ *                 i: I register
+ *    Return:      None
+ ******************************************************************/
+void TraceBegin(U16 pc, U16 opCode, const U8 *vx, U16 i)
+{
+    traceStreamType *stream = s_stream;
+
+    if (NULL != stream)
+    {
+        stream->pending.pc = pc;
+        stream->pending.opCode = opCode;
+        stream->pending.flags = 0U;
+        (void)memcpy(stream->registers, vx, TRACEFILE_REGISTERS);
+        stream->i = i;
+    }
+}
+
+/******************************************************************
+ * FUNCTION : TraceMemory()
+ *    Description: Record a memory write of the current instruction
+ *    Parameters:  address: first byte written
+ *                 data, count: written bytes
+ *    Return:      None
+ ******************************************************************/
+void TraceMemory(U16 address, const U8 *data, U8 count)
+{
+    traceStreamType *stream = s_stream;
+
+    if (NULL != stream)
+    {
+        if (count > TRACEFILE_MEMORY_MAX)
+        {
+            count = TRACEFILE_MEMORY_MAX;
+        }
+
+        stream->pending.flags |= TRACEFILE_FLAG_MEMORY;
+        stream->pending.memoryAddress = address;
+        stream->pending.memoryCount = count;
+        (void)memcpy(stream->pending.memory, data, count);
+    }
+}
+
+/******************************************************************
+ * FUNCTION : TraceEnd()
+ *    Description: Append the record of the executed instruction
+ *    Parameters:  vx: V registers after execution
+ *                 i: I register after execution
+ *    Return:      None
+ ******************************************************************/
+void TraceEnd(const U8 *vx, U16 i)
+{
+    traceStreamType *stream = s_stream;
+    traceRecordType *record;
+    U8 reg;
+
+    if (NULL == stream)
+    {
+        return;
+    }
+
+    record = &stream->pending;
+    record->registerMask = 0U;
+
+    for (reg = 0U; reg < TRACEFILE_REGISTERS; reg++)
+    {
+        if (vx[reg] != stream->registers[reg])
+        {
+            record->registerMask |= (U16)(1U << reg);
+            record->registers[reg] = vx[reg];
+        }
+    }
+
+    if (0U != record->registerMask)
+    {
+        record->flags |= TRACEFILE_FLAG_REGISTERS;
+    }
+
+    if (i != stream->i)
+    {
+        record->flags |= TRACEFILE_FLAG_I;
+        record->i = i;
+    }
+
+    stream->size += TraceFileEncodeRecord(record, &stream->blocks[SDL_AtomicGet(&stream->head) % TRACE_BLOCKS_PER_STREAM][stream->size]);
+    stream->records++;
+    stream->instructions++;
+
+    if (stream->records == TRACEFILE_BLOCK_RECORDS)
+    {
+        tracePublish(stream);
+    }
+}
+
+/******************************************************************
+ * FUNCTION : TraceClose()
+ *    Description: Stop tracing the calling thread. The writer
+ *                 flushes the last block, writes the index and
+ *                 closes the file.
+ *    Parameters:  None
+ *    Return:      None
+ ******************************************************************/
+void TraceClose(void)
+{
+    traceStreamType *stream = s_stream;
+
+    if (NULL != stream)
+    {
+        if (stream->records > 0U)
+        {
+            tracePublish(stream);
+        }
+
+        s_stream = NULL;
+        SDL_AtomicSet(&stream->closed, 1);
+        SDL_CondSignal(s_trace.wakeUp);
+    }
+}
+
+/******************************************************************
+ * FUNCTION : TraceExit()
+ *    Description: Write every pending block then stop the writer
+ *    Parameters:  None
+ *    Return:      None
+ ******************************************************************/
+void TraceExit(void)
+{
+    if (NULL != s_trace.writer)
+    {
+        SDL_AtomicSet(&s_trace.running, 0);
+        SDL_CondSignal(s_trace.wakeUp);
+        SDL_WaitThread(s_trace.writer, NULL);
+
+        SDL_DestroyCond(s_trace.wakeUp);
+        SDL_DestroyMutex(s_trace.mutex);
+        (void)memset(&s_trace, 0U, sizeof(traceType));
+    }
+}
+
+/******************************************************************
+ * FUNCTION : tracePublish()
+ *    Description: Hand the current block to the writer and wait
+ *                 for a free one if the ring is full
+ *    Parameters:  stream: stream of the calling thread
+ *    Return:      None
+ ******************************************************************/
+static void tracePublish(traceStreamType *stream)
+{
+    int head = SDL_AtomicGet(&stream->head);
+    traceBlockHeaderType *header = &stream->headers[head % TRACE_BLOCKS_PER_STREAM];
+
+    header->firstInstruction = stream->instructions - stream->records;
+    header->records = stream->records;
+    header->rawSize = stream->size;
+
+    /* Block content is visible before the new head */
+    SDL_MemoryBarrierRelease();
+    SDL_AtomicSet(&stream->head, head + 1);
+    SDL_CondSignal(s_trace.wakeUp);
+
+    stream->records = 0U;
+    stream->size = 0U;
+
+    /* Ring full: the writer is behind */
+    while ((SDL_AtomicGet(&stream->head) - SDL_AtomicGet(&stream->tail)) >= (int)TRACE_BLOCKS_PER_STREAM)
+    {
+        SDL_CondSignal(s_trace.wakeUp);
+        SDL_Delay(1U);
+    }
+}
+
+/******************************************************************
+ * FUNCTION : traceDrain()
+ *    Description: Compress and write published blocks of a stream
+ *    Parameters:  stream: stream to drain
+ *    Return:      TRUE if at least one block was written
+ ******************************************************************/
+static BOOL traceDrain(traceStreamType *stream)
+{
+    traceBlockHeaderType *header;
+    traceIndexEntryType *index;
+    int tail = SDL_AtomicGet(&stream->tail);
+    BOOL written = FALSE;
+
+    while (tail != SDL_AtomicGet(&stream->head))
+    {
+        SDL_MemoryBarrierAcquire();
+
+        header = &stream->headers[tail % TRACE_BLOCKS_PER_STREAM];
+        header->compressedSize = TraceFileCompress(stream->blocks[tail % TRACE_BLOCKS_PER_STREAM], header->rawSize, stream->compressed);
+
+        if (stream->blockCount == stream->indexCapacity)
+        {
+            stream->indexCapacity = (stream->indexCapacity == 0U) ? 256U : (stream->indexCapacity * 2U);
+            index = (traceIndexEntryType *)realloc(stream->index, stream->indexCapacity * sizeof(traceIndexEntryType));
+
+            if (NULL != index)
+            {
+                stream->index = index;
+            }
+        }
+
+        if (stream->blockCount < stream->indexCapacity)
+        {
+            stream->index[stream->blockCount].firstInstruction = header->firstInstruction;
+            stream->index[stream->blockCount].offset = (U64)ftell(stream->file);
+            stream->blockCount++;
+        }
+
+        (void)TraceFileWriteBlock(stream->file, header, stream->compressed);
+
+        tail++;
+        SDL_AtomicSet(&stream->tail, tail);
+        written = TRUE;
+    }
+
+    return written;
+}
+
+/******************************************************************
+ * FUNCTION : traceWriter()
+ *    Description: Background writer thread
+ *    Parameters:  data: unused
+ *    Return:      0
+ ******************************************************************/
+static int traceWriter(void *data)
+{
+    traceStreamType *stream;
+    BOOL running = TRUE;
+    BOOL active;
+    U8 i;
+
+    (void)data;
+
+    while (TRUE == running)
+    {
+        running = (0 != SDL_AtomicGet(&s_trace.running)) ? TRUE : FALSE;
+        active = FALSE;
+
+        for (i = 0U; i < TRACE_MAX_STREAMS; i++)
+        {
+            SDL_LockMutex(s_trace.mutex);
+            stream = s_trace.streams[i];
+            SDL_UnlockMutex(s_trace.mutex);
+
+            if (NULL == stream)
+            {
+                continue;
+            }
+
+            /* Read closed first: blocks published before closing are drained */
+            if (0 != SDL_AtomicGet(&stream->closed))
+            {
+                (void)traceDrain(stream);
+                (void)TraceFileWriteIndex(stream->file, stream->index, stream->blockCount);
+
+                SDL_LockMutex(s_trace.mutex);
+                s_trace.streams[i] = NULL;
+                SDL_UnlockMutex(s_trace.mutex);
+
+                traceFree(stream);
+            }
+            else if (TRUE == traceDrain(stream))
+            {
+                active = TRUE;
+            }
+        }
+
+        if ((TRUE == running) && (FALSE == active))
+        {
+            SDL_LockMutex(s_trace.mutex);
+            (void)SDL_CondWaitTimeout(s_trace.wakeUp, s_trace.mutex, TRACE_WRITER_PERIOD_MS);
+            SDL_UnlockMutex(s_trace.mutex);
+        }
+    }
+
+    /* Streams still open at exit are flushed as they are */
+    for (i = 0U; i < TRACE_MAX_STREAMS; i++)
+    {
+        if (NULL != s_trace.streams[i])
+        {
+            (void)traceDrain(s_trace.streams[i]);
+            (void)TraceFileWriteIndex(s_trace.streams[i]->file, s_trace.streams[i]->index, s_trace.streams[i]->blockCount);
+            traceFree(s_trace.streams[i]);
+            s_trace.streams[i] = NULL;
+        }
+    }
+
+    return 0;
+}
+
+/******************************************************************
+ * FUNCTION : traceFree()
+ *    Description: Close the file and release a stream
+ *    Parameters:  stream: stream to release
+ *    Return:      None
+ ******************************************************************/
+static void traceFree(traceStreamType *stream)
+{
+    U8 i;
+
+    if (NULL != stream->file)
+    {
+        fclose(stream->file);
+    }
+
+    for (i = 0U; i < TRACE_BLOCKS_PER_STREAM; i++)
+    {
+        free(stream->blocks[i]);
+    }
+
+    free(stream->compressed);
+    free(stream->index);
+    free(stream);
+}
@@ -0,0 +1,58 @@
+/******************************************************************
+ *
+ *
+ * FILE        : trace.h
+ * PROJECT     : chip8
+ * AUTHOR      : danpham
+ * DESCRIPTION : Binary instruction trace writer. Build with
+ *               -DTRACE_ENABLED to turn the hooks on, they are
+ *               compiled out otherwise.
+ *
+ ******************************************************************/
+#ifndef TRACE_H_
+#define TRACE_H_
+
+/******************************************************************
+ * 1. Included files (microcontroller ones then user defined ones)
+ ******************************************************************/
+#include "../headers/typedef.h"
+
+/******************************************************************
+ * 2. Define declarations (macros then function macros)
+ ******************************************************************/
+#define TRACE_FILE                                   "build/trace.c8t"
+
+#ifdef TRACE_ENABLED
+#define TRACE_START()                         (void)((E_OK == TraceInit()) && (E_OK == TraceOpen(TRACE_FILE)))
+#define TRACE_BEGIN(pc, opCode, vx, i)        TraceBegin((pc), (opCode), (vx), (i))
+#define TRACE_MEMORY(address, data, count)    TraceMemory((address), (data), (count))
+#define TRACE_END(vx, i)                      TraceEnd((vx), (i))
+#define TRACE_STOP()                          do { TraceClose(); TraceExit(); } while (0)
+#else
+#define TRACE_START()
+#define TRACE_BEGIN(pc, opCode, vx, i)
+#define TRACE_MEMORY(address, data, count)
+#define TRACE_END(vx, i)
+#define TRACE_STOP()
+#endif
+
+/******************************************************************
+ * 3. Typedef definitions (simple typedef, then enum and structs)
+ ******************************************************************/
+
+/******************************************************************
+ * 4. Variable definitions (static then global)
+ ******************************************************************/
+
+/******************************************************************
+ * 5. Functions prototypes (static only)
+ ******************************************************************/
+extern Std_ReturnType TraceInit(void);
+extern Std_ReturnType TraceOpen(const char *path);
+extern void TraceBegin(U16 pc, U16 opCode, const U8 *vx, U16 i);
+extern void TraceMemory(U16 address, const U8 *data, U8 count);
+extern void TraceEnd(const U8 *vx, U16 i);
+extern void TraceClose(void);
+extern void TraceExit(void);
+
+#endif /* TRACE_H_ */
@@ -0,0 +1,746 @@
+/******************************************************************
+ *
+ *
+ * FILE        : tracefile.c
+ * PROJECT     : chip8
+ * AUTHOR      : danpham
+ * DESCRIPTION : Instruction trace file format, shared by the trace
+ *               writer and the trace reader
+ *
+ ******************************************************************/
+
+/******************************************************************
+ * 1. Included files (microcontroller ones then user defined ones)
+ ******************************************************************/
+#include <stdlib.h>
+#include <string.h>
+#include "tracefile.h"
+
+/******************************************************************
+ * 2. Define declarations (macros then function macros)
+ ******************************************************************/
+#define TRACEFILE_MAGIC                                      "C8TR"
+#define TRACEFILE_INDEX_MAGIC                                "C8IX"
+#define TRACEFILE_MAGIC_SIZE                                      4U
+
+/* Compression: LZ77 sequences of literals then a back reference */
+#define TRACEFILE_HASH_BITS                                      12U
+#define TRACEFILE_HASH_SIZE                  (1U << TRACEFILE_HASH_BITS)
+#define TRACEFILE_MIN_MATCH                                       4U
+#define TRACEFILE_MAX_OFFSET                                  65535U
+#define TRACEFILE_TOKEN_MAX                                      15U
+
+/******************************************************************
+ * 3. Typedef definitions (simple typedef, then enum and structs)
+ ******************************************************************/
+
+/******************************************************************
+ * 4. Variable definitions (static then global)
+ ******************************************************************/
+
+/******************************************************************
+ * 5. Functions prototypes (static only)
+ ******************************************************************/
+static void tracefilePut16(U8 *buffer, U16 value);
+static void tracefilePut32(U8 *buffer, U32 value);
+static void tracefilePut64(U8 *buffer, U64 value);
+static U16 tracefileGet16(const U8 *buffer);
+static U32 tracefileGet32(const U8 *buffer);
+static U64 tracefileGet64(const U8 *buffer);
+static U32 tracefileRead32(const U8 *buffer);
+static U8 * tracefilePutLength(U8 *output, U32 length);
+static Std_ReturnType tracefileScanBlocks(traceFileType *trace);
+
+/******************************************************************
+ * FUNCTION : TraceFileEncodeRecord()
+ *    Description: Serialize one instruction record
+ *    Parameters:  record: record to write
+ *                 buffer: output, TRACEFILE_RECORD_MAX_SIZE bytes
+ *    Return:      Number of bytes written
+ ******************************************************************/
+U32 TraceFileEncodeRecord(const traceRecordType *record, U8 *buffer)
+{
+    U32 size = 5U;
+    U8 i;
+
+    tracefilePut16(&buffer[0U], record->pc);
+    tracefilePut16(&buffer[2U], record->opCode);
+    buffer[4U] = record->flags;
+
+    if (record->flags & TRACEFILE_FLAG_REGISTERS)
+    {
+        tracefilePut16(&buffer[size], record->registerMask);
+        size += 2U;
+
+        for (i = 0U; i < TRACEFILE_REGISTERS; i++)
+        {
+            if (record->registerMask & (1U << i))
+            {
+                buffer[size] = record->registers[i];
+                size++;
+            }
+        }
+    }
+
+    if (record->flags & TRACEFILE_FLAG_I)
+    {
+        tracefilePut16(&buffer[size], record->i);
+        size += 2U;
+    }
+
+    if (record->flags & TRACEFILE_FLAG_MEMORY)
+    {
+        tracefilePut16(&buffer[size], record->memoryAddress);
+        buffer[size + 2U] = record->memoryCount;
+        (void)memcpy(&buffer[size + 3U], record->memory, record->memoryCount);
+        size += 3U + record->memoryCount;
+    }
+
+    return size;
+}
+
+/******************************************************************
+ * FUNCTION : TraceFileDecodeRecord()
+ *    Description: Parse one instruction record
+ *    Parameters:  buffer, size: remaining bytes of a block
+ *                 record: output
+ *    Return:      Number of bytes read, 0 if the record is invalid
+ ******************************************************************/
+U32 TraceFileDecodeRecord(const U8 *buffer, U32 size, traceRecordType *record)
+{
+    U32 position = 5U;
+    U8 i;
+
+    if (size < position)
+    {
+        return 0U;
+    }
+
+    (void)memset(record, 0U, sizeof(traceRecordType));
+    record->pc = tracefileGet16(&buffer[0U]);
+    record->opCode = tracefileGet16(&buffer[2U]);
+    record->flags = buffer[4U];
+
+    if (record->flags & TRACEFILE_FLAG_REGISTERS)
+    {
+        if (size < (position + 2U))
+        {
+            return 0U;
+        }
+        record->registerMask = tracefileGet16(&buffer[position]);
+        position += 2U;
+
+        for (i = 0U; i < TRACEFILE_REGISTERS; i++)
+        {
+            if (record->registerMask & (1U << i))
+            {
+                if (size <= position)
+                {
+                    return 0U;
+                }
+                record->registers[i] = buffer[position];
+                position++;
+            }
+        }
+    }
+
+    if (record->flags & TRACEFILE_FLAG_I)
+    {
+        if (size < (position + 2U))
+        {
+            return 0U;
+        }
+        record->i = tracefileGet16(&buffer[position]);
+        position += 2U;
+    }
+
+    if (record->flags & TRACEFILE_FLAG_MEMORY)
+    {
+        if (size < (position + 3U))
+        {
+            return 0U;
+        }
+        record->memoryAddress = tracefileGet16(&buffer[position]);
+        record->memoryCount = buffer[position + 2U];
+        position += 3U;
+
+        if ((record->memoryCount > TRACEFILE_MEMORY_MAX) || (size < (position + record->memoryCount)))
+        {
+            return 0U;
+        }
+        (void)memcpy(record->memory, &buffer[position], record->memoryCount);
+        position += record->memoryCount;
+    }
+
+    return position;
+}
+
+/******************************************************************
+ * FUNCTION : TraceFileCompress()
+ *    Description: Compress a block. Each sequence is a token
+ *                 (literal length << 4 | match length - 4), the
+ *                 literals, then a 16 bits back offset; lengths
+ *                 of 15 continue on extra bytes. The last
+ *                 sequence has literals only.
+ *    Parameters:  source, size: raw bytes
+ *                 destination: TRACEFILE_COMPRESS_BOUND(size) bytes
+ *    Return:      Compressed size
+ ******************************************************************/
+U32 TraceFileCompress(const U8 *source, U32 size, U8 *destination)
+{
+    /* Only the trace writer thread compresses */
+    static U32 s_table[TRACEFILE_HASH_SIZE];
+    U8 *output = destination;
+    U8 *token;
+    U32 anchor = 0U;
+    U32 position = 0U;
+    U32 reference;
+    U32 hash;
+    U32 literals;
+    U32 match;
+
+    (void)memset(s_table, 0xFF, sizeof(s_table));
+
+    while ((position + TRACEFILE_MIN_MATCH) <= size)
+    {
+        hash = ((tracefileRead32(&source[position]) * 2654435761UL) & 0xFFFFFFFFUL) >> (32U - TRACEFILE_HASH_BITS);
+        reference = s_table[hash];
+        s_table[hash] = position;
+
+        if ((reference < position) && ((position - reference) <= TRACEFILE_MAX_OFFSET)
+            && (tracefileRead32(&source[reference]) == tracefileRead32(&source[position])))
+        {
+            match = TRACEFILE_MIN_MATCH;
+            while (((position + match) < size) && (source[reference + match] == source[position + match]))
+            {
+                match++;
+            }
+
+            literals = position - anchor;
+            token = output++;
+            *token = (U8)(((literals < TRACEFILE_TOKEN_MAX) ? literals : TRACEFILE_TOKEN_MAX) << 4U);
+            if (literals >= TRACEFILE_TOKEN_MAX)
+            {
+                output = tracefilePutLength(output, literals - TRACEFILE_TOKEN_MAX);
+            }
+            (void)memcpy(output, &source[anchor], literals);
+            output += literals;
+
+            tracefilePut16(output, (U16)(position - reference));
+            output += 2U;
+
+            *token |= (U8)(((match - TRACEFILE_MIN_MATCH) < TRACEFILE_TOKEN_MAX) ? (match - TRACEFILE_MIN_MATCH) : TRACEFILE_TOKEN_MAX);
+            if ((match - TRACEFILE_MIN_MATCH) >= TRACEFILE_TOKEN_MAX)
+            {
+                output = tracefilePutLength(output, match - TRACEFILE_MIN_MATCH - TRACEFILE_TOKEN_MAX);
+            }
+
+            position += match;
+            anchor = position;
+        }
+        else
+        {
+            position++;
+        }
+    }
+
+    /* Last literals */
+    literals = size - anchor;
+    token = output++;
+    *token = (U8)(((literals < TRACEFILE_TOKEN_MAX) ? literals : TRACEFILE_TOKEN_MAX) << 4U);
+    if (literals >= TRACEFILE_TOKEN_MAX)
+    {
+        output = tracefilePutLength(output, literals - TRACEFILE_TOKEN_MAX);
+    }
+    (void)memcpy(output, &source[anchor], literals);
+    output += literals;
+
+    return (U32)(output - destination);
+}
+
+/******************************************************************
+ * FUNCTION : TraceFileDecompress()
+ *    Description: Inflate a block compressed by
+ *                 TraceFileCompress()
+ *    Parameters:  source, size: compressed bytes
+ *                 destination, rawSize: expected output
+ *    Return:      E_OK if the block is well formed, E_NOT_OK
+ *                 otherwise.
+ ******************************************************************/
+Std_ReturnType TraceFileDecompress(const U8 *source, U32 size, U8 *destination, U32 rawSize)
+{
+    U32 input = 0U;
+    U32 output = 0U;
+    U32 length;
+    U32 offset;
+    U8 token;
+    U8 extra;
+
+    while (input < size)
+    {
+        token = source[input++];
+
+        /* Literals */
+        length = token >> 4U;
+        if (length == TRACEFILE_TOKEN_MAX)
+        {
+            do
+            {
+                if (input >= size)
+                {
+                    return E_NOT_OK;
+                }
+                extra = source[input++];
+                length += extra;
+            } while (extra == 255U);
+        }
+
+        if (((input + length) > size) || ((output + length) > rawSize))
+        {
+            return E_NOT_OK;
+        }
+        (void)memcpy(&destination[output], &source[input], length);
+        input += length;
+        output += length;
+
+        if (input == size)
+        {
+            break;
+        }
+
+        /* Back reference */
+        if ((input + 2U) > size)
+        {
+            return E_NOT_OK;
+        }
+        offset = tracefileGet16(&source[input]);
+        input += 2U;
+
+        length = (token & 0x0FU) + TRACEFILE_MIN_MATCH;
+        if ((token & 0x0FU) == TRACEFILE_TOKEN_MAX)
+        {
+            do
+            {
+                if (input >= size)
+                {
+                    return E_NOT_OK;
+                }
+                extra = source[input++];
+                length += extra;
+            } while (extra == 255U);
+        }
+
+        if ((offset == 0U) || (offset > output) || ((output + length) > rawSize))
+        {
+            return E_NOT_OK;
+        }
+
+        /* Byte copy, the reference may overlap the output */
+        while (length > 0U)
+        {
+            destination[output] = destination[output - offset];
+            output++;
+            length--;
+        }
+    }
+
+    return (output == rawSize) ? E_OK : E_NOT_OK;
+}
+
+/******************************************************************
+ * FUNCTION : TraceFileWriteHeader()
+ *    Description: Write the file header
+ *    Parameters:  file: output file
+ *    Return:      E_OK if written, E_NOT_OK otherwise
+ ******************************************************************/
+Std_ReturnType TraceFileWriteHeader(FILE *file)
+{
+    U8 header[TRACEFILE_HEADER_SIZE];
+
+    (void)memcpy(header, TRACEFILE_MAGIC, TRACEFILE_MAGIC_SIZE);
+    tracefilePut16(&header[4U], TRACEFILE_VERSION);
+    tracefilePut16(&header[6U], TRACEFILE_BLOCK_RECORDS);
+
+    return (fwrite(header, 1U, sizeof(header), file) == sizeof(header)) ? E_OK : E_NOT_OK;
+}
+
+/******************************************************************
+ * FUNCTION : TraceFileWriteBlock()
+ *    Description: Write a block header and its compressed records
+ *    Parameters:  file: output file
+ *                 header: block description
+ *                 compressed: header->compressedSize bytes
+ *    Return:      E_OK if written, E_NOT_OK otherwise
+ ******************************************************************/
+Std_ReturnType TraceFileWriteBlock(FILE *file, const traceBlockHeaderType *header, const U8 *compressed)
+{
+    U8 buffer[TRACEFILE_BLOCK_HEADER_SIZE];
+    Std_ReturnType returnValue = E_OK;
+
+    tracefilePut64(&buffer[0U], header->firstInstruction);
+    tracefilePut32(&buffer[8U], header->records);
+    tracefilePut32(&buffer[12U], header->rawSize);
+    tracefilePut32(&buffer[16U], header->compressedSize);
+
+    if ((fwrite(buffer, 1U, sizeof(buffer), file) != sizeof(buffer))
+        || (fwrite(compressed, 1U, header->compressedSize, file) != header->compressedSize))
+    {
+        returnValue = E_NOT_OK;
+    }
+
+    return returnValue;
+}
+
+/******************************************************************
+ * FUNCTION : TraceFileWriteIndex()
+ *    Description: Write the block index and the trailer
+ *    Parameters:  file: output file, positioned after last block
+ *                 index, blockCount: one entry per block
+ *    Return:      E_OK if written, E_NOT_OK otherwise
+ ******************************************************************/
+Std_ReturnType TraceFileWriteIndex(FILE *file, const traceIndexEntryType *index, U32 blockCount)
+{
+    U8 buffer[TRACEFILE_INDEX_ENTRY_SIZE];
+    U64 indexOffset = (U64)ftell(file);
+    U32 i;
+
+    for (i = 0U; i < blockCount; i++)
+    {
+        tracefilePut64(&buffer[0U], index[i].firstInstruction);
+        tracefilePut64(&buffer[8U], index[i].offset);
+
+        if (fwrite(buffer, 1U, sizeof(buffer), file) != sizeof(buffer))
+        {
+            return E_NOT_OK;
+        }
+    }
+
+    tracefilePut64(&buffer[0U], indexOffset);
+    tracefilePut32(&buffer[8U], blockCount);
+    (void)memcpy(&buffer[12U], TRACEFILE_INDEX_MAGIC, TRACEFILE_MAGIC_SIZE);
+
+    return (fwrite(buffer, 1U, TRACEFILE_TRAILER_SIZE, file) == TRACEFILE_TRAILER_SIZE) ? E_OK : E_NOT_OK;
+}
+
+/******************************************************************
+ * FUNCTION : TraceFileOpen()
+ *    Description: Open a trace and load its block index, from the
+ *                 trailer or by walking the block headers
+ *    Parameters:  trace: reader state
+ *                 path: trace file
+ *    Return:      E_OK if the trace is readable, E_NOT_OK
+ *                 otherwise.
+ ******************************************************************/
+Std_ReturnType TraceFileOpen(traceFileType *trace, const char *path)
+{
+    U8 buffer[TRACEFILE_INDEX_ENTRY_SIZE];
+    traceBlockHeaderType header;
+    U64 indexOffset;
+    U32 i;
+    Std_ReturnType returnValue = E_NOT_OK;
+
+    (void)memset(trace, 0U, sizeof(traceFileType));
+
+    if (NULL == (trace->file = fopen(path, "rb")))
+    {
+        return E_NOT_OK;
+    }
+
+    if ((fread(buffer, 1U, TRACEFILE_HEADER_SIZE, trace->file) != TRACEFILE_HEADER_SIZE)
+        || (0 != memcmp(buffer, TRACEFILE_MAGIC, TRACEFILE_MAGIC_SIZE))
+        || (tracefileGet16(&buffer[4U]) != TRACEFILE_VERSION))
+    {
+        TraceFileClose(trace);
+        return E_NOT_OK;
+    }
+
+    /* Index written on close */
+    if ((0 == fseek(trace->file, -(long)TRACEFILE_TRAILER_SIZE, SEEK_END))
+        && (fread(buffer, 1U, TRACEFILE_TRAILER_SIZE, trace->file) == TRACEFILE_TRAILER_SIZE)
+        && (0 == memcmp(&buffer[12U], TRACEFILE_INDEX_MAGIC, TRACEFILE_MAGIC_SIZE)))
+    {
+        indexOffset = tracefileGet64(&buffer[0U]);
+        trace->blockCount = tracefileGet32(&buffer[8U]);
+        trace->index = (traceIndexEntryType *)calloc(trace->blockCount + 1U, sizeof(traceIndexEntryType));
+
+        if ((NULL != trace->index) && (0 == fseek(trace->file, (long)indexOffset, SEEK_SET)))
+        {
+            returnValue = E_OK;
+
+            for (i = 0U; (i < trace->blockCount) && (E_OK == returnValue); i++)
+            {
+                if (fread(buffer, 1U, TRACEFILE_INDEX_ENTRY_SIZE, trace->file) == TRACEFILE_INDEX_ENTRY_SIZE)
+                {
+                    trace->index[i].firstInstruction = tracefileGet64(&buffer[0U]);
+                    trace->index[i].offset = tracefileGet64(&buffer[8U]);
+                }
+                else
+                {
+                    returnValue = E_NOT_OK;
+                }
+            }
+        }
+    }
+
+    if (E_OK != returnValue)
+    {
+        /* Unterminated trace, e.g. emulator killed */
+        free(trace->index);
+        trace->index = NULL;
+        returnValue = tracefileScanBlocks(trace);
+    }
+
+    if ((E_OK == returnValue) && (trace->blockCount > 0U))
+    {
+        /* Total instruction count from the last block header */
+        if (E_OK == TraceFileReadBlock(trace, trace->blockCount - 1U, &header, NULL))
+        {
+            trace->instructions = header.firstInstruction + header.records;
+        }
+    }
+
+    if (E_OK != returnValue)
+    {
+        TraceFileClose(trace);
+    }
+
+    return returnValue;
+}
+
+/******************************************************************
+ * FUNCTION : TraceFileReadBlock()
+ *    Description: Read one block header and inflate its records
+ *    Parameters:  trace: reader state
+ *                 block: block number
+ *                 header: output
+ *                 raw: output, TRACEFILE_BLOCK_MAX_SIZE bytes, or
+ *                      NULL to read the header only
+ *    Return:      E_OK if the block is valid, E_NOT_OK otherwise
+ ******************************************************************/
+Std_ReturnType TraceFileReadBlock(traceFileType *trace, U32 block, traceBlockHeaderType *header, U8 *raw)
+{
+    U8 buffer[TRACEFILE_BLOCK_HEADER_SIZE];
+    U8 *compressed;
+    Std_ReturnType returnValue = E_NOT_OK;
+
+    if ((block >= trace->blockCount)
+        || (0 != fseek(trace->file, (long)trace->index[block].offset, SEEK_SET))
+        || (fread(buffer, 1U, sizeof(buffer), trace->file) != sizeof(buffer)))
+    {
+        return E_NOT_OK;
+    }
+
+    header->firstInstruction = tracefileGet64(&buffer[0U]);
+    header->records = tracefileGet32(&buffer[8U]);
+    header->rawSize = tracefileGet32(&buffer[12U]);
+    header->compressedSize = tracefileGet32(&buffer[16U]);
+
+    if ((header->rawSize > TRACEFILE_BLOCK_MAX_SIZE) || (header->compressedSize > TRACEFILE_COMPRESS_BOUND(TRACEFILE_BLOCK_MAX_SIZE)))
+    {
+        return E_NOT_OK;
+    }
+
+    if (NULL == raw)
+    {
+        return E_OK;
+    }
+
+    compressed = (U8 *)malloc(header->compressedSize + 1U);
+
+    if ((NULL != compressed) && (fread(compressed, 1U, header->compressedSize, trace->file) == header->compressedSize))
+    {
+        returnValue = TraceFileDecompress(compressed, header->compressedSize, raw, header->rawSize);
+    }
+
+    free(compressed);
+
+    return returnValue;
+}
+
+/******************************************************************
+ * FUNCTION : TraceFileFindBlock()
+ *    Description: Binary search of the block holding an
+ *                 instruction
+ *    Parameters:  trace: reader state
+ *                 instruction: instruction number, from 0
+ *    Return:      Block number, blockCount if out of the trace
+ ******************************************************************/
+U32 TraceFileFindBlock(const traceFileType *trace, U64 instruction)
+{
+    U32 low = 0U;
+    U32 high = trace->blockCount;
+    U32 middle;
+
+    if (instruction >= trace->instructions)
+    {
+        return trace->blockCount;
+    }
+
+    /* Last block whose first instruction is <= instruction */
+    while ((high - low) > 1U)
+    {
+        middle = low + ((high - low) / 2U);
+
+        if (trace->index[middle].firstInstruction <= instruction)
+        {
+            low = middle;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+
+    return low;
+}
+
+/******************************************************************
+ * FUNCTION : TraceFileClose()
+ *    Description: Release reader state
+ *    Parameters:  trace: reader state
+ *    Return:      None
+ ******************************************************************/
+void TraceFileClose(traceFileType *trace)
+{
+    if (NULL != trace->file)
+    {
+        fclose(trace->file);
+    }
+
+    free(trace->index);
+    (void)memset(trace, 0U, sizeof(traceFileType));
+}
+
+/******************************************************************
+ * FUNCTION : tracefileScanBlocks()
+ *    Description: Rebuild the index by walking block headers,
+ *                 stopping at the first truncated block
+ *    Parameters:  trace: reader state
+ *    Return:      E_OK if the index is built, E_NOT_OK otherwise
+ ******************************************************************/
+static Std_ReturnType tracefileScanBlocks(traceFileType *trace)
+{
+    U8 buffer[TRACEFILE_BLOCK_HEADER_SIZE];
+    U32 capacity = 0U;
+    U64 offset = TRACEFILE_HEADER_SIZE;
+    U64 end;
+    U32 compressedSize;
+    traceIndexEntryType *index;
+
+    if (0 != fseek(trace->file, 0L, SEEK_END))
+    {
+        return E_NOT_OK;
+    }
+    end = (U64)ftell(trace->file);
+
+    trace->blockCount = 0U;
+
+    while (((offset + TRACEFILE_BLOCK_HEADER_SIZE) <= end)
+           && (0 == fseek(trace->file, (long)offset, SEEK_SET))
+           && (fread(buffer, 1U, sizeof(buffer), trace->file) == sizeof(buffer)))
+    {
+        compressedSize = tracefileGet32(&buffer[16U]);
+
+        if ((offset + TRACEFILE_BLOCK_HEADER_SIZE + compressedSize) > end)
+        {
+            break;
+        }
+
+        if (trace->blockCount == capacity)
+        {
+            capacity = (capacity == 0U) ? 64U : (capacity * 2U);
+            index = (traceIndexEntryType *)realloc(trace->index, capacity * sizeof(traceIndexEntryType));
+
+            if (NULL == index)
+            {
+                return E_NOT_OK;
+            }
+            trace->index = index;
+        }
+
+        trace->index[trace->blockCount].firstInstruction = tracefileGet64(&buffer[0U]);
+        trace->index[trace->blockCount].offset = offset;
+        trace->blockCount++;
+
+        offset += TRACEFILE_BLOCK_HEADER_SIZE + compressedSize;
+    }
+
+    return E_OK;
+}
+
+/******************************************************************
+ * FUNCTION : tracefilePutLength()
+ *    Description: Write the extra bytes of a sequence length
+ *    Parameters:  output: destination
+ *                 length: remaining length
+ *    Return:      Position after the written bytes
+ ******************************************************************/
+static U8 * tracefilePutLength(U8 *output, U32 length)
+{
+    while (length >= 255U)
+    {
+        *output++ = 255U;
+        length -= 255U;
+    }
+
+    *output++ = (U8)length;
+
+    return output;
+}
+
+/******************************************************************
+ * FUNCTION : tracefileRead32()
+ *    Description: Native order 32 bits read used for hashing
+ *    Parameters:  buffer: 4 bytes
+ *    Return:      Value
+ ******************************************************************/
+static U32 tracefileRead32(const U8 *buffer)
+{
+    return (U32)buffer[0U] | ((U32)buffer[1U] << 8U) | ((U32)buffer[2U] << 16U) | ((U32)buffer[3U] << 24U);
+}
+
+/******************************************************************
+ * FUNCTION : tracefilePut16() / tracefilePut32() / tracefilePut64()
+ *    Description: Little endian store
+ *    Parameters:  buffer: destination
+ *                 value: value to store
+ *    Return:      None
+ ******************************************************************/
+static void tracefilePut16(U8 *buffer, U16 value)
+{
+    buffer[0U] = (U8)value;
+    buffer[1U] = (U8)(value >> 8U);
+}
+
+static void tracefilePut32(U8 *buffer, U32 value)
+{
+    tracefilePut16(&buffer[0U], (U16)value);
+    tracefilePut16(&buffer[2U], (U16)(value >> 16U));
+}
+
+static void tracefilePut64(U8 *buffer, U64 value)
+{
+    tracefilePut32(&buffer[0U], (U32)value);
+    tracefilePut32(&buffer[4U], (U32)(value >> 32U));
+}
+
+/******************************************************************
+ * FUNCTION : tracefileGet16() / tracefileGet32() / tracefileGet64()
+ *    Description: Little endian load
+ *    Parameters:  buffer: source
+ *    Return:      Value
+ ******************************************************************/
+static U16 tracefileGet16(const U8 *buffer)
+{
+    return (U16)(buffer[0U] | (buffer[1U] << 8U));
+}
+
+static U32 tracefileGet32(const U8 *buffer)
+{
+    return (U32)tracefileGet16(&buffer[0U]) | ((U32)tracefileGet16(&buffer[2U]) << 16U);
+}
+
+static U64 tracefileGet64(const U8 *buffer)
+{
+    return (U64)tracefileGet32(&buffer[0U]) | ((U64)tracefileGet32(&buffer[4U]) << 32U);
+}
@@ -0,0 +1,112 @@
+/******************************************************************
+ *
+ *
+ * FILE        : tracefile.h
+ * PROJECT     : chip8
+ * AUTHOR      : danpham
+ * DESCRIPTION : Instruction trace file format.
+ *
+ *               header : "C8TR", U16 version, U16 block records
+ *               block  : U64 first instruction, U32 records,
+ *                        U32 raw size, U32 compressed size,
+ *                        compressed records
+ *               index  : (U64 first instruction, U64 offset)
+ *                        per block
+ *               trailer: U64 index offset, U32 blocks, "C8IX"
+ *
+ *               Numbers are little endian. Blocks are compressed
+ *               independently so a reader only inflates the block
+ *               holding the instruction it seeks to. The index is
+ *               written on close; without it the block headers
+ *               are walked instead.
+ *
+ ******************************************************************/
+#ifndef TRACEFILE_H_
+#define TRACEFILE_H_
+
+/******************************************************************
+ * 1. Included files (microcontroller ones then user defined ones)
+ ******************************************************************/
+#include <stdio.h>
+#include "../headers/typedef.h"
+
+/******************************************************************
+ * 2. Define declarations (macros then function macros)
+ ******************************************************************/
+#define TRACEFILE_VERSION                                         1U
+#define TRACEFILE_BLOCK_RECORDS                                4096U
+#define TRACEFILE_REGISTERS                                      16U
+#define TRACEFILE_MEMORY_MAX                                     16U
+
+#define TRACEFILE_HEADER_SIZE                                     8U
+#define TRACEFILE_BLOCK_HEADER_SIZE                              20U
+#define TRACEFILE_INDEX_ENTRY_SIZE                               16U
+#define TRACEFILE_TRAILER_SIZE                                   16U
+
+/* pc, opcode, flags, register mask and values, I, memory write */
+#define TRACEFILE_RECORD_MAX_SIZE   (5U + 2U + TRACEFILE_REGISTERS + 2U + 3U + TRACEFILE_MEMORY_MAX)
+#define TRACEFILE_BLOCK_MAX_SIZE    (TRACEFILE_BLOCK_RECORDS * TRACEFILE_RECORD_MAX_SIZE)
+#define TRACEFILE_COMPRESS_BOUND(size)   ((size) + ((size) / 255U) + 16U)
+
+#define TRACEFILE_FLAG_REGISTERS                               0x01U
+#define TRACEFILE_FLAG_I                                       0x02U
+#define TRACEFILE_FLAG_MEMORY                                  0x04U
+
+/******************************************************************
+ * 3. Typedef definitions (simple typedef, then enum and structs)
+ ******************************************************************/
+typedef struct
+{
+    U16 pc;
+    U16 opCode;
+    U8 flags;
+    U16 registerMask;               /* Bit n set when Vn changed */
+    U8 registers[TRACEFILE_REGISTERS];
+    U16 i;
+    U16 memoryAddress;
+    U8 memoryCount;
+    U8 memory[TRACEFILE_MEMORY_MAX];
+} traceRecordType;
+
+typedef struct
+{
+    U64 firstInstruction;
+    U64 offset;
+} traceIndexEntryType;
+
+typedef struct
+{
+    FILE *file;
+    U32 blockCount;
+    traceIndexEntryType *index;
+    U64 instructions;
+} traceFileType;
+
+typedef struct
+{
+    U64 firstInstruction;
+    U32 records;
+    U32 rawSize;
+    U32 compressedSize;
+} traceBlockHeaderType;
+
+/******************************************************************
+ * 4. Variable definitions (static then global)
+ ******************************************************************/
+
+/******************************************************************
+ * 5. Functions prototypes (static only)
+ ******************************************************************/
+extern U32 TraceFileEncodeRecord(const traceRecordType *record, U8 *buffer);
+extern U32 TraceFileDecodeRecord(const U8 *buffer, U32 size, traceRecordType *record);
+extern U32 TraceFileCompress(const U8 *source, U32 size, U8 *destination);
+extern Std_ReturnType TraceFileDecompress(const U8 *source, U32 size, U8 *destination, U32 rawSize);
+extern Std_ReturnType TraceFileWriteHeader(FILE *file);
+extern Std_ReturnType TraceFileWriteBlock(FILE *file, const traceBlockHeaderType *header, const U8 *compressed);
+extern Std_ReturnType TraceFileWriteIndex(FILE *file, const traceIndexEntryType *index, U32 blockCount);
+extern Std_ReturnType TraceFileOpen(traceFileType *trace, const char *path);
+extern Std_ReturnType TraceFileReadBlock(traceFileType *trace, U32 block, traceBlockHeaderType *header, U8 *raw);
+extern U32 TraceFileFindBlock(const traceFileType *trace, U64 instruction);
+extern void TraceFileClose(traceFileType *trace);
+
+#endif /* TRACEFILE_H_ */
@@ -0,0 +1,176 @@
+/******************************************************************
+ *
+ *
+ * FILE        : tracedump.c
+ * PROJECT     : chip8
+ * AUTHOR      : danpham
+ * DESCRIPTION : Print instruction records of a trace file,
+ *               starting at any instruction number
+ *
+ ******************************************************************/
+
+/******************************************************************
+ * 1. Included files (microcontroller ones then user defined ones)
+ ******************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../trace/tracefile.h"
+
+/******************************************************************
+ * 2. Define declarations (macros then function macros)
+ ******************************************************************/
+#define TRACEDUMP_DEFAULT_COUNT                                  32U
+
+/******************************************************************
+ * 3. Typedef definitions (simple typedef, then enum and structs)
+ ******************************************************************/
+
+/******************************************************************
+ * 4. Variable definitions (static then global)
+ ******************************************************************/
+
+/******************************************************************
+ * 5. Functions prototypes (static only)
+ ******************************************************************/
+static void tracedumpPrint(U64 instruction, const traceRecordType *record);
+
+/******************************************************************
+ * FUNCTION : main(int argc, char** argv)
+ *    Description: Usage: tracedump FILE [--from N] [--count M]
+ *                 Only the blocks holding the requested
+ *                 instructions are decompressed.
+ *    Parameters:  None
+ *    Return:      0 on success, 1 otherwise
+ ******************************************************************/
+int main(int argc, char **argv)
+{
+    traceFileType trace;
+    traceBlockHeaderType header;
+    traceRecordType record;
+    U8 *raw;
+    U64 from = 0U;
+    U64 count = TRACEDUMP_DEFAULT_COUNT;
+    U64 instruction;
+    U32 block;
+    U32 position;
+    U32 size;
+    U32 i;
+    int arg;
+    const char *path = NULL;
+    int returnValue = 0;
+
+    for (arg = 1; arg < argc; arg++)
+    {
+        if ((0 == strcmp(argv[arg], "--from")) && ((arg + 1) < argc))
+        {
+            from = strtoull(argv[++arg], NULL, 10);
+        }
+        else if ((0 == strcmp(argv[arg], "--count")) && ((arg + 1) < argc))
+        {
+            count = strtoull(argv[++arg], NULL, 10);
+        }
+        else
+        {
+            path = argv[arg];
+        }
+    }
+
+    if (NULL == path)
+    {
+        printf("Usage: tracedump FILE [--from N] [--count M]\n");
+        return 1;
+    }
+
+    if (E_OK != TraceFileOpen(&trace, path))
+    {
+        printf("Unable to read trace %s\n", path);
+        return 1;
+    }
+
+    printf("%llu instructions in %lu blocks\n", trace.instructions, (unsigned long)trace.blockCount);
+
+    raw = (U8 *)malloc(TRACEFILE_BLOCK_MAX_SIZE);
+    block = TraceFileFindBlock(&trace, from);
+
+    while ((NULL != raw) && (count > 0U) && (block < trace.blockCount))
+    {
+        if (E_OK != TraceFileReadBlock(&trace, block, &header, raw))
+        {
+            printf("Corrupted block %lu\n", (unsigned long)block);
+            returnValue = 1;
+            break;
+        }
+
+        position = 0U;
+        instruction = header.firstInstruction;
+
+        for (i = 0U; (i < header.records) && (count > 0U); i++)
+        {
+            size = TraceFileDecodeRecord(&raw[position], header.rawSize - position, &record);
+
+            if (0U == size)
+            {
+                printf("Corrupted record %llu\n", instruction);
+                returnValue = 1;
+                count = 0U;
+                break;
+            }
+
+            if (instruction >= from)
+            {
+                tracedumpPrint(instruction, &record);
+                count--;
+            }
+
+            position += size;
+            instruction++;
+        }
+
+        block++;
+    }
+
+    free(raw);
+    TraceFileClose(&trace);
+
+    return returnValue;
+}
+
+/******************************************************************
+ * FUNCTION : tracedumpPrint()
+ *    Description: Print one record on one line
+ *    Parameters:  instruction: instruction number
+ *                 record: decoded record
+ *    Return:      None
+ ******************************************************************/
+static void tracedumpPrint(U64 instruction, const traceRecordType *record)
+{
+    U8 i;
+
+    printf("%10llu  %03X  %04X", instruction, record->pc, record->opCode);
+
+    for (i = 0U; i < TRACEFILE_REGISTERS; i++)
+    {
+        if (record->registerMask & (1U << i))
+        {
+            printf("  V%X=%02X", i, record->registers[i]);
+        }
+    }
+
+    if (record->flags & TRACEFILE_FLAG_I)
+    {
+        printf("  I=%03X", record->i);
+    }
+
+    if (record->flags & TRACEFILE_FLAG_MEMORY)
+    {
+        printf("  [%03X]=", record->memoryAddress);
+
+        for (i = 0U; i < record->memoryCount; i++)
+        {
+            printf("%02X", record->memory[i]);
+        }
+    }
+
+    printf("\n");
+}